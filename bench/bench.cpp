@@ -0,0 +1,368 @@
+// Client instrumentation overhead benchmark.
+//
+// Each benchmark emits a single kind of event from 1..N producer threads, while
+// the "Tracy Profiler" thread drains the queues into an in-process sink, which
+// connects to the client as the server would, but only decompresses and discards
+// the received data. Rebuild (after make clean) with TRACYFLAGS=-DTRACY_ON_DEMAND
+// to measure on-demand mode.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "../Tracy.hpp"
+#include "../common/TracyProtocol.hpp"
+#include "../common/TracySocket.hpp"
+#include "../common/TracySystem.hpp"
+#include "../common/tracy_lz4.hpp"
+
+// Every n-th event is individually timed to get the latency distribution.
+enum { LatencySampleRate = 64 };
+
+static std::atomic<bool> s_sinkConnected { false };
+static std::atomic<bool> s_sinkExit { false };
+static std::atomic<uint64_t> s_sinkBytes { 0 };
+
+// Each thread sends a marker message after its events. Thread queues are drained in order, so all events of
+// a thread were sent once its marker is seen in the stream. The system time reports are sent periodically,
+// so the end of the data can't be detected by the lack of it.
+static const char DrainMarker[] = "tracy-bench-drain-marker";
+static std::atomic<uint64_t> s_markersSent { 0 };
+static std::atomic<uint64_t> s_sinkMarkers { 0 };
+static std::atomic<int64_t> s_sinkMarkerTime { 0 };
+
+static int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static void Sink( const char* addr, int port )
+{
+    // Sockets allocate through the profiler allocator.
+    tracy::InitRPMallocThread();
+
+    tracy::Socket sock;
+    while( !sock.Connect( addr, port ) )
+    {
+        if( s_sinkExit.load( std::memory_order_relaxed ) ) return;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    const uint32_t protocolVersion = tracy::ProtocolVersion;
+    sock.Send( tracy::HandshakeShibboleth, tracy::HandshakeShibbolethSize );
+    sock.Send( &protocolVersion, sizeof( protocolVersion ) );
+
+    auto ShouldExit = [] { return s_sinkExit.load( std::memory_order_relaxed ); };
+
+    tracy::HandshakeStatus handshake;
+    if( !sock.Read( &handshake, sizeof( handshake ), 10, ShouldExit ) || handshake != tracy::HandshakeWelcome )
+    {
+        fprintf( stderr, "Client handshake failed.\n" );
+        exit( 1 );
+    }
+    tracy::WelcomeMessage welcome;
+    if( !sock.Read( &welcome, sizeof( welcome ), 10, ShouldExit ) ) return;
+    if( welcome.onDemand != 0 )
+    {
+        tracy::OnDemandPayloadMessage onDemand;
+        if( !sock.Read( &onDemand, sizeof( onDemand ), 10, ShouldExit ) ) return;
+    }
+    s_sinkConnected.store( true, std::memory_order_release );
+
+    // Frames are decompressed as the server would do, but their contents are only searched for the drain markers.
+    auto stream = tracy::LZ4_createStreamDecode();
+    std::vector<char> buf( tracy::LZ4Size );
+    std::vector<char> frames( tracy::TargetFrameSize * 3 + 1 );
+    size_t offset = 0;
+    for(;;)
+    {
+        tracy::lz4sz_t sz;
+        if( !sock.Read( &sz, sizeof( sz ), 10, ShouldExit ) ) break;
+        if( sz > tracy::LZ4Size || !sock.Read( buf.data(), sz, 10, ShouldExit ) ) break;
+        s_sinkBytes.fetch_add( sz + sizeof( sz ), std::memory_order_relaxed );
+
+        const auto frame = frames.data() + offset;
+        const auto fsz = tracy::LZ4_decompress_safe_continue( stream, buf.data(), frame, sz, tracy::TargetFrameSize );
+        if( fsz < 0 ) break;
+        uint64_t markers = 0;
+        auto ptr = frame;
+        const auto end = frame + fsz;
+        for(;;)
+        {
+            ptr = std::search( ptr, end, DrainMarker, DrainMarker + sizeof( DrainMarker ) - 1 );
+            if( ptr == end ) break;
+            ptr += sizeof( DrainMarker ) - 1;
+            markers++;
+        }
+        if( markers != 0 )
+        {
+            s_sinkMarkerTime.store( Now(), std::memory_order_relaxed );
+            s_sinkMarkers.fetch_add( markers, std::memory_order_release );
+        }
+        offset += fsz;
+        if( offset > tracy::TargetFrameSize * 2 ) offset = 0;
+    }
+    tracy::LZ4_freeStreamDecode( stream );
+    s_sinkConnected.store( false, std::memory_order_release );
+
+    tracy::ServerQueryPacket terminate = { tracy::ServerQueryTerminate, 0, 0 };
+    sock.Send( &terminate, tracy::ServerQueryPacketSize );
+}
+
+static void SendDrainMarker()
+{
+    s_markersSent.fetch_add( 1, std::memory_order_relaxed );
+    TracyMessage( DrainMarker, sizeof( DrainMarker ) - 1 );
+}
+
+// Waits until the profiler thread has drained everything queued by the previous run, including the events of
+// the calling thread.
+static void WaitForDrain()
+{
+    SendDrainMarker();
+    const auto sent = s_markersSent.load( std::memory_order_relaxed );
+    while( s_sinkMarkers.load( std::memory_order_acquire ) < sent && s_sinkConnected.load( std::memory_order_acquire ) )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+}
+
+static void BenchZone( size_t )
+{
+    ZoneScopedN( "Bench zone" );
+}
+
+static void BenchZoneCallstack( size_t )
+{
+    ZoneScopedNS( "Bench zone callstack", 16 );
+}
+
+static void BenchLock( size_t )
+{
+    static thread_local TracyLockable( std::mutex, lock );
+    std::lock_guard<LockableBase( std::mutex )> guard( lock );
+}
+
+static void BenchAlloc( size_t i )
+{
+    const auto ptr = (void*)( ( uintptr_t( i ) + 1 ) * 16 );
+    TracyAlloc( ptr, 16 );
+    TracyFree( ptr );
+}
+
+static void BenchMessage( size_t )
+{
+    static const char text[] = "Bench message";
+    TracyMessage( text, sizeof( text ) - 1 );
+}
+
+static void BenchPlot( size_t i )
+{
+    TracyPlot( "Bench plot", int64_t( i ) );
+}
+
+static void BenchFrameMark( size_t )
+{
+    FrameMark;
+}
+
+struct Benchmark
+{
+    const char* name;
+    void(*fn)( size_t );
+    int eventsPerCall;
+};
+
+static const Benchmark s_benchmarks[] = {
+    { "ZoneScopedN", BenchZone, 2 },
+    { "ZoneScopedNS (callstack)", BenchZoneCallstack, 2 },
+    { "LockableCtx lock/unlock", BenchLock, 3 },
+    { "MemAlloc/MemFree", BenchAlloc, 2 },
+    { "Message", BenchMessage, 1 },
+    { "PlotData", BenchPlot, 1 },
+    { "FrameMark", BenchFrameMark, 1 },
+};
+
+struct ThreadResult
+{
+    int64_t time;
+    std::vector<int64_t> latency;
+};
+
+static void Producer( const Benchmark& bench, size_t count, bool marker, std::atomic<int>& ready, std::atomic<bool>& go, ThreadResult& result )
+{
+    // Message() copies the text with the profiler allocator before anything else
+    // would set up the allocator for this thread.
+    tracy::InitRPMallocThread();
+
+    auto& latency = result.latency;
+    latency.reserve( count / LatencySampleRate + 1 );
+
+    // Warm up the thread local state, so that its cost is not attributed to the first event.
+    bench.fn( 0 );
+
+    ready.fetch_add( 1, std::memory_order_acq_rel );
+    while( !go.load( std::memory_order_acquire ) ) {}
+
+    const auto t0 = Now();
+    for( size_t i=0; i<count; i++ )
+    {
+        if( i % LatencySampleRate == 0 )
+        {
+            const auto s = tracy::Profiler::GetTime();
+            bench.fn( i );
+            latency.push_back( tracy::Profiler::GetTime() - s );
+        }
+        else
+        {
+            bench.fn( i );
+        }
+    }
+    result.time = Now() - t0;
+    if( marker ) SendDrainMarker();
+}
+
+static void Usage()
+{
+    printf( "Usage: tracy_bench [-t threads] [-n calls] [-b name] [-d] [-a address] [-p port]\n\n" );
+    printf( "  -t threads: maximum number of producer threads (default: hardware concurrency)\n" );
+    printf( "  -n calls: number of instrumented calls made by each thread (default: 1000000)\n" );
+    printf( "  -b name: only run benchmarks with names containing the given text\n" );
+    printf( "  -d: do not connect the sink (requires on-demand mode)\n" );
+    printf( "  -a address: client address (default: 127.0.0.1)\n" );
+    printf( "  -p port: client port (default: 8086)\n" );
+    exit( 1 );
+}
+
+int main( int argc, char** argv )
+{
+    int maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    size_t count = 1000000;
+    const char* filter = nullptr;
+    bool connect = true;
+    const char* addr = "127.0.0.1";
+    int port = 8086;
+
+    for( int i=1; i<argc; i++ )
+    {
+        const auto arg = argv[i];
+        const auto hasValue = i + 1 < argc;
+        if( strcmp( arg, "-t" ) == 0 && hasValue ) maxThreads = atoi( argv[++i] );
+        else if( strcmp( arg, "-n" ) == 0 && hasValue ) count = strtoull( argv[++i], nullptr, 10 );
+        else if( strcmp( arg, "-b" ) == 0 && hasValue ) filter = argv[++i];
+        else if( strcmp( arg, "-d" ) == 0 ) connect = false;
+        else if( strcmp( arg, "-a" ) == 0 && hasValue ) addr = argv[++i];
+        else if( strcmp( arg, "-p" ) == 0 && hasValue ) port = atoi( argv[++i] );
+        else Usage();
+    }
+    if( maxThreads < 1 || count == 0 ) Usage();
+
+#ifdef TRACY_ON_DEMAND
+    const char* mode = connect ? "on-demand, connected" : "on-demand, not connected";
+#else
+    if( !connect )
+    {
+        fprintf( stderr, "Running without a connection requires on-demand mode.\n" );
+        exit( 1 );
+    }
+    const char* mode = "connected";
+#endif
+
+    tracy::SetThreadName( "Bench main" );
+
+    std::thread sink;
+    if( connect )
+    {
+        sink = std::thread( Sink, addr, port );
+        while( !s_sinkConnected.load( std::memory_order_acquire ) ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    // Profiler timer ticks are converted to nanoseconds with a steady clock calibration.
+    const auto c0 = Now();
+    const auto t0 = tracy::Profiler::GetTime();
+    std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    const auto c1 = Now();
+    const auto t1 = tracy::Profiler::GetTime();
+    const auto timerMul = double( c1 - c0 ) / double( t1 - t0 );
+
+    // Cost of the timer reads around each sampled event.
+    std::vector<int64_t> timerCost( 10000 );
+    for( auto& v : timerCost )
+    {
+        const auto s = tracy::Profiler::GetTime();
+        v = tracy::Profiler::GetTime() - s;
+    }
+    std::sort( timerCost.begin(), timerCost.end() );
+    const auto timerOverhead = timerCost[timerCost.size() / 2];
+
+    printf( "Mode: %s, %zu calls per thread, timer overhead %.1f ns\n\n", mode, count, timerOverhead * timerMul );
+    printf( "%-26s %7s %10s %10s %10s %14s %12s\n", "benchmark", "threads", "ns/event", "p50 ns", "p99 ns", "events/s", "sink MB/s" );
+
+    std::vector<int> threadCounts;
+    for( int t=1; t<maxThreads; t*=2 ) threadCounts.push_back( t );
+    threadCounts.push_back( maxThreads );
+
+    for( auto& bench : s_benchmarks )
+    {
+        if( filter && !strstr( bench.name, filter ) ) continue;
+        for( auto threads : threadCounts )
+        {
+            if( connect ) WaitForDrain();
+
+            std::atomic<int> ready { 0 };
+            std::atomic<bool> go { false };
+            std::vector<ThreadResult> results( threads );
+            std::vector<std::thread> producers;
+            for( int i=0; i<threads; i++ ) producers.emplace_back( Producer, std::cref( bench ), count, connect, std::ref( ready ), std::ref( go ), std::ref( results[i] ) );
+            while( ready.load( std::memory_order_acquire ) != threads ) std::this_thread::yield();
+
+            const auto bytes0 = s_sinkBytes.load( std::memory_order_relaxed );
+            const auto w0 = Now();
+            go.store( true, std::memory_order_release );
+            for( auto& v : producers ) v.join();
+            if( connect ) WaitForDrain();
+            const auto drain = s_sinkMarkerTime.load( std::memory_order_relaxed ) - w0;
+            const auto bytes = s_sinkBytes.load( std::memory_order_relaxed ) - bytes0;
+
+            int64_t time = 0;
+            std::vector<int64_t> latency;
+            for( auto& v : results )
+            {
+                time = std::max( time, v.time );
+                latency.insert( latency.end(), v.latency.begin(), v.latency.end() );
+            }
+            std::sort( latency.begin(), latency.end() );
+            const auto p50 = std::max<int64_t>( 0, latency[latency.size() / 2] - timerOverhead ) * timerMul / bench.eventsPerCall;
+            const auto p99 = std::max<int64_t>( 0, latency[std::min( latency.size() - 1, latency.size() * 99 / 100 )] - timerOverhead ) * timerMul / bench.eventsPerCall;
+
+            const auto events = double( count ) * bench.eventsPerCall;
+            const auto nsPerEvent = double( time ) / events;
+            const auto eventsPerSecond = events * threads * 1e9 / time;
+            printf( "%-26s %7i %10.2f %10.1f %10.1f %14.0f", bench.name, threads, nsPerEvent, p50, p99, eventsPerSecond );
+            if( connect && drain > 0 )
+            {
+                printf( " %12.1f\n", bytes / ( drain / 1e9 ) / ( 1024 * 1024 ) );
+            }
+            else
+            {
+                printf( " %12s\n", "-" );
+            }
+            fflush( stdout );
+        }
+    }
+
+    if( connect )
+    {
+        s_sinkExit.store( true, std::memory_order_relaxed );
+        sink.join();
+    }
+    return 0;
+}
@@ -27,7 +27,7 @@ void SigInt( int )
 
 void Usage()
 {
-    printf( "Usage: capture -o output.tracy [-a address] [-p port]\n" );
+    printf( "Usage: capture -o output.tracy [-a address] [-p port] [-r rawstream]\n" );
     exit( 1 );
 }
 
@@ -43,10 +43,11 @@ int main( int argc, char** argv )
 
     const char* address = "localhost";
     const char* output = nullptr;
+    const char* rawStream = nullptr;
     int port = 8086;
 
     int c;
-    while( ( c = getopt( argc, argv, "a:o:p:" ) ) != -1 )
+    while( ( c = getopt( argc, argv, "a:o:p:r:" ) ) != -1 )
     {
         switch( c )
         {
@@ -59,6 +60,9 @@ int main( int argc, char** argv )
         case 'p':
             port = atoi( optarg );
             break;
+        case 'r':
+            rawStream = optarg;
+            break;
         default:
             Usage();
             break;
@@ -67,9 +71,20 @@ int main( int argc, char** argv )
 
     if( !address || !output ) Usage();
 
+    FILE* rawStreamFile = nullptr;
+    if( rawStream )
+    {
+        rawStreamFile = fopen( rawStream, "wb" );
+        if( !rawStreamFile )
+        {
+            printf( "Cannot open raw stream file for writing!\n" );
+            return 1;
+        }
+    }
+
     printf( "Connecting to %s:%i...", address, port );
     fflush( stdout );
-    tracy::Worker worker( address, port );
+    tracy::Worker worker( address, port, rawStreamFile );
     while( !worker.IsConnected() )
     {
         const auto handshake = worker.GetHandshakeStatus();
@@ -127,7 +127,12 @@ void WINAPI EventRecordCallback( PEVENT_RECORD record )
             memcpy( &item->contextSwitch.newThread, &cswitch->newThreadId, sizeof( cswitch->newThreadId ) );
             memset( ((char*)&item->contextSwitch.oldThread)+4, 0, 4 );
             memset( ((char*)&item->contextSwitch.newThread)+4, 0, 4 );
-            MemWrite( &item->contextSwitch.cpu, record->BufferContext.ProcessorNumber );
+#ifdef EVENT_HEADER_FLAG_PROCESSOR_INDEX
+            const uint16_t cpu = ( hdr.Flags & EVENT_HEADER_FLAG_PROCESSOR_INDEX ) ? record->BufferContext.ProcessorIndex : record->BufferContext.ProcessorNumber;
+#else
+            const uint16_t cpu = record->BufferContext.ProcessorNumber;
+#endif
+            MemWrite( &item->contextSwitch.cpu, cpu );
             MemWrite( &item->contextSwitch.reason, cswitch->oldThreadWaitReason );
             MemWrite( &item->contextSwitch.state, cswitch->oldThreadState );
             TracyLfqCommit;
@@ -668,7 +673,7 @@ static void HandleTraceLine( const char* line )
     line += 23;
     while( *line != '[' ) line++;
     line++;
-    const auto cpu = (uint8_t)ReadNumber( line );
+    const auto cpu = (uint16_t)ReadNumber( line );
     line++;      // ']'
     while( *line == ' ' ) line++;
 
@@ -375,7 +375,7 @@ struct QueueContextSwitch
     int64_t time;
     uint64_t oldThread;
     uint64_t newThread;
-    uint8_t cpu;
+    uint16_t cpu;
     uint8_t reason;
     uint8_t state;
 };
@@ -112,28 +112,31 @@ bool Socket::Connect( const char* addr, int port )
 
     if( m_ptr )
     {
+        // Connection may also be established right away, in which case the call succeeds.
         const auto c = connect( m_connSock, m_ptr->ai_addr, m_ptr->ai_addrlen );
-        assert( c == -1 );
-#if defined _WIN32 || defined __CYGWIN__
-        const auto err = WSAGetLastError();
-        if( err == WSAEALREADY || err == WSAEINPROGRESS ) return false;
-        if( err != WSAEISCONN )
+        if( c == -1 )
         {
-            freeaddrinfo( m_res );
-            closesocket( m_connSock );
-            m_ptr = nullptr;
-            return false;
-        }
+#if defined _WIN32 || defined __CYGWIN__
+            const auto err = WSAGetLastError();
+            if( err == WSAEALREADY || err == WSAEINPROGRESS ) return false;
+            if( err != WSAEISCONN )
+            {
+                freeaddrinfo( m_res );
+                closesocket( m_connSock );
+                m_ptr = nullptr;
+                return false;
+            }
 #else
-        if( errno == EALREADY || errno == EINPROGRESS ) return false;
-        if( errno != EISCONN )
-        {
-            freeaddrinfo( m_res );
-            close( m_connSock );
-            m_ptr = nullptr;
-            return false;
-        }
+            if( errno == EALREADY || errno == EINPROGRESS ) return false;
+            if( errno != EISCONN )
+            {
+                freeaddrinfo( m_res );
+                close( m_connSock );
+                m_ptr = nullptr;
+                return false;
+            }
 #endif
+        }
 
 #if defined _WIN32 || defined __CYGWIN__
         u_long nonblocking = 0;
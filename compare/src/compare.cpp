@@ -0,0 +1,347 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <exception>
+#include <math.h>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyHistogram.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: compare [-m metric] [-t threshold] [-p pvalue] [-n count] [-f name] [-a] base.tracy new.tracy\n\n" );
+    printf( "  -m metric: zone time metric checked against threshold: mean, median (default), p90 or p99\n" );
+    printf( "  -t threshold: relative change of metric, in percent, which is reported as regression (default 10)\n" );
+    printf( "  -p pvalue: significance level of the Mann-Whitney U test (default 0.01)\n" );
+    printf( "  -n count: minimum number of zones in each trace for the zone to be checked (default 10)\n" );
+    printf( "  -f name: only compare zones with names containing the given text\n" );
+    printf( "  -a: list all matched zones, not only the ones with significant changes\n\n" );
+    printf( "Exit code is 2 if a regression was found, 1 on error and 0 otherwise.\n" );
+    exit( 1 );
+}
+
+enum class Metric { Mean, Median, P90, P99 };
+
+struct ZoneTimes
+{
+    const char* name;
+    const char* file;
+    uint32_t line;
+    std::vector<int64_t> times;
+    int64_t total;
+};
+
+struct Result
+{
+    const ZoneTimes* zt[2];
+    double delta;
+    double pvalue;
+    bool significant;
+    bool regression;
+};
+
+static tracy::Worker* Load( tracy::FileRead& f )
+{
+    try
+    {
+        auto worker = new tracy::Worker( f, tracy::EventType::None );
+        while( !worker->AreSourceLocationZonesReady() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        return worker;
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        throw std::runtime_error( "The file you are trying to open is from the future version." );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        throw std::runtime_error( "The file you are trying to open is not a tracy dump." );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        throw std::runtime_error( "The file you are trying to open cannot be mapped to memory." );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        throw std::runtime_error( "The file you are trying to open is from a legacy version." );
+    }
+}
+
+static std::vector<ZoneTimes> GetZoneTimes( const tracy::Worker& worker, const char* filter )
+{
+    std::vector<ZoneTimes> ret;
+    for( auto& v : worker.GetSourceLocationZones() )
+    {
+        if( v.second.zones.empty() ) continue;
+        auto& srcloc = worker.GetSourceLocation( v.first );
+        const auto name = worker.GetString( srcloc.name.active ? srcloc.name : srcloc.function );
+        if( filter && !strstr( name, filter ) ) continue;
+        ZoneTimes zt { name, worker.GetString( srcloc.file ), srcloc.line };
+        zt.times.reserve( v.second.zones.size() );
+        for( auto& z : v.second.zones ) zt.times.push_back( z.Zone()->End() - z.Zone()->Start() );
+        std::sort( zt.times.begin(), zt.times.end() );
+        zt.total = v.second.total;
+        ret.emplace_back( std::move( zt ) );
+    }
+    return ret;
+}
+
+static double GetMetric( const ZoneTimes& zt, Metric metric )
+{
+    switch( metric )
+    {
+    case Metric::Mean: return double( zt.total ) / zt.times.size();
+    case Metric::Median: return tracy::Percentile( zt.times, 0.5 );
+    case Metric::P90: return tracy::Percentile( zt.times, 0.9 );
+    case Metric::P99: return tracy::Percentile( zt.times, 0.99 );
+    default: assert( false ); return 0;
+    }
+}
+
+// Two-sided Mann-Whitney U test with normal approximation and tie correction. Both inputs must be
+// sorted. Returns the p-value and sets z to a positive value if the second sample tends to be larger.
+static double MannWhitney( const std::vector<int64_t>& a, const std::vector<int64_t>& b, double& z )
+{
+    const double n0 = a.size();
+    const double n1 = b.size();
+    const double n = n0 + n1;
+    double rankSum = 0;
+    double tieSum = 0;
+    size_t i = 0, j = 0;
+    while( i < a.size() || j < b.size() )
+    {
+        int64_t val;
+        if( j == b.size() || ( i < a.size() && a[i] < b[j] ) ) val = a[i];
+        else val = b[j];
+        size_t ca = 0, cb = 0;
+        while( i < a.size() && a[i] == val ) { i++; ca++; }
+        while( j < b.size() && b[j] == val ) { j++; cb++; }
+        const double t = ca + cb;
+        const double rank = i + j - ( t - 1 ) * 0.5;
+        rankSum += cb * rank;
+        tieSum += t * t * t - t;
+    }
+    const auto u = rankSum - n1 * ( n1 + 1 ) * 0.5;
+    const auto mu = n0 * n1 * 0.5;
+    const auto sigma = sqrt( n0 * n1 / 12. * ( ( n + 1 ) - tieSum / ( n * ( n - 1 ) ) ) );
+    if( sigma == 0 )
+    {
+        z = 0;
+        return 1;
+    }
+    z = ( u - mu ) / sigma;
+    return erfc( fabs( z ) / sqrt( 2. ) );
+}
+
+static const char* Location( const ZoneTimes& zt )
+{
+    static char buf[1024];
+    snprintf( buf, sizeof( buf ), "%s:%u", zt.file, zt.line );
+    return buf;
+}
+
+static void PrintRelative( double delta )
+{
+    printf( "%+8.1f%%", delta * 100 );
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    Metric metric = Metric::Median;
+    double threshold = 10;
+    double pvalue = 0.01;
+    size_t minCount = 10;
+    const char* filter = nullptr;
+    bool all = false;
+
+    int c;
+    while( ( c = getopt( argc, argv, "m:t:p:n:f:a" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'm':
+            if( strcmp( optarg, "mean" ) == 0 ) metric = Metric::Mean;
+            else if( strcmp( optarg, "median" ) == 0 ) metric = Metric::Median;
+            else if( strcmp( optarg, "p90" ) == 0 ) metric = Metric::P90;
+            else if( strcmp( optarg, "p99" ) == 0 ) metric = Metric::P99;
+            else Usage();
+            break;
+        case 't':
+            threshold = atof( optarg );
+            break;
+        case 'p':
+            pvalue = atof( optarg );
+            break;
+        case 'n':
+            minCount = std::max( 2, atoi( optarg ) );
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'a':
+            all = true;
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 2 ) Usage();
+
+    std::unique_ptr<tracy::FileRead> file[2];
+    for( int i=0; i<2; i++ )
+    {
+        file[i].reset( tracy::FileRead::Open( argv[optind+i] ) );
+        if( !file[i] )
+        {
+            fprintf( stderr, "Cannot open input file %s!\n", argv[optind+i] );
+            exit( 1 );
+        }
+    }
+
+    // Both traces are loaded at the same time.
+    std::unique_ptr<tracy::Worker> worker[2];
+    std::string error[2];
+    {
+        std::thread threads[2];
+        for( int i=0; i<2; i++ )
+        {
+            threads[i] = std::thread( [i, &file, &worker, &error] {
+                try
+                {
+                    worker[i].reset( Load( *file[i] ) );
+                }
+                catch( const std::runtime_error& e )
+                {
+                    error[i] = e.what();
+                }
+            } );
+        }
+        for( auto& v : threads ) v.join();
+    }
+    for( int i=0; i<2; i++ )
+    {
+        if( !error[i].empty() )
+        {
+            fprintf( stderr, "%s: %s\n", argv[optind+i], error[i].c_str() );
+            exit( 1 );
+        }
+    }
+
+    const auto zones0 = GetZoneTimes( *worker[0], filter );
+    const auto zones1 = GetZoneTimes( *worker[1], filter );
+
+    // Source locations are matched by name, file and line. The remaining ones are then matched by name
+    // and file, and finally by name alone, if the match is unambiguous in both traces. This handles zones
+    // which were moved to another line, or traces of programs built in different directories.
+    std::vector<Result> results;
+    std::vector<const ZoneTimes*> left[2];
+    for( auto& v : zones0 ) left[0].push_back( &v );
+    for( auto& v : zones1 ) left[1].push_back( &v );
+    auto Match = [&results, &left] ( auto key, bool unique ) {
+        std::unordered_map<std::string, std::vector<const ZoneTimes*>> map[2];
+        for( int i=0; i<2; i++ )
+        {
+            for( auto& v : left[i] ) map[i][key( *v )].push_back( v );
+            left[i].clear();
+        }
+        for( auto& v : map[0] )
+        {
+            size_t n = 0;
+            auto it = map[1].find( v.first );
+            if( it != map[1].end() && ( !unique || ( v.second.size() == 1 && it->second.size() == 1 ) ) )
+            {
+                n = std::min( v.second.size(), it->second.size() );
+                for( size_t i=0; i<n; i++ ) results.push_back( Result { { v.second[i], it->second[i] } } );
+                it->second.erase( it->second.begin(), it->second.begin() + n );
+            }
+            left[0].insert( left[0].end(), v.second.begin() + n, v.second.end() );
+        }
+        for( auto& v : map[1] ) left[1].insert( left[1].end(), v.second.begin(), v.second.end() );
+    };
+    Match( [] ( const ZoneTimes& zt ) { return std::string( zt.name ) + '\0' + zt.file + '\0' + std::to_string( zt.line ); }, false );
+    Match( [] ( const ZoneTimes& zt ) { return std::string( zt.name ) + '\0' + zt.file; }, true );
+    Match( [] ( const ZoneTimes& zt ) { return std::string( zt.name ); }, true );
+    for( auto& v : left )
+    {
+        std::sort( v.begin(), v.end(), [] ( const auto& l, const auto& r ) { return strcmp( l->name, r->name ) < 0; } );
+    }
+
+    bool regression = false;
+    for( auto& v : results )
+    {
+        const auto& t0 = *v.zt[0];
+        const auto& t1 = *v.zt[1];
+        const auto m0 = GetMetric( t0, metric );
+        const auto m1 = GetMetric( t1, metric );
+        v.delta = m0 == 0 ? 0 : ( m1 - m0 ) / m0;
+        v.pvalue = 1;
+        v.significant = false;
+        v.regression = false;
+        if( t0.times.size() >= minCount && t1.times.size() >= minCount )
+        {
+            double z;
+            v.pvalue = MannWhitney( t0.times, t1.times, z );
+            // The change of the checked metric must agree with the direction of the distribution shift.
+            v.significant = v.pvalue < pvalue && fabs( v.delta ) * 100 >= threshold && ( v.delta > 0 ) == ( z > 0 );
+            v.regression = v.significant && v.delta > 0;
+            if( v.regression ) regression = true;
+        }
+    }
+    std::sort( results.begin(), results.end(), [] ( const auto& l, const auto& r ) { return l.delta > r.delta; } );
+
+    printf( "%-32s %-32s %10s %10s %10s %10s %9s %10s %9s %10s %9s %10s %9s %9s\n",
+        "name", "location", "count", "count new", "mean", "mean new", "change", "median new", "change", "p90 new", "change", "p99 new", "change", "p-value" );
+    for( auto& v : results )
+    {
+        if( !all && !v.significant ) continue;
+        const auto& t0 = *v.zt[0];
+        const auto& t1 = *v.zt[1];
+        const double mean0 = double( t0.total ) / t0.times.size();
+        const double mean1 = double( t1.total ) / t1.times.size();
+        printf( "%-32s %-32s %10zu %10zu %10s ", t1.name, Location( t1 ), t0.times.size(), t1.times.size(), tracy::TimeToString( int64_t( mean0 ) ) );
+        printf( "%10s ", tracy::TimeToString( int64_t( mean1 ) ) );
+        PrintRelative( mean0 == 0 ? 0 : mean1 / mean0 - 1 );
+        const double pct[] = { 0.5, 0.9, 0.99 };
+        for( auto p : pct )
+        {
+            const auto p0 = tracy::Percentile( t0.times, p );
+            const auto p1 = tracy::Percentile( t1.times, p );
+            printf( " %10s ", tracy::TimeToString( p1 ) );
+            PrintRelative( p0 == 0 ? 0 : double( p1 ) / p0 - 1 );
+        }
+        printf( " %9.2g%s\n", v.pvalue, v.regression ? "  REGRESSION" : ( v.significant ? "  improvement" : "" ) );
+    }
+    if( all )
+    {
+        for( auto& v : left[0] ) printf( "%-32s %-32s only in base trace\n", v->name, Location( *v ) );
+        for( auto& v : left[1] ) printf( "%-32s %-32s only in new trace\n", v->name, Location( *v ) );
+    }
+
+    return regression ? 2 : 0;
+}
@@ -0,0 +1,297 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <inttypes.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyHistogram.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: csvexport [-j] [-s separator] [-f name] [-c] [-t thread] [-r start:end] input.tracy\n\n" );
+    printf( "  -j: output JSON instead of CSV\n" );
+    printf( "  -s separator: CSV field separator (default ',')\n" );
+    printf( "  -f name: only export zones with names containing the given text\n" );
+    printf( "  -c: name filter is case sensitive\n" );
+    printf( "  -t thread: only count zones from threads with names containing the given text, or with given thread id\n" );
+    printf( "  -r start:end: only count zones fully contained in the given time range (nanoseconds)\n\n" );
+    printf( "All times are reported in nanoseconds.\n" );
+    exit( 1 );
+}
+
+struct ZoneStats
+{
+    int16_t srcloc;
+    const char* name;
+    const char* file;
+    uint32_t line;
+    int64_t total;
+    int64_t selfTotal;
+    std::vector<int64_t> times;
+};
+
+static bool Contains( const char* str, const char* query, bool caseSensitive )
+{
+    if( caseSensitive ) return strstr( str, query ) != nullptr;
+    const auto qlen = strlen( query );
+    for( ; *str; str++ )
+    {
+        size_t i = 0;
+        while( i < qlen && str[i] && tolower( (unsigned char)str[i] ) == tolower( (unsigned char)query[i] ) ) i++;
+        if( i == qlen ) return true;
+    }
+    return qlen == 0;
+}
+
+static int64_t GetChildTime( const tracy::Worker& worker, const tracy::ZoneEvent& zone )
+{
+    if( !zone.HasChildren() ) return 0;
+    int64_t time = 0;
+    auto& children = worker.GetZoneChildren( zone.Child() );
+    if( children.is_magic() )
+    {
+        auto& vec = *(tracy::Vector<tracy::ZoneEvent>*)&children;
+        for( auto& v : vec )
+        {
+            if( v.IsEndValid() ) time += std::max<int64_t>( 0, v.End() - v.Start() );
+        }
+    }
+    else
+    {
+        for( auto& v : children )
+        {
+            if( v->IsEndValid() ) time += std::max<int64_t>( 0, v->End() - v->Start() );
+        }
+    }
+    return time;
+}
+
+static void PrintCsvString( const char* str, char separator )
+{
+    if( !strchr( str, separator ) && !strchr( str, '"' ) && !strchr( str, '\n' ) )
+    {
+        fputs( str, stdout );
+        return;
+    }
+    putchar( '"' );
+    for( ; *str; str++ )
+    {
+        if( *str == '"' ) putchar( '"' );
+        putchar( *str );
+    }
+    putchar( '"' );
+}
+
+static void PrintJsonString( const char* str )
+{
+    putchar( '"' );
+    for( ; *str; str++ )
+    {
+        const auto c = (unsigned char)*str;
+        switch( c )
+        {
+        case '"': fputs( "\\\"", stdout ); break;
+        case '\\': fputs( "\\\\", stdout ); break;
+        case '\n': fputs( "\\n", stdout ); break;
+        case '\r': fputs( "\\r", stdout ); break;
+        case '\t': fputs( "\\t", stdout ); break;
+        default:
+            if( c < 0x20 )
+            {
+                printf( "\\u%04x", c );
+            }
+            else
+            {
+                putchar( c );
+            }
+            break;
+        }
+    }
+    putchar( '"' );
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    bool json = false;
+    char separator = ',';
+    const char* nameFilter = nullptr;
+    bool caseSensitive = false;
+    const char* threadFilter = nullptr;
+    bool limitRange = false;
+    int64_t rangeMin = 0;
+    int64_t rangeMax = 0;
+
+    int c;
+    while( ( c = getopt( argc, argv, "js:f:ct:r:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'j':
+            json = true;
+            break;
+        case 's':
+            if( strlen( optarg ) != 1 ) Usage();
+            separator = optarg[0];
+            break;
+        case 'f':
+            nameFilter = optarg;
+            break;
+        case 'c':
+            caseSensitive = true;
+            break;
+        case 't':
+            threadFilter = optarg;
+            break;
+        case 'r':
+            if( sscanf( optarg, "%" SCNd64 ":%" SCNd64, &rangeMin, &rangeMax ) != 2 || rangeMin > rangeMax ) Usage();
+            limitRange = true;
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 1 ) Usage();
+    const char* input = argv[optind];
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    try
+    {
+        // Only zones are needed, everything else is skipped while loading.
+        tracy::Worker worker( *f, tracy::EventType::None );
+        while( !worker.AreSourceLocationZonesReady() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+        // Thread filter results, indexed by compressed thread id.
+        std::vector<int8_t> threadPass;
+        auto ThreadPasses = [&] ( uint16_t thread ) {
+            if( !threadFilter ) return true;
+            if( thread >= threadPass.size() ) threadPass.resize( thread + 1, -1 );
+            if( threadPass[thread] < 0 )
+            {
+                const auto tid = worker.DecompressThread( thread );
+                char* end;
+                const auto filterTid = strtoull( threadFilter, &end, 10 );
+                threadPass[thread] = ( *end == '\0' && filterTid == tid ) || Contains( worker.GetThreadName( tid ), threadFilter, true );
+            }
+            return threadPass[thread] != 0;
+        };
+
+        std::vector<ZoneStats> stats;
+        for( auto& v : worker.GetSourceLocationZones() )
+        {
+            auto& srcloc = worker.GetSourceLocation( v.first );
+            const auto name = worker.GetString( srcloc.name.active ? srcloc.name : srcloc.function );
+            if( nameFilter && !Contains( name, nameFilter, caseSensitive ) ) continue;
+
+            ZoneStats zs { v.first, name, worker.GetString( srcloc.file ), srcloc.line, 0, 0 };
+            for( auto& zt : v.second.zones )
+            {
+                auto& zone = *zt.Zone();
+                const auto start = zone.Start();
+                const auto end = zone.End();
+                if( limitRange && ( start < rangeMin || end > rangeMax ) ) continue;
+                if( !ThreadPasses( zt.Thread() ) ) continue;
+                const auto time = end - start;
+                zs.total += time;
+                zs.selfTotal += time - GetChildTime( worker, zone );
+                zs.times.push_back( time );
+            }
+            if( zs.times.empty() ) continue;
+            std::sort( zs.times.begin(), zs.times.end() );
+            stats.emplace_back( std::move( zs ) );
+        }
+
+        // Stable ordering, so that outputs of different traces can be compared line by line.
+        std::sort( stats.begin(), stats.end(), []( const auto& l, const auto& r ) {
+            const auto n = strcmp( l.name, r.name );
+            if( n != 0 ) return n < 0;
+            const auto f = strcmp( l.file, r.file );
+            if( f != 0 ) return f < 0;
+            if( l.line != r.line ) return l.line < r.line;
+            return l.srcloc < r.srcloc;
+        } );
+
+        if( json )
+        {
+            printf( "[" );
+            bool first = true;
+            for( auto& v : stats )
+            {
+                printf( first ? "\n  { \"name\": " : ",\n  { \"name\": " );
+                first = false;
+                PrintJsonString( v.name );
+                printf( ", \"src_file\": " );
+                PrintJsonString( v.file );
+                printf( ", \"src_line\": %" PRIu32 ", \"count\": %zu, \"total_ns\": %" PRIi64 ", \"self_ns\": %" PRIi64 ", \"mean_ns\": %" PRIi64 ", \"p50_ns\": %" PRIi64 ", \"p90_ns\": %" PRIi64 ", \"p99_ns\": %" PRIi64 ", \"max_ns\": %" PRIi64 " }",
+                    v.line, v.times.size(), v.total, v.selfTotal, v.total / int64_t( v.times.size() ),
+                    tracy::Percentile( v.times, 0.5 ), tracy::Percentile( v.times, 0.9 ), tracy::Percentile( v.times, 0.99 ), v.times.back() );
+            }
+            printf( "\n]\n" );
+        }
+        else
+        {
+            const auto s = separator;
+            printf( "name%csrc_file%csrc_line%ccount%ctotal_ns%cself_ns%cmean_ns%cp50_ns%cp90_ns%cp99_ns%cmax_ns\n", s, s, s, s, s, s, s, s, s, s );
+            for( auto& v : stats )
+            {
+                PrintCsvString( v.name, s );
+                putchar( s );
+                PrintCsvString( v.file, s );
+                printf( "%c%" PRIu32 "%c%zu%c%" PRIi64 "%c%" PRIi64 "%c%" PRIi64 "%c%" PRIi64 "%c%" PRIi64 "%c%" PRIi64 "%c%" PRIi64 "\n",
+                    s, v.line, s, v.times.size(), s, v.total, s, v.selfTotal, s, v.total / int64_t( v.times.size() ),
+                    s, tracy::Percentile( v.times, 0.5 ), s, tracy::Percentile( v.times, 0.9 ), s, tracy::Percentile( v.times, 0.99 ), s, v.times.back() );
+            }
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
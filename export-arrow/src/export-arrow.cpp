@@ -0,0 +1,985 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <inttypes.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyTaskDispatch.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: export-arrow [-b rows] input.tracy output\n\n" );
+    printf( "Exports zones, memory events, call stack samples and call stacks of a trace as Apache Arrow IPC files,\n" );
+    printf( "named output.zones.arrow, output.memory.arrow, output.samples.arrow and output.callstacks.arrow.\n\n" );
+    printf( "  -b rows: number of rows in a record batch (default 65536)\n" );
+    exit( 1 );
+}
+
+// Minimal FlatBuffers writer, sufficient for the Arrow IPC metadata. Unlike the reference implementation, the buffer
+// is written front to back. Objects referenced by a table are written after it, and the offsets are patched in.
+class FlatBuffer
+{
+public:
+    FlatBuffer() { Put<uint32_t>( 0 ); }
+
+    const char* Data() const { return m_data.data(); }
+    size_t Size() const { return m_data.size(); }
+
+    void Finish( size_t root )
+    {
+        PatchOffset( 0, root );
+        Pad( 8 );
+    }
+
+    template<typename T>
+    void Put( T val )
+    {
+        const auto pos = m_data.size();
+        m_data.resize( pos + sizeof( T ) );
+        memcpy( m_data.data() + pos, &val, sizeof( T ) );
+    }
+
+    template<typename T>
+    void Set( size_t pos, T val ) { memcpy( m_data.data() + pos, &val, sizeof( T ) ); }
+
+    void Grow( size_t size ) { m_data.resize( m_data.size() + size ); }
+    void Pad( size_t align ) { m_data.resize( ( m_data.size() + align - 1 ) / align * align ); }
+
+    void PatchOffset( size_t field, size_t target )
+    {
+        assert( target > field );
+        Set<uint32_t>( field, uint32_t( target - field ) );
+    }
+
+    size_t String( const char* str )
+    {
+        const auto sz = strlen( str );
+        Pad( 4 );
+        const auto pos = m_data.size();
+        Put<uint32_t>( uint32_t( sz ) );
+        m_data.insert( m_data.end(), str, str + sz + 1 );
+        return pos;
+    }
+
+    // Struct elements are 8 byte aligned.
+    size_t StructVector( const void* data, size_t count, size_t size )
+    {
+        Pad( 4 );
+        if( ( m_data.size() + 4 ) % 8 != 0 ) Put<uint32_t>( 0 );
+        const auto pos = m_data.size();
+        Put<uint32_t>( uint32_t( count ) );
+        m_data.insert( m_data.end(), (const char*)data, (const char*)data + count * size );
+        return pos;
+    }
+
+    // Element offsets are at the returned position + 4 + 4 * index.
+    size_t OffsetVector( size_t count )
+    {
+        Pad( 4 );
+        const auto pos = m_data.size();
+        Put<uint32_t>( uint32_t( count ) );
+        Grow( count * 4 );
+        return pos;
+    }
+
+private:
+    std::vector<char> m_data;
+};
+
+class FlatTable
+{
+public:
+    FlatTable( FlatBuffer& fb ) : m_fb( fb ), m_table( 0 ) {}
+
+    template<typename T>
+    void Add( uint16_t id, T val )
+    {
+        Field f = { id, sizeof( T ), 0, 0 };
+        memcpy( &f.val, &val, sizeof( T ) );
+        m_fields.emplace_back( f );
+    }
+
+    void AddOffset( uint16_t id ) { m_fields.emplace_back( Field { id, 4, 0, 0 } ); }
+
+    size_t Finish()
+    {
+        uint16_t numIds = 0;
+        for( auto& f : m_fields ) numIds = std::max<uint16_t>( numIds, f.id + 1 );
+        std::stable_sort( m_fields.begin(), m_fields.end(), [] ( const auto& l, const auto& r ) { return l.size > r.size; } );
+        uint16_t offset = 4;
+        for( auto& f : m_fields )
+        {
+            offset = ( offset + f.size - 1 ) / f.size * f.size;
+            f.offset = offset;
+            offset += f.size;
+        }
+
+        m_fb.Pad( 2 );
+        const auto vtable = m_fb.Size();
+        m_fb.Put<uint16_t>( 4 + numIds * 2 );
+        m_fb.Put<uint16_t>( offset );
+        std::vector<uint16_t> slots( numIds );
+        for( auto& f : m_fields ) slots[f.id] = f.offset;
+        for( auto& v : slots ) m_fb.Put<uint16_t>( v );
+
+        m_fb.Pad( 8 );
+        m_table = m_fb.Size();
+        m_fb.Grow( offset );
+        m_fb.Set<int32_t>( m_table, int32_t( m_table - vtable ) );
+        for( auto& f : m_fields )
+        {
+            switch( f.size )
+            {
+            case 1: m_fb.Set( m_table + f.offset, uint8_t( f.val ) ); break;
+            case 2: m_fb.Set( m_table + f.offset, uint16_t( f.val ) ); break;
+            case 4: m_fb.Set( m_table + f.offset, uint32_t( f.val ) ); break;
+            case 8: m_fb.Set( m_table + f.offset, f.val ); break;
+            default: assert( false ); break;
+            }
+        }
+        return m_table;
+    }
+
+    size_t FieldPos( uint16_t id ) const
+    {
+        for( auto& f : m_fields ) if( f.id == id ) return m_table + f.offset;
+        assert( false );
+        return 0;
+    }
+
+private:
+    struct Field
+    {
+        uint16_t id;
+        uint16_t size;
+        uint16_t offset;
+        uint64_t val;
+    };
+
+    FlatBuffer& m_fb;
+    std::vector<Field> m_fields;
+    size_t m_table;
+};
+
+enum class ColumnType : uint8_t
+{
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Utf8
+};
+
+static const int ColumnWidth[] = { 2, 2, 4, 4, 8, 8, 0 };
+
+// Dictionary encoded columns store Int32 indices into a Utf8 dictionary with the given id.
+struct ColumnDesc
+{
+    const char* name;
+    ColumnType type;
+    bool nullable;
+    int64_t dictionary;
+};
+
+class RecordBatchBuilder
+{
+public:
+    RecordBatchBuilder( const std::vector<ColumnDesc>& columns )
+        : m_desc( columns )
+        , m_columns( columns.size() )
+        , m_rows( 0 )
+    {
+        Reset();
+    }
+
+    int64_t Rows() const { return m_rows; }
+
+    template<typename T>
+    tracy_force_inline void Value( size_t col, T val )
+    {
+        auto& c = m_columns[col];
+        assert( ColumnWidth[(int)m_desc[col].type] == sizeof( T ) );
+        const auto pos = c.data.size();
+        c.data.resize( pos + sizeof( T ) );
+        memcpy( c.data.data() + pos, &val, sizeof( T ) );
+        if( m_desc[col].nullable ) SetValid( c, true );
+    }
+
+    tracy_force_inline void String( size_t col, const char* str )
+    {
+        auto& c = m_columns[col];
+        assert( m_desc[col].type == ColumnType::Utf8 );
+        c.data.insert( c.data.end(), str, str + strlen( str ) );
+        c.offsets.push_back( int32_t( c.data.size() ) );
+        if( m_desc[col].nullable ) SetValid( c, true );
+    }
+
+    tracy_force_inline void Null( size_t col )
+    {
+        auto& c = m_columns[col];
+        assert( m_desc[col].nullable );
+        if( m_desc[col].type == ColumnType::Utf8 )
+        {
+            c.offsets.push_back( int32_t( c.data.size() ) );
+        }
+        else
+        {
+            c.data.resize( c.data.size() + ColumnWidth[(int)m_desc[col].type] );
+        }
+        SetValid( c, false );
+        c.nulls++;
+    }
+
+    tracy_force_inline void EndRow() { m_rows++; }
+
+    void Reset()
+    {
+        for( auto& c : m_columns )
+        {
+            c.data.clear();
+            c.offsets.clear();
+            c.offsets.push_back( 0 );
+            c.validity.clear();
+            c.nulls = 0;
+        }
+        m_rows = 0;
+    }
+
+    struct FieldNode
+    {
+        int64_t length;
+        int64_t nulls;
+    };
+
+    struct Buffer
+    {
+        int64_t offset;
+        int64_t length;
+    };
+
+    // Returns the field nodes and buffer layout of the record batch. The body is appended to the given vector.
+    void Serialize( std::vector<FieldNode>& nodes, std::vector<Buffer>& buffers, std::vector<char>& body ) const
+    {
+        const auto base = body.size();
+        auto add = [&] ( const void* data, size_t size ) {
+            buffers.emplace_back( Buffer { int64_t( body.size() - base ), int64_t( size ) } );
+            body.insert( body.end(), (const char*)data, (const char*)data + size );
+            body.resize( ( body.size() + 7 ) / 8 * 8 );
+        };
+
+        for( size_t i=0; i<m_columns.size(); i++ )
+        {
+            auto& c = m_columns[i];
+            nodes.emplace_back( FieldNode { m_rows, c.nulls } );
+            add( c.validity.data(), c.nulls == 0 ? 0 : c.validity.size() );
+            if( m_desc[i].type == ColumnType::Utf8 ) add( c.offsets.data(), c.offsets.size() * sizeof( int32_t ) );
+            add( c.data.data(), c.data.size() );
+        }
+    }
+
+private:
+    struct Column
+    {
+        std::vector<char> data;
+        std::vector<int32_t> offsets;
+        std::vector<uint8_t> validity;
+        int64_t nulls;
+    };
+
+    tracy_force_inline void SetValid( Column& c, bool valid )
+    {
+        const auto bit = m_rows & 7;
+        if( bit == 0 ) c.validity.push_back( 0 );
+        if( valid ) c.validity.back() |= uint8_t( 1 << bit );
+    }
+
+    const std::vector<ColumnDesc>& m_desc;
+    std::vector<Column> m_columns;
+    int64_t m_rows;
+};
+
+// Writes the Arrow IPC file format: magic, schema message, dictionary and record batch messages, then the footer
+// listing all blocks. Record batches may be written from multiple threads, they are serialized in parallel and
+// appended in completion order.
+class ArrowFileWriter
+{
+public:
+    ArrowFileWriter( FILE* f, const std::vector<ColumnDesc>& columns )
+        : m_file( f )
+        , m_columns( columns )
+        , m_offset( 0 )
+        , m_rows( 0 )
+    {
+        Write( "ARROW1\0\0", 8 );
+
+        FlatBuffer fb;
+        const auto msg = Message( fb, Header_Schema, 0 );
+        fb.PatchOffset( msg, Schema( fb ) );
+        std::vector<char> data;
+        Encapsulate( fb, data );
+        Write( data.data(), data.size() );
+    }
+
+    void WriteDictionary( int64_t id, const RecordBatchBuilder& values )
+    {
+        std::vector<RecordBatchBuilder::FieldNode> nodes;
+        std::vector<RecordBatchBuilder::Buffer> buffers;
+        std::vector<char> body;
+        values.Serialize( nodes, buffers, body );
+
+        FlatBuffer fb;
+        const auto msg = Message( fb, Header_DictionaryBatch, body.size() );
+        FlatTable dict( fb );
+        dict.Add<int64_t>( DictionaryBatch_Id, id );
+        dict.AddOffset( DictionaryBatch_Data );
+        fb.PatchOffset( msg, dict.Finish() );
+        fb.PatchOffset( dict.FieldPos( DictionaryBatch_Data ), RecordBatch( fb, values.Rows(), nodes, buffers ) );
+
+        std::vector<char> data;
+        const auto metaSize = Encapsulate( fb, data );
+        data.insert( data.end(), body.begin(), body.end() );
+        std::lock_guard<std::mutex> lock( m_lock );
+        m_dictionaries.emplace_back( Block { m_offset, int32_t( metaSize ), 0, int64_t( body.size() ) } );
+        Write( data.data(), data.size() );
+    }
+
+    void WriteBatch( const RecordBatchBuilder& batch )
+    {
+        if( batch.Rows() == 0 ) return;
+
+        std::vector<RecordBatchBuilder::FieldNode> nodes;
+        std::vector<RecordBatchBuilder::Buffer> buffers;
+        std::vector<char> body;
+        batch.Serialize( nodes, buffers, body );
+
+        FlatBuffer fb;
+        const auto msg = Message( fb, Header_RecordBatch, body.size() );
+        fb.PatchOffset( msg, RecordBatch( fb, batch.Rows(), nodes, buffers ) );
+
+        std::vector<char> data;
+        const auto metaSize = Encapsulate( fb, data );
+        data.insert( data.end(), body.begin(), body.end() );
+        std::lock_guard<std::mutex> lock( m_lock );
+        m_batches.emplace_back( Block { m_offset, int32_t( metaSize ), 0, int64_t( body.size() ) } );
+        m_rows += batch.Rows();
+        Write( data.data(), data.size() );
+    }
+
+    void Finish()
+    {
+        const uint32_t eos[2] = { 0xFFFFFFFF, 0 };
+        Write( eos, sizeof( eos ) );
+
+        FlatBuffer fb;
+        FlatTable footer( fb );
+        footer.Add<int16_t>( Footer_Version, MetadataVersionV5 );
+        footer.AddOffset( Footer_Schema );
+        footer.AddOffset( Footer_Dictionaries );
+        footer.AddOffset( Footer_RecordBatches );
+        fb.Finish( footer.Finish() );
+        fb.PatchOffset( footer.FieldPos( Footer_Schema ), Schema( fb ) );
+        fb.PatchOffset( footer.FieldPos( Footer_Dictionaries ), fb.StructVector( m_dictionaries.data(), m_dictionaries.size(), sizeof( Block ) ) );
+        fb.PatchOffset( footer.FieldPos( Footer_RecordBatches ), fb.StructVector( m_batches.data(), m_batches.size(), sizeof( Block ) ) );
+        fb.Pad( 8 );
+
+        Write( fb.Data(), fb.Size() );
+        const auto size = int32_t( fb.Size() );
+        Write( &size, sizeof( size ) );
+        Write( "ARROW1", 6 );
+    }
+
+    uint64_t Size() const { return m_offset; }
+    uint64_t Rows() const { return m_rows; }
+
+private:
+    enum { MetadataVersionV5 = 4 };
+    enum { Header_Schema = 1, Header_DictionaryBatch = 2, Header_RecordBatch = 3 };
+    enum { Type_Int = 2, Type_Utf8 = 5 };
+
+    enum
+    {
+        Message_Version = 0,
+        Message_HeaderType = 1,
+        Message_Header = 2,
+        Message_BodyLength = 3,
+
+        Schema_Fields = 1,
+
+        Field_Name = 0,
+        Field_Nullable = 1,
+        Field_TypeType = 2,
+        Field_Type = 3,
+        Field_Dictionary = 4,
+        Field_Children = 5,
+
+        Int_BitWidth = 0,
+        Int_IsSigned = 1,
+
+        DictionaryEncoding_Id = 0,
+        DictionaryEncoding_IndexType = 1,
+
+        RecordBatch_Length = 0,
+        RecordBatch_Nodes = 1,
+        RecordBatch_Buffers = 2,
+
+        DictionaryBatch_Id = 0,
+        DictionaryBatch_Data = 1,
+
+        Footer_Version = 0,
+        Footer_Schema = 1,
+        Footer_Dictionaries = 2,
+        Footer_RecordBatches = 3
+    };
+
+    struct Block
+    {
+        int64_t offset;
+        int32_t metaDataLength;
+        int32_t padding;
+        int64_t bodyLength;
+    };
+
+    // Writes the root Message table, returns position of the header offset.
+    static size_t Message( FlatBuffer& fb, uint8_t type, size_t bodyLength )
+    {
+        FlatTable msg( fb );
+        msg.Add<int16_t>( Message_Version, MetadataVersionV5 );
+        msg.Add<uint8_t>( Message_HeaderType, type );
+        msg.AddOffset( Message_Header );
+        msg.Add<int64_t>( Message_BodyLength, int64_t( bodyLength ) );
+        fb.Finish( msg.Finish() );
+        return msg.FieldPos( Message_Header );
+    }
+
+    static size_t Int( FlatBuffer& fb, int bits, bool isSigned )
+    {
+        FlatTable t( fb );
+        t.Add<int32_t>( Int_BitWidth, bits );
+        t.Add<uint8_t>( Int_IsSigned, isSigned );
+        return t.Finish();
+    }
+
+    size_t Schema( FlatBuffer& fb ) const
+    {
+        FlatTable schema( fb );
+        schema.AddOffset( Schema_Fields );
+        const auto pos = schema.Finish();
+        const auto fields = fb.OffsetVector( m_columns.size() );
+        fb.PatchOffset( schema.FieldPos( Schema_Fields ), fields );
+
+        for( size_t i=0; i<m_columns.size(); i++ )
+        {
+            auto& c = m_columns[i];
+            const bool dict = c.dictionary >= 0;
+            const bool utf8 = dict || c.type == ColumnType::Utf8;
+
+            FlatTable field( fb );
+            field.AddOffset( Field_Name );
+            field.Add<uint8_t>( Field_Nullable, c.nullable );
+            field.Add<uint8_t>( Field_TypeType, utf8 ? Type_Utf8 : Type_Int );
+            field.AddOffset( Field_Type );
+            if( dict ) field.AddOffset( Field_Dictionary );
+            field.AddOffset( Field_Children );
+            fb.PatchOffset( fields + 4 + i * 4, field.Finish() );
+
+            fb.PatchOffset( field.FieldPos( Field_Name ), fb.String( c.name ) );
+            if( utf8 )
+            {
+                FlatTable type( fb );
+                fb.PatchOffset( field.FieldPos( Field_Type ), type.Finish() );
+            }
+            else
+            {
+                const bool isSigned = c.type == ColumnType::Int16 || c.type == ColumnType::Int32 || c.type == ColumnType::Int64;
+                fb.PatchOffset( field.FieldPos( Field_Type ), Int( fb, ColumnWidth[(int)c.type] * 8, isSigned ) );
+            }
+            if( dict )
+            {
+                FlatTable encoding( fb );
+                encoding.Add<int64_t>( DictionaryEncoding_Id, c.dictionary );
+                encoding.AddOffset( DictionaryEncoding_IndexType );
+                fb.PatchOffset( field.FieldPos( Field_Dictionary ), encoding.Finish() );
+                fb.PatchOffset( encoding.FieldPos( DictionaryEncoding_IndexType ), Int( fb, 32, true ) );
+            }
+            fb.PatchOffset( field.FieldPos( Field_Children ), fb.OffsetVector( 0 ) );
+        }
+        return pos;
+    }
+
+    static size_t RecordBatch( FlatBuffer& fb, int64_t rows, const std::vector<RecordBatchBuilder::FieldNode>& nodes, const std::vector<RecordBatchBuilder::Buffer>& buffers )
+    {
+        FlatTable rb( fb );
+        rb.Add<int64_t>( RecordBatch_Length, rows );
+        rb.AddOffset( RecordBatch_Nodes );
+        rb.AddOffset( RecordBatch_Buffers );
+        const auto pos = rb.Finish();
+        fb.PatchOffset( rb.FieldPos( RecordBatch_Nodes ), fb.StructVector( nodes.data(), nodes.size(), sizeof( RecordBatchBuilder::FieldNode ) ) );
+        fb.PatchOffset( rb.FieldPos( RecordBatch_Buffers ), fb.StructVector( buffers.data(), buffers.size(), sizeof( RecordBatchBuilder::Buffer ) ) );
+        return pos;
+    }
+
+    // Continuation marker, metadata size and the padded metadata. Returns the size of all three.
+    static size_t Encapsulate( FlatBuffer& fb, std::vector<char>& out )
+    {
+        fb.Pad( 8 );
+        const uint32_t hdr[2] = { 0xFFFFFFFF, uint32_t( fb.Size() ) };
+        out.insert( out.end(), (const char*)hdr, (const char*)hdr + sizeof( hdr ) );
+        out.insert( out.end(), fb.Data(), fb.Data() + fb.Size() );
+        return out.size();
+    }
+
+    void Write( const void* data, size_t size )
+    {
+        fwrite( data, 1, size, m_file );
+        m_offset += size;
+    }
+
+    FILE* m_file;
+    const std::vector<ColumnDesc>& m_columns;
+    int64_t m_offset;
+    uint64_t m_rows;
+    std::mutex m_lock;
+    std::vector<Block> m_dictionaries;
+    std::vector<Block> m_batches;
+};
+
+static const std::vector<ColumnDesc> ZoneColumns = {
+    { "id", ColumnType::UInt64, false, -1 },
+    { "parent", ColumnType::UInt64, true, -1 },
+    { "thread", ColumnType::UInt64, false, -1 },
+    { "name", ColumnType::Int32, false, 0 },
+    { "start", ColumnType::Int64, false, -1 },
+    { "end", ColumnType::Int64, false, -1 },
+    { "self", ColumnType::Int64, false, -1 },
+    { "depth", ColumnType::UInt16, false, -1 },
+    { "text", ColumnType::Utf8, true, -1 },
+};
+
+static const std::vector<ColumnDesc> DictionaryColumns = {
+    { "", ColumnType::Utf8, false, -1 },
+};
+
+static const std::vector<ColumnDesc> MemoryColumns = {
+    { "ptr", ColumnType::UInt64, false, -1 },
+    { "size", ColumnType::UInt64, false, -1 },
+    { "time_alloc", ColumnType::Int64, false, -1 },
+    { "time_free", ColumnType::Int64, true, -1 },
+    { "thread_alloc", ColumnType::UInt64, false, -1 },
+    { "thread_free", ColumnType::UInt64, true, -1 },
+    { "callstack_alloc", ColumnType::UInt32, true, -1 },
+    { "callstack_free", ColumnType::UInt32, true, -1 },
+};
+
+static const std::vector<ColumnDesc> SampleColumns = {
+    { "thread", ColumnType::UInt64, false, -1 },
+    { "time", ColumnType::Int64, false, -1 },
+    { "callstack", ColumnType::UInt32, false, -1 },
+};
+
+static const std::vector<ColumnDesc> CallstackColumns = {
+    { "callstack", ColumnType::UInt32, false, -1 },
+    { "frame", ColumnType::UInt16, false, -1 },
+    { "inline", ColumnType::UInt16, false, -1 },
+    { "address", ColumnType::UInt64, false, -1 },
+    { "function", ColumnType::Utf8, false, -1 },
+    { "file", ColumnType::Utf8, false, -1 },
+    { "line", ColumnType::UInt32, false, -1 },
+};
+
+class Exporter
+{
+public:
+    Exporter( tracy::Worker& worker, int64_t batchRows )
+        : m_worker( worker )
+        , m_batchRows( batchRows )
+        , m_td( std::max<int>( std::thread::hardware_concurrency() - 1, 1 ) )
+    {
+    }
+
+    // Zones are numbered in depth-first order of each thread, threads follow each other. A counting pass over
+    // all threads is done first to establish the numbering and the dictionary of used source locations.
+    void Zones( ArrowFileWriter& out )
+    {
+        auto& threads = m_worker.GetThreadData();
+        std::vector<ThreadZones> tz( threads.size() );
+        for( size_t i=0; i<threads.size(); i++ )
+        {
+            m_td.Queue( [this, &tz, &threads, i] {
+                tz[i].srclocs.resize( 65536 );
+                CountZones( threads[i]->timeline, tz[i] );
+            } );
+        }
+        m_td.Sync();
+
+        std::vector<int32_t> dict( 65536, -1 );
+        RecordBatchBuilder names( DictionaryColumns );
+        for( int i=0; i<65536; i++ )
+        {
+            const auto srcloc = int16_t( i - 32768 );
+            if( std::none_of( tz.begin(), tz.end(), [srcloc] ( const auto& v ) { return v.srclocs[uint16_t( srcloc )] != 0; } ) ) continue;
+            dict[uint16_t( srcloc )] = int32_t( names.Rows() );
+            names.String( 0, m_worker.GetZoneName( m_worker.GetSourceLocation( srcloc ) ) );
+            names.EndRow();
+        }
+        out.WriteDictionary( 0, names );
+
+        uint64_t base = 0;
+        for( size_t i=0; i<threads.size(); i++ )
+        {
+            const auto tid = threads[i]->id;
+            m_td.Queue( [this, &out, &dict, &threads, i, tid, base] {
+                ZoneWriter writer( m_worker, out, dict, m_batchRows, tid, base );
+                writer.Write( threads[i]->timeline, 0, 0 );
+                out.WriteBatch( writer.Batch() );
+            } );
+            base += tz[i].count;
+        }
+        m_td.Sync();
+    }
+
+    void Memory( ArrowFileWriter& out )
+    {
+        auto& mem = m_worker.GetMemData().data;
+        for( size_t start=0; start<mem.size(); start+=m_batchRows )
+        {
+            m_td.Queue( [this, &out, &mem, start] {
+                RecordBatchBuilder batch( MemoryColumns );
+                const auto end = std::min<size_t>( start + m_batchRows, mem.size() );
+                for( size_t i=start; i<end; i++ )
+                {
+                    auto& ev = mem[i];
+                    const bool freed = ev.TimeFree() >= 0;
+                    batch.Value<uint64_t>( 0, ev.Ptr() );
+                    batch.Value<uint64_t>( 1, ev.Size() );
+                    batch.Value<int64_t>( 2, ev.TimeAlloc() );
+                    if( freed ) batch.Value<int64_t>( 3, ev.TimeFree() ); else batch.Null( 3 );
+                    batch.Value<uint64_t>( 4, m_worker.DecompressThread( ev.ThreadAlloc() ) );
+                    if( freed ) batch.Value<uint64_t>( 5, m_worker.DecompressThread( ev.ThreadFree() ) ); else batch.Null( 5 );
+                    if( ev.CsAlloc() != 0 ) batch.Value<uint32_t>( 6, ev.CsAlloc() ); else batch.Null( 6 );
+                    if( ev.csFree.Val() != 0 ) batch.Value<uint32_t>( 7, ev.csFree.Val() ); else batch.Null( 7 );
+                    batch.EndRow();
+                }
+                out.WriteBatch( batch );
+            } );
+        }
+        m_td.Sync();
+    }
+
+    void Samples( ArrowFileWriter& out )
+    {
+        for( auto& td : m_worker.GetThreadData() )
+        {
+            if( td->samples.empty() ) continue;
+            m_td.Queue( [this, &out, td] {
+                RecordBatchBuilder batch( SampleColumns );
+                for( auto& v : td->samples )
+                {
+                    batch.Value<uint64_t>( 0, td->id );
+                    batch.Value<int64_t>( 1, v.time.Val() );
+                    batch.Value<uint32_t>( 2, v.callstack.Val() );
+                    batch.EndRow();
+                    if( batch.Rows() == m_batchRows )
+                    {
+                        out.WriteBatch( batch );
+                        batch.Reset();
+                    }
+                }
+                out.WriteBatch( batch );
+            } );
+        }
+        m_td.Sync();
+    }
+
+    // One row per frame of each call stack. Inlined functions have their own rows, with the same frame index.
+    void Callstacks( ArrowFileWriter& out )
+    {
+        RecordBatchBuilder batch( CallstackColumns );
+        const auto count = m_worker.GetCallstackPayloadCount();
+        for( uint32_t cs=1; cs<=count; cs++ )
+        {
+            auto& callstack = m_worker.GetCallstack( cs );
+            for( uint16_t i=0; i<callstack.size(); i++ )
+            {
+                auto& id = callstack[i];
+                const auto address = m_worker.GetCanonicalPointer( id );
+                auto frameData = id.custom ? nullptr : m_worker.GetCallstackFrame( id );
+                const uint16_t lines = frameData ? frameData->size : 1;
+                for( uint16_t j=0; j<lines; j++ )
+                {
+                    batch.Value<uint32_t>( 0, cs );
+                    batch.Value<uint16_t>( 1, i );
+                    batch.Value<uint16_t>( 2, uint16_t( lines - 1 - j ) );
+                    batch.Value<uint64_t>( 3, address );
+                    if( frameData )
+                    {
+                        auto& frame = frameData->data[j];
+                        batch.String( 4, m_worker.GetString( frame.name ) );
+                        batch.String( 5, m_worker.GetString( frame.file ) );
+                        batch.Value<uint32_t>( 6, frame.line );
+                    }
+                    else
+                    {
+                        batch.String( 4, "[unknown]" );
+                        batch.String( 5, "" );
+                        batch.Value<uint32_t>( 6, 0 );
+                    }
+                    batch.EndRow();
+                }
+            }
+            if( batch.Rows() >= m_batchRows )
+            {
+                out.WriteBatch( batch );
+                batch.Reset();
+            }
+        }
+        out.WriteBatch( batch );
+    }
+
+private:
+    struct ThreadZones
+    {
+        uint64_t count = 0;
+        std::vector<uint8_t> srclocs;
+    };
+
+    void CountZones( const tracy::Vector<tracy::short_ptr<tracy::ZoneEvent>>& vec, ThreadZones& tz )
+    {
+        if( vec.is_magic() )
+        {
+            CountZonesImpl<tracy::VectorAdapterDirect<tracy::ZoneEvent>>( *(const tracy::Vector<tracy::ZoneEvent>*)&vec, tz );
+        }
+        else
+        {
+            CountZonesImpl<tracy::VectorAdapterPointer<tracy::ZoneEvent>>( vec, tz );
+        }
+    }
+
+    template<typename Adapter, typename V>
+    void CountZonesImpl( const V& vec, ThreadZones& tz )
+    {
+        Adapter a;
+        tz.count += vec.size();
+        for( auto& v : vec )
+        {
+            const auto& ev = a( v );
+            tz.srclocs[uint16_t( ev.SrcLoc() )] = 1;
+            if( ev.HasChildren() ) CountZones( m_worker.GetZoneChildren( ev.Child() ), tz );
+        }
+    }
+
+    class ZoneWriter
+    {
+    public:
+        ZoneWriter( tracy::Worker& worker, ArrowFileWriter& out, const std::vector<int32_t>& dict, int64_t batchRows, uint64_t tid, uint64_t firstId )
+            : m_worker( worker )
+            , m_out( out )
+            , m_dict( dict )
+            , m_batch( ZoneColumns )
+            , m_batchRows( batchRows )
+            , m_tid( tid )
+            , m_nextId( firstId )
+        {
+        }
+
+        const RecordBatchBuilder& Batch() const { return m_batch; }
+
+        // Zones are written after their children, to know the self time. Returns total time of the zones.
+        int64_t Write( const tracy::Vector<tracy::short_ptr<tracy::ZoneEvent>>& vec, uint64_t parent, uint16_t depth )
+        {
+            if( vec.is_magic() )
+            {
+                return WriteImpl<tracy::VectorAdapterDirect<tracy::ZoneEvent>>( *(const tracy::Vector<tracy::ZoneEvent>*)&vec, parent, depth );
+            }
+            else
+            {
+                return WriteImpl<tracy::VectorAdapterPointer<tracy::ZoneEvent>>( vec, parent, depth );
+            }
+        }
+
+    private:
+        template<typename Adapter, typename V>
+        int64_t WriteImpl( const V& vec, uint64_t parent, uint16_t depth )
+        {
+            Adapter a;
+            int64_t total = 0;
+            for( auto& v : vec )
+            {
+                const auto& ev = a( v );
+                const auto id = m_nextId++;
+                const auto start = ev.Start();
+                const auto end = m_worker.GetZoneEnd( ev );
+                const auto childTime = ev.HasChildren() ? Write( m_worker.GetZoneChildren( ev.Child() ), id, depth + 1 ) : 0;
+                total += end - start;
+
+                m_batch.Value<uint64_t>( 0, id );
+                if( depth != 0 ) m_batch.Value<uint64_t>( 1, parent ); else m_batch.Null( 1 );
+                m_batch.Value<uint64_t>( 2, m_tid );
+                m_batch.Value<int32_t>( 3, m_dict[uint16_t( ev.SrcLoc() )] );
+                m_batch.Value<int64_t>( 4, start );
+                m_batch.Value<int64_t>( 5, end );
+                m_batch.Value<int64_t>( 6, end - start - childTime );
+                m_batch.Value<uint16_t>( 7, depth );
+                if( m_worker.HasZoneExtra( ev ) && m_worker.GetZoneExtra( ev ).text.Active() )
+                {
+                    m_batch.String( 8, m_worker.GetString( m_worker.GetZoneExtra( ev ).text ) );
+                }
+                else
+                {
+                    m_batch.Null( 8 );
+                }
+                m_batch.EndRow();
+                if( m_batch.Rows() == m_batchRows )
+                {
+                    m_out.WriteBatch( m_batch );
+                    m_batch.Reset();
+                }
+            }
+            return total;
+        }
+
+        tracy::Worker& m_worker;
+        ArrowFileWriter& m_out;
+        const std::vector<int32_t>& m_dict;
+        RecordBatchBuilder m_batch;
+        int64_t m_batchRows;
+        uint64_t m_tid;
+        uint64_t m_nextId;
+    };
+
+    tracy::Worker& m_worker;
+    int64_t m_batchRows;
+    tracy::TaskDispatch m_td;
+};
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    int64_t batchRows = 65536;
+
+    int c;
+    while( ( c = getopt( argc, argv, "b:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'b':
+            batchRows = atoll( optarg );
+            if( batchRows < 1 ) Usage();
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 2 ) Usage();
+    const char* input = argv[optind];
+    const std::string output = argv[optind+1];
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    try
+    {
+        printf( "Loading...\r" );
+        fflush( stdout );
+        const auto eventMask = tracy::EventType::Type( tracy::EventType::Memory | tracy::EventType::Samples );
+        tracy::Worker worker( *f, eventMask, false );
+        f.reset();
+
+        Exporter exporter( worker, batchRows );
+
+        struct Table
+        {
+            const char* name;
+            const std::vector<ColumnDesc>& columns;
+            void(Exporter::*func)( ArrowFileWriter& );
+        };
+        const Table tables[] = {
+            { "zones", ZoneColumns, &Exporter::Zones },
+            { "memory", MemoryColumns, &Exporter::Memory },
+            { "samples", SampleColumns, &Exporter::Samples },
+            { "callstacks", CallstackColumns, &Exporter::Callstacks },
+        };
+
+        for( auto& table : tables )
+        {
+            const auto fn = output + "." + table.name + ".arrow";
+            FILE* fout = fopen( fn.c_str(), "wb" );
+            if( !fout )
+            {
+                fprintf( stderr, "Cannot open output file %s!\n", fn.c_str() );
+                exit( 1 );
+            }
+            printf( "Exporting %s...\r", table.name );
+            fflush( stdout );
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            ArrowFileWriter writer( fout, table.columns );
+            ( exporter.*table.func )( writer );
+            writer.Finish();
+            const bool error = ferror( fout ) != 0;
+            fclose( fout );
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            if( error )
+            {
+                fprintf( stderr, "Cannot write output file %s!\n", fn.c_str() );
+                exit( 1 );
+            }
+
+            const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+            printf( "%-28s %14s rows %12s %12s (%.1f MB/s)\n", fn.c_str(), tracy::RealToString( writer.Rows() ), tracy::MemSizeToString( writer.Size() ),
+                tracy::TimeToString( time ), writer.Size() / ( std::max<int64_t>( 1, time ) / 1e9 ) / ( 1024 * 1024 ) );
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
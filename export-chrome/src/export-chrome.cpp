@@ -0,0 +1,800 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <assert.h>
+#include <inttypes.h>
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../../server/TracyExport.hpp"
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: export-chrome [-p] [-r start:end] [-t thread] input.tracy output\n\n" );
+    printf( "Exports zones, GPU zones, messages, plots and context switches as a chrome:tracing JSON file.\n\n" );
+    printf( "  -p: write a Perfetto protobuf trace instead\n" );
+    printf( "  -r start:end: only export events overlapping the given time range (nanoseconds)\n" );
+    printf( "  -t thread: only export threads with names containing the given text, or with given thread id (can be repeated)\n\n" );
+    printf( "Use - as output to write to the standard output.\n" );
+    exit( 1 );
+}
+
+class OutputBuffer
+{
+public:
+    OutputBuffer( FILE* f ) : m_file( f ), m_offset( 0 ) {}
+    ~OutputBuffer() { Flush(); }
+
+    tracy_force_inline void Write( const void* ptr, size_t size )
+    {
+        if( m_offset + size > BufSize )
+        {
+            Flush();
+            if( size > BufSize )
+            {
+                fwrite( ptr, 1, size, m_file );
+                return;
+            }
+        }
+        memcpy( m_buf + m_offset, ptr, size );
+        m_offset += size;
+    }
+
+    tracy_force_inline void Write( const char* str ) { Write( str, strlen( str ) ); }
+
+    tracy_force_inline void Put( char c )
+    {
+        if( m_offset == BufSize ) Flush();
+        m_buf[m_offset++] = c;
+    }
+
+    void Uint( uint64_t val )
+    {
+        char tmp[20];
+        auto ptr = tmp + sizeof( tmp );
+        do
+        {
+            *--ptr = '0' + val % 10;
+            val /= 10;
+        }
+        while( val != 0 );
+        Write( ptr, tmp + sizeof( tmp ) - ptr );
+    }
+
+    void Int( int64_t val )
+    {
+        if( val < 0 )
+        {
+            Put( '-' );
+            Uint( uint64_t( -val ) );
+        }
+        else
+        {
+            Uint( uint64_t( val ) );
+        }
+    }
+
+    void Flush()
+    {
+        if( m_offset == 0 ) return;
+        fwrite( m_buf, 1, m_offset, m_file );
+        m_offset = 0;
+    }
+
+private:
+    enum { BufSize = 4 * 1024 * 1024 };
+
+    FILE* m_file;
+    size_t m_offset;
+    char m_buf[BufSize];
+};
+
+// Destination format interface. Tracks are numbered by the exporter, processes first, and all events reference
+// a previously declared track.
+class TraceWriter
+{
+public:
+    virtual ~TraceWriter() = default;
+
+    virtual void Begin() = 0;
+    virtual void End() = 0;
+
+    virtual void Process( uint32_t track, uint64_t pid, const char* name ) = 0;
+    virtual void Thread( uint32_t track, uint32_t process, uint64_t tid, const char* name ) = 0;
+    virtual void CounterTrack( uint32_t track, uint32_t process, const char* name ) = 0;
+
+    // Slices on a track must be properly nested. ZoneBegin gets the end time, as some formats write complete slices.
+    virtual void ZoneBegin( uint32_t track, int64_t start, int64_t end, const char* name, const char* text ) = 0;
+    virtual void ZoneEnd( uint32_t track, int64_t end ) = 0;
+    virtual void Instant( uint32_t track, int64_t time, const char* name ) = 0;
+    virtual void Counter( uint32_t track, int64_t time, double val ) = 0;
+};
+
+class ChromeJsonWriter : public TraceWriter
+{
+public:
+    ChromeJsonWriter( OutputBuffer& out ) : m_out( out ), m_first( true ) {}
+
+    void Begin() override { m_out.Write( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" ); }
+    void End() override { m_out.Write( "\n]}\n" ); }
+
+    void Process( uint32_t track, uint64_t pid, const char* name ) override
+    {
+        SetTrack( track, pid, 0, nullptr );
+        EventStart( "M", track );
+        m_out.Write( ",\"name\":\"process_name\",\"args\":{\"name\":" );
+        String( name );
+        m_out.Write( "}}" );
+    }
+
+    void Thread( uint32_t track, uint32_t process, uint64_t tid, const char* name ) override
+    {
+        SetTrack( track, m_tracks[process].pid, tid, nullptr );
+        EventStart( "M", track );
+        m_out.Write( ",\"name\":\"thread_name\",\"args\":{\"name\":" );
+        String( name );
+        m_out.Write( "}}" );
+    }
+
+    void CounterTrack( uint32_t track, uint32_t process, const char* name ) override
+    {
+        SetTrack( track, m_tracks[process].pid, 0, name );
+    }
+
+    void ZoneBegin( uint32_t track, int64_t start, int64_t end, const char* name, const char* text ) override
+    {
+        EventStart( "X", track );
+        m_out.Write( ",\"ts\":" );
+        Time( start );
+        m_out.Write( ",\"dur\":" );
+        Time( end - start );
+        m_out.Write( ",\"name\":" );
+        String( name );
+        if( text )
+        {
+            m_out.Write( ",\"args\":{\"text\":" );
+            String( text );
+            m_out.Put( '}' );
+        }
+        m_out.Put( '}' );
+    }
+
+    void ZoneEnd( uint32_t, int64_t ) override {}
+
+    void Instant( uint32_t track, int64_t time, const char* name ) override
+    {
+        EventStart( "i", track );
+        m_out.Write( ",\"s\":\"t\",\"ts\":" );
+        Time( time );
+        m_out.Write( ",\"name\":" );
+        String( name );
+        m_out.Put( '}' );
+    }
+
+    void Counter( uint32_t track, int64_t time, double val ) override
+    {
+        EventStart( "C", track );
+        m_out.Write( ",\"ts\":" );
+        Time( time );
+        m_out.Write( ",\"name\":" );
+        String( m_tracks[track].name );
+        char buf[64];
+        m_out.Write( buf, sprintf( buf, ",\"args\":{\"value\":%.17g}}", val ) );
+    }
+
+private:
+    struct Track
+    {
+        uint64_t pid;
+        uint64_t tid;
+        const char* name;
+    };
+
+    void SetTrack( uint32_t track, uint64_t pid, uint64_t tid, const char* name )
+    {
+        if( m_tracks.size() <= track ) m_tracks.resize( track + 1 );
+        m_tracks[track] = Track { pid, tid, name };
+    }
+
+    void EventStart( const char* ph, uint32_t track )
+    {
+        m_out.Write( m_first ? "\n{\"ph\":\"" : ",\n{\"ph\":\"" );
+        m_first = false;
+        m_out.Write( ph );
+        m_out.Write( "\",\"pid\":" );
+        m_out.Uint( m_tracks[track].pid );
+        m_out.Write( ",\"tid\":" );
+        m_out.Uint( m_tracks[track].tid );
+    }
+
+    // Nanoseconds, written as microseconds with fractional part.
+    void Time( int64_t t )
+    {
+        if( t < 0 )
+        {
+            m_out.Put( '-' );
+            t = -t;
+        }
+        m_out.Uint( uint64_t( t ) / 1000 );
+        const auto frac = uint32_t( uint64_t( t ) % 1000 );
+        if( frac != 0 )
+        {
+            char buf[4] = { '.', char( '0' + frac / 100 ), char( '0' + frac / 10 % 10 ), char( '0' + frac % 10 ) };
+            m_out.Write( buf, 4 );
+        }
+    }
+
+    void String( const char* str )
+    {
+        m_out.Put( '"' );
+        for(;;)
+        {
+            auto ptr = str;
+            while( (unsigned char)*ptr >= 0x20 && *ptr != '"' && *ptr != '\\' ) ptr++;
+            m_out.Write( str, ptr - str );
+            if( *ptr == '\0' ) break;
+            switch( *ptr )
+            {
+            case '"': m_out.Write( "\\\"", 2 ); break;
+            case '\\': m_out.Write( "\\\\", 2 ); break;
+            case '\n': m_out.Write( "\\n", 2 ); break;
+            case '\t': m_out.Write( "\\t", 2 ); break;
+            default:
+            {
+                char buf[8];
+                m_out.Write( buf, sprintf( buf, "\\u%04x", (unsigned char)*ptr ) );
+                break;
+            }
+            }
+            str = ptr + 1;
+        }
+        m_out.Put( '"' );
+    }
+
+    OutputBuffer& m_out;
+    bool m_first;
+    std::vector<Track> m_tracks;
+};
+
+// Writes the Perfetto TrackEvent format, as a sequence of TracePacket messages of a Trace message.
+class PerfettoWriter : public TraceWriter
+{
+public:
+    PerfettoWriter( OutputBuffer& out ) : m_out( out ), m_nextIid( 1 ) {}
+
+    void Begin() override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        p.Varint( TracePacket_TrustedPacketSequenceId, SequenceId );
+        p.Varint( TracePacket_SequenceFlags, SeqIncrementalStateCleared );
+        WritePacket();
+    }
+
+    void End() override {}
+
+    void Process( uint32_t track, uint64_t pid, const char* name ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        const auto td = p.BeginMessage( TracePacket_TrackDescriptor );
+        p.Varint( TrackDescriptor_Uuid, Uuid( track ) );
+        const auto pd = p.BeginMessage( TrackDescriptor_Process );
+        p.Varint( ProcessDescriptor_Pid, uint32_t( pid ) );
+        p.String( ProcessDescriptor_ProcessName, name );
+        p.EndMessage( pd );
+        p.EndMessage( td );
+        WritePacket();
+        SetTrackPid( track, pid );
+    }
+
+    void Thread( uint32_t track, uint32_t process, uint64_t tid, const char* name ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        const auto td = p.BeginMessage( TracePacket_TrackDescriptor );
+        p.Varint( TrackDescriptor_Uuid, Uuid( track ) );
+        p.Varint( TrackDescriptor_ParentUuid, Uuid( process ) );
+        const auto thd = p.BeginMessage( TrackDescriptor_Thread );
+        p.Varint( ThreadDescriptor_Pid, uint32_t( m_trackPid[process] ) );
+        p.Varint( ThreadDescriptor_Tid, uint32_t( tid ) );
+        p.String( ThreadDescriptor_ThreadName, name );
+        p.EndMessage( thd );
+        p.EndMessage( td );
+        WritePacket();
+    }
+
+    void CounterTrack( uint32_t track, uint32_t process, const char* name ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        const auto td = p.BeginMessage( TracePacket_TrackDescriptor );
+        p.Varint( TrackDescriptor_Uuid, Uuid( track ) );
+        p.Varint( TrackDescriptor_ParentUuid, Uuid( process ) );
+        p.String( TrackDescriptor_Name, name );
+        p.EndMessage( p.BeginMessage( TrackDescriptor_Counter ) );
+        p.EndMessage( td );
+        WritePacket();
+    }
+
+    void ZoneBegin( uint32_t track, int64_t start, int64_t, const char* name, const char* text ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        const auto iid = InternName( name );
+        EventStart( start );
+        const auto te = p.BeginMessage( TracePacket_TrackEvent );
+        p.Varint( TrackEvent_Type, TypeSliceBegin );
+        p.Varint( TrackEvent_TrackUuid, Uuid( track ) );
+        p.Varint( TrackEvent_NameIid, iid );
+        if( text )
+        {
+            const auto da = p.BeginMessage( TrackEvent_DebugAnnotations );
+            p.String( DebugAnnotation_Name, "text" );
+            p.String( DebugAnnotation_StringValue, text );
+            p.EndMessage( da );
+        }
+        p.EndMessage( te );
+        WritePacket();
+    }
+
+    void ZoneEnd( uint32_t track, int64_t end ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        EventStart( end );
+        const auto te = p.BeginMessage( TracePacket_TrackEvent );
+        p.Varint( TrackEvent_Type, TypeSliceEnd );
+        p.Varint( TrackEvent_TrackUuid, Uuid( track ) );
+        p.EndMessage( te );
+        WritePacket();
+    }
+
+    void Instant( uint32_t track, int64_t time, const char* name ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        EventStart( time );
+        const auto te = p.BeginMessage( TracePacket_TrackEvent );
+        p.Varint( TrackEvent_Type, TypeInstant );
+        p.Varint( TrackEvent_TrackUuid, Uuid( track ) );
+        p.String( TrackEvent_Name, name );
+        p.EndMessage( te );
+        WritePacket();
+    }
+
+    void Counter( uint32_t track, int64_t time, double val ) override
+    {
+        auto& p = m_packet;
+        p.Clear();
+        EventStart( time );
+        const auto te = p.BeginMessage( TracePacket_TrackEvent );
+        p.Varint( TrackEvent_Type, TypeCounter );
+        p.Varint( TrackEvent_TrackUuid, Uuid( track ) );
+        p.Double( TrackEvent_DoubleCounterValue, val );
+        p.EndMessage( te );
+        WritePacket();
+    }
+
+private:
+    enum { SequenceId = 1 };
+    enum { SeqIncrementalStateCleared = 1, SeqNeedsIncrementalState = 2 };
+    enum { TypeSliceBegin = 1, TypeSliceEnd = 2, TypeInstant = 3, TypeCounter = 4 };
+
+    enum
+    {
+        Trace_Packet = 1,
+
+        TracePacket_Timestamp = 8,
+        TracePacket_TrustedPacketSequenceId = 10,
+        TracePacket_TrackEvent = 11,
+        TracePacket_InternedData = 12,
+        TracePacket_SequenceFlags = 13,
+        TracePacket_TrackDescriptor = 60,
+
+        TrackDescriptor_Uuid = 1,
+        TrackDescriptor_Name = 2,
+        TrackDescriptor_Process = 3,
+        TrackDescriptor_Thread = 4,
+        TrackDescriptor_ParentUuid = 5,
+        TrackDescriptor_Counter = 8,
+
+        ProcessDescriptor_Pid = 1,
+        ProcessDescriptor_ProcessName = 6,
+
+        ThreadDescriptor_Pid = 1,
+        ThreadDescriptor_Tid = 2,
+        ThreadDescriptor_ThreadName = 5,
+
+        TrackEvent_DebugAnnotations = 4,
+        TrackEvent_Type = 9,
+        TrackEvent_NameIid = 10,
+        TrackEvent_TrackUuid = 11,
+        TrackEvent_Name = 23,
+        TrackEvent_DoubleCounterValue = 44,
+
+        DebugAnnotation_StringValue = 6,
+        DebugAnnotation_Name = 10,
+
+        InternedData_EventNames = 2,
+        EventName_Iid = 1,
+        EventName_Name = 2
+    };
+
+    static uint64_t Uuid( uint32_t track ) { return uint64_t( track ) + 1; }
+
+    void SetTrackPid( uint32_t track, uint64_t pid )
+    {
+        if( m_trackPid.size() <= track ) m_trackPid.resize( track + 1 );
+        m_trackPid[track] = pid;
+    }
+
+    void EventStart( int64_t time )
+    {
+        m_packet.Varint( TracePacket_Timestamp, uint64_t( std::max<int64_t>( 0, time ) ) );
+        m_packet.Varint( TracePacket_TrustedPacketSequenceId, SequenceId );
+        m_packet.Varint( TracePacket_SequenceFlags, SeqNeedsIncrementalState );
+    }
+
+    // Zone names are interned, new names are sent along with the packet which uses them first. Names are
+    // stable string pointers owned by the Worker.
+    uint64_t InternName( const char* name )
+    {
+        auto it = m_iids.find( name );
+        if( it != m_iids.end() ) return it->second;
+        const auto iid = m_nextIid++;
+        m_iids.emplace( name, iid );
+        auto& p = m_packet;
+        const auto id = p.BeginMessage( TracePacket_InternedData );
+        const auto en = p.BeginMessage( InternedData_EventNames );
+        p.Varint( EventName_Iid, iid );
+        p.String( EventName_Name, name );
+        p.EndMessage( en );
+        p.EndMessage( id );
+        return iid;
+    }
+
+    void WritePacket()
+    {
+        char hdr[16];
+        size_t sz = 0;
+        hdr[sz++] = char( ( Trace_Packet << 3 ) | 2 );
+        auto val = m_packet.Size();
+        while( val >= 0x80 )
+        {
+            hdr[sz++] = char( 0x80 | ( val & 0x7F ) );
+            val >>= 7;
+        }
+        hdr[sz++] = char( val );
+        m_out.Write( hdr, sz );
+        m_out.Write( m_packet.Data(), m_packet.Size() );
+    }
+
+    OutputBuffer& m_out;
+    tracy::ProtoBuffer m_packet;
+    tracy::unordered_flat_map<const char*, uint64_t> m_iids;
+    uint64_t m_nextIid;
+    std::vector<uint64_t> m_trackPid;
+};
+
+template<typename T, typename F>
+static void ForEach( const tracy::Vector<tracy::short_ptr<T>>& vec, F&& f )
+{
+    if( vec.is_magic() )
+    {
+        for( auto& v : *(const tracy::Vector<T>*)&vec ) f( v );
+    }
+    else
+    {
+        for( auto& v : vec ) f( *v );
+    }
+}
+
+class Exporter
+{
+public:
+    Exporter( tracy::Worker& worker, TraceWriter& writer, int64_t rangeMin, int64_t rangeMax )
+        : m_worker( worker )
+        , m_writer( writer )
+        , m_rangeMin( rangeMin )
+        , m_rangeMax( rangeMax )
+        , m_tracks( 0 )
+        , m_threadFilter( worker )
+    {
+    }
+
+    void SetThreadFilter( const std::vector<const char*>& filter ) { m_threadFilter.Set( filter ); }
+
+    void Export()
+    {
+        m_writer.Begin();
+
+        const auto pid = m_worker.GetPid();
+        const auto& program = m_worker.GetCaptureProgram();
+        const auto process = m_tracks++;
+        m_writer.Process( process, pid, program.empty() ? "Tracy" : program.c_str() );
+
+        for( auto& td : m_worker.GetThreadData() )
+        {
+            if( !m_threadFilter.Pass( td->id ) ) continue;
+            const auto track = m_tracks++;
+            m_writer.Thread( track, process, td->id, m_worker.GetThreadName( td->id ) );
+            ExportZones( td->timeline, track );
+            for( auto& msg : td->messages )
+            {
+                if( msg->time < m_rangeMin ) continue;
+                if( msg->time > m_rangeMax ) break;
+                m_writer.Instant( track, msg->time, m_worker.GetString( msg->ref ) );
+            }
+        }
+
+        for( auto& plot : m_worker.GetPlots() )
+        {
+            const auto track = m_tracks++;
+            m_writer.CounterTrack( track, process, GetPlotName( plot ) );
+            auto& data = plot->data;
+            auto it = std::lower_bound( data.begin(), data.end(), m_rangeMin, [] ( const auto& l, const auto& r ) { return l.time.Val() < r; } );
+            for( ; it != data.end() && it->time.Val() <= m_rangeMax; ++it )
+            {
+                m_writer.Counter( track, it->time.Val(), it->val );
+            }
+        }
+
+        ExportGpu( pid );
+        ExportCpus( pid );
+
+        m_writer.End();
+    }
+
+private:
+    const char* GetPlotName( const tracy::PlotData* plot ) const
+    {
+        switch( plot->type )
+        {
+        case tracy::PlotType::User: return m_worker.GetString( plot->name );
+        case tracy::PlotType::Memory: return "Memory usage";
+        case tracy::PlotType::SysTime: return "CPU usage";
+        default: return "???";
+        }
+    }
+
+    void ExportZones( const tracy::Vector<tracy::short_ptr<tracy::ZoneEvent>>& vec, uint32_t track )
+    {
+        if( vec.is_magic() )
+        {
+            ExportZonesImpl<tracy::VectorAdapterDirect<tracy::ZoneEvent>>( *(const tracy::Vector<tracy::ZoneEvent>*)&vec, track );
+        }
+        else
+        {
+            ExportZonesImpl<tracy::VectorAdapterPointer<tracy::ZoneEvent>>( vec, track );
+        }
+    }
+
+    // Sibling zones do not overlap, so the first zone in range is found by its end time, and the
+    // export stops at the first zone starting after the range.
+    template<typename Adapter, typename V>
+    void ExportZonesImpl( const V& vec, uint32_t track )
+    {
+        Adapter a;
+        auto it = std::lower_bound( vec.begin(), vec.end(), std::max<int64_t>( 0, m_rangeMin ), [] ( const auto& l, const auto& r ) { Adapter a; return (uint64_t)a(l).End() < (uint64_t)r; } );
+        for( ; it != vec.end(); ++it )
+        {
+            auto& ev = a(*it);
+            const auto start = ev.Start();
+            if( start > m_rangeMax ) break;
+            const auto end = m_worker.GetZoneEnd( ev );
+            if( end < m_rangeMin ) continue;
+
+            const char* text = nullptr;
+            if( m_worker.HasZoneExtra( ev ) )
+            {
+                auto& extra = m_worker.GetZoneExtra( ev );
+                if( extra.text.Active() ) text = m_worker.GetString( extra.text );
+            }
+
+            m_writer.ZoneBegin( track, start, end, m_worker.GetZoneName( ev ), text );
+            if( ev.HasChildren() ) ExportZones( m_worker.GetZoneChildren( ev.Child() ), track );
+            m_writer.ZoneEnd( track, end );
+        }
+    }
+
+    void ExportGpuZones( const tracy::Vector<tracy::short_ptr<tracy::GpuEvent>>& vec, uint32_t track, bool topLevel )
+    {
+        ForEach( vec, [this, track, topLevel] ( const tracy::GpuEvent& ev ) {
+            const auto start = ev.GpuStart();
+            if( start < 0 || start > m_rangeMax ) return;
+            const auto end = m_worker.GetZoneEnd( ev );
+            if( end < m_rangeMin ) return;
+            if( topLevel && !m_threadFilter.Pass( m_worker.DecompressThread( ev.Thread() ) ) ) return;
+
+            m_writer.ZoneBegin( track, start, end, m_worker.GetZoneName( ev ), nullptr );
+            if( ev.Child() >= 0 ) ExportGpuZones( m_worker.GetGpuChildren( ev.Child() ), track, false );
+            m_writer.ZoneEnd( track, end );
+        } );
+    }
+
+    // GPU contexts and CPU cores are exported as threads of separate pseudo processes.
+    void ExportGpu( uint64_t pid )
+    {
+        auto& gpuData = m_worker.GetGpuData();
+        if( gpuData.empty() ) return;
+
+        const auto process = m_tracks++;
+        m_writer.Process( process, pid + 1, "GPU" );
+        uint64_t tid = 0;
+        for( size_t i=0; i<gpuData.size(); i++ )
+        {
+            for( auto& td : gpuData[i]->threadData )
+            {
+                char buf[64];
+                if( gpuData[i]->threadData.size() == 1 )
+                {
+                    sprintf( buf, "GPU context %zu", i );
+                }
+                else
+                {
+                    sprintf( buf, "GPU context %zu, thread %" PRIu64, i, td.first );
+                }
+                const auto track = m_tracks++;
+                m_writer.Thread( track, process, tid++, buf );
+                ExportGpuZones( td.second.timeline, track, true );
+            }
+        }
+    }
+
+    void ExportCpus( uint64_t pid )
+    {
+        const auto cpus = m_worker.GetCpuDataCpuCount();
+        if( cpus == 0 ) return;
+
+        const auto process = m_tracks++;
+        m_writer.Process( process, pid + 2, "CPU cores" );
+        const auto cpuData = m_worker.GetCpuData();
+        for( int i=0; i<cpus; i++ )
+        {
+            auto& cs = cpuData[i].cs;
+            if( cs.empty() ) continue;
+            char buf[32];
+            sprintf( buf, "CPU %i", i );
+            const auto track = m_tracks++;
+            m_writer.Thread( track, process, i, buf );
+
+            auto it = std::lower_bound( cs.begin(), cs.end(), m_rangeMin, [] ( const auto& l, const auto& r ) { return ( l.IsEndValid() ? l.End() : l.Start() ) < r; } );
+            for( ; it != cs.end() && it->Start() <= m_rangeMax; ++it )
+            {
+                if( !it->IsEndValid() ) continue;
+                const auto tid = m_worker.DecompressThreadExternal( it->Thread() );
+                if( !m_threadFilter.Pass( tid ) ) continue;
+                const auto name = m_worker.GetThreadName( tid );
+                m_writer.ZoneBegin( track, it->Start(), it->End(), name, nullptr );
+                m_writer.ZoneEnd( track, it->End() );
+            }
+        }
+    }
+
+    tracy::Worker& m_worker;
+    TraceWriter& m_writer;
+    int64_t m_rangeMin;
+    int64_t m_rangeMax;
+    uint32_t m_tracks;
+    tracy::ThreadFilter m_threadFilter;
+};
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    bool perfetto = false;
+    int64_t rangeMin = std::numeric_limits<int64_t>::min();
+    int64_t rangeMax = std::numeric_limits<int64_t>::max();
+    std::vector<const char*> threadFilter;
+
+    int c;
+    while( ( c = getopt( argc, argv, "pr:t:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'p':
+            perfetto = true;
+            break;
+        case 'r':
+            if( sscanf( optarg, "%" SCNd64 ":%" SCNd64, &rangeMin, &rangeMax ) != 2 || rangeMin > rangeMax ) Usage();
+            break;
+        case 't':
+            threadFilter.push_back( optarg );
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 2 ) Usage();
+    const char* input = argv[optind];
+    const char* output = argv[optind+1];
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    try
+    {
+        const auto eventMask = tracy::EventType::Type( tracy::EventType::Messages | tracy::EventType::Plots | tracy::EventType::ContextSwitches );
+        tracy::Worker worker( *f, eventMask, false );
+        f.reset();
+
+        const bool toStdout = strcmp( output, "-" ) == 0;
+        FILE* fout = toStdout ? stdout : fopen( output, "wb" );
+        if( !fout )
+        {
+            fprintf( stderr, "Cannot open output file!\n" );
+            exit( 1 );
+        }
+
+        {
+            auto out = std::make_unique<OutputBuffer>( fout );
+            std::unique_ptr<TraceWriter> writer;
+            if( perfetto )
+            {
+                writer = std::make_unique<PerfettoWriter>( *out );
+            }
+            else
+            {
+                writer = std::make_unique<ChromeJsonWriter>( *out );
+            }
+            Exporter exporter( worker, *writer, rangeMin, rangeMax );
+            exporter.SetThreadFilter( threadFilter );
+            exporter.Export();
+        }
+
+        const bool error = ferror( fout ) != 0;
+        if( !toStdout ) fclose( fout );
+        if( error )
+        {
+            fprintf( stderr, "Cannot write output file!\n" );
+            exit( 1 );
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
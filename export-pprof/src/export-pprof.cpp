@@ -0,0 +1,657 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <assert.h>
+#include <deque>
+#include <inttypes.h>
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../../server/TracyExport.hpp"
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: export-pprof [-m mode] [-f] [-r start:end] [-t thread] input.tracy output\n\n" );
+    printf( "Exports call stacks of a trace in the pprof profile format.\n\n" );
+    printf( "  -m mode: source of the stacks (default samples)\n" );
+    printf( "      samples: call stack samples, weighted by sample count\n" );
+    printf( "      zones: zone paths, weighted by zone self time\n" );
+    printf( "      memory: allocation call stacks, weighted by allocated and in use bytes and counts\n" );
+    printf( "  -f: write folded stacks instead, one stack per line, weighted by the first value of the mode\n" );
+    printf( "  -r start:end: only export events fully contained in the given time range (nanoseconds)\n" );
+    printf( "  -t thread: only export threads with names containing the given text, or with given thread id (can be repeated)\n\n" );
+    printf( "Use - as output to write to the standard output.\n" );
+    exit( 1 );
+}
+
+enum class Mode
+{
+    Samples,
+    Zones,
+    Memory
+};
+
+// One frame of a stack. Inlined functions are separate lines of a single frame, innermost first.
+struct FrameLine
+{
+    const char* name;
+    const char* file;
+    uint32_t line;
+};
+
+// Stacks gathered from the trace, in a form shared by the output formats. Frames are listed leaf first.
+class StackProfile
+{
+public:
+    enum { MaxValues = 4 };
+
+    struct ValueType
+    {
+        const char* type;
+        const char* unit;
+    };
+
+    struct Sample
+    {
+        uint32_t frames;
+        uint32_t frameCount;
+        int64_t values[MaxValues];
+    };
+
+    struct Frame
+    {
+        uint64_t address;
+        uint32_t lines;
+        uint32_t lineCount;
+    };
+
+    std::vector<ValueType> valueTypes;
+    std::vector<Sample> samples;
+    std::vector<uint32_t> sampleFrames;
+    std::vector<Frame> frames;
+    std::vector<FrameLine> lines;
+    int64_t period = 0;
+    int64_t timeNs = 0;
+    int64_t durationNs = 0;
+
+    uint32_t AddFrame( uint64_t address )
+    {
+        frames.emplace_back( Frame { address, uint32_t( lines.size() ), 0 } );
+        return uint32_t( frames.size() - 1 );
+    }
+
+    void AddLine( const char* name, const char* file, uint32_t line )
+    {
+        lines.emplace_back( FrameLine { name, file, line } );
+        frames.back().lineCount++;
+    }
+};
+
+// Encodes the profile.proto message of pprof. The output is not gzip compressed, which pprof accepts.
+class PprofWriter
+{
+public:
+    PprofWriter( const StackProfile& profile ) : m_profile( profile )
+    {
+        m_strings.emplace_back( "" );
+        m_stringMap.emplace( "", 0 );
+    }
+
+    void Write( FILE* f )
+    {
+        auto& p = m_buf;
+
+        for( auto& v : m_profile.valueTypes )
+        {
+            const auto vt = p.BeginMessage( Profile_SampleType );
+            p.Varint( ValueType_Type, String( v.type ) );
+            p.Varint( ValueType_Unit, String( v.unit ) );
+            p.EndMessage( vt );
+        }
+
+        const auto nval = m_profile.valueTypes.size();
+        for( auto& s : m_profile.samples )
+        {
+            const auto sm = p.BeginMessage( Profile_Sample );
+            const auto loc = p.BeginMessage( Sample_LocationId );
+            for( uint32_t i=0; i<s.frameCount; i++ ) p.RawVarint( m_profile.sampleFrames[s.frames+i] + 1 );
+            p.EndMessage( loc );
+            const auto val = p.BeginMessage( Sample_Value );
+            for( size_t i=0; i<nval; i++ ) p.RawVarint( uint64_t( s.values[i] ) );
+            p.EndMessage( val );
+            p.EndMessage( sm );
+        }
+
+        for( size_t i=0; i<m_profile.frames.size(); i++ )
+        {
+            auto& frame = m_profile.frames[i];
+            const auto lc = p.BeginMessage( Profile_Location );
+            p.Varint( Location_Id, i+1 );
+            if( frame.address != 0 ) p.Varint( Location_Address, frame.address );
+            for( uint32_t j=0; j<frame.lineCount; j++ )
+            {
+                auto& line = m_profile.lines[frame.lines+j];
+                const auto ln = p.BeginMessage( Location_Line );
+                p.Varint( Line_FunctionId, Function( line ) );
+                if( line.line != 0 ) p.Varint( Line_Line, line.line );
+                p.EndMessage( ln );
+            }
+            p.EndMessage( lc );
+        }
+
+        for( size_t i=0; i<m_functions.size(); i++ )
+        {
+            const auto fn = p.BeginMessage( Profile_Function );
+            p.Varint( Function_Id, i+1 );
+            p.Varint( Function_Name, m_functions[i].name );
+            p.Varint( Function_SystemName, m_functions[i].name );
+            p.Varint( Function_Filename, m_functions[i].file );
+            p.EndMessage( fn );
+        }
+
+        if( !m_profile.valueTypes.empty() ) p.Varint( Profile_DefaultSampleType, String( m_profile.valueTypes[0].type ) );
+        if( m_profile.timeNs != 0 ) p.Varint( Profile_TimeNanos, m_profile.timeNs );
+        p.Varint( Profile_DurationNanos, m_profile.durationNs );
+        if( m_profile.period != 0 )
+        {
+            const auto pt = p.BeginMessage( Profile_PeriodType );
+            p.Varint( ValueType_Type, String( "cpu" ) );
+            p.Varint( ValueType_Unit, String( "nanoseconds" ) );
+            p.EndMessage( pt );
+            p.Varint( Profile_Period, m_profile.period );
+        }
+
+        // String table goes last, as all strings are known only now.
+        for( auto& str : m_strings ) p.String( Profile_StringTable, str );
+
+        fwrite( p.Data(), 1, p.Size(), f );
+    }
+
+private:
+    enum
+    {
+        Profile_SampleType = 1,
+        Profile_Sample = 2,
+        Profile_Location = 4,
+        Profile_Function = 5,
+        Profile_StringTable = 6,
+        Profile_TimeNanos = 9,
+        Profile_DurationNanos = 10,
+        Profile_PeriodType = 11,
+        Profile_Period = 12,
+        Profile_DefaultSampleType = 14,
+
+        ValueType_Type = 1,
+        ValueType_Unit = 2,
+
+        Sample_LocationId = 1,
+        Sample_Value = 2,
+
+        Location_Id = 1,
+        Location_Address = 3,
+        Location_Line = 4,
+
+        Line_FunctionId = 1,
+        Line_Line = 2,
+
+        Function_Id = 1,
+        Function_Name = 2,
+        Function_SystemName = 3,
+        Function_Filename = 4
+    };
+
+    struct FunctionData
+    {
+        uint64_t name;
+        uint64_t file;
+    };
+
+    // Strings are stable pointers, owned either by the Worker or by the exporter.
+    uint64_t String( const char* str )
+    {
+        auto it = m_stringMap.find( str );
+        if( it != m_stringMap.end() ) return it->second;
+        const auto idx = m_strings.size();
+        m_strings.emplace_back( str );
+        m_stringMap.emplace( str, idx );
+        return idx;
+    }
+
+    uint64_t Function( const FrameLine& line )
+    {
+        const auto name = String( line.name );
+        const auto file = String( line.file );
+        const auto key = ( name << 32 ) | file;
+        auto it = m_functionMap.find( key );
+        if( it != m_functionMap.end() ) return it->second;
+        m_functions.emplace_back( FunctionData { name, file } );
+        const auto id = m_functions.size();
+        m_functionMap.emplace( key, id );
+        return id;
+    }
+
+    const StackProfile& m_profile;
+    tracy::ProtoBuffer m_buf;
+    std::vector<const char*> m_strings;
+    tracy::unordered_flat_map<const char*, uint64_t> m_stringMap;
+    std::vector<FunctionData> m_functions;
+    tracy::unordered_flat_map<uint64_t, uint64_t> m_functionMap;
+};
+
+// Writes stacks in the folded format used by flame graph tools: frames from root to leaf separated with
+// semicolons, followed by the weight.
+static void WriteFolded( const StackProfile& profile, FILE* f )
+{
+    std::string line;
+    for( auto& s : profile.samples )
+    {
+        if( s.values[0] == 0 ) continue;
+        line.clear();
+        for( uint32_t i=s.frameCount; i>0; i-- )
+        {
+            auto& frame = profile.frames[profile.sampleFrames[s.frames+i-1]];
+            for( uint32_t j=frame.lineCount; j>0; j-- )
+            {
+                if( !line.empty() ) line.push_back( ';' );
+                for( auto ptr = profile.lines[frame.lines+j-1].name; *ptr; ptr++ )
+                {
+                    line.push_back( ( *ptr == ';' || *ptr == '\n' ) ? ' ' : *ptr );
+                }
+            }
+        }
+        fprintf( f, "%s %" PRIi64 "\n", line.c_str(), s.values[0] );
+    }
+}
+
+class StackCollector
+{
+public:
+    StackCollector( tracy::Worker& worker, StackProfile& profile, int64_t rangeMin, int64_t rangeMax )
+        : m_worker( worker )
+        , m_profile( profile )
+        , m_rangeMin( rangeMin )
+        , m_rangeMax( rangeMax )
+        , m_threadFilter( worker )
+    {
+    }
+
+    void SetThreadFilter( const std::vector<const char*>& filter ) { m_threadFilter.Set( filter ); }
+
+    void CollectSamples()
+    {
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "samples", "count" } );
+        const auto period = m_worker.GetSamplingPeriod();
+        if( period != 0 )
+        {
+            m_profile.valueTypes.emplace_back( StackProfile::ValueType { "cpu", "nanoseconds" } );
+            m_profile.period = period;
+        }
+
+        // Call stacks are deduplicated by the Worker, so samples can be aggregated by call stack index.
+        tracy::unordered_flat_map<uint32_t, uint32_t> counts;
+        for( auto& td : m_worker.GetThreadData() )
+        {
+            if( !m_threadFilter.Pass( td->id ) ) continue;
+            auto& samples = td->samples;
+            auto it = std::lower_bound( samples.begin(), samples.end(), m_rangeMin, [] ( const auto& l, const auto& r ) { return l.time.Val() < r; } );
+            for( ; it != samples.end() && it->time.Val() <= m_rangeMax; ++it )
+            {
+                counts[it->callstack.Val()]++;
+            }
+        }
+
+        for( auto& v : SortedKeys( counts ) )
+        {
+            auto& sample = AddCallstackSample( v.first );
+            sample.values[0] = v.second;
+            sample.values[1] = int64_t( v.second ) * period;
+        }
+    }
+
+    void CollectZones()
+    {
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "time", "nanoseconds" } );
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "zones", "count" } );
+
+        // Zone paths are kept in a tree of source locations, shared by all threads.
+        m_nodes.emplace_back( Node { 0, 0, 0, 0 } );
+        for( auto& td : m_worker.GetThreadData() )
+        {
+            if( !m_threadFilter.Pass( td->id ) ) continue;
+            CollectZones( td->timeline, 0 );
+        }
+
+        tracy::unordered_flat_map<int16_t, uint32_t> srclocFrames;
+        for( size_t i=1; i<m_nodes.size(); i++ )
+        {
+            auto& node = m_nodes[i];
+            if( node.count == 0 ) continue;
+            StackProfile::Sample sample = { uint32_t( m_profile.sampleFrames.size() ), 0, { node.self, int64_t( node.count ) } };
+            for( auto idx = uint32_t( i ); idx != 0; idx = m_nodes[idx].parent )
+            {
+                const auto srcloc = m_nodes[idx].srcloc;
+                auto it = srclocFrames.find( srcloc );
+                if( it == srclocFrames.end() )
+                {
+                    auto& sl = m_worker.GetSourceLocation( srcloc );
+                    const auto frame = m_profile.AddFrame( 0 );
+                    m_profile.AddLine( m_worker.GetZoneName( sl ), m_worker.GetString( sl.file ), sl.line );
+                    it = srclocFrames.emplace( srcloc, frame ).first;
+                }
+                m_profile.sampleFrames.push_back( it->second );
+                sample.frameCount++;
+            }
+            m_profile.samples.emplace_back( sample );
+        }
+    }
+
+    void CollectMemory()
+    {
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "alloc_space", "bytes" } );
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "alloc_objects", "count" } );
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "inuse_space", "bytes" } );
+        m_profile.valueTypes.emplace_back( StackProfile::ValueType { "inuse_objects", "count" } );
+
+        // Memory still in use at the end of the range is counted as in use. Allocations without a
+        // call stack are gathered under the callstack index 0.
+        tracy::unordered_flat_map<uint32_t, AllocStats> stats;
+        auto& mem = m_worker.GetMemData().data;
+        auto it = std::lower_bound( mem.begin(), mem.end(), m_rangeMin, [] ( const auto& l, const auto& r ) { return l.TimeAlloc() < r; } );
+        for( ; it != mem.end() && it->TimeAlloc() <= m_rangeMax; ++it )
+        {
+            const auto cs = it->CsAlloc();
+            if( !m_threadFilter.Pass( m_worker.DecompressThread( it->ThreadAlloc() ) ) ) continue;
+            auto& s = stats[cs];
+            const auto size = int64_t( it->Size() );
+            s.bytes += size;
+            s.count++;
+            if( it->TimeFree() < 0 || it->TimeFree() > m_rangeMax )
+            {
+                s.inuseBytes += size;
+                s.inuseCount++;
+            }
+        }
+
+        for( auto& v : SortedKeys( stats ) )
+        {
+            auto& sample = AddCallstackSample( v.first );
+            sample.values[0] = v.second.bytes;
+            sample.values[1] = v.second.count;
+            sample.values[2] = v.second.inuseBytes;
+            sample.values[3] = v.second.inuseCount;
+        }
+    }
+
+private:
+    struct Node
+    {
+        uint32_t parent;
+        int16_t srcloc;
+        int64_t self;
+        uint64_t count;
+    };
+
+    struct AllocStats
+    {
+        int64_t bytes = 0;
+        int64_t count = 0;
+        int64_t inuseBytes = 0;
+        int64_t inuseCount = 0;
+    };
+
+    template<typename T>
+    static std::vector<std::pair<uint32_t, T>> SortedKeys( const tracy::unordered_flat_map<uint32_t, T>& map )
+    {
+        std::vector<std::pair<uint32_t, T>> ret;
+        ret.reserve( map.size() );
+        for( auto& v : map ) ret.emplace_back( v.first, v.second );
+        std::sort( ret.begin(), ret.end(), [] ( const auto& l, const auto& r ) { return l.first < r.first; } );
+        return ret;
+    }
+
+    StackProfile::Sample& AddCallstackSample( uint32_t callstack )
+    {
+        StackProfile::Sample sample = {};
+        sample.frames = uint32_t( m_profile.sampleFrames.size() );
+        if( callstack == 0 )
+        {
+            m_profile.sampleFrames.push_back( m_profile.AddFrame( 0 ) );
+            m_profile.AddLine( "[no call stack]", "", 0 );
+            sample.frameCount = 1;
+        }
+        else
+        {
+            for( auto& id : m_worker.GetCallstack( callstack ) )
+            {
+                m_profile.sampleFrames.push_back( GetFrame( id ) );
+                sample.frameCount++;
+            }
+        }
+        m_profile.samples.emplace_back( sample );
+        return m_profile.samples.back();
+    }
+
+    uint32_t GetFrame( const tracy::CallstackFrameId& id )
+    {
+        auto it = m_frames.find( id.data );
+        if( it != m_frames.end() ) return it->second;
+
+        const auto address = m_worker.GetCanonicalPointer( id );
+        const auto frame = m_profile.AddFrame( address );
+        auto frameData = id.custom ? nullptr : m_worker.GetCallstackFrame( id );
+        if( frameData )
+        {
+            for( uint8_t i=0; i<frameData->size; i++ )
+            {
+                auto& f = frameData->data[i];
+                m_profile.AddLine( m_worker.GetString( f.name ), m_worker.GetString( f.file ), f.line );
+            }
+        }
+        else
+        {
+            char buf[32];
+            sprintf( buf, "[0x%" PRIx64 "]", address );
+            m_ownedStrings.emplace_back( buf );
+            m_profile.AddLine( m_ownedStrings.back().c_str(), "", 0 );
+        }
+        m_frames.emplace( id.data, frame );
+        return frame;
+    }
+
+    uint32_t GetNode( uint32_t parent, int16_t srcloc )
+    {
+        const auto key = ( uint64_t( parent ) << 16 ) | uint16_t( srcloc );
+        auto it = m_nodeMap.find( key );
+        if( it != m_nodeMap.end() ) return it->second;
+        const auto idx = uint32_t( m_nodes.size() );
+        m_nodes.emplace_back( Node { parent, srcloc, 0, 0 } );
+        m_nodeMap.emplace( key, idx );
+        return idx;
+    }
+
+    // Returns the total time of the given zones, which is subtracted from the parent's self time.
+    int64_t CollectZones( const tracy::Vector<tracy::short_ptr<tracy::ZoneEvent>>& vec, uint32_t parent )
+    {
+        if( vec.is_magic() )
+        {
+            return CollectZonesImpl<tracy::VectorAdapterDirect<tracy::ZoneEvent>>( *(const tracy::Vector<tracy::ZoneEvent>*)&vec, parent );
+        }
+        else
+        {
+            return CollectZonesImpl<tracy::VectorAdapterPointer<tracy::ZoneEvent>>( vec, parent );
+        }
+    }
+
+    template<typename Adapter, typename V>
+    int64_t CollectZonesImpl( const V& vec, uint32_t parent )
+    {
+        Adapter a;
+        int64_t total = 0;
+        for( auto& v : vec )
+        {
+            const auto& ev = a( v );
+            const auto start = ev.Start();
+            if( start > m_rangeMax ) break;
+            const auto end = m_worker.GetZoneEnd( ev );
+            if( end < m_rangeMin ) continue;
+
+            const auto time = end - start;
+            total += time;
+            const auto node = GetNode( parent, ev.SrcLoc() );
+            const auto childTime = ev.HasChildren() ? CollectZones( m_worker.GetZoneChildren( ev.Child() ), node ) : 0;
+            if( start >= m_rangeMin && end <= m_rangeMax )
+            {
+                m_nodes[node].self += time - childTime;
+                m_nodes[node].count++;
+            }
+        }
+        return total;
+    }
+
+    tracy::Worker& m_worker;
+    StackProfile& m_profile;
+    int64_t m_rangeMin;
+    int64_t m_rangeMax;
+    tracy::ThreadFilter m_threadFilter;
+    tracy::unordered_flat_map<uint64_t, uint32_t> m_frames;
+    std::deque<std::string> m_ownedStrings;
+    std::vector<Node> m_nodes;
+    tracy::unordered_flat_map<uint64_t, uint32_t> m_nodeMap;
+};
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    Mode mode = Mode::Samples;
+    bool folded = false;
+    int64_t rangeMin = std::numeric_limits<int64_t>::min();
+    int64_t rangeMax = std::numeric_limits<int64_t>::max();
+    std::vector<const char*> threadFilter;
+
+    int c;
+    while( ( c = getopt( argc, argv, "m:fr:t:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'm':
+            if( strcmp( optarg, "samples" ) == 0 ) mode = Mode::Samples;
+            else if( strcmp( optarg, "zones" ) == 0 ) mode = Mode::Zones;
+            else if( strcmp( optarg, "memory" ) == 0 ) mode = Mode::Memory;
+            else Usage();
+            break;
+        case 'f':
+            folded = true;
+            break;
+        case 'r':
+            if( sscanf( optarg, "%" SCNd64 ":%" SCNd64, &rangeMin, &rangeMax ) != 2 || rangeMin > rangeMax ) Usage();
+            break;
+        case 't':
+            threadFilter.push_back( optarg );
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 2 ) Usage();
+    const char* input = argv[optind];
+    const char* output = argv[optind+1];
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    try
+    {
+        tracy::EventType::Type eventMask = tracy::EventType::None;
+        switch( mode )
+        {
+        case Mode::Samples: eventMask = tracy::EventType::Samples; break;
+        case Mode::Memory: eventMask = tracy::EventType::Memory; break;
+        default: break;
+        }
+        tracy::Worker worker( *f, eventMask, false );
+        f.reset();
+
+        StackProfile profile;
+        profile.timeNs = int64_t( worker.GetCaptureTime() ) * 1000000000ll;
+        profile.durationNs = std::min( rangeMax, worker.GetLastTime() ) - std::max<int64_t>( rangeMin, 0 );
+
+        StackCollector collector( worker, profile, rangeMin, rangeMax );
+        collector.SetThreadFilter( threadFilter );
+        switch( mode )
+        {
+        case Mode::Samples: collector.CollectSamples(); break;
+        case Mode::Zones: collector.CollectZones(); break;
+        case Mode::Memory: collector.CollectMemory(); break;
+        default: assert( false ); break;
+        }
+
+        const bool toStdout = strcmp( output, "-" ) == 0;
+        FILE* fout = toStdout ? stdout : fopen( output, "wb" );
+        if( !fout )
+        {
+            fprintf( stderr, "Cannot open output file!\n" );
+            exit( 1 );
+        }
+        if( folded )
+        {
+            WriteFolded( profile, fout );
+        }
+        else
+        {
+            PprofWriter( profile ).Write( fout );
+        }
+        const bool error = ferror( fout ) != 0;
+        if( !toStdout ) fclose( fout );
+        if( error )
+        {
+            fprintf( stderr, "Cannot write output file!\n" );
+            exit( 1 );
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
@@ -0,0 +1,275 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyFileWrite.hpp"
+#include "../../server/TracyMemory.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyWorker.hpp"
+#include "../../zstd/zstd.h"
+
+#include "../../capture/src/getopt.h"
+
+#ifdef __CYGWIN__
+#  define ftello64(x) ftello(x)
+#elif defined _WIN32
+#  define ftello64(x) _ftelli64(x)
+#elif defined __APPLE__
+#  define ftello64(x) ftello(x)
+#endif
+
+void Usage()
+{
+    printf( "Usage: filebench [-n runs] [-z levels] [-o temp.tracy] input.tracy\n\n" );
+    printf( "Loads a trace, then saves and reloads it with each compression mode, reporting per section timings.\n\n" );
+    printf( "  -n runs: number of save and reload runs per compression mode, the fastest one is reported (default 1)\n" );
+    printf( "  -z levels: comma separated list of Zstd compression levels to test (default 1,3,9,19)\n" );
+    printf( "  -o temp.tracy: file used for saving (default input.tracy.tmp, removed on exit)\n" );
+    exit( 1 );
+}
+
+struct Mode
+{
+    tracy::FileWrite::Compression comp;
+    int level;
+    char name[16];
+};
+
+struct SaveResult
+{
+    int64_t saveTime;
+    int64_t reloadTime;
+    uint64_t srcBytes;
+    uint64_t fileSize;
+    std::vector<tracy::FileSectionStats> sections;
+};
+
+static int64_t Elapsed( const std::chrono::time_point<std::chrono::high_resolution_clock>& t0 )
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - t0 ).count();
+}
+
+static uint64_t GetFileSize( const char* fn )
+{
+    FILE* f = fopen( fn, "rb" );
+    if( !f ) return 0;
+    fseek( f, 0, SEEK_END );
+    const auto sz = ftello64( f );
+    fclose( f );
+    return sz;
+}
+
+static double Throughput( uint64_t bytes, int64_t time )
+{
+    return time == 0 ? 0. : bytes / ( time / 1e9 ) / ( 1024 * 1024 );
+}
+
+static void PrintSections( const std::vector<tracy::FileSectionStats>& sections )
+{
+    int64_t total = 0;
+    for( auto& v : sections ) total += v.time;
+
+    printf( "%-18s %12s %7s %12s %10s %12s\n", "section", "time", "time%", "data", "MB/s", "memory" );
+    for( auto& v : sections )
+    {
+        printf( "%-18s %12s %6.2f%% %12s %10.1f %12s\n", v.name, tracy::TimeToString( v.time ), 100. * v.time / std::max<int64_t>( 1, total ),
+            tracy::MemSizeToString( v.bytes ), Throughput( v.bytes, v.time ), tracy::MemSizeToString( v.memory ) );
+    }
+}
+
+static bool Save( tracy::Worker& worker, const Mode& mode, const char* fn, SaveResult& res )
+{
+    auto w = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( fn, mode.comp, mode.level ) );
+    if( !w ) return false;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    worker.Write( *w );
+    w->Finish();
+    res.saveTime = Elapsed( t0 );
+    res.srcBytes = w->GetCompressionStatistics().first;
+    res.sections = worker.GetSaveSectionStats();
+    return true;
+}
+
+static int64_t Reload( const char* fn )
+{
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( fn ) );
+    if( !f ) return -1;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    tracy::Worker worker( *f, tracy::EventType::All, false );
+    return Elapsed( t0 );
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    int runs = 1;
+    const char* levels = "1,3,9,19";
+    const char* tmpName = nullptr;
+
+    int c;
+    while( ( c = getopt( argc, argv, "n:z:o:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'n':
+            runs = atoi( optarg );
+            if( runs < 1 ) Usage();
+            break;
+        case 'z':
+            levels = optarg;
+            break;
+        case 'o':
+            tmpName = optarg;
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 1 ) Usage();
+    const char* input = argv[optind];
+
+    std::string tmpFile = tmpName ? tmpName : std::string( input ) + ".tmp";
+
+    std::vector<Mode> modes;
+    modes.emplace_back( Mode { tracy::FileWrite::Compression::Fast, 1, "lz4" } );
+    modes.emplace_back( Mode { tracy::FileWrite::Compression::Slow, 1, "lz4hc" } );
+    modes.emplace_back( Mode { tracy::FileWrite::Compression::Extreme, 1, "lz4 extreme" } );
+    for( auto ptr = levels; *ptr; )
+    {
+        char* end;
+        const auto level = (int)strtol( ptr, &end, 10 );
+        if( end == ptr || ( *end != ',' && *end != '\0' ) ) Usage();
+        if( level > ZSTD_maxCLevel() || level < ZSTD_minCLevel() )
+        {
+            printf( "Available Zstd compression levels range: %i - %i\n", ZSTD_minCLevel(), ZSTD_maxCLevel() );
+            exit( 1 );
+        }
+        Mode mode = { tracy::FileWrite::Compression::Zstd, level };
+        snprintf( mode.name, sizeof( mode.name ), "zstd %i", level );
+        modes.emplace_back( mode );
+        ptr = *end == ',' ? end + 1 : end;
+    }
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+    const auto inSize = GetFileSize( input );
+
+    try
+    {
+        printf( "Loading...\r" );
+        fflush( stdout );
+
+        const auto memBase = tracy::memUsage;
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        tracy::Worker worker( *f, tracy::EventType::All, true );
+        const auto loadTime = Elapsed( t0 );
+        while( !worker.IsBackgroundDone() ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        const auto bgTime = Elapsed( t0 ) - loadTime;
+        const auto memLoaded = tracy::memUsage - memBase;
+        f.reset();
+
+        const auto& loadSections = worker.GetLoadSectionStats();
+        uint64_t loadBytes = 0;
+        for( auto& v : loadSections ) loadBytes += v.bytes;
+
+        printf( "%s: %s on disk, %s uncompressed, %s zones\n", input, tracy::MemSizeToString( inSize ), tracy::MemSizeToString( loadBytes ),
+            tracy::RealToString( worker.GetZoneCount() ) );
+        printf( "Load: %s (%.1f MB/s), background processing: %s, memory: %s\n\n", tracy::TimeToString( loadTime ),
+            Throughput( loadBytes, loadTime ), tracy::TimeToString( bgTime ), tracy::MemSizeToString( memLoaded ) );
+        PrintSections( loadSections );
+        printf( "\n" );
+
+        std::vector<SaveResult> results;
+        for( auto& mode : modes )
+        {
+            printf( "Saving with %s...\r", mode.name );
+            fflush( stdout );
+
+            SaveResult best = {};
+            for( int i=0; i<runs; i++ )
+            {
+                SaveResult res;
+                if( !Save( worker, mode, tmpFile.c_str(), res ) )
+                {
+                    fprintf( stderr, "Cannot open output file!\n" );
+                    exit( 1 );
+                }
+                res.reloadTime = Reload( tmpFile.c_str() );
+                const auto reload = i == 0 ? res.reloadTime : std::min( best.reloadTime, res.reloadTime );
+                if( i == 0 || res.saveTime < best.saveTime ) best = std::move( res );
+                best.reloadTime = reload;
+            }
+            best.fileSize = GetFileSize( tmpFile.c_str() );
+            results.emplace_back( std::move( best ) );
+        }
+        remove( tmpFile.c_str() );
+
+        printf( "%-14s %12s %8s %12s %10s %12s %10s\n", "compression", "size", "ratio", "save", "MB/s", "reload", "MB/s" );
+        for( size_t i=0; i<modes.size(); i++ )
+        {
+            auto& r = results[i];
+            printf( "%-14s %12s %7.2f%% %12s %10.1f %12s %10.1f\n", modes[i].name, tracy::MemSizeToString( r.fileSize ),
+                100. * r.fileSize / std::max<uint64_t>( 1, r.srcBytes ), tracy::TimeToString( r.saveTime ), Throughput( r.srcBytes, r.saveTime ),
+                tracy::TimeToString( r.reloadTime ), Throughput( r.srcBytes, r.reloadTime ) );
+        }
+
+        // Section sizes do not depend on the compression mode, so only the save times are listed per mode.
+        printf( "\n%-18s %12s", "save section", "data" );
+        for( auto& mode : modes ) printf( " %12s", mode.name );
+        printf( "\n" );
+        const auto& sections = results[0].sections;
+        for( size_t i=0; i<sections.size(); i++ )
+        {
+            printf( "%-18s %12s", sections[i].name, tracy::MemSizeToString( sections[i].bytes ) );
+            for( auto& r : results ) printf( " %12s", tracy::TimeToString( r.sections[i].time ) );
+            printf( "\n" );
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
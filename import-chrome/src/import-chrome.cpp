@@ -2,16 +2,33 @@
 #  include <windows.h>
 #endif
 
-#include <fstream>
+#include <algorithm>
+#include <inttypes.h>
+#include <limits>
+#include <memory>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "json.hpp"
 
 #include "../../server/TracyFileWrite.hpp"
+#include "../../server/TracyMmap.hpp"
+#include "../../server/TracyTaskDispatch.hpp"
 #include "../../server/TracyWorker.hpp"
 
+#ifdef __CYGWIN__
+#  define ftello64(x) ftello(x)
+#elif defined _WIN32
+#  define ftello64(x) _ftelli64(x)
+#elif defined __APPLE__
+#  define ftello64(x) ftello(x)
+#endif
+
 using json = nlohmann::json;
 
 void Usage()
@@ -20,6 +37,421 @@ void Usage()
     exit( 1 );
 }
 
+enum { ChunkSize = 8 * 1024 * 1024 };
+
+// Name values with special meaning. After the per thread merge, names of zone begin events are source locations.
+enum : uint32_t
+{
+    NameMessage = 0xFFFFFFFE,
+    NameEnd = 0xFFFFFFFF
+};
+
+struct ImportEvent
+{
+    int64_t timestamp;
+    int64_t end;        // end of complete ('X') events, maximum value for all other events
+    uint64_t text;      // offset in the chunk text buffer, pointer after the merge
+    uint32_t textSize;
+    uint32_t name;
+};
+
+struct Chunk
+{
+    const char* begin;
+    const char* end;
+
+    tracy::unordered_flat_map<uint64_t, std::vector<ImportEvent>> threads;
+    std::vector<uint64_t> threadOrder;
+    std::vector<std::string> names;
+    std::vector<int16_t> srcloc;
+    std::vector<char> text;
+    int64_t minTime;
+    uint64_t errors;
+};
+
+static const char* SkipWhitespace( const char* ptr, const char* end )
+{
+    while( ptr < end && ( *ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r' ) ) ptr++;
+    return ptr;
+}
+
+// Finds the end of the JSON value starting at ptr. Only the structure of the value is checked. Returns nullptr
+// if the value is not terminated.
+static const char* SkipValue( const char* ptr, const char* end )
+{
+    if( *ptr != '{' && *ptr != '[' && *ptr != '"' )
+    {
+        while( ptr < end && *ptr != ',' && *ptr != ']' && *ptr != '}' && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r' ) ptr++;
+        return ptr;
+    }
+
+    int depth = 0;
+    while( ptr < end )
+    {
+        switch( *ptr++ )
+        {
+        case '"':
+            for(;;)
+            {
+                ptr = (const char*)memchr( ptr, '"', end - ptr );
+                if( !ptr ) return nullptr;
+                auto bs = ptr;
+                while( bs[-1] == '\\' ) bs--;
+                ptr++;
+                if( ( ptr - 1 - bs ) % 2 == 0 ) break;
+            }
+            if( depth == 0 ) return ptr;
+            break;
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            if( --depth == 0 ) return ptr;
+            break;
+        default:
+            break;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the position right after the opening bracket of the event array, which is either the top level value,
+// or is stored under the "traceEvents" key of the top level object.
+static const char* FindEventArray( const char* ptr, const char* end )
+{
+    ptr = SkipWhitespace( ptr, end );
+    if( ptr == end ) return nullptr;
+    if( *ptr == '[' ) return ptr + 1;
+    if( *ptr != '{' ) return nullptr;
+    ptr++;
+    for(;;)
+    {
+        ptr = SkipWhitespace( ptr, end );
+        if( ptr == end || *ptr != '"' ) return nullptr;
+        auto keyEnd = SkipValue( ptr, end );
+        if( !keyEnd ) return nullptr;
+        const bool match = keyEnd - ptr == 13 && memcmp( ptr, "\"traceEvents\"", 13 ) == 0;
+        ptr = SkipWhitespace( keyEnd, end );
+        if( ptr == end || *ptr != ':' ) return nullptr;
+        ptr = SkipWhitespace( ptr + 1, end );
+        if( ptr == end ) return nullptr;
+        if( match ) return *ptr == '[' ? ptr + 1 : nullptr;
+        ptr = SkipValue( ptr, end );
+        if( !ptr ) return nullptr;
+        ptr = SkipWhitespace( ptr, end );
+        if( ptr == end || *ptr != ',' ) return nullptr;
+        ptr++;
+    }
+}
+
+// Moves ptr to the start of the next array element and sets elemEnd to its end. The closing bracket may be
+// missing, as the trace format allows unterminated arrays. A truncated last element is ignored.
+static bool NextElement( const char*& ptr, const char* end, const char*& elemEnd )
+{
+    ptr = SkipWhitespace( ptr, end );
+    if( ptr < end && *ptr == ',' ) ptr = SkipWhitespace( ptr + 1, end );
+    if( ptr == end || *ptr == ']' ) return false;
+    elemEnd = SkipValue( ptr, end );
+    return elemEnd != nullptr;
+}
+
+static void AppendEscaped( std::string& out, const std::string& str )
+{
+    out += '"';
+    for( auto c : str )
+    {
+        switch( c )
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if( (unsigned char)c < 0x20 )
+            {
+                char buf[8];
+                sprintf( buf, "\\u%04x", c );
+                out += buf;
+            }
+            else
+            {
+                out += c;
+            }
+            break;
+        }
+    }
+    out += '"';
+}
+
+// SAX handler for a single trace event object. Arguments are converted to "key: value" lines of zone text.
+class EventParser
+{
+public:
+    using number_integer_t = json::number_integer_t;
+    using number_unsigned_t = json::number_unsigned_t;
+    using number_float_t = json::number_float_t;
+    using string_t = json::string_t;
+
+    void Reset()
+    {
+        m_depth = 0;
+        m_key = Key::Other;
+        m_inArgs = false;
+        m_ph.clear();
+        m_name.clear();
+        m_text.clear();
+        m_tid = 0;
+        m_ts = 0;
+        m_dur = 0;
+    }
+
+    bool null() { Value( "null", 4 ); return true; }
+    bool boolean( bool val ) { if( val ) Value( "true", 4 ); else Value( "false", 5 ); return true; }
+
+    bool number_integer( number_integer_t val )
+    {
+        if( m_depth == 1 ) Number( double( val ), uint64_t( val ) );
+        else if( m_inArgs )
+        {
+            char buf[32];
+            Value( buf, sprintf( buf, "%" PRIi64, int64_t( val ) ) );
+        }
+        return true;
+    }
+
+    bool number_unsigned( number_unsigned_t val )
+    {
+        if( m_depth == 1 ) Number( double( val ), uint64_t( val ) );
+        else if( m_inArgs )
+        {
+            char buf[32];
+            Value( buf, sprintf( buf, "%" PRIu64, uint64_t( val ) ) );
+        }
+        return true;
+    }
+
+    bool number_float( number_float_t val, const string_t& str )
+    {
+        if( m_depth == 1 ) Number( val, uint64_t( val ) );
+        else if( m_inArgs ) Value( str.c_str(), str.size() );
+        return true;
+    }
+
+    bool string( string_t& val )
+    {
+        if( m_depth == 1 )
+        {
+            switch( m_key )
+            {
+            case Key::Ph: m_ph = std::move( val ); break;
+            case Key::Name: m_name = std::move( val ); break;
+            case Key::Tid: m_tid = strtoull( val.c_str(), nullptr, 10 ); break;
+            default: break;
+            }
+        }
+        else if( m_inArgs )
+        {
+            if( m_depth > 2 ) Separator();
+            AppendEscaped( m_text, val );
+            if( m_depth == 2 ) m_text += '\n';
+        }
+        return true;
+    }
+
+    bool key( string_t& val )
+    {
+        if( m_depth == 1 )
+        {
+            if( val == "ph" ) m_key = Key::Ph;
+            else if( val == "name" ) m_key = Key::Name;
+            else if( val == "tid" ) m_key = Key::Tid;
+            else if( val == "ts" ) m_key = Key::Ts;
+            else if( val == "dur" ) m_key = Key::Dur;
+            else if( val == "args" ) m_key = Key::Args;
+            else m_key = Key::Other;
+        }
+        else if( m_inArgs )
+        {
+            if( m_depth == 2 )
+            {
+                m_text += val;
+                m_text += ": ";
+            }
+            else
+            {
+                Separator();
+                AppendEscaped( m_text, val );
+                m_text += ':';
+            }
+        }
+        return true;
+    }
+
+    bool start_object( std::size_t ) { return Open( '{' ); }
+    bool end_object() { return Close( '}' ); }
+    bool start_array( std::size_t ) { return Open( '[' ); }
+    bool end_array() { return Close( ']' ); }
+
+    bool parse_error( std::size_t, const std::string&, const nlohmann::detail::exception& ) { return false; }
+
+    const std::string& Ph() const { return m_ph; }
+    const std::string& Name() const { return m_name; }
+    const std::string& Text() const { return m_text; }
+    uint64_t Tid() const { return m_tid; }
+    double Ts() const { return m_ts; }
+    double Dur() const { return m_dur; }
+
+private:
+    enum class Key { Ph, Name, Tid, Ts, Dur, Args, Other };
+
+    void Number( double val, uint64_t uval )
+    {
+        switch( m_key )
+        {
+        case Key::Tid: m_tid = uval; break;
+        case Key::Ts: m_ts = val; break;
+        case Key::Dur: m_dur = val; break;
+        default: break;
+        }
+    }
+
+    void Value( const char* str, size_t sz )
+    {
+        if( !m_inArgs || m_depth < 2 ) return;
+        if( m_depth > 2 ) Separator();
+        m_text.append( str, sz );
+        if( m_depth == 2 ) m_text += '\n';
+    }
+
+    void Separator()
+    {
+        const auto c = m_text.back();
+        if( c != '{' && c != '[' && c != ':' ) m_text += ',';
+    }
+
+    bool Open( char c )
+    {
+        if( m_depth == 1 && m_key == Key::Args && c == '{' )
+        {
+            m_inArgs = true;
+        }
+        else if( m_inArgs )
+        {
+            if( m_depth > 2 ) Separator();
+            m_text += c;
+        }
+        m_depth++;
+        return true;
+    }
+
+    bool Close( char c )
+    {
+        m_depth--;
+        if( m_inArgs )
+        {
+            if( m_depth == 1 )
+            {
+                m_inArgs = false;
+            }
+            else
+            {
+                m_text += c;
+                if( m_depth == 2 ) m_text += '\n';
+            }
+        }
+        return true;
+    }
+
+    int m_depth;
+    Key m_key;
+    bool m_inArgs;
+    std::string m_ph;
+    std::string m_name;
+    std::string m_text;
+    uint64_t m_tid;
+    double m_ts;
+    double m_dur;
+};
+
+static void ParseChunk( Chunk& chunk )
+{
+    EventParser parser;
+    tracy::unordered_flat_map<std::string, uint32_t> names;
+
+    uint64_t lastTid = 0;
+    std::vector<ImportEvent>* lastThread = nullptr;
+    auto GetThread = [&] ( uint64_t tid ) -> std::vector<ImportEvent>& {
+        if( lastThread && lastTid == tid ) return *lastThread;
+        auto it = chunk.threads.find( tid );
+        if( it == chunk.threads.end() )
+        {
+            it = chunk.threads.emplace( tid, std::vector<ImportEvent>() ).first;
+            chunk.threadOrder.push_back( tid );
+        }
+        lastTid = tid;
+        lastThread = &it->second;
+        return *lastThread;
+    };
+    auto StoreText = [&chunk] ( const std::string& str ) {
+        const auto offset = chunk.text.size();
+        chunk.text.insert( chunk.text.end(), str.begin(), str.end() );
+        return offset;
+    };
+
+    chunk.minTime = std::numeric_limits<int64_t>::max();
+    chunk.errors = 0;
+
+    auto ptr = chunk.begin;
+    const char* elemEnd;
+    while( NextElement( ptr, chunk.end, elemEnd ) )
+    {
+        parser.Reset();
+        const auto ok = json::sax_parse( ptr, elemEnd, &parser );
+        ptr = elemEnd;
+        if( !ok )
+        {
+            chunk.errors++;
+            continue;
+        }
+
+        auto& ph = parser.Ph();
+        if( ph.size() != 1 ) continue;
+        const auto type = ph[0];
+        if( type != 'B' && type != 'E' && type != 'X' && type != 'i' && type != 'I' ) continue;
+
+        const auto ts = int64_t( parser.Ts() * 1000. );
+        if( ts < chunk.minTime ) chunk.minTime = ts;
+        auto& thread = GetThread( parser.Tid() );
+        const auto noEnd = std::numeric_limits<int64_t>::max();
+
+        if( type == 'i' || type == 'I' )
+        {
+            auto& name = parser.Name();
+            thread.emplace_back( ImportEvent { ts, noEnd, StoreText( name ), uint32_t( name.size() ), NameMessage } );
+        }
+        else if( type == 'E' )
+        {
+            thread.emplace_back( ImportEvent { ts, noEnd, 0, 0, NameEnd } );
+        }
+        else
+        {
+            auto it = names.find( parser.Name() );
+            if( it == names.end() ) it = names.emplace( parser.Name(), uint32_t( names.size() ) ).first;
+            auto& text = parser.Text();
+            const auto end = type == 'X' ? std::max( ts, ts + int64_t( parser.Dur() * 1000. ) ) : noEnd;
+            thread.emplace_back( ImportEvent { ts, end, StoreText( text ), uint32_t( text.size() ), it->second } );
+        }
+    }
+
+    chunk.names.resize( names.size() );
+    for( auto& v : names ) chunk.names[v.second] = v.first;
+}
+
 int main( int argc, char** argv )
 {
 #ifdef _WIN32
@@ -40,108 +472,168 @@ int main( int argc, char** argv )
     printf( "Loading...\r" );
     fflush( stdout );
 
-    std::ifstream is( input );
-    if( !is.is_open() )
+    FILE* f = fopen( input, "rb" );
+    if( !f )
     {
         fprintf( stderr, "Cannot open input file!\n" );
         exit( 1 );
     }
-    json j;
-    is >> j;
-    is.close();
-
-    printf( "\33[2KParsing...\r" );
-    fflush( stdout );
-
-    std::vector<tracy::Worker::ImportEventTimeline> timeline;
-    std::vector<tracy::Worker::ImportEventMessages> messages;
-
-    if( j.is_object() && j.contains( "traceEvents" ) )
+    fseek( f, 0, SEEK_END );
+    const size_t size = ftello64( f );
+    const char* data = size == 0 ? (const char*)MAP_FAILED : (const char*)mmap( nullptr, size, PROT_READ, MAP_SHARED, fileno( f ), 0 );
+    fclose( f );
+    if( data == (const char*)MAP_FAILED )
     {
-        j = j["traceEvents"];
+        fprintf( stderr, "Cannot read input file!\n" );
+        exit( 1 );
     }
+    const auto dataEnd = data + size;
 
-    if( !j.is_array() )
+    auto ptr = FindEventArray( data, dataEnd );
+    if( !ptr )
     {
         fprintf( stderr, "Input must be either an array of events or an object containing an array of events under \"traceEvents\" key.\n" );
         exit( 1 );
     }
 
-    for( auto& v : j )
+    printf( "\33[2KParsing...\r" );
+    fflush( stdout );
+
+    // The event array is split into chunks at element boundaries, which are parsed in parallel. Events of each
+    // chunk are bucketed per thread and zone names are interned in a chunk local string table.
+    std::vector<std::unique_ptr<Chunk>> chunks;
     {
-        const auto type = v["ph"].get<std::string>();
+        tracy::TaskDispatch td( std::max<int>( std::thread::hardware_concurrency() - 1, 1 ) );
 
-        std::string zoneText = "";
-        if ( v.contains( "args" ) )
+        auto chunkStart = ptr;
+        const char* elemEnd;
+        while( NextElement( ptr, dataEnd, elemEnd ) )
         {
-            for ( auto& kv : v["args"].items() )
+            ptr = elemEnd;
+            if( ptr - chunkStart >= ChunkSize )
             {
-                zoneText += kv.key() + ": " + kv.value().dump() + "\n";
+                chunks.emplace_back( std::make_unique<Chunk>() );
+                auto chunk = chunks.back().get();
+                chunk->begin = chunkStart;
+                chunk->end = ptr;
+                td.Queue( [chunk] { ParseChunk( *chunk ); } );
+                chunkStart = ptr;
             }
         }
-
-        if( type == "B" )
+        if( ptr != chunkStart )
         {
-            timeline.emplace_back( tracy::Worker::ImportEventTimeline {
-                v["tid"].get<uint64_t>(),
-                uint64_t( v["ts"].get<double>() * 1000. ),
-                v["name"].get<std::string>(),
-                std::move(zoneText),
-                false
-            } );
+            chunks.emplace_back( std::make_unique<Chunk>() );
+            auto chunk = chunks.back().get();
+            chunk->begin = chunkStart;
+            chunk->end = ptr;
+            td.Queue( [chunk] { ParseChunk( *chunk ); } );
         }
-        else if( type == "E" )
-        {
-            timeline.emplace_back( tracy::Worker::ImportEventTimeline {
-                v["tid"].get<uint64_t>(),
-                uint64_t( v["ts"].get<double>() * 1000. ),
-                "",
-                std::move(zoneText),
-                true
-            } );
-        }
-        else if( type == "X" )
+        td.Sync();
+    }
+    munmap( (void*)data, size );
+
+    printf( "\33[2KProcessing...\r" );
+    fflush( stdout );
+
+    auto program = input + strlen( input );
+    while( program > input && program[-1] != '/' && program[-1] != '\\' ) program--;
+    tracy::Worker worker( program );
+
+    uint64_t errors = 0;
+    int64_t mts = std::numeric_limits<int64_t>::max();
+    std::vector<uint64_t> threadOrder;
+    tracy::unordered_flat_map<uint64_t, size_t> threadIdx;
+    for( auto& chunk : chunks )
+    {
+        errors += chunk->errors;
+        if( chunk->minTime < mts ) mts = chunk->minTime;
+        for( auto tid : chunk->threadOrder )
         {
-            const auto tid = v["tid"].get<uint64_t>();
-            const auto ts0 = uint64_t( v["ts"].get<double>() * 1000. );
-            const auto ts1 = v["dur"].is_object() ? ts0 + uint64_t( v["dur"].get<double>() * 1000. ) : ts0;
-            const auto name = v["name"].get<std::string>();
-            timeline.emplace_back( tracy::Worker::ImportEventTimeline { tid, ts0, name, std::move(zoneText), false } );
-            timeline.emplace_back( tracy::Worker::ImportEventTimeline { tid, ts1, "", "", true } );
+            if( threadIdx.emplace( tid, threadOrder.size() ).second ) threadOrder.push_back( tid );
         }
-        else if( type == "i" || type == "I" )
+        chunk->srcloc.reserve( chunk->names.size() );
+        for( auto& name : chunk->names ) chunk->srcloc.push_back( worker.ImportSourceLocation( name.c_str(), name.size() ) );
+        chunk->names = std::vector<std::string>();
+    }
+
+    // Per thread event lists are gathered from the chunks and sorted in parallel. The chunk text buffers are kept
+    // until all events are imported.
+    std::vector<std::vector<ImportEvent>> threads( threadOrder.size() );
+    {
+        tracy::TaskDispatch td( std::max<int>( std::thread::hardware_concurrency(), 1 ) );
+        for( size_t i=0; i<threadOrder.size(); i++ )
         {
-            messages.emplace_back( tracy::Worker::ImportEventMessages {
-                v["tid"].get<uint64_t>(),
-                uint64_t( v["ts"].get<double>() * 1000. ),
-                v["name"].get<std::string>()
+            td.Queue( [&chunks, &threads, &threadOrder, i] {
+                auto& events = threads[i];
+                const auto tid = threadOrder[i];
+                size_t count = 0;
+                for( auto& chunk : chunks )
+                {
+                    auto it = chunk->threads.find( tid );
+                    if( it != chunk->threads.end() ) count += it->second.size();
+                }
+                events.reserve( count );
+                for( auto& chunk : chunks )
+                {
+                    auto it = chunk->threads.find( tid );
+                    if( it == chunk->threads.end() ) continue;
+                    const auto text = (uint64_t)chunk->text.data();
+                    for( auto& v : it->second )
+                    {
+                        events.emplace_back( v );
+                        auto& ev = events.back();
+                        ev.text += text;
+                        if( ev.name < NameMessage ) ev.name = uint16_t( chunk->srcloc[ev.name] );
+                    }
+                    it->second = std::vector<ImportEvent>();
+                }
+                // Complete events starting at the same time are ordered from the longest to the shortest, so that they
+                // nest properly. Other events keep their input order and are placed before them.
+                std::stable_sort( events.begin(), events.end(), [] ( const auto& l, const auto& r ) { return l.timestamp < r.timestamp || ( l.timestamp == r.timestamp && l.end > r.end ); } );
             } );
         }
+        td.Sync();
     }
 
-    std::stable_sort( timeline.begin(), timeline.end(), [] ( const auto& l, const auto& r ) { return l.timestamp < r.timestamp; } );
-    std::stable_sort( messages.begin(), messages.end(), [] ( const auto& l, const auto& r ) { return l.timestamp < r.timestamp; } );
-
-    uint64_t mts = 0;
-    if( !timeline.empty() )
+    // End times of open complete events are kept on a stack. They are closed before any event which starts at or
+    // after their end is processed.
+    std::vector<int64_t> pending;
+    for( size_t i=0; i<threadOrder.size(); i++ )
     {
-        mts = timeline[0].timestamp;
-    }
-    if( !messages.empty() )
-    {
-        if( mts > messages[0].timestamp ) mts = messages[0].timestamp;
+        const auto tid = threadOrder[i];
+        for( auto& v : threads[i] )
+        {
+            while( !pending.empty() && pending.back() <= v.timestamp )
+            {
+                worker.ImportZoneEnd( tid, pending.back() - mts );
+                pending.pop_back();
+            }
+            const auto time = v.timestamp - mts;
+            switch( v.name )
+            {
+            case NameEnd:
+                worker.ImportZoneEnd( tid, time );
+                break;
+            case NameMessage:
+                worker.ImportMessage( tid, time, (const char*)v.text, v.textSize );
+                break;
+            default:
+                worker.ImportZoneBegin( tid, time, int16_t( v.name ), (const char*)v.text, v.textSize );
+                if( v.end != std::numeric_limits<int64_t>::max() ) pending.push_back( v.end );
+                break;
+            }
+        }
+        while( !pending.empty() )
+        {
+            worker.ImportZoneEnd( tid, pending.back() - mts );
+            pending.pop_back();
+        }
+        threads[i] = std::vector<ImportEvent>();
     }
-    for( auto& v : timeline ) v.timestamp -= mts;
-    for( auto& v : messages ) v.timestamp -= mts;
-
-    printf( "\33[2KProcessing...\r" );
-    fflush( stdout );
+    worker.ImportFinish();
+    chunks.clear();
 
-    auto program = input;
-    while( *program ) program++;
-    program--;
-    while( program > input && ( *program != '/' || *program != '\\' ) ) program--;
-    tracy::Worker worker( program, timeline, messages );
+    if( errors != 0 ) printf( "\33[2K%" PRIu64 " malformed events were skipped.\n", errors );
 
     auto w = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( output, clev ) );
     if( !w )
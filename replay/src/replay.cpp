@@ -0,0 +1,284 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "../../common/TracyQueue.hpp"
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyMemory.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+static const char* QueueTypeNames[] = {
+    "ZoneText",
+    "ZoneName",
+    "Message",
+    "MessageColor",
+    "MessageCallstack",
+    "MessageColorCallstack",
+    "MessageAppInfo",
+    "ZoneBeginAllocSrcLoc",
+    "ZoneBeginAllocSrcLocLean",
+    "ZoneBeginAllocSrcLocCallstack",
+    "ZoneBeginAllocSrcLocCallstackLean",
+    "CallstackMemory",
+    "CallstackMemoryLean",
+    "Callstack",
+    "CallstackLean",
+    "CallstackAlloc",
+    "CallstackAllocLean",
+    "CallstackSample",
+    "CallstackSampleLean",
+    "FrameImage",
+    "FrameImageLean",
+    "ZoneBegin",
+    "ZoneBeginCallstack",
+    "ZoneEnd",
+    "LockWait",
+    "LockObtain",
+    "LockRelease",
+    "LockSharedWait",
+    "LockSharedObtain",
+    "LockSharedRelease",
+    "LockName",
+    "MemAlloc",
+    "MemFree",
+    "MemAllocCallstack",
+    "MemFreeCallstack",
+    "GpuZoneBegin",
+    "GpuZoneBeginCallstack",
+    "GpuZoneEnd",
+    "GpuZoneBeginSerial",
+    "GpuZoneBeginCallstackSerial",
+    "GpuZoneEndSerial",
+    "PlotData",
+    "ContextSwitch",
+    "ThreadWakeup",
+    "GpuTime",
+    "Terminate",
+    "KeepAlive",
+    "ThreadContext",
+    "Crash",
+    "CrashReport",
+    "ZoneValidation",
+    "FrameMarkMsg",
+    "FrameMarkMsgStart",
+    "FrameMarkMsgEnd",
+    "SourceLocation",
+    "LockAnnounce",
+    "LockTerminate",
+    "LockMark",
+    "MessageLiteral",
+    "MessageLiteralColor",
+    "MessageLiteralCallstack",
+    "MessageLiteralColorCallstack",
+    "GpuNewContext",
+    "CallstackFrameSize",
+    "CallstackFrame",
+    "SymbolInformation",
+    "CodeInformation",
+    "SysTimeReport",
+    "TidToPid",
+    "PlotConfig",
+    "ParamSetup",
+    "ParamPingback",
+    "CpuTopology",
+    "StringData",
+    "ThreadName",
+    "CustomStringData",
+    "PlotName",
+    "SourceLocationPayload",
+    "CallstackPayload",
+    "CallstackAllocPayload",
+    "FrameName",
+    "FrameImageData",
+    "ExternalName",
+    "ExternalThreadName",
+    "SymbolCode",
+};
+
+static_assert( sizeof( QueueTypeNames ) / sizeof( *QueueTypeNames ) == (int)tracy::QueueType::NUM_TYPES, "QueueTypeNames mismatch" );
+
+void Usage()
+{
+    printf( "Usage: replay [-n runs] [-s] input.raw\n\n" );
+    printf( "Replays a raw stream recorded with 'capture -r' into the server at maximum speed.\n\n" );
+    printf( "  -n runs: number of timed runs, the fastest one is reported (default 3)\n" );
+    printf( "  -s: skip the per event type timing run\n" );
+    exit( 1 );
+}
+
+struct RunResult
+{
+    int64_t time;
+    size_t peakMemory;
+    uint64_t zones;
+    bool handshake;
+};
+
+static RunResult Replay( const std::vector<char>& data, bool queueTypeStats, std::vector<tracy::Worker::QueueTypeStats>* stats )
+{
+    const auto memBase = tracy::memUsage;
+    auto peak = memBase;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    tracy::Worker worker( tracy::Worker::RawStreamReplay { data.data(), data.size(), queueTypeStats } );
+    while( !worker.HasData() )
+    {
+        const auto handshake = worker.GetHandshakeStatus();
+        if( handshake != tracy::HandshakePending && handshake != tracy::HandshakeWelcome ) return RunResult { 0, 0, 0, false };
+        std::this_thread::yield();
+    }
+    while( worker.IsConnected() )
+    {
+        peak = std::max( peak, tracy::memUsage );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    peak = std::max( peak, tracy::memUsage );
+
+    if( stats )
+    {
+        auto ptr = worker.GetQueueTypeStats();
+        stats->assign( ptr, ptr + (int)tracy::QueueType::NUM_TYPES );
+    }
+    return RunResult { std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count(), peak - memBase, worker.GetZoneCount(), true };
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    int runs = 3;
+    bool typeStats = true;
+
+    int c;
+    while( ( c = getopt( argc, argv, "n:s" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'n':
+            runs = atoi( optarg );
+            if( runs < 1 ) Usage();
+            break;
+        case 's':
+            typeStats = false;
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 1 ) Usage();
+    const char* input = argv[optind];
+
+    FILE* f = fopen( input, "rb" );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+    fseek( f, 0, SEEK_END );
+    std::vector<char> data( ftell( f ) );
+    fseek( f, 0, SEEK_SET );
+    const auto rd = fread( data.data(), 1, data.size(), f );
+    fclose( f );
+    if( rd != data.size() )
+    {
+        fprintf( stderr, "Cannot read input file!\n" );
+        exit( 1 );
+    }
+
+    try
+    {
+        // Per event type timing adds two clock reads to every event, so it is done in a separate run
+        // and only its event counts are used for the throughput figures.
+        std::vector<tracy::Worker::QueueTypeStats> stats;
+        if( typeStats )
+        {
+            printf( "Timing event types..." );
+            fflush( stdout );
+            if( !Replay( data, true, &stats ).handshake )
+            {
+                printf( "\nRecorded stream has no valid handshake.\n" );
+                exit( 1 );
+            }
+            printf( " done\n" );
+        }
+
+        RunResult best = {};
+        for( int i=0; i<runs; i++ )
+        {
+            const auto res = Replay( data, false, nullptr );
+            if( !res.handshake )
+            {
+                printf( "Recorded stream has no valid handshake.\n" );
+                exit( 1 );
+            }
+            printf( "Run %i: %s\n", i+1, tracy::TimeToString( res.time ) );
+            fflush( stdout );
+            if( i == 0 || res.time < best.time ) best = res;
+        }
+
+        printf( "\nStream size: %s\nZones: %s\nTime: %s (%.1f MB/s)\nPeak memory: %s\n",
+            tracy::MemSizeToString( data.size() ), tracy::RealToString( best.zones ), tracy::TimeToString( best.time ),
+            data.size() / ( best.time / 1e9 ) / ( 1024 * 1024 ), tracy::MemSizeToString( best.peakMemory ) );
+
+        if( typeStats )
+        {
+            uint64_t events = 0;
+            int64_t dispatchTime = 0;
+            for( auto& v : stats )
+            {
+                events += v.count;
+                dispatchTime += v.time;
+            }
+            printf( "Events: %s (%s events/s, %.1f ns/event)\n\n", tracy::RealToString( events ),
+                tracy::RealToString( uint64_t( events / ( best.time / 1e9 ) ) ), double( best.time ) / std::max<uint64_t>( 1, events ) );
+
+            std::vector<int> order;
+            for( int i=0; i<(int)tracy::QueueType::NUM_TYPES; i++ )
+            {
+                if( stats[i].count != 0 ) order.push_back( i );
+            }
+            std::sort( order.begin(), order.end(), [&stats] ( const auto& l, const auto& r ) { return stats[l].time > stats[r].time; } );
+
+            printf( "%-34s %14s %12s %10s %7s\n", "event type", "count", "total", "ns/event", "time" );
+            for( auto i : order )
+            {
+                auto& v = stats[i];
+                printf( "%-34s %14s %12s %10.1f %6.2f%%\n", QueueTypeNames[i], tracy::RealToString( v.count ), tracy::TimeToString( v.time ),
+                    double( v.time ) / v.count, 100. * v.time / std::max<int64_t>( 1, dispatchTime ) );
+            }
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The raw stream was recorded with a different protocol version (%i).\n", e.version );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a raw stream recording.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
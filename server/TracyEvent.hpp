@@ -229,7 +229,7 @@ struct LockEvent
     tracy_force_inline void SetSrcLoc( int16_t srcloc ) { memcpy( &_time_srcloc, &srcloc, 2 ); }
 
     uint64_t _time_srcloc;
-    uint8_t thread;
+    uint16_t thread;
     Type type;
 };
 
@@ -242,7 +242,7 @@ struct LockEventShared : public LockEvent
 struct LockEventPtr
 {
     short_ptr<LockEvent> ptr;
-    uint8_t lockingThread;
+    uint16_t lockingThread;
     uint8_t lockCount;
     uint64_t waitList;
 };
@@ -251,8 +251,9 @@ enum { LockEventSize = sizeof( LockEvent ) };
 enum { LockEventSharedSize = sizeof( LockEventShared ) };
 enum { LockEventPtrSize = sizeof( LockEventPtr ) };
 
-enum { MaxLockThreads = sizeof( LockEventPtr::waitList ) * 8 };
-static_assert( std::numeric_limits<decltype(LockEventPtr::lockCount)>::max() >= MaxLockThreads, "Not enough space for lock count." );
+enum { MaxLockThreads = std::numeric_limits<decltype(LockEvent::thread)>::max() + 1 };
+// Wait lists of locks used by more threads than this are not stored inline. See LockMap.
+enum { LockInlineThreads = sizeof( LockEventPtr::waitList ) * 8 };
 
 
 struct GpuEvent
@@ -412,8 +413,8 @@ struct ContextSwitchData
     tracy_force_inline int64_t End() const { return int64_t( _end_reason_state ) >> 16; }
     tracy_force_inline void SetEnd( int64_t end ) { assert( end < (int64_t)( 1ull << 47 ) ); memcpy( ((char*)&_end_reason_state)+2, &end, 4 ); memcpy( ((char*)&_end_reason_state)+6, ((char*)&end)+4, 2 ); }
     tracy_force_inline bool IsEndValid() const { return ( _end_reason_state >> 63 ) == 0; }
-    tracy_force_inline uint8_t Cpu() const { return uint8_t( _start_cpu & 0xFF ); }
-    tracy_force_inline void SetCpu( uint8_t cpu ) { memcpy( &_start_cpu, &cpu, 1 ); }
+    tracy_force_inline uint16_t Cpu() const { return uint16_t( _start_cpu & 0xFFFF ); }
+    tracy_force_inline void SetCpu( uint16_t cpu ) { memcpy( &_start_cpu, &cpu, 2 ); }
     tracy_force_inline int8_t Reason() const { return int8_t( (_end_reason_state >> 8) & 0xFF ); }
     tracy_force_inline void SetReason( int8_t reason ) { memcpy( ((char*)&_end_reason_state)+1, &reason, 1 ); }
     tracy_force_inline int8_t State() const { return int8_t( _end_reason_state & 0xFF ); }
@@ -421,7 +422,7 @@ struct ContextSwitchData
     tracy_force_inline int64_t WakeupVal() const { return _wakeup.Val(); }
     tracy_force_inline void SetWakeup( int64_t wakeup ) { assert( wakeup < (int64_t)( 1ull << 47 ) ); _wakeup.SetVal( wakeup ); }
 
-    tracy_force_inline void SetStartCpu( int64_t start, uint8_t cpu ) { assert( start < (int64_t)( 1ull << 47 ) ); _start_cpu = ( uint64_t( start ) << 16 ) | cpu; }
+    tracy_force_inline void SetStartCpu( int64_t start, uint16_t cpu ) { assert( start < (int64_t)( 1ull << 47 ) ); _start_cpu = ( uint64_t( start ) << 16 ) | cpu; }
     tracy_force_inline void SetEndReasonState( int64_t end, int8_t reason, int8_t state ) { assert( end < (int64_t)( 1ull << 47 ) ); _end_reason_state = ( uint64_t( end ) << 16 ) | ( uint64_t( reason ) << 8 ) | uint8_t( state ); }
 
     uint64_t _start_cpu;
@@ -454,16 +455,18 @@ enum { ContextSwitchCpuSize = sizeof( ContextSwitchCpu ) };
 struct ContextSwitchUsage
 {
     ContextSwitchUsage() {}
-    ContextSwitchUsage( int64_t time, uint8_t other, uint8_t own ) { SetTime( time ); SetOther( other ); SetOwn( own ); }
+    ContextSwitchUsage( int64_t time, uint16_t other, uint16_t own ) { SetTime( time ); SetOther( other ); SetOwn( own ); }
 
-    tracy_force_inline int64_t Time() const { return int64_t( _time_other_own ) >> 16; }
-    tracy_force_inline void SetTime( int64_t time ) { assert( time < (int64_t)( 1ull << 47 ) ); memcpy( ((char*)&_time_other_own)+2, &time, 4 ); memcpy( ((char*)&_time_other_own)+6, ((char*)&time)+4, 2 ); }
-    tracy_force_inline uint8_t Other() const { return uint8_t( _time_other_own ); }
-    tracy_force_inline void SetOther( uint8_t other ) { memcpy( &_time_other_own, &other, 1 ); }
-    tracy_force_inline uint8_t Own() const { uint8_t v; memcpy( &v, ((char*)&_time_other_own)+1, 1 );return v; }
-    tracy_force_inline void SetOwn( uint8_t own ) { memcpy( ((char*)&_time_other_own)+1, &own, 1 ); }
+    tracy_force_inline int64_t Time() const { return _time.Val(); }
+    tracy_force_inline void SetTime( int64_t time ) { assert( time < (int64_t)( 1ull << 47 ) ); _time.SetVal( time ); }
+    tracy_force_inline uint16_t Other() const { return _other; }
+    tracy_force_inline void SetOther( uint16_t other ) { _other = other; }
+    tracy_force_inline uint16_t Own() const { return _own; }
+    tracy_force_inline void SetOwn( uint16_t own ) { _own = own; }
 
-    uint64_t _time_other_own;
+    Int48 _time;
+    uint16_t _other;
+    uint16_t _own;
 };
 
 enum { ContextSwitchUsageSize = sizeof( ContextSwitchUsage ) };
@@ -490,6 +493,16 @@ struct PlotItem
 enum { PlotItemSize = sizeof( PlotItem ) };
 
 
+struct PlotLodItem
+{
+    double min;
+    double max;
+};
+
+enum { PlotLodItemSize = sizeof( PlotLodItem ) };
+enum { PlotLodShift = 5 };
+
+
 struct FrameEvent
 {
     int64_t start;
@@ -524,6 +537,19 @@ enum { GhostZoneSize = sizeof( GhostZone ) };
 #pragma pack()
 
 
+struct ZoneLod
+{
+    // Level n keeps the largest end time difference between consecutive zones, for each aligned group
+    // of 2^(ZoneLodShift+n) zones. It allows skipping runs of zones which are drawn merged.
+    Vector<Vector<int64_t>> maxStep;
+    uint32_t count = 0;
+};
+
+enum { ZoneLodShift = 5 };
+enum { ZoneLodMinSize = 1024 };
+enum { SlowZonesCount = 256 };
+
+
 struct ThreadData
 {
     uint64_t id;
@@ -536,6 +562,9 @@ struct ThreadData
 #ifndef TRACY_NO_STATISTICS
     Vector<int64_t> childTimeStack;
     Vector<GhostZone> ghostZones;
+    ZoneLod timelineLod;
+    // Min-heap of the SlowZonesCount longest zones ended on this thread.
+    Vector<short_ptr<ZoneEvent>> slowZones;
 #endif
     Vector<SampleData> samples;
 };
@@ -569,10 +598,59 @@ struct LockMap
         int64_t end = std::numeric_limits<int64_t>::min();
     };
 
+    // Thread lists (waitList, waitShared, sharedList) are bit masks of lock thread indices, as long
+    // as the lock is used by no more than LockInlineThreads threads. Otherwise the thread list is
+    // an offset into waitPool, where waitWords of bit mask are stored. Offset 0 is always the empty
+    // list. The lists are interned (waitPoolMap maps list hash to offset), so the lists can still be
+    // compared for equality, or checked for emptiness, directly.
+    tracy_force_inline bool IsThreadWaiting( uint64_t list, uint16_t thread ) const
+    {
+        if( waitWords == 0 ) return ( list & ( uint64_t( 1 ) << thread ) ) != 0;
+        return ( waitPool[list + thread / 64] & ( uint64_t( 1 ) << ( thread % 64 ) ) ) != 0;
+    }
+
+    tracy_force_inline bool AreOtherWaiting( uint64_t list, uint16_t thread ) const
+    {
+        if( waitWords == 0 ) return ( list & ~( uint64_t( 1 ) << thread ) ) != 0;
+        if( list == 0 ) return false;
+        for( uint16_t i=0; i<waitWords; i++ )
+        {
+            auto bits = waitPool[list + i];
+            if( i == thread / 64 ) bits &= ~( uint64_t( 1 ) << ( thread % 64 ) );
+            if( bits != 0 ) return true;
+        }
+        return false;
+    }
+
+    tracy_force_inline uint64_t CountWaiting( uint64_t list ) const
+    {
+        if( waitWords == 0 ) return TracyCountBits( list );
+        uint64_t cnt = 0;
+        for( uint16_t i=0; i<waitWords; i++ ) cnt += TracyCountBits( waitPool[list + i] );
+        return cnt;
+    }
+
+    template<typename T>
+    void ForEachWaiting( uint64_t list, T&& func ) const
+    {
+        const auto words = waitWords == 0 ? 1 : waitWords;
+        for( uint16_t i=0; i<words; i++ )
+        {
+            auto bits = waitWords == 0 ? list : waitPool[list + i];
+            uint16_t t = i * 64;
+            while( bits != 0 )
+            {
+                if( bits & 0x1 ) func( t );
+                bits >>= 1;
+                t++;
+            }
+        }
+    }
+
     StringIdx customName;
     int16_t srcloc;
     Vector<LockEventPtr> timeline;
-    unordered_flat_map<uint64_t, uint8_t> threadMap;
+    unordered_flat_map<uint64_t, uint16_t> threadMap;
     std::vector<uint64_t> threadList;
     LockType type;
     int64_t timeAnnounce;
@@ -580,7 +658,11 @@ struct LockMap
     bool valid;
     bool isContended;
 
-    TimeRange range[64];
+    uint16_t waitWords = 0;
+    Vector<uint64_t> waitPool;
+    unordered_flat_map<uint64_t, uint64_t> waitPoolMap;
+
+    std::vector<TimeRange> range;
 };
 
 struct LockHighlight
@@ -588,7 +670,7 @@ struct LockHighlight
     int64_t id;
     int64_t begin;
     int64_t end;
-    uint8_t thread;
+    uint16_t thread;
     bool blocked;
 };
 
@@ -616,8 +698,14 @@ struct PlotData
     uint64_t postponeTime;
     PlotType type;
     PlotValueFormatting format;
+#ifndef TRACY_NO_STATISTICS
+    // Level n keeps value range of each group of 2^(PlotLodShift+n) consecutive data points.
+    Vector<Vector<PlotLodItem>> lod;
+#endif
 };
 
+enum { MemFreeIndexShift = 5 };
+
 struct MemData
 {
     Vector<MemEvent> data;
@@ -627,6 +715,11 @@ struct MemData
     uint64_t low = std::numeric_limits<uint64_t>::max();
     uint64_t usage = 0;
     PlotData* plot = nullptr;
+#ifndef TRACY_NO_STATISTICS
+    // Level n keeps the latest free time of each group of 2^(MemFreeIndexShift+n) consecutive allocations.
+    // Allocations which are not freed are treated as freed at the end of time.
+    Vector<Vector<int64_t>> freeIndex;
+#endif
 };
 
 struct FrameData
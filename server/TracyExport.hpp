@@ -0,0 +1,124 @@
+#ifndef __TRACYEXPORT_HPP__
+#define __TRACYEXPORT_HPP__
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "tracy_robin_hood.h"
+#include "TracyWorker.hpp"
+
+namespace tracy
+{
+
+// Minimal protocol buffers encoder, used by the trace export utilities.
+class ProtoBuffer
+{
+public:
+    void Clear() { m_data.clear(); }
+    const char* Data() const { return m_data.data(); }
+    size_t Size() const { return m_data.size(); }
+
+    void Varint( uint32_t field, uint64_t val )
+    {
+        Tag( field, 0 );
+        RawVarint( val );
+    }
+
+    void Double( uint32_t field, double val )
+    {
+        Tag( field, 1 );
+        const auto pos = m_data.size();
+        m_data.resize( pos + sizeof( val ) );
+        memcpy( m_data.data() + pos, &val, sizeof( val ) );
+    }
+
+    void String( uint32_t field, const char* str )
+    {
+        const auto sz = strlen( str );
+        Tag( field, 2 );
+        RawVarint( sz );
+        m_data.insert( m_data.end(), str, str + sz );
+    }
+
+    // Message length is written as a redundant 4 byte varint, so that it doesn't have to be known in advance.
+    // Also used for packed repeated fields, which are filled with RawVarint().
+    size_t BeginMessage( uint32_t field )
+    {
+        Tag( field, 2 );
+        const auto pos = m_data.size();
+        m_data.resize( pos + 4 );
+        return pos;
+    }
+
+    void EndMessage( size_t pos )
+    {
+        const auto sz = uint32_t( m_data.size() - pos - 4 );
+        assert( sz < ( 1u << 28 ) );
+        m_data[pos] = char( 0x80 | ( sz & 0x7F ) );
+        m_data[pos+1] = char( 0x80 | ( ( sz >> 7 ) & 0x7F ) );
+        m_data[pos+2] = char( 0x80 | ( ( sz >> 14 ) & 0x7F ) );
+        m_data[pos+3] = char( sz >> 21 );
+    }
+
+    void RawVarint( uint64_t val )
+    {
+        while( val >= 0x80 )
+        {
+            m_data.push_back( char( 0x80 | ( val & 0x7F ) ) );
+            val >>= 7;
+        }
+        m_data.push_back( char( val ) );
+    }
+
+private:
+    void Tag( uint32_t field, uint32_t type ) { RawVarint( ( field << 3 ) | type ); }
+
+    std::vector<char> m_data;
+};
+
+// Selects threads with names containing one of the filter strings, or with thread id equal to one of them.
+// All threads pass if there are no filters.
+class ThreadFilter
+{
+public:
+    ThreadFilter( const Worker& worker ) : m_worker( worker ) {}
+
+    void Set( const std::vector<const char*>& filter )
+    {
+        m_filter = filter;
+        m_pass.clear();
+    }
+
+    bool Pass( uint64_t tid )
+    {
+        if( m_filter.empty() ) return true;
+        auto it = m_pass.find( tid );
+        if( it != m_pass.end() ) return it->second;
+        bool pass = false;
+        const auto name = m_worker.GetThreadName( tid );
+        for( auto& filter : m_filter )
+        {
+            char* end;
+            const auto filterTid = strtoull( filter, &end, 10 );
+            if( ( *end == '\0' && filterTid == tid ) || strstr( name, filter ) )
+            {
+                pass = true;
+                break;
+            }
+        }
+        m_pass.emplace( tid, pass );
+        return pass;
+    }
+
+private:
+    const Worker& m_worker;
+    std::vector<const char*> m_filter;
+    unordered_flat_map<uint64_t, bool> m_pass;
+};
+
+}
+
+#endif
@@ -294,6 +294,7 @@ public:
     }
 
     const std::string& GetFilename() const { return m_filename; }
+    uint64_t GetBytesRead() const { return m_bufBase + m_offset; }
 
 private:
     FileRead( FILE* f, const char* fn )
@@ -303,6 +304,7 @@ private:
         , m_buf( m_bufData[1] )
         , m_second( m_bufData[0] )
         , m_offset( 0 )
+        , m_bufBase( 0 )
         , m_lastBlock( 0 )
         , m_signalSwitch( false )
         , m_signalAvailable( false )
@@ -342,8 +344,9 @@ private:
 
         m_data = (char*)mmap( nullptr, m_dataSize, PROT_READ, MAP_SHARED, fileno( f ), 0 );
         fclose( f );
-        if( !m_data )
+        if( m_data == (char*)MAP_FAILED )
         {
+            m_data = nullptr;
             throw FileReadError();
         }
         m_dataOffset = sizeof( hdr );
@@ -399,6 +402,7 @@ private:
             {
                 sz = std::min<size_t>( size, BufSize );
 
+                m_bufBase += BufSize;
                 m_signalSwitch.store( true, std::memory_order_relaxed );
                 while( m_signalAvailable.load( std::memory_order_acquire ) == false ) { YieldThread(); }
                 m_signalAvailable.store( false, std::memory_order_relaxed );
@@ -426,6 +430,7 @@ private:
         {
             if( m_offset == BufSize )
             {
+                m_bufBase += BufSize;
                 m_signalSwitch.store( true, std::memory_order_relaxed );
                 while( m_signalAvailable.load( std::memory_order_acquire ) == false ) { YieldThread(); }
                 m_signalAvailable.store( false, std::memory_order_relaxed );
@@ -466,6 +471,7 @@ private:
     char* m_buf;
     char* m_second;
     size_t m_offset;
+    uint64_t m_bufBase;
     size_t m_lastBlock;
 
     alignas(64) std::atomic<bool> m_signalSwitch;
@@ -65,6 +65,7 @@ public:
     }
 
     std::pair<size_t, size_t> GetCompressionStatistics() const { return std::make_pair( m_srcBytes, m_dstBytes ); }
+    size_t GetBytesWritten() const { return m_srcBytes + m_offset; }
 
 private:
     FileWrite( FILE* f, Compression comp, int level )
@@ -0,0 +1,130 @@
+#ifndef __TRACYHISTOGRAM_HPP__
+#define __TRACYHISTOGRAM_HPP__
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#if defined _MSC_VER && defined _WIN64
+#  include <intrin.h>
+#endif
+
+#include "../common/TracyForceInline.hpp"
+
+namespace tracy
+{
+
+static tracy_force_inline int HistogramLog2( uint64_t val )
+{
+    assert( val != 0 );
+#if defined _MSC_VER && defined _WIN64
+    unsigned long idx;
+    _BitScanReverse64( &idx, val );
+    return int( idx );
+#elif defined __GNUC__ || defined __clang__
+    return 63 - __builtin_clzll( val );
+#else
+    int idx = 0;
+    while( val >>= 1 ) idx++;
+    return idx;
+#endif
+}
+
+// Log-bucketed histogram of time spans, in the spirit of HDR histograms. Values below SubCount have
+// their own buckets. Each following power of two range is split into SubCount linear buckets, which
+// bounds the relative bucket width to 1/SubCount. Histograms with equal layout can be merged by
+// adding bucket counts.
+class LogHistogram
+{
+public:
+    enum { SubBits = 5 };
+    enum { SubCount = 1 << SubBits };
+
+    tracy_force_inline void Add( int64_t val )
+    {
+        const auto idx = BucketIndex( val );
+        if( idx >= m_bins.size() ) m_bins.resize( idx + 1 );
+        m_bins[idx]++;
+        m_count++;
+    }
+
+    void Merge( const LogHistogram& other )
+    {
+        if( other.m_bins.size() > m_bins.size() ) m_bins.resize( other.m_bins.size() );
+        for( size_t i=0; i<other.m_bins.size(); i++ ) m_bins[i] += other.m_bins[i];
+        m_count += other.m_count;
+    }
+
+    void Clear()
+    {
+        m_bins.clear();
+        m_count = 0;
+    }
+
+    tracy_force_inline uint64_t Count() const { return m_count; }
+    tracy_force_inline size_t NumBuckets() const { return m_bins.size(); }
+    tracy_force_inline uint64_t BucketCount( size_t idx ) const { return m_bins[idx]; }
+
+    // Value at the given quantile (0-1), linearly interpolated within the bucket it falls into.
+    int64_t Percentile( double p ) const
+    {
+        if( m_count == 0 ) return 0;
+        auto target = uint64_t( p * m_count );
+        if( target >= m_count ) target = m_count - 1;
+        uint64_t cnt = 0;
+        for( size_t i=0; i<m_bins.size(); i++ )
+        {
+            const auto bin = m_bins[i];
+            if( cnt + bin > target )
+            {
+                const auto bmin = BucketMin( i );
+                const auto width = BucketMax( i ) - bmin;
+                return bmin + int64_t( width * ( double( target - cnt ) + 0.5 ) / bin );
+            }
+            cnt += bin;
+        }
+        assert( false );
+        return 0;
+    }
+
+    static tracy_force_inline size_t BucketIndex( int64_t val )
+    {
+        if( val < SubCount ) return val < 0 ? 0 : size_t( val );
+        const auto shift = HistogramLog2( uint64_t( val ) ) - SubBits;
+        return ( size_t( shift + 1 ) << SubBits ) + size_t( ( uint64_t( val ) >> shift ) - SubCount );
+    }
+
+    static tracy_force_inline int64_t BucketMin( size_t idx )
+    {
+        const auto block = idx >> SubBits;
+        const auto sub = int64_t( idx & ( SubCount - 1 ) );
+        if( block == 0 ) return sub;
+        return ( SubCount + sub ) << ( block - 1 );
+    }
+
+    // Exclusive upper bound.
+    static tracy_force_inline int64_t BucketMax( size_t idx )
+    {
+        const auto block = idx >> SubBits;
+        return BucketMin( idx ) + ( block == 0 ? 1 : ( int64_t( 1 ) << ( block - 1 ) ) );
+    }
+
+private:
+    std::vector<uint64_t> m_bins;
+    uint64_t m_count = 0;
+};
+
+// Value at the given quantile (0-1) of a sorted, non-empty list of values.
+template<typename T>
+static tracy_force_inline int64_t Percentile( const T& sorted, double p )
+{
+    assert( !sorted.empty() );
+    auto idx = size_t( p * sorted.size() );
+    if( idx >= sorted.size() ) idx = sorted.size() - 1;
+    return sorted[idx];
+}
+
+}
+
+#endif
@@ -159,6 +159,11 @@ void UserData::StateShouldBePreserved()
     m_preserveState = true;
 }
 
+void UserData::StateShouldNotBePreserved()
+{
+    m_preserveState = false;
+}
+
 void UserData::LoadAnnotations( std::vector<std::unique_ptr<Annotation>>& data )
 {
     assert( Valid() );
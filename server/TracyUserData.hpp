@@ -29,6 +29,7 @@ public:
     void LoadState( ViewData& data );
     void SaveState( const ViewData& data );
     void StateShouldBePreserved();
+    void StateShouldNotBePreserved();
 
     void LoadAnnotations( std::vector<std::unique_ptr<Annotation>>& data );
     void SaveAnnotations( const std::vector<std::unique_ptr<Annotation>>& data );
@@ -33,8 +33,8 @@
 #include "TracyFilesystem.hpp"
 #include "TracyPopcnt.hpp"
 #include "TracyPrint.hpp"
-#include "TracySort.hpp"
 #include "TracySourceView.hpp"
+#include "TracyTaskDispatch.hpp"
 #include "TracyView.hpp"
 
 #include "../imgui/imgui_internal.h"
@@ -73,21 +73,6 @@ static const char* s_tracyStackFrames[] = {
 };
 
 
-static inline uint64_t GetThreadBit( uint8_t thread )
-{
-    return uint64_t( 1 ) << thread;
-}
-
-static inline bool IsThreadWaiting( uint64_t bitlist, uint64_t threadBit )
-{
-    return ( bitlist & threadBit ) != 0;
-}
-
-static inline bool AreOtherWaiting( uint64_t bitlist, uint64_t threadBit )
-{
-    return ( bitlist & ~threadBit ) != 0;
-}
-
 static tracy_force_inline void PrintStringPercent( char* buf, const char* string, double percent )
 {
     const auto ssz = strlen( string );
@@ -185,6 +170,68 @@ View::~View()
     s_instance = nullptr;
 }
 
+// Restores default view settings and prevents them from being saved, so that scripted runs
+// are repeatable and do not overwrite the user's state.
+void View::ResetUserState()
+{
+    m_vd = ViewData();
+    m_annotations.clear();
+    m_userData.StateShouldNotBePreserved();
+    SetViewToLastFrames();
+}
+
+void View::SetViewRange( int64_t start, int64_t end )
+{
+    assert( start < end );
+    m_zoomAnim.active = false;
+    m_vd.zvStart = start;
+    m_vd.zvEnd = end;
+}
+
+void View::ShowWindow( ScriptWindow window, bool show )
+{
+    switch( window )
+    {
+    case ScriptWindow::Messages:
+        m_showMessages = show;
+        break;
+    case ScriptWindow::FindZone:
+        m_findZone.show = show;
+        break;
+    case ScriptWindow::Statistics:
+        m_showStatistics = show;
+        break;
+    case ScriptWindow::Memory:
+        m_memInfo.show = show;
+        break;
+    case ScriptWindow::Info:
+        m_showInfo = show;
+        break;
+    case ScriptWindow::SlowZones:
+        m_showSlowZones = show;
+        break;
+    default:
+        assert( false );
+        break;
+    }
+}
+
+void View::ShowFindZone( int16_t srcloc )
+{
+    auto& sl = m_worker.GetSourceLocation( srcloc );
+    m_findZone.ShowZone( srcloc, m_worker.GetString( sl.name.active ? sl.name : sl.function ) );
+}
+
+TaskDispatch& View::GetTaskDispatch()
+{
+    if( !m_taskDispatch )
+    {
+        const auto workers = std::max<int>( std::thread::hardware_concurrency() - 1, 1 );
+        m_taskDispatch = std::make_unique<TaskDispatch>( workers );
+    }
+    return *m_taskDispatch;
+}
+
 void View::InitTextEditor( ImFont* font )
 {
     m_sourceView = std::make_unique<SourceView>( font );
@@ -589,6 +636,10 @@ bool View::DrawImpl()
         {
             m_showAnnotationList = true;
         }
+        if( ImGui::Button( ICON_FA_HOURGLASS_HALF " Slowest zones" ) )
+        {
+            m_showSlowZones = true;
+        }
         ImGui::EndPopup();
     }
     ImGui::SameLine();
@@ -753,6 +804,7 @@ bool View::DrawImpl()
     if( m_showCpuDataWindow ) DrawCpuDataWindow();
     if( m_selectedAnnotation ) DrawSelectedAnnotation();
     if( m_showAnnotationList ) DrawAnnotationList();
+    if( m_showSlowZones ) DrawSlowZones();
     if( m_sampleParents.symAddr != 0 ) DrawSampleParents();
 
     if( m_zoomAnim.active )
@@ -2248,6 +2300,12 @@ void View::DrawZones()
 
     ImGui::BeginChild( "##zoneWin", ImVec2( ImGui::GetWindowContentRegionWidth(), ImGui::GetContentRegionAvail().y ), false, ImGuiWindowFlags_AlwaysVerticalScrollbar | ImGuiWindowFlags_NoScrollWithMouse );
 
+    if( m_timelineScroll >= 0 )
+    {
+        ImGui::SetScrollY( m_timelineScroll );
+        m_timelineScroll = -1;
+    }
+
     const auto wpos = ImGui::GetCursorScreenPos();
     const auto h = std::max<float>( m_vd.zvHeight, ImGui::GetContentRegionAvail().y - 4 );    // magic border value
 
@@ -2540,10 +2598,38 @@ void View::DrawZones()
         }
     }
 
+    // Zone selection for each thread row is independent of the other rows, so it is done in parallel.
+    // Drawing and hover handling of the selected zones is done below, in thread order.
+    m_threadZoneDraw.resize( m_threadOrder.size() );
+    for( auto& td : m_threadZoneDraw ) td.ready = false;
+    if( m_vd.drawZones )
+    {
+        auto& td = GetTaskDispatch();
+        const auto nspxi = int64_t( nspx );
+        for( size_t i=0; i<m_threadOrder.size(); i++ )
+        {
+            auto v = m_threadOrder[i];
+            const auto& vis = Vis( v );
+            if( !vis.visible || !vis.showFull ) continue;
+#ifndef TRACY_NO_STATISTICS
+            if( m_worker.AreGhostZonesReady() && ( vis.ghost || ( m_vd.ghostZones && v->timeline.empty() ) ) ) continue;
+#endif
+            auto zd = &m_threadZoneDraw[i];
+            td.Queue( [this, v, zd, pxns, nspxi] {
+                zd->list.clear();
+                zd->depth = PrepareZoneLevel( v->timeline, &v->timelineLod, pxns, nspxi, 0, zd->list );
+                zd->ready = true;
+            } );
+        }
+        td.Sync();
+    }
+
     auto& crash = m_worker.GetCrashEvent();
     LockHighlight nextLockHighlight { -1 };
+    size_t threadIdx = 0;
     for( const auto& v : m_threadOrder )
     {
+        auto& zoneDraw = m_threadZoneDraw[threadIdx++];
         auto& vis = Vis( v );
         if( !vis.visible )
         {
@@ -2587,7 +2673,14 @@ void View::DrawZones()
                 else
 #endif
                 {
-                    depth = DispatchZoneLevel( v->timeline, hover, pxns, int64_t( nspx ), wpos, offset, 0, yMin, yMax, v->id );
+                    // Visibility of the row may have been changed after the parallel pass.
+                    if( !zoneDraw.ready )
+                    {
+                        zoneDraw.list.clear();
+                        zoneDraw.depth = PrepareZoneLevel( v->timeline, &v->timelineLod, pxns, int64_t( nspx ), 0, zoneDraw.list );
+                    }
+                    DrawTimelineZones( zoneDraw.list, hover, pxns, wpos, offset, yMin, yMax, v->id );
+                    depth = zoneDraw.depth;
                 }
                 offset += ostep * depth;
             }
@@ -2997,6 +3090,22 @@ void View::DrawZones()
         draw->AddRect( ImVec2( wpos.x + px0, linepos.y ), ImVec2( wpos.x + px1, linepos.y + lineh ), 0x2288DDDD );
     }
 
+    if( m_showStatistics && m_statLimitRange && m_statMode == 0 )
+    {
+        const auto px0 = ( m_statRangeMin - m_vd.zvStart ) * pxns;
+        const auto px1 = std::max( px0 + std::max( 1.0, pxns * 0.5 ), ( m_statRangeMax - m_vd.zvStart ) * pxns );
+        draw->AddRectFilled( ImVec2( wpos.x + px0, linepos.y ), ImVec2( wpos.x + px1, linepos.y + lineh ), 0x11DD88DD );
+        draw->AddRect( ImVec2( wpos.x + px0, linepos.y ), ImVec2( wpos.x + px1, linepos.y + lineh ), 0x22DD88DD );
+    }
+
+    if( m_showMessages && m_msgLimitRange )
+    {
+        const auto px0 = ( m_msgRangeMin - m_vd.zvStart ) * pxns;
+        const auto px1 = std::max( px0 + std::max( 1.0, pxns * 0.5 ), ( m_msgRangeMax - m_vd.zvStart ) * pxns );
+        draw->AddRectFilled( ImVec2( wpos.x + px0, linepos.y ), ImVec2( wpos.x + px1, linepos.y + lineh ), 0x11DDDD88 );
+        draw->AddRect( ImVec2( wpos.x + px0, linepos.y ), ImVec2( wpos.x + px1, linepos.y + lineh ), 0x22DDDD88 );
+    }
+
     if( m_highlight.active && m_highlight.start != m_highlight.end )
     {
         const auto s = std::min( m_highlight.start, m_highlight.end );
@@ -3701,39 +3810,22 @@ int View::SkipGhostLevel( const Vector<GhostZone>& vec, bool hover, double pxns,
 }
 #endif
 
-int View::DispatchZoneLevel( const Vector<short_ptr<ZoneEvent>>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int _offset, int depth, float yMin, float yMax, uint64_t tid )
+int View::PrepareZoneLevel( const Vector<short_ptr<ZoneEvent>>& vec, const ZoneLod* lod, double pxns, int64_t nspx, int depth, std::vector<TimelineDraw>& out )
 {
-    const auto ty = ImGui::GetFontSize();
-    const auto ostep = ty + 1;
-    const auto offset = _offset + ostep * depth;
-
-    const auto yPos = wpos.y + offset;
-    if( yPos + ostep >= yMin && yPos <= yMax )
+    if( vec.is_magic() )
     {
-        if( vec.is_magic() )
-        {
-            return DrawZoneLevel<VectorAdapterDirect<ZoneEvent>>( *(Vector<ZoneEvent>*)( &vec ), hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-        }
-        else
-        {
-            return DrawZoneLevel<VectorAdapterPointer<ZoneEvent>>( vec, hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-        }
+        return PrepareZoneLevelImpl<VectorAdapterDirect<ZoneEvent>>( *(Vector<ZoneEvent>*)( &vec ), lod, pxns, nspx, depth, out );
     }
     else
     {
-        if( vec.is_magic() )
-        {
-            return SkipZoneLevel<VectorAdapterDirect<ZoneEvent>>( *(Vector<ZoneEvent>*)( &vec ), hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-        }
-        else
-        {
-            return SkipZoneLevel<VectorAdapterPointer<ZoneEvent>>( vec, hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-        }
+        return PrepareZoneLevelImpl<VectorAdapterPointer<ZoneEvent>>( vec, lod, pxns, nspx, depth, out );
     }
 }
 
+// Selects zones to be displayed on the timeline, without touching ImGui state, so that it can be run
+// on a worker thread. Items are emitted in the order in which they are to be drawn.
 template<typename Adapter, typename V>
-int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int _offset, int depth, float yMin, float yMax, uint64_t tid )
+int View::PrepareZoneLevelImpl( const V& vec, const ZoneLod* lod, double pxns, int64_t nspx, int depth, std::vector<TimelineDraw>& out )
 {
     const auto delay = m_worker.GetDelay();
     const auto resolution = m_worker.GetResolution();
@@ -3746,10 +3838,43 @@ int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, co
     Adapter a;
     if( !a(*it).IsEndValid() && m_worker.GetZoneEnd( a(*it) ) < m_vd.zvStart ) return depth;
 
+    depth++;
+    int maxdepth = depth;
+
+    while( it < zitend )
+    {
+        auto& ev = a(*it);
+        const auto end = m_worker.GetZoneEnd( ev );
+        const auto zsz = std::max( ( end - ev.Start() ) * pxns, pxns * 0.5 );
+        if( zsz < MinVisSize )
+        {
+            const auto first = size_t( std::distance( vec.begin(), it ) );
+            auto idx = first + 1;
+            const auto rend = MergeSmallZones<Adapter>( vec, lod, idx, std::distance( vec.begin(), zitend ), end, MinVisSize * 2 * nspx );
+            it = vec.begin() + idx;
+            out.emplace_back( TimelineDraw { TimelineDrawType::Folded, uint16_t( depth ), uint32_t( idx - first ), &ev, rend } );
+        }
+        else
+        {
+            if( ev.HasChildren() )
+            {
+                const auto d = PrepareZoneLevel( m_worker.GetZoneChildren( ev.Child() ), m_worker.GetZoneChildrenLod( ev.Child() ), pxns, nspx, depth, out );
+                if( d > maxdepth ) maxdepth = d;
+            }
+            out.emplace_back( TimelineDraw { TimelineDrawType::Zone, uint16_t( depth ), 0, &ev, end } );
+            ++it;
+        }
+    }
+    return maxdepth;
+}
+
+void View::DrawTimelineZones( const std::vector<TimelineDraw>& list, bool hover, double pxns, const ImVec2& wpos, int _offset, float yMin, float yMax, uint64_t tid )
+{
+    const auto delay = m_worker.GetDelay();
+    const auto resolution = m_worker.GetResolution();
     const auto w = ImGui::GetWindowContentRegionWidth() - 1;
     const auto ty = ImGui::GetFontSize();
     const auto ostep = ty + 1;
-    const auto offset = _offset + ostep * depth;
     auto draw = ImGui::GetWindowDrawList();
     const auto dsz = delay * pxns;
     const auto rsz = resolution * pxns;
@@ -3758,36 +3883,21 @@ int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, co
     const auto ty05  = round( ty * 0.5f );
     const auto ty075 = round( ty * 0.75f );
 
-    depth++;
-    int maxdepth = depth;
-
-    while( it < zitend )
+    for( auto& item : list )
     {
-        auto& ev = a(*it);
-        const auto end = m_worker.GetZoneEnd( ev );
-        const auto zsz = std::max( ( end - ev.Start() ) * pxns, pxns * 0.5 );
-        if( zsz < MinVisSize )
+        const auto depth = int( item.depth );
+        const auto offset = _offset + ostep * ( depth - 1 );
+        const auto yPos = wpos.y + offset;
+        if( yPos + ostep < yMin || yPos > yMax ) continue;
+
+        auto& ev = *item.ev;
+        if( item.type == TimelineDrawType::Folded )
         {
             const auto color = GetThreadColor( tid, depth );
-            int num = 0;
+            const auto rend = item.rend;
+            const auto num = int( item.num );
             const auto px0 = ( ev.Start() - m_vd.zvStart ) * pxns;
-            auto px1 = ( end - m_vd.zvStart ) * pxns;
-            auto rend = end;
-            auto nextTime = end + MinVisSize * nspx;
-            for(;;)
-            {
-                const auto prevIt = it;
-                it = std::lower_bound( it, zitend, nextTime, [] ( const auto& l, const auto& r ) { Adapter a; return (uint64_t)a(l).End() < (uint64_t)r; } );
-                if( it == prevIt ) ++it;
-                num += std::distance( prevIt, it );
-                if( it == zitend ) break;
-                const auto nend = m_worker.GetZoneEnd( a(*it) );
-                const auto pxnext = ( nend - m_vd.zvStart ) * pxns;
-                if( pxnext - px1 >= MinVisSize * 2 ) break;
-                px1 = pxnext;
-                rend = nend;
-                nextTime = nend + nspx;
-            }
+            const auto px1 = ( rend - m_vd.zvStart ) * pxns;
             draw->AddRectFilled( wpos + ImVec2( std::max( px0, -10.0 ), offset ), wpos + ImVec2( std::min( std::max( px1, px0+MinVisSize ), double( w + 10 ) ), offset + ty ), color );
             DrawZigZag( draw, wpos + ImVec2( 0, offset + ty/2 ), std::max( px0, -10.0 ), std::min( std::max( px1, px0+MinVisSize ), double( w + 10 ) ), ty/4, DarkenColor( color ) );
             if( hover && ImGui::IsMouseHoveringRect( wpos + ImVec2( std::max( px0, -10.0 ), offset ), wpos + ImVec2( std::min( std::max( px1, px0+MinVisSize ), double( w + 10 ) ), offset + ty ) ) )
@@ -3840,15 +3950,11 @@ int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, co
         }
         else
         {
+            const auto end = item.rend;
+            const auto zsz = std::max( ( end - ev.Start() ) * pxns, pxns * 0.5 );
             const auto color = GetZoneColor( ev, tid, depth );
             const char* zoneName = m_worker.GetZoneName( ev );
 
-            if( ev.HasChildren() )
-            {
-                const auto d = DispatchZoneLevel( m_worker.GetZoneChildren( ev.Child() ), hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-                if( d > maxdepth ) maxdepth = d;
-            }
-
             auto tsz = ImGui::CalcTextSize( zoneName );
             if( tsz.x > zsz )
             {
@@ -3948,62 +4054,60 @@ int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, co
                 m_zoneSrcLocHighlight = ev.SrcLoc();
                 m_zoneHover = &ev;
             }
-
-            ++it;
         }
     }
-    return maxdepth;
 }
 
+// Zones are merged while each one ends closer than mergeDist to the end of the previous one. Returns end
+// time of the last merged zone, idx is advanced past it.
 template<typename Adapter, typename V>
-int View::SkipZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int _offset, int depth, float yMin, float yMax, uint64_t tid )
+int64_t View::MergeSmallZones( const V& vec, const ZoneLod* lod, size_t& idx, size_t endIdx, int64_t rend, int64_t mergeDist )
 {
-    const auto delay = m_worker.GetDelay();
-    const auto resolution = m_worker.GetResolution();
-    // cast to uint64_t, so that unended zones (end = -1) are still drawn
-    auto it = std::lower_bound( vec.begin(), vec.end(), std::max<int64_t>( 0, m_vd.zvStart - delay ), [] ( const auto& l, const auto& r ) { Adapter a; return (uint64_t)a(l).End() < (uint64_t)r; } );
-    if( it == vec.end() ) return depth;
-
-    const auto zitend = std::lower_bound( it, vec.end(), m_vd.zvEnd + resolution, [] ( const auto& l, const auto& r ) { Adapter a; return a(l).Start() < r; } );
-    if( it == zitend ) return depth;
-
-    depth++;
-    int maxdepth = depth;
-
     Adapter a;
-    while( it < zitend )
+    if( !lod )
     {
-        auto& ev = a(*it);
-        const auto end = m_worker.GetZoneEnd( ev );
-        const auto zsz = std::max( ( end - ev.Start() ) * pxns, pxns * 0.5 );
-        if( zsz < MinVisSize )
+        // Zones ending less than half of mergeDist after the previous end are skipped with a binary search.
+        auto it = vec.begin() + idx;
+        const auto itend = vec.begin() + endIdx;
+        for(;;)
         {
-            auto px1 = ( end - m_vd.zvStart ) * pxns;
-            auto nextTime = end + MinVisSize * nspx;
-            for(;;)
-            {
-                const auto prevIt = it;
-                it = std::lower_bound( it, zitend, nextTime, [] ( const auto& l, const auto& r ) { Adapter a; return (uint64_t)a(l).End() < (uint64_t)r; } );
-                if( it == prevIt ) ++it;
-                if( it == zitend ) break;
-                const auto nend = m_worker.GetZoneEnd( a(*it) );
-                const auto pxnext = ( nend - m_vd.zvStart ) * pxns;
-                if( pxnext - px1 >= MinVisSize * 2 ) break;
-                px1 = pxnext;
-                nextTime = nend + nspx;
-            }
+            const auto prevIt = it;
+            it = std::lower_bound( it, itend, rend + mergeDist / 2, [] ( const auto& l, const auto& r ) { Adapter a; return (uint64_t)a(l).End() < (uint64_t)r; } );
+            if( it != prevIt ) rend = a(*(it-1)).End();
+            if( it == itend ) break;
+            const auto end = m_worker.GetZoneEnd( a(*it) );
+            if( end - rend >= mergeDist ) break;
+            rend = end;
+            ++it;
         }
-        else
+        idx = std::distance( vec.begin(), it );
+        return rend;
+    }
+
+    const auto lodCount = std::min<size_t>( lod->count, endIdx );
+    while( idx < endIdx )
+    {
+        // Skip the largest aligned group of zones in which no zone ends too far from the previous one.
+        int level = -1;
+        while( level + 1 < (int)lod->maxStep.size() )
         {
-            if( ev.HasChildren() )
-            {
-                const auto d = DispatchZoneLevel( m_worker.GetZoneChildren( ev.Child() ), hover, pxns, nspx, wpos, _offset, depth, yMin, yMax, tid );
-                if( d > maxdepth ) maxdepth = d;
-            }
-            ++it;
+            const auto shift = ZoneLodShift + level + 1;
+            const auto size = size_t( 1 ) << shift;
+            if( ( idx & ( size - 1 ) ) != 0 || idx + size > lodCount || lod->maxStep[level+1][idx >> shift] >= mergeDist ) break;
+            level++;
+        }
+        if( level >= 0 )
+        {
+            idx += size_t( 1 ) << ( ZoneLodShift + level );
+            rend = m_worker.GetZoneEnd( a(vec[idx-1]) );
+            continue;
         }
+        const auto end = m_worker.GetZoneEnd( a(vec[idx]) );
+        if( end - rend >= mergeDist ) break;
+        rend = end;
+        idx++;
     }
-    return maxdepth;
+    return rend;
 }
 
 int View::DispatchGpuZoneLevel( const Vector<short_ptr<GpuEvent>>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int _offset, int depth, uint64_t thread, float yMin, float yMax, int64_t begin, int drift )
@@ -4269,7 +4373,7 @@ enum class LockState
     WaitLock            // red
 };
 
-static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockEventPtr>::const_iterator& it, const Vector<LockEventPtr>::const_iterator& end, LockState& nextState, uint64_t threadBit )
+static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockEventPtr>::const_iterator& it, const Vector<LockEventPtr>::const_iterator& end, LockState& nextState, const LockMap& lockmap, uint16_t thread )
 {
     auto next = it;
     next++;
@@ -4281,12 +4385,12 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockE
         {
             if( next->lockCount != 0 )
             {
-                if( GetThreadBit( next->lockingThread ) == threadBit )
+                if( next->lockingThread == thread )
                 {
-                    nextState = AreOtherWaiting( next->waitList, threadBit ) ? LockState::HasBlockingLock : LockState::HasLock;
+                    nextState = lockmap.AreOtherWaiting( next->waitList, thread ) ? LockState::HasBlockingLock : LockState::HasLock;
                     break;
                 }
-                else if( IsThreadWaiting( next->waitList, threadBit ) )
+                else if( lockmap.IsThreadWaiting( next->waitList, thread ) )
                 {
                     nextState = LockState::WaitLock;
                     break;
@@ -4305,7 +4409,7 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockE
             }
             if( next->waitList != 0 )
             {
-                if( AreOtherWaiting( next->waitList, threadBit ) )
+                if( lockmap.AreOtherWaiting( next->waitList, thread ) )
                 {
                     nextState = LockState::HasBlockingLock;
                 }
@@ -4336,9 +4440,9 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockE
     case LockState::WaitLock:
         while( next < end )
         {
-            if( GetThreadBit( next->lockingThread ) == threadBit )
+            if( next->lockingThread == thread )
             {
-                nextState = AreOtherWaiting( next->waitList, threadBit ) ? LockState::HasBlockingLock : LockState::HasLock;
+                nextState = lockmap.AreOtherWaiting( next->waitList, thread ) ? LockState::HasBlockingLock : LockState::HasLock;
                 break;
             }
             if( next->lockingThread != it->lockingThread )
@@ -4360,7 +4464,7 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEvent( const Vector<LockE
     return next;
 }
 
-static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector<LockEventPtr>::const_iterator& it, const Vector<LockEventPtr>::const_iterator& end, LockState& nextState, uint64_t threadBit )
+static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector<LockEventPtr>::const_iterator& it, const Vector<LockEventPtr>::const_iterator& end, LockState& nextState, const LockMap& lockmap, uint16_t thread )
 {
     const auto itptr = (const LockEventShared*)(const LockEvent*)it->ptr;
     auto next = it;
@@ -4374,24 +4478,23 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector
             const auto ptr = (const LockEventShared*)(const LockEvent*)next->ptr;
             if( next->lockCount != 0 )
             {
-                const auto wait = next->waitList | ptr->waitShared;
-                if( GetThreadBit( next->lockingThread ) == threadBit )
+                if( next->lockingThread == thread )
                 {
-                    nextState = AreOtherWaiting( wait, threadBit ) ? LockState::HasBlockingLock : LockState::HasLock;
+                    nextState = ( lockmap.AreOtherWaiting( next->waitList, thread ) || lockmap.AreOtherWaiting( ptr->waitShared, thread ) ) ? LockState::HasBlockingLock : LockState::HasLock;
                     break;
                 }
-                else if( IsThreadWaiting( wait, threadBit ) )
+                else if( lockmap.IsThreadWaiting( next->waitList, thread ) || lockmap.IsThreadWaiting( ptr->waitShared, thread ) )
                 {
                     nextState = LockState::WaitLock;
                     break;
                 }
             }
-            else if( IsThreadWaiting( ptr->sharedList, threadBit ) )
+            else if( lockmap.IsThreadWaiting( ptr->sharedList, thread ) )
             {
                 nextState = ( next->waitList != 0 ) ? LockState::HasBlockingLock : LockState::HasLock;
                 break;
             }
-            else if( ptr->sharedList != 0 && IsThreadWaiting( next->waitList, threadBit ) )
+            else if( ptr->sharedList != 0 && lockmap.IsThreadWaiting( next->waitList, thread ) )
             {
                 nextState = LockState::WaitLock;
                 break;
@@ -4403,20 +4506,20 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector
         while( next < end )
         {
             const auto ptr = (const LockEventShared*)(const LockEvent*)next->ptr;
-            if( next->lockCount == 0 && !IsThreadWaiting( ptr->sharedList, threadBit ) )
+            if( next->lockCount == 0 && !lockmap.IsThreadWaiting( ptr->sharedList, thread ) )
             {
                 nextState = LockState::Nothing;
                 break;
             }
             if( next->waitList != 0 )
             {
-                if( AreOtherWaiting( next->waitList, threadBit ) )
+                if( lockmap.AreOtherWaiting( next->waitList, thread ) )
                 {
                     nextState = LockState::HasBlockingLock;
                 }
                 break;
             }
-            else if( !IsThreadWaiting( ptr->sharedList, threadBit ) && ptr->waitShared != 0 )
+            else if( !lockmap.IsThreadWaiting( ptr->sharedList, thread ) && ptr->waitShared != 0 )
             {
                 nextState = LockState::HasBlockingLock;
                 break;
@@ -4432,7 +4535,7 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector
         while( next < end )
         {
             const auto ptr = (const LockEventShared*)(const LockEvent*)next->ptr;
-            if( next->lockCount == 0 && !IsThreadWaiting( ptr->sharedList, threadBit ) )
+            if( next->lockCount == 0 && !lockmap.IsThreadWaiting( ptr->sharedList, thread ) )
             {
                 nextState = LockState::Nothing;
                 break;
@@ -4448,13 +4551,12 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector
         while( next < end )
         {
             const auto ptr = (const LockEventShared*)(const LockEvent*)next->ptr;
-            if( GetThreadBit( next->lockingThread ) == threadBit )
+            if( next->lockingThread == thread )
             {
-                const auto wait = next->waitList | ptr->waitShared;
-                nextState = AreOtherWaiting( wait, threadBit ) ? LockState::HasBlockingLock : LockState::HasLock;
+                nextState = ( lockmap.AreOtherWaiting( next->waitList, thread ) || lockmap.AreOtherWaiting( ptr->waitShared, thread ) ) ? LockState::HasBlockingLock : LockState::HasLock;
                 break;
             }
-            if( IsThreadWaiting( ptr->sharedList, threadBit ) )
+            if( lockmap.IsThreadWaiting( ptr->sharedList, thread ) )
             {
                 nextState = ( next->waitList != 0 ) ? LockState::HasBlockingLock : LockState::HasLock;
                 break;
@@ -4463,7 +4565,7 @@ static Vector<LockEventPtr>::const_iterator GetNextLockEventShared( const Vector
             {
                 break;
             }
-            if( next->lockCount == 0 && !IsThreadWaiting( ptr->waitShared, threadBit ) )
+            if( next->lockCount == 0 && !lockmap.IsThreadWaiting( ptr->waitShared, thread ) )
             {
                 break;
             }
@@ -4483,7 +4585,7 @@ static LockState CombineLockState( LockState state, LockState next )
     return (LockState)std::max( (int)state, (int)next );
 }
 
-void View::DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLocation& srcloc, bool hover, ImDrawList* draw, const ImVec2& wpos, float w, float ty, float offset, uint8_t tid )
+void View::DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLocation& srcloc, bool hover, ImDrawList* draw, const ImVec2& wpos, float w, float ty, float offset, uint16_t tid )
 {
     char buf[1024];
     if( lockmap.customName.Active() )
@@ -4618,7 +4720,6 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
         auto GetNextLockFunc = lockmap.type == LockType::Lockable ? GetNextLockEvent : GetNextLockEventShared;
 
         const auto thread = it->second;
-        const auto threadBit = GetThreadBit( thread );
 
         auto vbegin = std::lower_bound( tl.begin(), tl.end(), std::max( range.start, m_vd.zvStart - delay ), [] ( const auto& l, const auto& r ) { return l.ptr->Time() < r; } );
         const auto vend = std::lower_bound( vbegin, tl.end(), std::min( range.end, m_vd.zvEnd + resolution ), [] ( const auto& l, const auto& r ) { return l.ptr->Time() < r; } );
@@ -4632,9 +4733,9 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
             {
                 if( vbegin->lockingThread == thread )
                 {
-                    state = AreOtherWaiting( vbegin->waitList, threadBit ) ? LockState::HasBlockingLock : LockState::HasLock;
+                    state = lockmap.AreOtherWaiting( vbegin->waitList, thread ) ? LockState::HasBlockingLock : LockState::HasLock;
                 }
-                else if( IsThreadWaiting( vbegin->waitList, threadBit ) )
+                else if( lockmap.IsThreadWaiting( vbegin->waitList, thread ) )
                 {
                     state = LockState::WaitLock;
                 }
@@ -4647,18 +4748,18 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
             {
                 if( vbegin->lockingThread == thread )
                 {
-                    state = ( AreOtherWaiting( vbegin->waitList, threadBit ) || AreOtherWaiting( ptr->waitShared, threadBit ) ) ? LockState::HasBlockingLock : LockState::HasLock;
+                    state = ( lockmap.AreOtherWaiting( vbegin->waitList, thread ) || lockmap.AreOtherWaiting( ptr->waitShared, thread ) ) ? LockState::HasBlockingLock : LockState::HasLock;
                 }
-                else if( IsThreadWaiting( vbegin->waitList, threadBit ) || IsThreadWaiting( ptr->waitShared, threadBit ) )
+                else if( lockmap.IsThreadWaiting( vbegin->waitList, thread ) || lockmap.IsThreadWaiting( ptr->waitShared, thread ) )
                 {
                     state = LockState::WaitLock;
                 }
             }
-            else if( IsThreadWaiting( ptr->sharedList, threadBit ) )
+            else if( lockmap.IsThreadWaiting( ptr->sharedList, thread ) )
             {
                 state = vbegin->waitList != 0 ? LockState::HasBlockingLock : LockState::HasLock;
             }
-            else if( ptr->sharedList != 0 && IsThreadWaiting( vbegin->waitList, threadBit ) )
+            else if( ptr->sharedList != 0 && lockmap.IsThreadWaiting( vbegin->waitList, thread ) )
             {
                 state = LockState::WaitLock;
             }
@@ -4677,14 +4778,14 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                 {
                     while( vbegin < vend && ( state == LockState::Nothing || state == LockState::HasLock ) )
                     {
-                        vbegin = GetNextLockFunc( vbegin, vend, state, threadBit );
+                        vbegin = GetNextLockFunc( vbegin, vend, state, lockmap, thread );
                     }
                 }
                 else
                 {
                     while( vbegin < vend && state == LockState::Nothing )
                     {
-                        vbegin = GetNextLockFunc( vbegin, vend, state, threadBit );
+                        vbegin = GetNextLockFunc( vbegin, vend, state, lockmap, thread );
                     }
                 }
                 if( vbegin >= vend ) break;
@@ -4693,7 +4794,7 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                 drawn = true;
 
                 LockState drawState = state;
-                auto next = GetNextLockFunc( vbegin, vend, state, threadBit );
+                auto next = GetNextLockFunc( vbegin, vend, state, lockmap, thread );
 
                 const auto t0 = vbegin->ptr->Time();
                 int64_t t1 = next == tl.end() ? m_worker.GetLastTime() : next->ptr->Time();
@@ -4711,12 +4812,12 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                         auto ns = state;
                         while( n < vend && ( ns == LockState::Nothing || ns == LockState::HasLock ) )
                         {
-                            n = GetNextLockFunc( n, vend, ns, threadBit );
+                            n = GetNextLockFunc( n, vend, ns, lockmap, thread );
                         }
                         if( n >= vend ) break;
                         if( n == next )
                         {
-                            n = GetNextLockFunc( n, vend, ns, threadBit );
+                            n = GetNextLockFunc( n, vend, ns, lockmap, thread );
                         }
                         drawState = CombineLockState( drawState, state );
                         condensed++;
@@ -4740,12 +4841,12 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                         auto ns = state;
                         while( n < vend && ns == LockState::Nothing )
                         {
-                            n = GetNextLockFunc( n, vend, ns, threadBit );
+                            n = GetNextLockFunc( n, vend, ns, lockmap, thread );
                         }
                         if( n >= vend ) break;
                         if( n == next )
                         {
-                            n = GetNextLockFunc( n, vend, ns, threadBit );
+                            n = GetNextLockFunc( n, vend, ns, lockmap, thread );
                         }
                         drawState = CombineLockState( drawState, state );
                         condensed++;
@@ -4840,7 +4941,7 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                         {
                             if( it->ptr->thread == thread )
                             {
-                                if( ( it->lockingThread == thread || IsThreadWaiting( it->waitList, threadBit ) ) && it->ptr->SrcLoc() != 0 )
+                                if( ( it->lockingThread == thread || lockmap.IsThreadWaiting( it->waitList, thread ) ) && it->ptr->SrcLoc() != 0 )
                                 {
                                     markloc = it->ptr->SrcLoc();
                                     break;
@@ -4873,7 +4974,7 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                                 }
                                 if( vbegin->waitList != 0 )
                                 {
-                                    assert( !AreOtherWaiting( next->waitList, threadBit ) );
+                                    assert( !lockmap.AreOtherWaiting( next->waitList, thread ) );
                                     ImGui::TextUnformatted( "Recursive lock acquire in thread." );
                                 }
                                 break;
@@ -4881,24 +4982,16 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                             {
                                 if( vbegin->lockCount == 1 )
                                 {
-                                    ImGui::Text( "Thread \"%s\" has lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), TracyCountBits( vbegin->waitList ) );
+                                    ImGui::Text( "Thread \"%s\" has lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), lockmap.CountWaiting( vbegin->waitList ) );
                                 }
                                 else
                                 {
-                                    ImGui::Text( "Thread \"%s\" has %i locks. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), vbegin->lockCount, TracyCountBits( vbegin->waitList ) );
+                                    ImGui::Text( "Thread \"%s\" has %i locks. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), vbegin->lockCount, lockmap.CountWaiting( vbegin->waitList ) );
                                 }
-                                auto waitList = vbegin->waitList;
-                                int t = 0;
                                 ImGui::Indent( ty );
-                                while( waitList != 0 )
-                                {
-                                    if( waitList & 0x1 )
-                                    {
-                                        ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                    }
-                                    waitList >>= 1;
-                                    t++;
-                                }
+                                lockmap.ForEachWaiting( vbegin->waitList, [&] ( uint16_t t ) {
+                                    ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                } );
                                 ImGui::Unindent( ty );
                                 break;
                             }
@@ -4934,26 +5027,18 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                                     assert( vbegin->lockCount == 1 );
                                     ImGui::Text( "Thread \"%s\" has lock. No other threads are waiting.", m_worker.GetThreadName( tid ) );
                                 }
-                                else if( TracyCountBits( ptr->sharedList ) == 1 )
+                                else if( lockmap.CountWaiting( ptr->sharedList ) == 1 )
                                 {
                                     ImGui::Text( "Thread \"%s\" has a sole shared lock. No other threads are waiting.", m_worker.GetThreadName( tid ) );
                                 }
                                 else
                                 {
                                     ImGui::Text( "Thread \"%s\" has shared lock. No other threads are waiting.", m_worker.GetThreadName( tid ) );
-                                    ImGui::Text( "Threads sharing the lock (%" PRIu64 "):", TracyCountBits( ptr->sharedList ) - 1 );
-                                    auto sharedList = ptr->sharedList;
-                                    int t = 0;
+                                    ImGui::Text( "Threads sharing the lock (%" PRIu64 "):", lockmap.CountWaiting( ptr->sharedList ) - 1 );
                                     ImGui::Indent( ty );
-                                    while( sharedList != 0 )
-                                    {
-                                        if( sharedList & 0x1 && t != thread )
-                                        {
-                                            ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                        }
-                                        sharedList >>= 1;
-                                        t++;
-                                    }
+                                    lockmap.ForEachWaiting( ptr->sharedList, [&] ( uint16_t t ) {
+                                        if( t != thread ) ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                    } );
                                     ImGui::Unindent( ty );
                                 }
                                 break;
@@ -4962,55 +5047,31 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                                 if( ptr->sharedList == 0 )
                                 {
                                     assert( vbegin->lockCount == 1 );
-                                    ImGui::Text( "Thread \"%s\" has lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), TracyCountBits( vbegin->waitList ) + TracyCountBits( ptr->waitShared ) );
+                                    ImGui::Text( "Thread \"%s\" has lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), lockmap.CountWaiting( vbegin->waitList ) + lockmap.CountWaiting( ptr->waitShared ) );
                                 }
-                                else if( TracyCountBits( ptr->sharedList ) == 1 )
+                                else if( lockmap.CountWaiting( ptr->sharedList ) == 1 )
                                 {
-                                    ImGui::Text( "Thread \"%s\" has a sole shared lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), TracyCountBits( vbegin->waitList ) + TracyCountBits( ptr->waitShared ) );
+                                    ImGui::Text( "Thread \"%s\" has a sole shared lock. Blocked threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), lockmap.CountWaiting( vbegin->waitList ) + lockmap.CountWaiting( ptr->waitShared ) );
                                 }
                                 else
                                 {
                                     ImGui::Text( "Thread \"%s\" has shared lock.", m_worker.GetThreadName( tid ) );
-                                    ImGui::Text( "Threads sharing the lock (%" PRIu64 "):", TracyCountBits( ptr->sharedList ) - 1 );
-                                    auto sharedList = ptr->sharedList;
-                                    int t = 0;
+                                    ImGui::Text( "Threads sharing the lock (%" PRIu64 "):", lockmap.CountWaiting( ptr->sharedList ) - 1 );
                                     ImGui::Indent( ty );
-                                    while( sharedList != 0 )
-                                    {
-                                        if( sharedList & 0x1 && t != thread )
-                                        {
-                                            ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                        }
-                                        sharedList >>= 1;
-                                        t++;
-                                    }
+                                    lockmap.ForEachWaiting( ptr->sharedList, [&] ( uint16_t t ) {
+                                        if( t != thread ) ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                    } );
                                     ImGui::Unindent( ty );
-                                    ImGui::Text( "Blocked threads (%" PRIu64 "):", TracyCountBits( vbegin->waitList ) + TracyCountBits( ptr->waitShared ) );
+                                    ImGui::Text( "Blocked threads (%" PRIu64 "):", lockmap.CountWaiting( vbegin->waitList ) + lockmap.CountWaiting( ptr->waitShared ) );
                                 }
 
-                                auto waitList = vbegin->waitList;
-                                int t = 0;
                                 ImGui::Indent( ty );
-                                while( waitList != 0 )
-                                {
-                                    if( waitList & 0x1 )
-                                    {
-                                        ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                    }
-                                    waitList >>= 1;
-                                    t++;
-                                }
-                                auto waitShared = ptr->waitShared;
-                                t = 0;
-                                while( waitShared != 0 )
-                                {
-                                    if( waitShared & 0x1 )
-                                    {
-                                        ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                    }
-                                    waitShared >>= 1;
-                                    t++;
-                                }
+                                lockmap.ForEachWaiting( vbegin->waitList, [&] ( uint16_t t ) {
+                                    ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                } );
+                                lockmap.ForEachWaiting( ptr->waitShared, [&] ( uint16_t t ) {
+                                    ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                } );
                                 ImGui::Unindent( ty );
                                 break;
                             }
@@ -5019,7 +5080,7 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                                 assert( vbegin->lockCount == 0 || vbegin->lockCount == 1 );
                                 if( vbegin->lockCount != 0 || ptr->sharedList != 0 )
                                 {
-                                    ImGui::Text( "Thread \"%s\" is blocked by other threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), vbegin->lockCount + TracyCountBits( ptr->sharedList ) );
+                                    ImGui::Text( "Thread \"%s\" is blocked by other threads (%" PRIu64 "):", m_worker.GetThreadName( tid ), vbegin->lockCount + lockmap.CountWaiting( ptr->sharedList ) );
                                 }
                                 else
                                 {
@@ -5030,17 +5091,9 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
                                 {
                                     ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[vbegin->lockingThread] ) );
                                 }
-                                auto sharedList = ptr->sharedList;
-                                int t = 0;
-                                while( sharedList != 0 )
-                                {
-                                    if( sharedList & 0x1 )
-                                    {
-                                        ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
-                                    }
-                                    sharedList >>= 1;
-                                    t++;
-                                }
+                                lockmap.ForEachWaiting( ptr->sharedList, [&] ( uint16_t t ) {
+                                    ImGui::Text( "\"%s\"", m_worker.GetThreadName( lockmap.threadList[t] ) );
+                                } );
                                 ImGui::Unindent( ty );
                                 break;
                             }
@@ -5110,7 +5163,7 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
         {
             while( vbegin < vend && ( state == LockState::Nothing || ( m_vd.onlyContendedLocks && state == LockState::HasLock ) ) )
             {
-                vbegin = GetNextLockFunc( vbegin, vend, state, threadBit );
+                vbegin = GetNextLockFunc( vbegin, vend, state, lockmap, thread );
             }
             if( vbegin < vend ) cnt++;
         }
@@ -5755,25 +5808,10 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
                 if( end != vec.end() ) end++;
                 if( it != vec.begin() ) it--;
 
-                double min = it->val;
-                double max = it->val;
                 const auto num = std::distance( it, end );
-                if( num > 1000000 )
-                {
-                    min = v->min;
-                    max = v->max;
-                }
-                else
-                {
-                    auto tmp = it;
-                    ++tmp;
-                    const auto sz = end - tmp;
-                    for( ptrdiff_t i=0; i<sz; i++ )
-                    {
-                        min = tmp[i].val < min ? tmp[i].val : min;
-                        max = tmp[i].val > max ? tmp[i].val : max;
-                    }
-                }
+                const auto plotRange = m_worker.GetPlotRange( v, std::distance( vec.begin(), it ), std::distance( vec.begin(), end ) );
+                double min = plotRange.first;
+                double max = plotRange.second;
                 if( min == max )
                 {
                     min--;
@@ -5844,38 +5882,38 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
                         prevx = it;
 
                         skip = rsz / MaxPoints;
-                        const auto skip1 = std::max<ptrdiff_t>( 1, skip );
-                        const auto sz = rsz / skip1 + 1;
-                        assert( sz <= MaxPoints*2 );
-
-                        auto dst = tmpvec;
-                        const auto rsz = std::distance( it, range );
-                        const auto ssz = rsz / skip1;
-                        for( int64_t i=0; i<ssz; i++ )
-                        {
-                            *dst++ = float( it->val );
-                            it += skip1;
-                        }
-                        pdqsort_branchless( tmpvec, dst );
-
                         if( rsz > MaxPoints )
                         {
-                            draw->AddLine( wpos + ImVec2( x1, offset + PlotHeight - ( tmpvec[0] - min ) * revrange * PlotHeight ), wpos + ImVec2( x1, offset + PlotHeight - ( dst[-1] - min ) * revrange * PlotHeight ), 0xFF44DDDD, 4.f );
+                            // Value range of the points merged into this pixel comes from the plot LOD data, so
+                            // the cost doesn't depend on the number of points.
+                            const auto idx = std::distance( vec.begin(), it );
+                            const auto prange = m_worker.GetPlotRange( v, idx, idx + rsz );
+                            it = range;
+
+                            draw->AddLine( wpos + ImVec2( x1, offset + PlotHeight - ( prange.first - min ) * revrange * PlotHeight ), wpos + ImVec2( x1, offset + PlotHeight - ( prange.second - min ) * revrange * PlotHeight ), 0xFF44DDDD, 4.f );
 
                             if( hover && ImGui::IsMouseHoveringRect( wpos + ImVec2( x1 - 2, offset ), wpos + ImVec2( x1 + 2, offset + PlotHeight ) ) )
                             {
                                 ImGui::BeginTooltip();
                                 TextFocused( "Number of values:", RealToString( rsz ) );
-                                TextDisabledUnformatted( "Estimated range:" );
+                                TextDisabledUnformatted( "Value range:" );
                                 ImGui::SameLine();
-                                ImGui::Text( "%s - %s", FormatPlotValue( tmpvec[0], v->format ), FormatPlotValue( dst[-1], v->format ) );
+                                ImGui::Text( "%s - %s", FormatPlotValue( prange.first, v->format ), FormatPlotValue( prange.second, v->format ) );
                                 ImGui::SameLine();
-                                ImGui::TextDisabled( "(%s)", FormatPlotValue( dst[-1] - tmpvec[0], v->format ) );
+                                ImGui::TextDisabled( "(%s)", FormatPlotValue( prange.second - prange.first, v->format ) );
                                 ImGui::EndTooltip();
                             }
                         }
                         else
                         {
+                            auto dst = tmpvec;
+                            while( it != range )
+                            {
+                                *dst++ = float( it->val );
+                                ++it;
+                            }
+                            pdqsort_branchless( tmpvec, dst );
+
                             draw->AddLine( wpos + ImVec2( x1, offset + PlotHeight - ( tmpvec[0] - min ) * revrange * PlotHeight ), wpos + ImVec2( x1, offset + PlotHeight - ( dst[-1] - min ) * revrange * PlotHeight ), 0xFF44DDDD );
 
                             auto vit = tmpvec;
@@ -6525,7 +6563,7 @@ void View::DrawZoneInfoWindow()
             }
             else if( cnt > 1 )
             {
-                uint8_t cpus[256] = {};
+                std::vector<uint8_t> cpus( m_worker.GetCpuDataCpuCount() );
                 auto bit = it;
                 int64_t running = it->End() - ev.Start();
                 cpus[it->Cpu()] = 1;
@@ -6554,7 +6592,7 @@ void View::DrawZoneInfoWindow()
                 TextFocused( "Running state regions:", RealToString( cnt ) );
 
                 int numCpus = 0;
-                for( int i=0; i<256; i++ ) numCpus += cpus[i];
+                for( auto& v : cpus ) numCpus += v;
                 if( numCpus == 1 )
                 {
                     TextFocused( "CPU:", RealToString( it->Cpu() ) );
@@ -8427,11 +8465,12 @@ void View::DrawMessages()
     size_t tsz = 0;
     for( const auto& t : m_threadOrder ) if( !t->messages.empty() ) tsz++;
 
-    m_messageFilter.Draw( ICON_FA_FILTER " Filter messages", 200 );
+    bool filterChanged = m_messageFilter.Draw( ICON_FA_FILTER " Filter messages", 200 );
     ImGui::SameLine();
     if( ImGui::Button( ICON_FA_BACKSPACE " Clear" ) )
     {
         m_messageFilter.Clear();
+        filterChanged = true;
     }
     ImGui::SameLine();
     ImGui::Spacing();
@@ -8448,6 +8487,10 @@ void View::DrawMessages()
         ImGui::SameLine();
         ImGui::Checkbox( ICON_FA_IMAGE " Show frame images", &m_showMessageImages );
     }
+    ImGui::SameLine();
+    ImGui::Spacing();
+    ImGui::SameLine();
+    DrawRangeLimit( "Message time range:", m_msgLimitRange, m_msgRangeMin, m_msgRangeMax );
 
     auto expand = ImGui::TreeNode( ICON_FA_RANDOM " Visible threads:" );
     ImGui::SameLine();
@@ -8463,6 +8506,7 @@ void View::DrawMessages()
             {
                 VisibleMsgThread( t->id ) = true;
             }
+            filterChanged = true;
         }
         ImGui::SameLine();
         if( ImGui::SmallButton( "Unselect all" ) )
@@ -8471,6 +8515,7 @@ void View::DrawMessages()
             {
                 VisibleMsgThread( t->id ) = false;
             }
+            filterChanged = true;
         }
 
         int idx = 0;
@@ -8481,7 +8526,7 @@ void View::DrawMessages()
             const auto threadColor = GetThreadColor( t->id, 0 );
             SmallColorBox( threadColor );
             ImGui::SameLine();
-            SmallCheckbox( m_worker.GetThreadName( t->id ), &VisibleMsgThread( t->id ) );
+            if( SmallCheckbox( m_worker.GetThreadName( t->id ), &VisibleMsgThread( t->id ) ) ) filterChanged = true;
             ImGui::PopID();
             ImGui::SameLine();
             ImGui::TextDisabled( "(%s)", RealToString( t->messages.size() ) );
@@ -8527,81 +8572,59 @@ void View::DrawMessages()
     }
     ImGui::Separator();
 
-    int msgcnt = 0;
-    const auto filterActive = m_messageFilter.IsActive();
-    int idx = 0;
-    for( const auto& v : msgs )
+    // Messages passing the thread and text filters are cached, so that only new messages have to be
+    // checked. Messages are kept sorted by time and may be inserted out of order, which shifts the
+    // already processed ones and requires the list to be rebuilt.
+    if( filterChanged || m_prevMessages > msgs.size() || ( m_prevMessages != 0 && msgs[m_prevMessages-1] != m_prevMessagesBack ) )
+    {
+        m_msgList.clear();
+        m_prevMessages = 0;
+    }
+    if( m_prevMessages != msgs.size() )
     {
-        const auto tid = m_worker.DecompressThread( v->thread );
-        if( VisibleMsgThread( tid ) )
+        const auto filterActive = m_messageFilter.IsActive();
+        for( size_t i=m_prevMessages; i<msgs.size(); i++ )
         {
-            const auto text = m_worker.GetString( v->ref );
-            if( !filterActive || m_messageFilter.PassFilter( text ) )
+            const auto& v = msgs[i];
+            if( VisibleMsgThread( m_worker.DecompressThread( v->thread ) ) )
             {
-                ImGui::PushID( v );
-                if( ImGui::Selectable( TimeToStringExact( v->time ), m_msgHighlight == v, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap ) )
+                if( !filterActive || m_messageFilter.PassFilter( m_worker.GetString( v->ref ) ) )
                 {
-                    CenterAtTime( v->time );
+                    m_msgList.push_back( uint32_t( i ) );
                 }
-                if( ImGui::IsItemHovered() )
-                {
-                    m_msgHighlight = v;
+            }
+        }
+        m_prevMessages = msgs.size();
+        m_prevMessagesBack = msgs.back();
+    }
 
-                    if( m_showMessageImages )
-                    {
-                        const auto frameIdx = m_worker.GetFrameRange( *m_frames, v->time, v->time ).first;
-                        auto fi = m_worker.GetFrameImage( *m_frames, frameIdx );
-                        if( fi )
-                        {
-                            ImGui::BeginTooltip();
-                            if( fi != m_frameTexturePtr )
-                            {
-                                if( !m_frameTexture ) m_frameTexture = MakeTexture();
-                                UpdateTexture( m_frameTexture, m_worker.UnpackFrameImage( *fi ), fi->w, fi->h );
-                                m_frameTexturePtr = fi;
-                            }
-                            if( fi->flip )
-                            {
-                                ImGui::Image( m_frameTexture, ImVec2( fi->w, fi->h ), ImVec2( 0, 1 ), ImVec2( 1, 0 ) );
-                            }
-                            else
-                            {
-                                ImGui::Image( m_frameTexture, ImVec2( fi->w, fi->h ) );
-                            }
-                            ImGui::EndTooltip();
-                        }
-                    }
-                }
-                if( m_msgToFocus == v )
-                {
-                    ImGui::SetScrollHereY();
-                    m_msgToFocus.Decay( nullptr );
-                    m_messagesScrollBottom = false;
-                }
-                ImGui::PopID();
-                ImGui::NextColumn();
-                SmallColorBox( GetThreadColor( tid, 0 ) );
-                ImGui::SameLine();
-                ImGui::TextUnformatted( m_worker.GetThreadName( tid ) );
-                ImGui::SameLine();
-                ImGui::TextDisabled( "(%s)", RealToString( tid ) );
-                ImGui::NextColumn();
-                ImGui::PushStyleColor( ImGuiCol_Text, v->color );
-                ImGui::TextWrapped( "%s", text );
-                ImGui::PopStyleColor();
-                ImGui::NextColumn();
-                if( hasCallstack )
-                {
-                    const auto cs = v->callstack.Val();
-                    if( cs != 0 )
-                    {
-                        SmallCallstackButton( ICON_FA_ALIGN_JUSTIFY, cs, idx );
-                        ImGui::SameLine();
-                        DrawCallstackCalls( cs, 4 );
-                    }
-                    ImGui::NextColumn();
-                }
-                msgcnt++;
+    auto lbegin = m_msgList.begin();
+    auto lend = m_msgList.end();
+    if( m_msgLimitRange )
+    {
+        const auto rb = std::lower_bound( msgs.begin(), msgs.end(), m_msgRangeMin, [] ( const auto& l, const auto& r ) { return l->time < r; } );
+        const auto re = std::lower_bound( rb, msgs.end(), m_msgRangeMax, [] ( const auto& l, const auto& r ) { return l->time <= r; } );
+        lbegin = std::lower_bound( lbegin, lend, uint32_t( std::distance( msgs.begin(), rb ) ) );
+        lend = std::lower_bound( lbegin, lend, uint32_t( std::distance( msgs.begin(), re ) ) );
+    }
+    const auto msgcnt = int( std::distance( lbegin, lend ) );
+
+    if( m_msgToFocus )
+    {
+        // Scrolling to the focused message requires all lines to be laid out.
+        for( auto it = lbegin; it != lend; ++it )
+        {
+            DrawMessageLine( *msgs[*it], hasCallstack, int( *it ) );
+        }
+    }
+    else
+    {
+        ImGuiListClipper clipper( msgcnt );
+        while( clipper.Step() )
+        {
+            for( auto i=clipper.DisplayStart; i<clipper.DisplayEnd; i++ )
+            {
+                DrawMessageLine( *msgs[lbegin[i]], hasCallstack, int( lbegin[i] ) );
             }
         }
     }
@@ -8617,6 +8640,87 @@ void View::DrawMessages()
     ImGui::End();
 }
 
+void View::DrawMessageLine( const MessageData& msg, bool hasCallstack, int idx )
+{
+    const auto tid = m_worker.DecompressThread( msg.thread );
+    const auto text = m_worker.GetString( msg.ref );
+    ImGui::PushID( &msg );
+    if( ImGui::Selectable( TimeToStringExact( msg.time ), m_msgHighlight == &msg, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap ) )
+    {
+        CenterAtTime( msg.time );
+    }
+    if( ImGui::IsItemHovered() )
+    {
+        m_msgHighlight = &msg;
+
+        if( m_showMessageImages )
+        {
+            const auto frameIdx = m_worker.GetFrameRange( *m_frames, msg.time, msg.time ).first;
+            auto fi = m_worker.GetFrameImage( *m_frames, frameIdx );
+            if( fi )
+            {
+                ImGui::BeginTooltip();
+                if( fi != m_frameTexturePtr )
+                {
+                    if( !m_frameTexture ) m_frameTexture = MakeTexture();
+                    UpdateTexture( m_frameTexture, m_worker.UnpackFrameImage( *fi ), fi->w, fi->h );
+                    m_frameTexturePtr = fi;
+                }
+                if( fi->flip )
+                {
+                    ImGui::Image( m_frameTexture, ImVec2( fi->w, fi->h ), ImVec2( 0, 1 ), ImVec2( 1, 0 ) );
+                }
+                else
+                {
+                    ImGui::Image( m_frameTexture, ImVec2( fi->w, fi->h ) );
+                }
+                ImGui::EndTooltip();
+            }
+        }
+    }
+    if( m_msgToFocus == &msg )
+    {
+        ImGui::SetScrollHereY();
+        m_msgToFocus.Decay( nullptr );
+        m_messagesScrollBottom = false;
+    }
+    ImGui::PopID();
+    ImGui::NextColumn();
+    SmallColorBox( GetThreadColor( tid, 0 ) );
+    ImGui::SameLine();
+    ImGui::TextUnformatted( m_worker.GetThreadName( tid ) );
+    ImGui::SameLine();
+    ImGui::TextDisabled( "(%s)", RealToString( tid ) );
+    ImGui::NextColumn();
+    // The list clipper requires all rows to have the same height, so only the first line of the message is
+    // displayed. The full text is shown in a tooltip.
+    const auto eol = strchr( text, '\n' );
+    ImGui::PushStyleColor( ImGuiCol_Text, msg.color );
+    ImGui::TextUnformatted( text, eol );
+    ImGui::PopStyleColor();
+    if( ImGui::IsItemHovered() && ( eol || ImGui::GetItemRectSize().x > ImGui::GetColumnWidth() ) )
+    {
+        const auto ty = ImGui::GetFontSize();
+        ImGui::BeginTooltip();
+        ImGui::PushTextWrapPos( 450.0f * ty / 15.f );
+        ImGui::TextUnformatted( text );
+        ImGui::PopTextWrapPos();
+        ImGui::EndTooltip();
+    }
+    ImGui::NextColumn();
+    if( hasCallstack )
+    {
+        const auto cs = msg.callstack.Val();
+        if( cs != 0 )
+        {
+            SmallCallstackButton( ICON_FA_ALIGN_JUSTIFY, cs, idx );
+            ImGui::SameLine();
+            DrawCallstackCalls( cs, 4 );
+        }
+        ImGui::NextColumn();
+    }
+}
+
 uint64_t View::GetSelectionTarget( const Worker::ZoneThreadData& ev, FindZone::GroupBy groupBy ) const
 {
     switch( groupBy )
@@ -8645,6 +8749,196 @@ uint64_t View::GetSelectionTarget( const Worker::ZoneThreadData& ev, FindZone::G
     }
 }
 
+void View::GroupFindZones( const Worker::ZoneThreadData* zptr, const Worker::ZoneThreadData* zend, FindZone::GroupPart& part, int64_t rangeMin, int64_t rangeMax )
+{
+    const auto hmin = std::min( m_findZone.highlight.start, m_findZone.highlight.end );
+    const auto hmax = std::max( m_findZone.highlight.start, m_findZone.highlight.end );
+    const auto groupBy = m_findZone.groupBy;
+    const auto highlightActive = m_findZone.highlight.active;
+    const auto limitRange = m_findZone.limitRange;
+    unordered_flat_map<uint64_t, size_t> index;
+    FindZone::PartGroup* group = nullptr;
+    uint64_t lastGid = std::numeric_limits<uint64_t>::max() - 1;
+    while( zptr < zend )
+    {
+        auto& ev = *zptr;
+        const auto end = ev.Zone()->End();
+        const auto start = ev.Zone()->Start();
+        if( limitRange && ( start < rangeMin || end > rangeMax ) )
+        {
+            zptr++;
+            continue;
+        }
+        auto timespan = end - start;
+        assert( timespan != 0 );
+        if( m_findZone.selfTime )
+        {
+            timespan -= GetZoneChildTimeFast( *ev.Zone() );
+        }
+        else if( m_findZone.runningTime )
+        {
+            const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( ev.Thread() ) );
+            if( !ctx ) break;
+            int64_t t;
+            uint64_t cnt;
+            if( !GetZoneRunningTime( ctx, *ev.Zone(), t, cnt ) ) break;
+            timespan = t;
+        }
+
+        if( highlightActive )
+        {
+            if( timespan < hmin || timespan > hmax )
+            {
+                zptr++;
+                continue;
+            }
+        }
+
+        zptr++;
+        uint64_t gid = 0;
+        switch( groupBy )
+        {
+        case FindZone::GroupBy::Thread:
+            gid = ev.Thread();
+            break;
+        case FindZone::GroupBy::UserText:
+        {
+            const auto& zone = *ev.Zone();
+            if( !m_worker.HasZoneExtra( zone ) )
+            {
+                gid = std::numeric_limits<uint64_t>::max();
+            }
+            else
+            {
+                const auto& extra = m_worker.GetZoneExtra( zone );
+                gid = extra.text.Active() ? extra.text.Idx() : std::numeric_limits<uint64_t>::max();
+            }
+            break;
+        }
+        case FindZone::GroupBy::Callstack:
+            gid = m_worker.GetZoneExtra( *ev.Zone() ).callstack.Val();
+            break;
+        case FindZone::GroupBy::Parent:
+        {
+            const auto parent = GetZoneParent( *ev.Zone(), m_worker.DecompressThread( ev.Thread() ) );
+            if( parent ) gid = uint64_t( uint16_t( parent->SrcLoc() ) );
+            break;
+        }
+        case FindZone::GroupBy::NoGrouping:
+            break;
+        default:
+            assert( false );
+            break;
+        }
+        if( lastGid != gid )
+        {
+            lastGid = gid;
+            auto it = index.find( gid );
+            if( it == index.end() )
+            {
+                it = index.emplace( gid, part.groups.size() ).first;
+                part.groups.emplace_back( FindZone::PartGroup { gid, 0 } );
+            }
+            group = &part.groups[it->second];
+        }
+        group->time += timespan;
+        group->zones.push_back( ev.Zone() );
+    }
+    part.end = zptr;
+}
+
+void View::CollectFindZoneTimes( const Worker::ZoneThreadData* zptr, const Worker::ZoneThreadData* zend, FindZone::TimePart& part, int64_t rangeMin, int64_t rangeMax, uint64_t selGroup )
+{
+    const auto groupBy = m_findZone.groupBy;
+    const auto limitRange = m_findZone.limitRange;
+    part.times.reserve( zend - zptr );
+    while( zptr < zend )
+    {
+        auto& ev = *zptr;
+        auto& zone = *ev.Zone();
+        const auto end = zone.End();
+        const auto start = zone.Start();
+        if( ( limitRange && ( start < rangeMin || end > rangeMax ) ) || ( selGroup != FindZone::Unselected && selGroup != GetSelectionTarget( ev, groupBy ) ) )
+        {
+            zptr++;
+            continue;
+        }
+        int64_t t;
+        if( m_findZone.runningTime )
+        {
+            const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( ev.Thread() ) );
+            if( !ctx ) break;
+            uint64_t cnt;
+            if( !GetZoneRunningTime( ctx, zone, t, cnt ) ) break;
+            if( t < part.tmin ) part.tmin = t;
+            if( t > part.tmax ) part.tmax = t;
+        }
+        else if( m_findZone.selfTime )
+        {
+            t = end - start - GetZoneChildTimeFast( zone );
+        }
+        else
+        {
+            t = end - start;
+        }
+        part.times.push_back( t );
+        part.total += t;
+        zptr++;
+    }
+    part.end = zptr;
+    pdqsort_branchless( part.times.begin(), part.times.end() );
+}
+
+// Zone times are collected and sorted in parts, which are processed in parallel and merged into the
+// sorted vector in zone order. As with grouping, running time queries are not parallelized.
+View::FindZone::TimePart View::SortFindZoneTimes( const Worker::ZoneThreadData* zbegin, const Worker::ZoneThreadData* zend, Vector<int64_t>& vec, int64_t rangeMin, int64_t rangeMax, uint64_t selGroup )
+{
+    enum { MinPartSize = 64 * 1024 };
+
+    FindZone::TimePart ret;
+    ret.end = zbegin;
+    if( zbegin >= zend ) return ret;
+
+    const auto sz = size_t( zend - zbegin );
+    const auto maxParts = m_findZone.runningTime ? 1 : std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+    const auto parts = std::min<size_t>( maxParts, ( sz + MinPartSize - 1 ) / MinPartSize );
+    const auto partSize = ( sz + parts - 1 ) / parts;
+    std::vector<FindZone::TimePart> partial( parts );
+    if( parts == 1 )
+    {
+        CollectFindZoneTimes( zbegin, zend, partial[0], rangeMin, rangeMax, selGroup );
+    }
+    else
+    {
+        auto& td = GetTaskDispatch();
+        for( size_t i=0; i<parts; i++ )
+        {
+            auto part = &partial[i];
+            const auto begin = zbegin + i * partSize;
+            const auto pend = std::min( zend, begin + partSize );
+            td.Queue( [this, part, begin, pend, rangeMin, rangeMax, selGroup] { CollectFindZoneTimes( begin, pend, *part, rangeMin, rangeMax, selGroup ); } );
+        }
+        td.Sync();
+    }
+
+    for( size_t i=0; i<parts; i++ )
+    {
+        auto& part = partial[i];
+        if( !part.times.empty() )
+        {
+            const auto mid = vec.size();
+            vec.insert( vec.end(), part.times.data(), part.times.data() + part.times.size() );
+            std::inplace_merge( vec.begin(), vec.begin() + mid, vec.end() );
+        }
+        ret.total += part.total;
+        ret.tmin = std::min( ret.tmin, part.tmin );
+        ret.tmax = std::max( ret.tmax, part.tmax );
+        ret.end = part.end;
+        if( part.end != std::min( zend, zbegin + ( i+1 ) * partSize ) ) break;
+    }
+    return ret;
+}
+
 static void DrawHistogramMinMaxLabel( ImDrawList* draw, int64_t tmin, int64_t tmax, ImVec2 wpos, float w, float ty )
 {
     const auto ty15 = round( ty * 1.5f );
@@ -8663,6 +8957,43 @@ static void DrawHistogramMinMaxLabel( ImDrawList* draw, int64_t tmin, int64_t tm
     draw->AddText( wpos + ImVec2( round( (w-1-rsz) * 0.5 ), ty15 ), 0x66FFFFFF, range );
 }
 
+static int64_t HistogramBinEdge( bool logTime, int64_t tmin, int64_t tmax, int64_t numBins, int64_t bin )
+{
+    if( logTime )
+    {
+        const auto tMinLog = log10( tmin );
+        const auto zmax = ( log10( tmax ) - tMinLog ) / numBins;
+        return int64_t( pow( 10.0, tMinLog + bin * zmax ) );
+    }
+    else
+    {
+        return tmin + bin * ( tmax - tmin ) / numBins;
+    }
+}
+
+static void HistogramCumulative( const LogHistogram& hist, std::vector<uint64_t>& cumulative )
+{
+    const auto sz = hist.NumBuckets();
+    cumulative.resize( sz + 1 );
+    uint64_t cnt = 0;
+    for( size_t i=0; i<sz; i++ )
+    {
+        cumulative[i] = cnt;
+        cnt += hist.BucketCount( i );
+    }
+    cumulative[sz] = cnt;
+}
+
+// Number of values lower than val, assuming that values are evenly spread within each bucket.
+static double HistogramCountBelow( const LogHistogram& hist, const std::vector<uint64_t>& cumulative, int64_t val )
+{
+    const auto idx = LogHistogram::BucketIndex( val );
+    if( idx >= hist.NumBuckets() ) return double( cumulative.back() );
+    const auto bmin = LogHistogram::BucketMin( idx );
+    const auto width = LogHistogram::BucketMax( idx ) - bmin;
+    return cumulative[idx] + double( hist.BucketCount( idx ) ) * ( val - bmin ) / width;
+}
+
 void View::DrawFindZone()
 {
     if( m_shortcut == ShortcutAction::OpenFind ) ImGui::SetNextWindowFocus();
@@ -8702,31 +9033,9 @@ void View::DrawFindZone()
     ImGui::SameLine();
     ImGui::Checkbox( "Ignore case", &m_findZone.ignoreCase );
     ImGui::SameLine();
-    if( ImGui::Checkbox( "Limit range", &m_findZone.limitRange ) )
+    if( DrawRangeLimit( "Zone time range:", m_findZone.limitRange, m_findZone.rangeMin, m_findZone.rangeMax ) )
     {
         m_findZone.ResetMatch();
-        if( m_findZone.limitRange )
-        {
-            m_findZone.rangeMin = m_vd.zvStart;
-            m_findZone.rangeMax = m_vd.zvEnd;
-        }
-    }
-    if( m_findZone.limitRange )
-    {
-        ImGui::TextUnformatted( ICON_FA_LOCK );
-        ImGui::SameLine();
-        TextFocused( "Zone time range:", TimeToStringExact( m_findZone.rangeMin ) );
-        ImGui::SameLine();
-        TextFocused( "-", TimeToStringExact( m_findZone.rangeMax ) );
-        ImGui::SameLine();
-        ImGui::TextDisabled( "(%s)", TimeToString( m_findZone.rangeMax - m_findZone.rangeMin ) );
-        ImGui::SameLine();
-        if( ImGui::SmallButton( "Limit to view" ) )
-        {
-            m_findZone.ResetMatch();
-            m_findZone.rangeMin = m_vd.zvStart;
-            m_findZone.rangeMax = m_vd.zvEnd;
-        }
     }
 
     if( findClicked )
@@ -8809,124 +9118,74 @@ void View::DrawFindZone()
             int64_t tmax = m_findZone.tmax;
             int64_t total = m_findZone.total;
             const auto zsz = zones.size();
+            const auto candidates = m_findZone.limitRange ? m_worker.GetZoneRangeCandidates( zoneData, rangeMin, rangeMax ) : std::make_pair( size_t( 0 ), zsz );
+            const auto useHist = !m_findZone.limitRange && !m_findZone.runningTime;
+            const auto& hist = m_findZone.selfTime ? zoneData.selfHist : zoneData.hist;
             if( m_findZone.sortedNum != zsz )
             {
-                auto& vec = m_findZone.sorted;
-                const auto vszorig = vec.size();
-                vec.reserve( zsz );
-                size_t i;
-                if( m_findZone.runningTime )
+                if( useHist )
                 {
-                    if( m_findZone.limitRange )
+                    // Unfiltered zone times are already aggregated by the worker, no need to sort them.
+                    if( m_findZone.selfTime )
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto end = zone.End();
-                            if( end > rangeMax || zone.Start() < rangeMin ) continue;
-                            const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( zones[i].Thread() ) );
-                            if( !ctx ) break;
-                            int64_t t;
-                            uint64_t cnt;
-                            if( !GetZoneRunningTime( ctx, zone, t, cnt ) ) break;
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                            if( t < tmin ) tmin = t;
-                            else if( t > tmax ) tmax = t;
-                        }
+                        tmin = zoneData.selfMin;
+                        tmax = zoneData.selfMax;
+                        total = zoneData.selfTotal;
                     }
                     else
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( zones[i].Thread() ) );
-                            if( !ctx ) break;
-                            int64_t t;
-                            uint64_t cnt;
-                            if( !GetZoneRunningTime( ctx, zone, t, cnt ) ) break;
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                            if( t < tmin ) tmin = t;
-                            else if( t > tmax ) tmax = t;
-                        }
+                        tmin = zoneData.min;
+                        tmax = zoneData.max;
+                        total = zoneData.total;
                     }
+                    m_findZone.average = float( total ) / zsz;
+                    m_findZone.median = hist.Percentile( 0.5 );
+                    m_findZone.total = total;
+                    m_findZone.sortedNum = zsz;
+                    m_findZone.tmin = tmin;
+                    m_findZone.tmax = tmax;
                 }
-                else if( m_findZone.selfTime )
+                else
                 {
-                    tmin = zoneData.selfMin;
-                    tmax = zoneData.selfMax;
+                    auto& vec = m_findZone.sorted;
+                    vec.reserve( zsz );
+                    auto zbegin = zones.data() + m_findZone.sortedNum;
+                    auto zend = zones.data() + zsz;
                     if( m_findZone.limitRange )
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto end = zone.End();
-                            const auto start = zone.Start();
-                            if( end > rangeMax || start < rangeMin ) continue;
-                            const auto t = end - start - GetZoneChildTimeFast( zone );
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                        }
+                        zbegin = std::max( zbegin, zones.data() + candidates.first );
+                        zend = std::max( zbegin, zones.data() + candidates.second );
                     }
-                    else
+                    const auto part = SortFindZoneTimes( zbegin, zend, vec, rangeMin, rangeMax, FindZone::Unselected );
+                    total += part.total;
+                    if( m_findZone.runningTime )
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto end = zone.End();
-                            const auto t = end - zone.Start() - GetZoneChildTimeFast( zone );
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                        }
+                        tmin = std::min( tmin, part.tmin );
+                        tmax = std::max( tmax, part.tmax );
                     }
-                }
-                else
-                {
-                    tmin = zoneData.min;
-                    tmax = zoneData.max;
-                    if( m_findZone.limitRange )
+                    else if( m_findZone.selfTime )
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto end = zone.End();
-                            const auto start = zone.Start();
-                            if( end > rangeMax || start < rangeMin ) continue;
-                            const auto t = end - start;
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                        }
+                        tmin = zoneData.selfMin;
+                        tmax = zoneData.selfMax;
                     }
                     else
                     {
-                        for( i=m_findZone.sortedNum; i<zsz; i++ )
-                        {
-                            auto& zone = *zones[i].Zone();
-                            const auto end = zone.End();
-                            const auto t = end - zone.Start();
-                            vec.push_back_no_space_check( t );
-                            total += t;
-                        }
+                        tmin = zoneData.min;
+                        tmax = zoneData.max;
                     }
-                }
-                auto mid = vec.begin() + vszorig;
-#ifdef NO_PARALLEL_SORT
-                pdqsort_branchless( mid, vec.end() );
-#else
-                std::sort( std::execution::par_unseq, mid, vec.end() );
-#endif
-                std::inplace_merge( vec.begin(), mid, vec.end() );
+                    // Zones after the range candidates are never in range.
+                    const auto i = part.end == zend ? zsz : size_t( part.end - zones.data() );
 
-                const auto vsz = vec.size();
-                if( vsz != 0 )
-                {
-                    m_findZone.average = float( total ) / vsz;
-                    m_findZone.median = vec[vsz/2];
-                    m_findZone.total = total;
-                    m_findZone.sortedNum = i;
-                    m_findZone.tmin = tmin;
-                    m_findZone.tmax = tmax;
+                    const auto vsz = vec.size();
+                    if( vsz != 0 )
+                    {
+                        m_findZone.average = float( total ) / vsz;
+                        m_findZone.median = vec[vsz/2];
+                        m_findZone.total = total;
+                        m_findZone.sortedNum = i;
+                        m_findZone.tmin = tmin;
+                        m_findZone.tmax = tmax;
+                    }
                 }
             }
 
@@ -8934,121 +9193,20 @@ void View::DrawFindZone()
             {
                 if( m_findZone.selSortNum != m_findZone.sortedNum )
                 {
-                    const auto selGroup = m_findZone.selGroup;
-                    const auto groupBy = m_findZone.groupBy;
-
                     auto& vec = m_findZone.selSort;
                     vec.reserve( zsz );
-                    auto act = m_findZone.selSortActive;
-                    int64_t total = m_findZone.selTotal;
-                    if( m_findZone.runningTime )
-                    {
-                        if( m_findZone.limitRange )
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( ev.Zone()->End() > rangeMax || ev.Zone()->Start() < rangeMin ) continue;
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( zones[i].Thread() ) );
-                                    int64_t t;
-                                    uint64_t cnt;
-                                    GetZoneRunningTime( ctx, *ev.Zone(), t, cnt );
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( zones[i].Thread() ) );
-                                    int64_t t;
-                                    uint64_t cnt;
-                                    GetZoneRunningTime( ctx, *ev.Zone(), t, cnt );
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
-                    }
-                    else if( m_findZone.selfTime )
+                    auto zbegin = zones.data() + m_findZone.selSortNum;
+                    auto zend = zones.data() + m_findZone.sortedNum;
+                    if( m_findZone.limitRange )
                     {
-                        if( m_findZone.limitRange )
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( ev.Zone()->End() > rangeMax || ev.Zone()->Start() < rangeMin ) continue;
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto t = ev.Zone()->End() - ev.Zone()->Start() - GetZoneChildTimeFast( *ev.Zone() );
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto t = ev.Zone()->End() - ev.Zone()->Start() - GetZoneChildTimeFast( *ev.Zone() );
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
-                    }
-                    else
-                    {
-                        if( m_findZone.limitRange )
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( ev.Zone()->End() > rangeMax || ev.Zone()->Start() < rangeMin ) continue;
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto t = ev.Zone()->End() - ev.Zone()->Start();
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for( size_t i=m_findZone.selSortNum; i<m_findZone.sortedNum; i++ )
-                            {
-                                auto& ev = zones[i];
-                                if( selGroup == GetSelectionTarget( ev, groupBy ) )
-                                {
-                                    const auto t = ev.Zone()->End() - ev.Zone()->Start();
-                                    vec.push_back_no_space_check( t );
-                                    act++;
-                                    total += t;
-                                }
-                            }
-                        }
+                        zbegin = std::max( zbegin, zones.data() + candidates.first );
+                        zend = std::max( zbegin, std::min( zend, zones.data() + candidates.second ) );
                     }
+                    const auto part = SortFindZoneTimes( zbegin, zend, vec, rangeMin, rangeMax, m_findZone.selGroup );
                     if( !vec.empty() )
                     {
-                        auto mid = vec.begin() + m_findZone.selSortActive;
-                        pdqsort_branchless( mid, vec.end() );
-                        std::inplace_merge( vec.begin(), mid, vec.end() );
-
+                        const auto act = vec.size();
+                        const auto total = m_findZone.selTotal + part.total;
                         m_findZone.selAverage = float( total ) / act;
                         m_findZone.selMedian = vec[act/2];
                         m_findZone.selTotal = total;
@@ -9058,7 +9216,7 @@ void View::DrawFindZone()
                 }
             }
 
-            if( tmin != std::numeric_limits<int64_t>::max() && !m_findZone.sorted.empty() )
+            if( tmin != std::numeric_limits<int64_t>::max() && ( useHist ? hist.Count() != 0 : !m_findZone.sorted.empty() ) )
             {
                 TextDisabledUnformatted( "Minimum values in bin:" );
                 ImGui::SameLine();
@@ -9112,66 +9270,6 @@ void View::DrawFindZone()
                         const auto s = std::min( m_findZone.highlight.start, m_findZone.highlight.end );
                         const auto e = std::max( m_findZone.highlight.start, m_findZone.highlight.end );
 
-                        const auto& sorted = m_findZone.sorted;
-
-                        auto sortedBegin = sorted.begin();
-                        auto sortedEnd = sorted.end();
-                        while( sortedBegin != sortedEnd && *sortedBegin == 0 ) ++sortedBegin;
-
-                        if( m_findZone.minBinVal > 1 || m_findZone.limitRange )
-                        {
-                            if( m_findZone.logTime )
-                            {
-                                const auto tMinLog = log10( tmin );
-                                const auto zmax = ( log10( tmax ) - tMinLog ) / numBins;
-                                int64_t i;
-                                for( i=0; i<numBins; i++ )
-                                {
-                                    const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
-                                    auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
-                                    const auto distance = std::distance( sortedBegin, nit );
-                                    if( distance >= m_findZone.minBinVal ) break;
-                                    sortedBegin = nit;
-                                }
-                                for( int64_t j=numBins-1; j>i; j-- )
-                                {
-                                    const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( j-1 ) * zmax ) );
-                                    auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
-                                    const auto distance = std::distance( nit, sortedEnd );
-                                    if( distance >= m_findZone.minBinVal ) break;
-                                    sortedEnd = nit;
-                                }
-                            }
-                            else
-                            {
-                                const auto zmax = tmax - tmin;
-                                int64_t i;
-                                for( i=0; i<numBins; i++ )
-                                {
-                                    const auto nextBinVal = tmin + ( i+1 ) * zmax / numBins;
-                                    auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
-                                    const auto distance = std::distance( sortedBegin, nit );
-                                    if( distance >= m_findZone.minBinVal ) break;
-                                    sortedBegin = nit;
-                                }
-                                for( int64_t j=numBins-1; j>i; j-- )
-                                {
-                                    const auto nextBinVal = tmin + ( j-1 ) * zmax / numBins;
-                                    auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
-                                    const auto distance = std::distance( nit, sortedEnd );
-                                    if( distance >= m_findZone.minBinVal ) break;
-                                    sortedEnd = nit;
-                                }
-                            }
-
-                            if( sortedBegin != sorted.end() )
-                            {
-                                tmin = *sortedBegin;
-                                tmax = *(sortedEnd-1);
-                                total = tmax - tmin;
-                            }
-                        }
-
                         if( numBins > m_findZone.numBins )
                         {
                             m_findZone.numBins = numBins;
@@ -9185,47 +9283,65 @@ void View::DrawFindZone()
                         const auto& binTime = m_findZone.binTime;
                         const auto& selBin = m_findZone.selBin;
 
-                        const auto distBegin = std::distance( sorted.begin(), sortedBegin );
-                        const auto distEnd = std::distance( sorted.begin(), sortedEnd );
-                        if( m_findZone.binCache.numBins != numBins ||
-                            m_findZone.binCache.distBegin != distBegin ||
-                            m_findZone.binCache.distEnd != distEnd )
+                        if( useHist )
                         {
-                            m_findZone.binCache.numBins = numBins;
-                            m_findZone.binCache.distBegin = distBegin;
-                            m_findZone.binCache.distEnd = distEnd;
+                            auto& cumulative = m_findZone.histCumulative;
+                            HistogramCumulative( hist, cumulative );
+
+                            // Zero-length zones are not displayed, same as in the sorted path.
+                            auto cntBegin = HistogramCountBelow( hist, cumulative, 1 );
+                            auto cntEnd = double( hist.Count() );
+
+                            if( m_findZone.minBinVal > 1 )
+                            {
+                                auto tBegin = tmin;
+                                auto tEnd = tmax;
+                                int64_t i;
+                                for( i=0; i<numBins; i++ )
+                                {
+                                    const auto nextBinVal = HistogramBinEdge( m_findZone.logTime, tmin, tmax, numBins, i+1 );
+                                    const auto cnt = HistogramCountBelow( hist, cumulative, nextBinVal );
+                                    if( cnt - cntBegin >= m_findZone.minBinVal ) break;
+                                    cntBegin = cnt;
+                                    tBegin = nextBinVal;
+                                }
+                                for( int64_t j=numBins-1; j>i; j-- )
+                                {
+                                    const auto nextBinVal = HistogramBinEdge( m_findZone.logTime, tmin, tmax, numBins, j-1 );
+                                    const auto cnt = HistogramCountBelow( hist, cumulative, nextBinVal );
+                                    if( cntEnd - cnt >= m_findZone.minBinVal ) break;
+                                    cntEnd = cnt;
+                                    tEnd = nextBinVal;
+                                }
+                                tmin = tBegin;
+                                tmax = tEnd;
+                                total = tmax - tmin;
+                            }
 
-                            memset( bins.get(), 0, sizeof( int64_t ) * numBins );
-                            memset( binTime.get(), 0, sizeof( int64_t ) * numBins );
-                            memset( selBin.get(), 0, sizeof( int64_t ) * numBins );
+                            const auto distBegin = ptrdiff_t( cntBegin );
+                            const auto distEnd = ptrdiff_t( cntEnd );
+                            if( m_findZone.binCache.numBins != numBins ||
+                                m_findZone.binCache.distBegin != distBegin ||
+                                m_findZone.binCache.distEnd != distEnd )
+                            {
+                                m_findZone.binCache.numBins = numBins;
+                                m_findZone.binCache.distBegin = distBegin;
+                                m_findZone.binCache.distEnd = distEnd;
 
-                            int64_t selectionTime = 0;
+                                memset( selBin.get(), 0, sizeof( int64_t ) * numBins );
 
-                            if( m_findZone.logTime )
-                            {
-                                const auto tMinLog = log10( tmin );
-                                const auto zmax = ( log10( tmax ) - tMinLog ) / numBins;
+                                int64_t selectionTime = 0;
+                                auto binStart = tmin;
+                                auto prev = cntBegin;
+                                for( int64_t i=0; i<numBins; i++ )
                                 {
-                                    auto zit = sortedBegin;
-                                    for( int64_t i=0; i<numBins; i++ )
-                                    {
-                                        const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
-                                        auto nit = std::lower_bound( zit, sortedEnd, nextBinVal );
-                                        const auto distance = std::distance( zit, nit );
-                                        const auto timeSum = std::accumulate( zit, nit, int64_t( 0 ) );
-                                        bins[i] = distance;
-                                        binTime[i] = timeSum;
-                                        if( m_findZone.highlight.active )
-                                        {
-                                            auto end = nit == zit ? zit : nit-1;
-                                            if( *zit >= s && *end <= e ) selectionTime += timeSum;
-                                        }
-                                        zit = nit;
-                                    }
-                                    const auto timeSum = std::accumulate( zit, sortedEnd, int64_t( 0 ) );
-                                    bins[numBins-1] += std::distance( zit, sortedEnd );
-                                    binTime[numBins-1] += timeSum;
-                                    if( m_findZone.highlight.active && *zit >= s && *(sortedEnd-1) <= e ) selectionTime += timeSum;
+                                    const auto nextBinVal = HistogramBinEdge( m_findZone.logTime, tmin, tmax, numBins, i+1 );
+                                    const auto cnt = i == numBins-1 ? cntEnd : std::min( cntEnd, HistogramCountBelow( hist, cumulative, nextBinVal ) );
+                                    bins[i] = int64_t( cnt + 0.5 ) - int64_t( prev + 0.5 );
+                                    binTime[i] = int64_t( bins[i] * ( double( binStart ) + nextBinVal ) * 0.5 );
+                                    if( m_findZone.highlight.active && bins[i] != 0 && binStart >= s && nextBinVal <= e ) selectionTime += binTime[i];
+                                    prev = cnt;
+                                    binStart = nextBinVal;
                                 }
 
                                 if( m_findZone.selGroup != m_findZone.Unselected )
@@ -9234,7 +9350,7 @@ void View::DrawFindZone()
                                     while( zit != m_findZone.selSort.end() && *zit == 0 ) ++zit;
                                     for( int64_t i=0; i<numBins; i++ )
                                     {
-                                        const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
+                                        const auto nextBinVal = HistogramBinEdge( m_findZone.logTime, tmin, tmax, numBins, i+1 );
                                         auto nit = std::lower_bound( zit, m_findZone.selSort.end(), nextBinVal );
                                         if( cumulateTime )
                                         {
@@ -9247,53 +9363,182 @@ void View::DrawFindZone()
                                         zit = nit;
                                     }
                                 }
+
+                                m_findZone.selTime = selectionTime;
                             }
-                            else
+                        }
+                        else
+                        {
+                            const auto& sorted = m_findZone.sorted;
+
+                            auto sortedBegin = sorted.begin();
+                            auto sortedEnd = sorted.end();
+                            while( sortedBegin != sortedEnd && *sortedBegin == 0 ) ++sortedBegin;
+
+                            if( m_findZone.minBinVal > 1 || m_findZone.limitRange )
                             {
-                                const auto zmax = tmax - tmin;
-                                auto zit = sortedBegin;
-                                for( int64_t i=0; i<numBins; i++ )
+                                if( m_findZone.logTime )
                                 {
-                                    const auto nextBinVal = tmin + ( i+1 ) * zmax / numBins;
-                                    auto nit = std::lower_bound( zit, sortedEnd, nextBinVal );
-                                    const auto distance = std::distance( zit, nit );
-                                    const auto timeSum = std::accumulate( zit, nit, int64_t( 0 ) );
-                                    bins[i] = distance;
-                                    binTime[i] = timeSum;
-                                    if( m_findZone.highlight.active )
+                                    const auto tMinLog = log10( tmin );
+                                    const auto zmax = ( log10( tmax ) - tMinLog ) / numBins;
+                                    int64_t i;
+                                    for( i=0; i<numBins; i++ )
+                                    {
+                                        const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
+                                        auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
+                                        const auto distance = std::distance( sortedBegin, nit );
+                                        if( distance >= m_findZone.minBinVal ) break;
+                                        sortedBegin = nit;
+                                    }
+                                    for( int64_t j=numBins-1; j>i; j-- )
+                                    {
+                                        const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( j-1 ) * zmax ) );
+                                        auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
+                                        const auto distance = std::distance( nit, sortedEnd );
+                                        if( distance >= m_findZone.minBinVal ) break;
+                                        sortedEnd = nit;
+                                    }
+                                }
+                                else
+                                {
+                                    const auto zmax = tmax - tmin;
+                                    int64_t i;
+                                    for( i=0; i<numBins; i++ )
+                                    {
+                                        const auto nextBinVal = tmin + ( i+1 ) * zmax / numBins;
+                                        auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
+                                        const auto distance = std::distance( sortedBegin, nit );
+                                        if( distance >= m_findZone.minBinVal ) break;
+                                        sortedBegin = nit;
+                                    }
+                                    for( int64_t j=numBins-1; j>i; j-- )
                                     {
-                                        auto end = nit == zit ? zit : nit-1;
-                                        if( *zit >= s && *end <= e ) selectionTime += timeSum;
+                                        const auto nextBinVal = tmin + ( j-1 ) * zmax / numBins;
+                                        auto nit = std::lower_bound( sortedBegin, sortedEnd, nextBinVal );
+                                        const auto distance = std::distance( nit, sortedEnd );
+                                        if( distance >= m_findZone.minBinVal ) break;
+                                        sortedEnd = nit;
                                     }
-                                    zit = nit;
                                 }
-                                const auto timeSum = std::accumulate( zit, sortedEnd, int64_t( 0 ) );
-                                bins[numBins-1] += std::distance( zit, sortedEnd );
-                                binTime[numBins-1] += timeSum;
-                                if( m_findZone.highlight.active && *zit >= s && *(sortedEnd-1) <= e ) selectionTime += timeSum;
 
-                                if( m_findZone.selGroup != m_findZone.Unselected )
+                                if( sortedBegin != sorted.end() )
                                 {
-                                    auto zit = m_findZone.selSort.begin();
-                                    while( zit != m_findZone.selSort.end() && *zit == 0 ) ++zit;
+                                    tmin = *sortedBegin;
+                                    tmax = *(sortedEnd-1);
+                                    total = tmax - tmin;
+                                }
+                            }
+
+                            const auto distBegin = std::distance( sorted.begin(), sortedBegin );
+                            const auto distEnd = std::distance( sorted.begin(), sortedEnd );
+                            if( m_findZone.binCache.numBins != numBins ||
+                                m_findZone.binCache.distBegin != distBegin ||
+                                m_findZone.binCache.distEnd != distEnd )
+                            {
+                                m_findZone.binCache.numBins = numBins;
+                                m_findZone.binCache.distBegin = distBegin;
+                                m_findZone.binCache.distEnd = distEnd;
+
+                                memset( bins.get(), 0, sizeof( int64_t ) * numBins );
+                                memset( binTime.get(), 0, sizeof( int64_t ) * numBins );
+                                memset( selBin.get(), 0, sizeof( int64_t ) * numBins );
+
+                                int64_t selectionTime = 0;
+
+                                if( m_findZone.logTime )
+                                {
+                                    const auto tMinLog = log10( tmin );
+                                    const auto zmax = ( log10( tmax ) - tMinLog ) / numBins;
+                                    {
+                                        auto zit = sortedBegin;
+                                        for( int64_t i=0; i<numBins; i++ )
+                                        {
+                                            const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
+                                            auto nit = std::lower_bound( zit, sortedEnd, nextBinVal );
+                                            const auto distance = std::distance( zit, nit );
+                                            const auto timeSum = std::accumulate( zit, nit, int64_t( 0 ) );
+                                            bins[i] = distance;
+                                            binTime[i] = timeSum;
+                                            if( m_findZone.highlight.active )
+                                            {
+                                                auto end = nit == zit ? zit : nit-1;
+                                                if( *zit >= s && *end <= e ) selectionTime += timeSum;
+                                            }
+                                            zit = nit;
+                                        }
+                                        const auto timeSum = std::accumulate( zit, sortedEnd, int64_t( 0 ) );
+                                        bins[numBins-1] += std::distance( zit, sortedEnd );
+                                        binTime[numBins-1] += timeSum;
+                                        if( m_findZone.highlight.active && *zit >= s && *(sortedEnd-1) <= e ) selectionTime += timeSum;
+                                    }
+
+                                    if( m_findZone.selGroup != m_findZone.Unselected )
+                                    {
+                                        auto zit = m_findZone.selSort.begin();
+                                        while( zit != m_findZone.selSort.end() && *zit == 0 ) ++zit;
+                                        for( int64_t i=0; i<numBins; i++ )
+                                        {
+                                            const auto nextBinVal = int64_t( pow( 10.0, tMinLog + ( i+1 ) * zmax ) );
+                                            auto nit = std::lower_bound( zit, m_findZone.selSort.end(), nextBinVal );
+                                            if( cumulateTime )
+                                            {
+                                                selBin[i] = std::accumulate( zit, nit, int64_t( 0 ) );
+                                            }
+                                            else
+                                            {
+                                                selBin[i] = std::distance( zit, nit );
+                                            }
+                                            zit = nit;
+                                        }
+                                    }
+                                }
+                                else
+                                {
+                                    const auto zmax = tmax - tmin;
+                                    auto zit = sortedBegin;
                                     for( int64_t i=0; i<numBins; i++ )
                                     {
                                         const auto nextBinVal = tmin + ( i+1 ) * zmax / numBins;
-                                        auto nit = std::lower_bound( zit, m_findZone.selSort.end(), nextBinVal );
-                                        if( cumulateTime )
+                                        auto nit = std::lower_bound( zit, sortedEnd, nextBinVal );
+                                        const auto distance = std::distance( zit, nit );
+                                        const auto timeSum = std::accumulate( zit, nit, int64_t( 0 ) );
+                                        bins[i] = distance;
+                                        binTime[i] = timeSum;
+                                        if( m_findZone.highlight.active )
                                         {
-                                            selBin[i] = std::accumulate( zit, nit, int64_t( 0 ) );
+                                            auto end = nit == zit ? zit : nit-1;
+                                            if( *zit >= s && *end <= e ) selectionTime += timeSum;
                                         }
-                                        else
+                                        zit = nit;
+                                    }
+                                    const auto timeSum = std::accumulate( zit, sortedEnd, int64_t( 0 ) );
+                                    bins[numBins-1] += std::distance( zit, sortedEnd );
+                                    binTime[numBins-1] += timeSum;
+                                    if( m_findZone.highlight.active && *zit >= s && *(sortedEnd-1) <= e ) selectionTime += timeSum;
+
+                                    if( m_findZone.selGroup != m_findZone.Unselected )
+                                    {
+                                        auto zit = m_findZone.selSort.begin();
+                                        while( zit != m_findZone.selSort.end() && *zit == 0 ) ++zit;
+                                        for( int64_t i=0; i<numBins; i++ )
                                         {
-                                            selBin[i] = std::distance( zit, nit );
+                                            const auto nextBinVal = tmin + ( i+1 ) * zmax / numBins;
+                                            auto nit = std::lower_bound( zit, m_findZone.selSort.end(), nextBinVal );
+                                            if( cumulateTime )
+                                            {
+                                                selBin[i] = std::accumulate( zit, nit, int64_t( 0 ) );
+                                            }
+                                            else
+                                            {
+                                                selBin[i] = std::distance( zit, nit );
+                                            }
+                                            zit = nit;
                                         }
-                                        zit = nit;
                                     }
                                 }
-                            }
 
-                            m_findZone.selTime = selectionTime;
+                                m_findZone.selTime = selectionTime;
+                            }
                         }
 
                         int maxBin = 0;
@@ -9352,9 +9597,10 @@ void View::DrawFindZone()
                             }
                             TextFocused( "Mode:", TimeToString( ( t0 + t1 ) / 2 ) );
                         }
-                        if( !m_findZone.limitRange && m_findZone.sorted.size() > 1 )
+                        const auto sortedSize = useHist ? size_t( hist.Count() ) : m_findZone.sorted.size();
+                        if( !m_findZone.limitRange && sortedSize > 1 )
                         {
-                            const auto sz = m_findZone.sorted.size();
+                            const auto sz = sortedSize;
                             const auto avg = m_findZone.average;
                             const auto ss = zoneData.sumSq - 2. * zoneData.total * avg + avg * avg * sz;
                             const auto sd = sqrt( ss / ( sz - 1 ) );
@@ -9370,6 +9616,26 @@ void View::DrawFindZone()
                                 ImGui::EndTooltip();
                             }
                         }
+                        {
+                            auto percentile = [&]( double p ) {
+                                if( useHist ) return hist.Percentile( p );
+                                return m_findZone.sorted[std::min( sortedSize - 1, size_t( p * sortedSize ) )];
+                            };
+                            TextFocused( "P90:", TimeToString( percentile( 0.9 ) ) );
+                            ImGui::SameLine();
+                            ImGui::Spacing();
+                            ImGui::SameLine();
+                            TextFocused( "P99:", TimeToString( percentile( 0.99 ) ) );
+                            ImGui::SameLine();
+                            ImGui::Spacing();
+                            ImGui::SameLine();
+                            TextFocused( "P99.9:", TimeToString( percentile( 0.999 ) ) );
+                            if( useHist )
+                            {
+                                ImGui::SameLine();
+                                DrawHelpMarker( "Percentiles and median are estimated from a logarithmic histogram with about 3% resolution." );
+                            }
+                        }
 
                         TextDisabledUnformatted( "Selection range:" );
                         ImGui::SameLine();
@@ -9766,6 +10032,11 @@ void View::DrawFindZone()
         ImGui::TextUnformatted( "Found zones:" );
         ImGui::SameLine();
         DrawHelpMarker( "Left click to highlight entry. Right click to clear selection." );
+        if( zoneData.zones.size() - m_findZone.processed > m_findZone.partSize )
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled( "(processing: %.1f%%)", 100.f * m_findZone.processed / zoneData.zones.size() );
+        }
 
         bool groupChanged = false;
         ImGui::PushStyleVar( ImGuiStyleVar_FramePadding, ImVec2( 0, 0 ) );
@@ -9800,101 +10071,69 @@ void View::DrawFindZone()
         DrawHelpMarker( "Mean time per call" );
 
         auto& zones = zoneData.zones;
-        const auto hmin = std::min( m_findZone.highlight.start, m_findZone.highlight.end );
-        const auto hmax = std::max( m_findZone.highlight.start, m_findZone.highlight.end );
         const auto groupBy = m_findZone.groupBy;
-        const auto highlightActive = m_findZone.highlight.active;
-        const auto limitRange = m_findZone.limitRange;
-        FindZone::Group* group = nullptr;
-        uint64_t lastGid = std::numeric_limits<uint64_t>::max() - 1;
         auto zptr = zones.data() + m_findZone.processed;
-        const auto zend = zones.data() + zones.size();
-        while( zptr < zend )
+        auto zend = zones.data() + zones.size();
+        if( m_findZone.limitRange )
         {
-            auto& ev = *zptr;
-            const auto end = ev.Zone()->End();
-            const auto start = ev.Zone()->Start();
-            if( limitRange && ( start < rangeMin || end > rangeMax ) )
-            {
-                zptr++;
-                continue;
-            }
-            auto timespan = end - start;
-            assert( timespan != 0 );
-            if( m_findZone.selfTime )
-            {
-                timespan -= GetZoneChildTimeFast( *ev.Zone() );
-            }
-            else if( m_findZone.runningTime )
+            const auto candidates = m_worker.GetZoneRangeCandidates( zoneData, rangeMin, rangeMax );
+            zptr = std::max( zptr, zones.data() + candidates.first );
+            zend = std::max( zptr, zones.data() + candidates.second );
+        }
+        if( zptr < zend )
+        {
+            // Zones are grouped in parts, which are processed in parallel and merged in zone order. Only a
+            // limited number of parts is processed each frame, so that the groups fill in progressively.
+            // Running time queries go through the worker's context switch cache and are not parallelized.
+            const auto zbegin = zptr;
+            const auto partSize = m_findZone.partSize;
+            const auto maxParts = m_findZone.runningTime ? 1 : std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+            const auto parts = std::min<size_t>( maxParts, ( zend - zptr + partSize - 1 ) / partSize );
+            std::vector<FindZone::GroupPart> partial( parts );
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            if( parts == 1 )
             {
-                const auto ctx = m_worker.GetContextSwitchData( m_worker.DecompressThread( ev.Thread() ) );
-                if( !ctx ) break;
-                int64_t t;
-                uint64_t cnt;
-                if( !GetZoneRunningTime( ctx, *ev.Zone(), t, cnt ) ) break;
-                timespan = t;
+                GroupFindZones( zptr, std::min( zend, zptr + partSize ), partial[0], rangeMin, rangeMax );
             }
-
-            if( highlightActive )
+            else
             {
-                if( timespan < hmin || timespan > hmax )
+                auto& td = GetTaskDispatch();
+                for( size_t i=0; i<parts; i++ )
                 {
-                    zptr++;
-                    continue;
+                    auto part = &partial[i];
+                    const auto begin = zbegin + i * partSize;
+                    const auto pend = std::min( zend, begin + partSize );
+                    td.Queue( [this, part, begin, pend, rangeMin, rangeMax] { GroupFindZones( begin, pend, *part, rangeMin, rangeMax ); } );
                 }
+                td.Sync();
             }
+            const auto t1 = std::chrono::high_resolution_clock::now();
 
-            zptr++;
-            uint64_t gid = 0;
-            switch( groupBy )
-            {
-            case FindZone::GroupBy::Thread:
-                gid = ev.Thread();
-                break;
-            case FindZone::GroupBy::UserText:
-            {
-                const auto& zone = *ev.Zone();
-                if( !m_worker.HasZoneExtra( zone ) )
-                {
-                    gid = std::numeric_limits<uint64_t>::max();
-                }
-                else
-                {
-                    const auto& extra = m_worker.GetZoneExtra( zone );
-                    gid = extra.text.Active() ? extra.text.Idx() : std::numeric_limits<uint64_t>::max();
-                }
-                break;
-            }
-            case FindZone::GroupBy::Callstack:
-                gid = m_worker.GetZoneExtra( *ev.Zone() ).callstack.Val();
-                break;
-            case FindZone::GroupBy::Parent:
-            {
-                const auto parent = GetZoneParent( *ev.Zone(), m_worker.DecompressThread( ev.Thread() ) );
-                if( parent ) gid = uint64_t( uint16_t( parent->SrcLoc() ) );
-                break;
-            }
-            case FindZone::GroupBy::NoGrouping:
-                break;
-            default:
-                assert( false );
-                break;
-            }
-            if( lastGid != gid )
+            for( size_t i=0; i<parts; i++ )
             {
-                lastGid = gid;
-                auto it = m_findZone.groups.find( gid );
-                if( it == m_findZone.groups.end() )
+                auto& part = partial[i];
+                for( auto& v : part.groups )
                 {
-                    it = m_findZone.groups.emplace( gid, FindZone::Group { m_findZone.groupId++ } ).first;
-                    it->second.zones.reserve( 1024 );
+                    auto it = m_findZone.groups.find( v.gid );
+                    if( it == m_findZone.groups.end() )
+                    {
+                        it = m_findZone.groups.emplace( v.gid, FindZone::Group { m_findZone.groupId++ } ).first;
+                        it->second.zones.reserve( std::max<size_t>( 1024, v.zones.size() ) );
+                    }
+                    auto& group = it->second;
+                    group.time += v.time;
+                    group.zones.insert( group.zones.end(), v.zones.data(), v.zones.data() + v.zones.size() );
                 }
-                group = &it->second;
+                zptr = part.end;
+                if( zptr != std::min( zend, zbegin + ( i+1 ) * partSize ) ) break;
             }
-            group->time += timespan;
-            group->zones.push_back_non_empty( ev.Zone() );
+            m_findZone.processed = zptr == zend ? zones.size() : zptr - zones.data();
+
+            // Adjust the part size to keep the per-frame processing time within a few milliseconds.
+            const auto ms = std::chrono::duration_cast<std::chrono::microseconds>( t1 - t0 ).count() / 1000.;
+            if( ms < 4 && partSize < 4 * 1024 * 1024 ) m_findZone.partSize = partSize * 2;
+            else if( ms > 12 && partSize > 1024 ) m_findZone.partSize = partSize / 2;
         }
-        m_findZone.processed = zptr - zones.data();
 
         Vector<decltype( m_findZone.groups )::iterator> groups;
         groups.reserve_and_use( m_findZone.groups.size() );
@@ -11278,61 +11517,93 @@ void View::DrawStatistics()
             m_statisticsFilter.Clear();
         }
 
-        const auto filterActive = m_statisticsFilter.IsActive();
-        auto& slz = m_worker.GetSourceLocationZones();
-        Vector<decltype(slz.begin())> srcloc;
-        srcloc.reserve( slz.size() );
-        uint32_t slzcnt = 0;
-        for( auto it = slz.begin(); it != slz.end(); ++it )
-        {
-            if( it->second.total != 0 )
-            {
-                slzcnt++;
-                if( !filterActive )
-                {
-                    srcloc.push_back_no_space_check( it );
-                }
-                else
-                {
-                    auto& sl = m_worker.GetSourceLocation( it->first );
-                    auto name = m_worker.GetString( sl.name.active ? sl.name : sl.function );
-                    if( m_statisticsFilter.PassFilter( name ) )
+        // Live captures update zone statistics continuously, so the list is refreshed a few times per
+        // second instead of on every frame.
+        auto& cache = m_statCache;
+        const auto generation = m_worker.GetSourceLocationZonesGeneration();
+        if( !cache.valid ||
+            cache.filter != m_statisticsFilter.InputBuf ||
+            cache.sort != m_statSort ||
+            cache.self != m_statSelf ||
+            cache.limitRange != m_statLimitRange ||
+            ( m_statLimitRange && ( cache.rangeMin != m_statRangeMin || cache.rangeMax != m_statRangeMax ) ) ||
+            ( cache.generation != generation && s_time - cache.time >= 0.25 ) )
+        {
+            cache.valid = true;
+            cache.filter = m_statisticsFilter.InputBuf;
+            cache.sort = m_statSort;
+            cache.self = m_statSelf;
+            cache.limitRange = m_statLimitRange;
+            cache.rangeMin = m_statRangeMin;
+            cache.rangeMax = m_statRangeMax;
+            cache.generation = generation;
+            cache.time = s_time;
+
+            const auto filterActive = m_statisticsFilter.IsActive();
+            auto& slz = m_worker.GetSourceLocationZones();
+            auto& srcloc = cache.srcloc;
+            srcloc.clear();
+            srcloc.reserve( slz.size() );
+            uint32_t slzcnt = 0;
+            for( auto it = slz.begin(); it != slz.end(); ++it )
+            {
+                if( it->second.total != 0 )
+                {
+                    slzcnt++;
+                    if( filterActive )
                     {
-                        srcloc.push_back_no_space_check( it );
+                        auto& sl = m_worker.GetSourceLocation( it->first );
+                        auto name = m_worker.GetString( sl.name.active ? sl.name : sl.function );
+                        if( !m_statisticsFilter.PassFilter( name ) ) continue;
+                    }
+                    if( m_statLimitRange )
+                    {
+                        const auto stats = m_worker.GetZoneRangeStats( it->second, m_statRangeMin, m_statRangeMax );
+                        if( stats.count != 0 )
+                        {
+                            srcloc.push_back_no_space_check( SrcLocStat { it->first, stats.total, stats.selfTotal, stats.count } );
+                        }
+                    }
+                    else
+                    {
+                        srcloc.push_back_no_space_check( SrcLocStat { it->first, it->second.total, it->second.selfTotal, it->second.zones.size() } );
                     }
                 }
             }
-        }
+            cache.slzcnt = slzcnt;
 
-        switch( m_statSort )
-        {
-        case 0:
-            if( m_statSelf )
-            {
-                pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs->second.selfTotal > rhs->second.selfTotal; } );
-            }
-            else
-            {
-                pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs->second.total > rhs->second.total; } );
-            }
-            break;
-        case 1:
-            pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs->second.zones.size() > rhs->second.zones.size(); } );
-            break;
-        case 2:
-            if( m_statSelf )
-            {
-                pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs->second.selfTotal / lhs->second.zones.size() > rhs->second.selfTotal / rhs->second.zones.size(); } );
-            }
-            else
+            switch( m_statSort )
             {
-                pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs->second.total / lhs->second.zones.size() > rhs->second.total / rhs->second.zones.size(); } );
+            case 0:
+                if( m_statSelf )
+                {
+                    pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs.selfTotal > rhs.selfTotal; } );
+                }
+                else
+                {
+                    pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs.total > rhs.total; } );
+                }
+                break;
+            case 1:
+                pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs.count > rhs.count; } );
+                break;
+            case 2:
+                if( m_statSelf )
+                {
+                    pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs.selfTotal / lhs.count > rhs.selfTotal / rhs.count; } );
+                }
+                else
+                {
+                    pdqsort_branchless( srcloc.begin(), srcloc.end(), []( const auto& lhs, const auto& rhs ) { return lhs.total / lhs.count > rhs.total / rhs.count; } );
+                }
+                break;
+            default:
+                assert( false );
+                break;
             }
-            break;
-        default:
-            assert( false );
-            break;
         }
+        const auto& srcloc = cache.srcloc;
+        const auto slzcnt = cache.slzcnt;
 
         ImGui::SameLine();
         ImGui::Spacing();
@@ -11346,6 +11617,10 @@ void View::DrawStatistics()
         ImGui::Spacing();
         ImGui::SameLine();
         ImGui::Checkbox( ICON_FA_CLOCK " Self time", &m_statSelf );
+        ImGui::SameLine();
+        ImGui::Spacing();
+        ImGui::SameLine();
+        DrawRangeLimit( "Zone time range:", m_statLimitRange, m_statRangeMin, m_statRangeMax );
 
         ImGui::Separator();
 
@@ -11382,58 +11657,63 @@ void View::DrawStatistics()
             ImGui::NextColumn();
             ImGui::Separator();
 
-            const auto lastTime = m_worker.GetLastTime();
-            for( auto& v : srcloc )
+            const auto lastTime = m_statLimitRange ? m_statRangeMax - m_statRangeMin : m_worker.GetLastTime();
+            ImGuiListClipper clipper( srcloc.size() );
+            while( clipper.Step() )
             {
-                ImGui::PushID( v->first );
-                auto& srcloc = m_worker.GetSourceLocation( v->first );
-                auto name = m_worker.GetString( srcloc.name.active ? srcloc.name : srcloc.function );
-                SmallColorBox( GetSrcLocColor( srcloc, 0 ) );
-                ImGui::SameLine();
-                if( ImGui::Selectable( name, m_findZone.show && !m_findZone.match.empty() && m_findZone.match[m_findZone.selMatch] == v->first, ImGuiSelectableFlags_SpanAllColumns ) )
-                {
-                    m_findZone.ShowZone( v->first, name );
-                }
-                ImGui::NextColumn();
-                float indentVal = 0.f;
-                if( m_statBuzzAnim.Match( v->first ) )
+                for( auto i=clipper.DisplayStart; i<clipper.DisplayEnd; i++ )
                 {
-                    const auto time = m_statBuzzAnim.Time();
-                    indentVal = sin( time * 60.f ) * 10.f * time;
-                    ImGui::Indent( indentVal );
-                }
-                const auto file = m_worker.GetString( srcloc.file );
+                    auto& v = srcloc[i];
+                    ImGui::PushID( v.srcloc );
+                    auto& srcloc = m_worker.GetSourceLocation( v.srcloc );
+                    auto name = m_worker.GetString( srcloc.name.active ? srcloc.name : srcloc.function );
+                    SmallColorBox( GetSrcLocColor( srcloc, 0 ) );
+                    ImGui::SameLine();
+                    if( ImGui::Selectable( name, m_findZone.show && !m_findZone.match.empty() && m_findZone.match[m_findZone.selMatch] == v.srcloc, ImGuiSelectableFlags_SpanAllColumns ) )
+                    {
+                        m_findZone.ShowZone( v.srcloc, name );
+                    }
+                    ImGui::NextColumn();
+                    float indentVal = 0.f;
+                    if( m_statBuzzAnim.Match( v.srcloc ) )
+                    {
+                        const auto time = m_statBuzzAnim.Time();
+                        indentVal = sin( time * 60.f ) * 10.f * time;
+                        ImGui::Indent( indentVal );
+                    }
+                    const auto file = m_worker.GetString( srcloc.file );
+
+                    ImGui::TextDisabled( "%s:%i", file, srcloc.line );
+                    if( ImGui::IsItemClicked( 1 ) )
+                    {
+                        if( SourceFileValid( file, m_worker.GetCaptureTime(), *this ) )
+                        {
+                            ViewSource( file, srcloc.line );
+                        }
+                        else
+                        {
+                            m_statBuzzAnim.Enable( v.srcloc, 0.5f );
+                        }
+                    }
+                    if( indentVal != 0.f )
+                    {
+                        ImGui::Unindent( indentVal );
+                    }
+                    ImGui::NextColumn();
+                    const auto time = m_statSelf ? v.selfTotal : v.total;
+                    ImGui::TextUnformatted( TimeToString( time ) );
+                    ImGui::SameLine();
+                    char buf[64];
+                    PrintStringPercent( buf, 100. * time / lastTime );
+                    TextDisabledUnformatted( buf );
+                    ImGui::NextColumn();
+                    ImGui::TextUnformatted( RealToString( v.count ) );
+                    ImGui::NextColumn();
+                    ImGui::TextUnformatted( TimeToString( ( m_statSelf ? v.selfTotal : v.total ) / v.count ) );
+                    ImGui::NextColumn();
 
-                ImGui::TextDisabled( "%s:%i", file, srcloc.line );
-                if( ImGui::IsItemClicked( 1 ) )
-                {
-                    if( SourceFileValid( file, m_worker.GetCaptureTime(), *this ) )
-                    {
-                        ViewSource( file, srcloc.line );
-                    }
-                    else
-                    {
-                        m_statBuzzAnim.Enable( v->first, 0.5f );
-                    }
-                }
-                if( indentVal != 0.f )
-                {
-                    ImGui::Unindent( indentVal );
+                    ImGui::PopID();
                 }
-                ImGui::NextColumn();
-                const auto time = m_statSelf ? v->second.selfTotal : v->second.total;
-                ImGui::TextUnformatted( TimeToString( time ) );
-                ImGui::SameLine();
-                char buf[64];
-                PrintStringPercent( buf, 100. * time / lastTime );
-                TextDisabledUnformatted( buf );
-                ImGui::NextColumn();
-                ImGui::TextUnformatted( RealToString( v->second.zones.size() ) );
-                ImGui::NextColumn();
-                ImGui::TextUnformatted( TimeToString( ( m_statSelf ? v->second.selfTotal : v->second.total ) / v->second.zones.size() ) );
-                ImGui::NextColumn();
-
-                ImGui::PopID();
             }
             ImGui::EndColumns();
             ImGui::EndChild();
@@ -11472,142 +11752,149 @@ void View::DrawStatistics()
         const auto& symMap = m_worker.GetSymbolMap();
         const auto& symStat = m_worker.GetSymbolStats();
 
-        struct SymList
-        {
-            uint64_t symAddr;
-            uint32_t incl, excl;
-            uint32_t count;
-        };
-
-        Vector<SymList> data;
-        if( m_showAllSymbols )
-        {
-            data.reserve( symMap.size() );
-            if( m_statisticsFilter.IsActive() )
+        auto& cache = m_statCache;
+        const auto generation = m_worker.GetSymbolStatsGeneration();
+        if( !cache.symbolsValid ||
+            cache.symbolFilter != m_statisticsFilter.InputBuf ||
+            cache.symbolSelf != m_statSelf ||
+            cache.showAll != m_showAllSymbols ||
+            cache.separateInlines != m_statSeparateInlines ||
+            cache.symbolCount != symMap.size() ||
+            ( cache.symbolGeneration != generation && s_time - cache.symbolTime >= 0.25 ) )
+        {
+            cache.symbolsValid = true;
+            cache.symbolFilter = m_statisticsFilter.InputBuf;
+            cache.symbolSelf = m_statSelf;
+            cache.showAll = m_showAllSymbols;
+            cache.separateInlines = m_statSeparateInlines;
+            cache.symbolCount = symMap.size();
+            cache.symbolGeneration = generation;
+            cache.symbolTime = s_time;
+
+            auto& data = cache.symbols;
+            data.clear();
+            if( m_showAllSymbols )
             {
-                for( auto& v : symMap )
+                data.reserve( symMap.size() );
+                if( m_statisticsFilter.IsActive() )
                 {
-                    auto name = m_worker.GetString( v.second.name );
-                    bool pass = m_statisticsFilter.PassFilter( name );
-                    if( !pass && v.second.size.Val() == 0 )
+                    for( auto& v : symMap )
                     {
-                        const auto parentAddr = m_worker.GetSymbolForAddress( v.first );
-                        if( parentAddr != 0 )
+                        auto name = m_worker.GetString( v.second.name );
+                        bool pass = m_statisticsFilter.PassFilter( name );
+                        if( !pass && v.second.size.Val() == 0 )
                         {
-                            auto pit = symMap.find( parentAddr );
-                            if( pit != symMap.end() )
+                            const auto parentAddr = m_worker.GetSymbolForAddress( v.first );
+                            if( parentAddr != 0 )
                             {
-                                const auto parentName = m_worker.GetString( pit->second.name );
-                                pass = m_statisticsFilter.PassFilter( parentName );
+                                auto pit = symMap.find( parentAddr );
+                                if( pit != symMap.end() )
+                                {
+                                    const auto parentName = m_worker.GetString( pit->second.name );
+                                    pass = m_statisticsFilter.PassFilter( parentName );
+                                }
+                            }
+                        }
+                        if( pass )
+                        {
+                            auto it = symStat.find( v.first );
+                            if( it == symStat.end() )
+                            {
+                                data.push_back_no_space_check( SymbolStat { v.first, 0, 0 } );
+                            }
+                            else
+                            {
+                                data.push_back_no_space_check( SymbolStat { v.first, it->second.incl, it->second.excl } );
                             }
                         }
                     }
-                    if( pass )
+                }
+                else
+                {
+                    for( auto& v : symMap )
                     {
                         auto it = symStat.find( v.first );
                         if( it == symStat.end() )
                         {
-                            data.push_back_no_space_check( SymList { v.first, 0, 0 } );
+                            data.push_back_no_space_check( SymbolStat { v.first, 0, 0 } );
                         }
                         else
                         {
-                            data.push_back_no_space_check( SymList { v.first, it->second.incl, it->second.excl } );
+                            data.push_back_no_space_check( SymbolStat { v.first, it->second.incl, it->second.excl } );
                         }
                     }
                 }
             }
             else
             {
-                for( auto& v : symMap )
-                {
-                    auto it = symStat.find( v.first );
-                    if( it == symStat.end() )
-                    {
-                        data.push_back_no_space_check( SymList { v.first, 0, 0 } );
-                    }
-                    else
-                    {
-                        data.push_back_no_space_check( SymList { v.first, it->second.incl, it->second.excl } );
-                    }
-                }
-            }
-        }
-        else
-        {
-            data.reserve( symStat.size() );
-            if( m_statisticsFilter.IsActive() )
-            {
-                for( auto& v : symStat )
+                data.reserve( symStat.size() );
+                if( m_statisticsFilter.IsActive() )
                 {
-                    auto sit = symMap.find( v.first );
-                    if( sit != symMap.end() )
+                    for( auto& v : symStat )
                     {
-                        auto name = m_worker.GetString( sit->second.name );
-                        bool pass = m_statisticsFilter.PassFilter( name );
-                        if( !pass && sit->second.size.Val() == 0 )
+                        auto sit = symMap.find( v.first );
+                        if( sit != symMap.end() )
                         {
-                            const auto parentAddr = m_worker.GetSymbolForAddress( v.first );
-                            if( parentAddr != 0 )
+                            auto name = m_worker.GetString( sit->second.name );
+                            bool pass = m_statisticsFilter.PassFilter( name );
+                            if( !pass && sit->second.size.Val() == 0 )
                             {
-                                auto pit = symMap.find( parentAddr );
-                                if( pit != symMap.end() )
+                                const auto parentAddr = m_worker.GetSymbolForAddress( v.first );
+                                if( parentAddr != 0 )
                                 {
-                                    const auto parentName = m_worker.GetString( pit->second.name );
-                                    pass = m_statisticsFilter.PassFilter( parentName );
+                                    auto pit = symMap.find( parentAddr );
+                                    if( pit != symMap.end() )
+                                    {
+                                        const auto parentName = m_worker.GetString( pit->second.name );
+                                        pass = m_statisticsFilter.PassFilter( parentName );
+                                    }
                                 }
                             }
-                        }
-                        if( pass )
-                        {
-                            data.push_back_no_space_check( SymList { v.first, v.second.incl, v.second.excl } );
+                            if( pass )
+                            {
+                                data.push_back_no_space_check( SymbolStat { v.first, v.second.incl, v.second.excl } );
+                            }
                         }
                     }
                 }
-            }
-            else
-            {
-                for( auto& v : symStat )
+                else
                 {
-                    data.push_back_no_space_check( SymList { v.first, v.second.incl, v.second.excl } );
+                    for( auto& v : symStat )
+                    {
+                        data.push_back_no_space_check( SymbolStat { v.first, v.second.incl, v.second.excl } );
+                    }
                 }
             }
-        }
 
-        if( !m_statSeparateInlines )
-        {
-            static unordered_flat_map<uint64_t, SymList> baseMap;
-            assert( baseMap.empty() );
-            for( auto& v : data )
+            if( !m_statSeparateInlines )
             {
-                auto sym = m_worker.GetSymbolData( v.symAddr );
-                const auto symAddr = ( sym && sym->isInline ) ? m_worker.GetSymbolForAddress( v.symAddr ) : v.symAddr;
-                auto it = baseMap.find( symAddr );
-                if( it == baseMap.end() )
+                static unordered_flat_map<uint64_t, SymbolStat> baseMap;
+                assert( baseMap.empty() );
+                for( auto& v : data )
                 {
-                    baseMap.emplace( symAddr, SymList { symAddr, v.incl, v.excl, 0 } );
+                    auto sym = m_worker.GetSymbolData( v.symAddr );
+                    const auto symAddr = ( sym && sym->isInline ) ? m_worker.GetSymbolForAddress( v.symAddr ) : v.symAddr;
+                    auto it = baseMap.find( symAddr );
+                    if( it == baseMap.end() )
+                    {
+                        baseMap.emplace( symAddr, SymbolStat { symAddr, v.incl, v.excl, 0 } );
+                    }
+                    else
+                    {
+                        assert( symAddr == it->second.symAddr );
+                        it->second.incl += v.incl;
+                        it->second.excl += v.excl;
+                        it->second.count++;
+                    }
                 }
-                else
+                data.clear();
+                for( auto& v : baseMap )
                 {
-                    assert( symAddr == it->second.symAddr );
-                    it->second.incl += v.incl;
-                    it->second.excl += v.excl;
-                    it->second.count++;
+                    data.push_back_no_space_check( v.second );
                 }
+                baseMap.clear();
             }
-            data.clear();
-            for( auto& v : baseMap )
-            {
-                data.push_back_no_space_check( v.second );
-            }
-            baseMap.clear();
-        }
 
-        if( data.empty() )
-        {
-            ImGui::TextUnformatted( "No entries to be displayed." );
-        }
-        else
-        {
             if( m_statSelf )
             {
                 pdqsort_branchless( data.begin(), data.end(), []( const auto& l, const auto& r ) { return l.excl != r.excl ? l.excl > r.excl : l.symAddr < r.symAddr; } );
@@ -11616,7 +11903,15 @@ void View::DrawStatistics()
             {
                 pdqsort_branchless( data.begin(), data.end(), []( const auto& l, const auto& r ) { return l.incl != l.incl ? l.incl > r.incl : l.symAddr < r.symAddr; } );
             }
+        }
+        const auto& data = cache.symbols;
 
+        if( data.empty() )
+        {
+            ImGui::TextUnformatted( "No entries to be displayed." );
+        }
+        else
+        {
             ImGui::BeginChild( "##statisticsSampling" );
             const auto w = ImGui::GetWindowWidth();
             static bool widthSet = false;
@@ -11835,24 +12130,24 @@ void View::DrawStatistics()
                         auto inSym = m_worker.GetInlineSymbolList( v.symAddr, symlen );
                         assert( inSym != 0 );
                         const auto symEnd = v.symAddr + symlen;
-                        Vector<SymList> inSymList;
+                        Vector<SymbolStat> inSymList;
                         while( *inSym < symEnd )
                         {
                             auto sit = symStat.find( *inSym );
                             if( sit != symStat.end() )
                             {
-                                inSymList.push_back( SymList { *inSym, sit->second.incl, sit->second.excl } );
+                                inSymList.push_back( SymbolStat { *inSym, sit->second.incl, sit->second.excl } );
                             }
                             else
                             {
-                                inSymList.push_back( SymList { *inSym, 0, 0 } );
+                                inSymList.push_back( SymbolStat { *inSym, 0, 0 } );
                             }
                             inSym++;
                         }
                         auto statIt = symStat.find( v.symAddr );
                         if( statIt != symStat.end() )
                         {
-                            inSymList.push_back( SymList { v.symAddr, statIt->second.incl, statIt->second.excl } );
+                            inSymList.push_back( SymbolStat { v.symAddr, statIt->second.incl, statIt->second.excl } );
                         }
 
                         if( m_statSelf )
@@ -13301,7 +13596,7 @@ void View::DrawLockInfoWindow()
             }
             else
             {
-                maxWaitingThreads = std::max<uint32_t>( maxWaitingThreads, TracyCountBits( v.waitList ) );
+                maxWaitingThreads = std::max<uint32_t>( maxWaitingThreads, lock.CountWaiting( v.waitList ) );
             }
         }
         else
@@ -13310,7 +13605,7 @@ void View::DrawLockInfoWindow()
             {
                 waitStartTime = v.ptr->Time();
                 waitState = true;
-                maxWaitingThreads = std::max<uint32_t>( maxWaitingThreads, TracyCountBits( v.waitList ) );
+                maxWaitingThreads = std::max<uint32_t>( maxWaitingThreads, lock.CountWaiting( v.waitList ) );
             }
         }
     }
@@ -13896,6 +14191,105 @@ void View::DrawAnnotationList()
     ImGui::End();
 }
 
+void View::DrawSlowZones()
+{
+    ImGui::SetNextWindowSize( ImVec2( 900, 500 ), ImGuiCond_FirstUseEver );
+    ImGui::Begin( "Slowest zones", &m_showSlowZones );
+#ifdef TRACY_NO_STATISTICS
+    ImGui::TextWrapped( "Collection of statistical data is disabled in this build." );
+    ImGui::TextWrapped( "Rebuild without the TRACY_NO_STATISTICS macro to enable slowest zones list." );
+#else
+    if( !m_worker.AreSourceLocationZonesReady() )
+    {
+        ImGui::TextWrapped( "Please wait, computing data..." );
+        DrawWaitingDots( s_time );
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SetNextItemWidth( 300 );
+    if( ImGui::BeginCombo( "Thread", m_slowZonesThread == 0 ? "All threads" : m_worker.GetThreadName( m_slowZonesThread ) ) )
+    {
+        if( ImGui::Selectable( "All threads", m_slowZonesThread == 0 ) ) m_slowZonesThread = 0;
+        for( const auto& t : m_threadOrder )
+        {
+            if( t->slowZones.empty() ) continue;
+            ImGui::PushID( t );
+            if( ImGui::Selectable( m_worker.GetThreadName( t->id ), m_slowZonesThread == t->id ) ) m_slowZonesThread = t->id;
+            ImGui::PopID();
+        }
+        ImGui::EndCombo();
+    }
+
+    // Each thread keeps its own longest zones, so the overall longest zones are among them.
+    std::vector<std::pair<const ZoneEvent*, uint64_t>> zones;
+    for( const auto& t : m_worker.GetThreadData() )
+    {
+        if( m_slowZonesThread != 0 && t->id != m_slowZonesThread ) continue;
+        for( const auto& z : t->slowZones ) zones.emplace_back( z.get(), t->id );
+    }
+    const auto cnt = std::min<size_t>( zones.size(), SlowZonesCount );
+    std::partial_sort( zones.begin(), zones.begin() + cnt, zones.end(), [] ( const auto& lhs, const auto& rhs ) { return lhs.first->End() - lhs.first->Start() > rhs.first->End() - rhs.first->Start(); } );
+
+    ImGui::SameLine();
+    ImGui::Spacing();
+    ImGui::SameLine();
+    TextFocused( "Zones:", RealToString( cnt ) );
+    ImGui::SameLine();
+    DrawHelpMarker( "Click on zone to zoom to it and open zone information." );
+
+    ImGui::Separator();
+    ImGui::BeginChild( "##slowZones" );
+    ImGui::Columns( 4 );
+    ImGui::TextUnformatted( "Execution time" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Name" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Thread" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Time from start" );
+    ImGui::NextColumn();
+    ImGui::Separator();
+
+    ImGuiListClipper clipper( cnt );
+    while( clipper.Step() )
+    {
+        for( auto i=clipper.DisplayStart; i<clipper.DisplayEnd; i++ )
+        {
+            auto ev = zones[i].first;
+            const auto tid = zones[i].second;
+            ImGui::PushID( ev );
+            if( m_zoneHover == ev ) ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0, 1, 0, 1 ) );
+            if( ImGui::Selectable( TimeToString( ev->End() - ev->Start() ), m_zoneInfoWindow == ev, ImGuiSelectableFlags_SpanAllColumns ) )
+            {
+                ZoomToZone( *ev );
+                ShowZoneInfo( *ev );
+            }
+            if( ImGui::IsItemHovered() )
+            {
+                m_zoneHighlight = ev;
+                ZoneTooltip( *ev );
+                m_zoneHover2 = ev;
+            }
+            ImGui::NextColumn();
+            ImGui::TextUnformatted( m_worker.GetZoneName( *ev ) );
+            ImGui::NextColumn();
+            SmallColorBox( GetThreadColor( tid, 0 ) );
+            ImGui::SameLine();
+            ImGui::TextUnformatted( m_worker.GetThreadName( tid ) );
+            ImGui::NextColumn();
+            ImGui::TextUnformatted( TimeToStringExact( ev->Start() ) );
+            ImGui::NextColumn();
+            if( m_zoneHover == ev ) ImGui::PopStyleColor();
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndColumns();
+    ImGui::EndChild();
+#endif
+    ImGui::End();
+}
+
 void View::DrawSampleParents()
 {
     const auto symbol = m_worker.GetSymbolData( m_sampleParents.symAddr );
@@ -14466,59 +14860,173 @@ static tracy_force_inline CallstackFrameTree* GetFrameTreeItemGroup( unordered_f
     return &it->second;
 }
 
-unordered_flat_map<uint32_t, View::PathData> View::GetCallstackPaths( const MemData& mem, bool onlyActive ) const
+void View::AddCallstackPaths( unordered_flat_map<uint32_t, PathData>& paths, const MemEvent* begin, const MemEvent* end, int64_t time, bool onlyActive )
 {
-    unordered_flat_map<uint32_t, PathData> pathSum;
-    pathSum.reserve( m_worker.GetCallstackPayloadCount() );
+    for( auto ev = begin; ev != end; ++ev )
+    {
+        if( ev->CsAlloc() == 0 ) continue;
+        if( ev->TimeAlloc() >= time ) continue;
+        if( onlyActive && ev->TimeFree() >= 0 && ev->TimeFree() <= time ) continue;
 
-    const auto zvMid = m_vd.zvStart + ( m_vd.zvEnd - m_vd.zvStart ) / 2;
+        auto it = paths.find( ev->CsAlloc() );
+        if( it == paths.end() )
+        {
+            paths.emplace( ev->CsAlloc(), PathData { 1, ev->Size() } );
+        }
+        else
+        {
+            it->second.cnt++;
+            it->second.mem += ev->Size();
+        }
+    }
+}
 
-    if( m_memInfo.restrictTime )
+// Returns true if call stack paths have changed.
+bool View::UpdateCallstackPaths( MemPathCache& cache, const MemData& mem, bool onlyActive )
+{
+    const auto restrictTime = m_memInfo.restrictTime;
+    const auto time = restrictTime ? m_vd.zvStart + ( m_vd.zvEnd - m_vd.zvStart ) / 2 : std::numeric_limits<int64_t>::max();
+
+    // Call stack of an allocation is received after the allocation, so the last one may not have it yet.
+    auto count = mem.data.size();
+    if( count != 0 && m_worker.IsConnected() && mem.data.back().CsAlloc() == 0 ) count--;
+
+    if( cache.valid && cache.onlyActive == onlyActive && cache.restrictTime == restrictTime && cache.time == time )
     {
-        for( auto& ev : mem.data )
-        {
-            if( ev.CsAlloc() == 0 ) continue;
-            if( ev.TimeAlloc() >= zvMid ) continue;
-            if( onlyActive && ev.TimeFree() >= 0 && ev.TimeFree() < zvMid ) continue;
+        if( cache.allocCount == count && cache.freeCount == mem.frees.size() ) return false;
 
-            auto it = pathSum.find( ev.CsAlloc() );
-            if( it == pathSum.end() )
-            {
-                pathSum.emplace( ev.CsAlloc(), PathData { 1, ev.Size() } );
-            }
-            else
+        if( onlyActive )
+        {
+            // Allocations already accounted for, which were freed since the last update.
+            for( size_t i=cache.freeCount; i<mem.frees.size(); i++ )
             {
-                it->second.cnt++;
-                it->second.mem += ev.Size();
+                const auto idx = mem.frees[i];
+                if( idx >= cache.allocCount ) continue;
+                const auto& ev = mem.data[idx];
+                if( ev.CsAlloc() == 0 || ev.TimeAlloc() >= time || ev.TimeFree() > time ) continue;
+                auto it = cache.paths.find( ev.CsAlloc() );
+                assert( it != cache.paths.end() );
+                if( --it->second.cnt == 0 )
+                {
+                    cache.paths.erase( it );
+                }
+                else
+                {
+                    it->second.mem -= ev.Size();
+                }
             }
         }
+        AddCallstackPaths( cache.paths, mem.data.data() + cache.allocCount, mem.data.data() + count, time, onlyActive );
+        cache.allocCount = count;
+        cache.freeCount = mem.frees.size();
+        return true;
+    }
+
+    cache.valid = true;
+    cache.onlyActive = onlyActive;
+    cache.restrictTime = restrictTime;
+    cache.time = time;
+    cache.allocCount = count;
+    cache.freeCount = mem.frees.size();
+    cache.paths.clear();
+
+    auto ptr = mem.data.data();
+    if( onlyActive )
+    {
+        std::vector<const MemEvent*> active;
+        if( restrictTime )
+        {
+            m_worker.GetActiveMemAllocs( time, active );
+        }
+        else
+        {
+            active.reserve( mem.active.size() );
+            for( auto& v : mem.active ) active.emplace_back( ptr + v.second );
+        }
+        for( auto& ev : active )
+        {
+            if( size_t( ev - ptr ) < count ) AddCallstackPaths( cache.paths, ev, ev+1, time, true );
+        }
     }
     else
     {
-        for( auto& ev : mem.data )
+        auto end = count;
+        if( restrictTime )
         {
-            if( ev.CsAlloc() == 0 ) continue;
-            if( onlyActive && ev.TimeFree() >= 0 ) continue;
+            end = std::min<size_t>( end, std::distance( mem.data.begin(), std::lower_bound( mem.data.begin(), mem.data.end(), time, [] ( const auto& lhs, const auto& rhs ) { return lhs.TimeAlloc() < rhs; } ) ) );
+        }
 
-            auto it = pathSum.find( ev.CsAlloc() );
-            if( it == pathSum.end() )
+        // Large allocation lists are split into parts, which are processed in parallel and merged.
+        constexpr size_t PartSize = 1024 * 1024;
+        const auto parts = ( end + PartSize - 1 ) / PartSize;
+        if( parts < 2 )
+        {
+            AddCallstackPaths( cache.paths, ptr, ptr + end, time, false );
+        }
+        else
+        {
+            std::vector<unordered_flat_map<uint32_t, PathData>> partial( parts );
+            auto& td = GetTaskDispatch();
+            for( size_t i=0; i<parts; i++ )
             {
-                pathSum.emplace( ev.CsAlloc(), PathData { 1, ev.Size() } );
+                auto paths = &partial[i];
+                const auto begin = ptr + i * PartSize;
+                const auto pend = ptr + std::min( end, ( i+1 ) * PartSize );
+                td.Queue( [paths, begin, pend, time] { AddCallstackPaths( *paths, begin, pend, time, false ); } );
             }
-            else
+            td.Sync();
+            cache.paths.swap( partial[0] );
+            for( size_t i=1; i<parts; i++ )
             {
-                it->second.cnt++;
-                it->second.mem += ev.Size();
+                for( auto& v : partial[i] )
+                {
+                    auto it = cache.paths.find( v.first );
+                    if( it == cache.paths.end() )
+                    {
+                        cache.paths.emplace( v.first, v.second );
+                    }
+                    else
+                    {
+                        it->second.cnt += v.second.cnt;
+                        it->second.mem += v.second.mem;
+                    }
+                }
             }
         }
     }
-    return pathSum;
+    return true;
+}
+
+const unordered_flat_map<uint64_t, CallstackFrameTree>& View::GetCallstackFrameTreeBottomUp( const MemData& mem )
+{
+    auto& cache = m_memPathBottomUp;
+    if( UpdateCallstackPaths( cache, mem, m_activeOnlyBottomUp ) || !cache.treeValid || cache.groupByName != m_groupCallstackTreeByNameBottomUp || cache.frameCount != m_worker.GetCallstackFrameCount() )
+    {
+        cache.tree.clear();
+        cache.groupByName = m_groupCallstackTreeByNameBottomUp;
+        cache.frameCount = m_worker.GetCallstackFrameCount();
+        cache.treeValid = true;
+        BuildCallstackFrameTreeBottomUp( cache.paths, cache.tree );
+    }
+    return cache.tree;
+}
+
+const unordered_flat_map<uint64_t, CallstackFrameTree>& View::GetCallstackFrameTreeTopDown( const MemData& mem )
+{
+    auto& cache = m_memPathTopDown;
+    if( UpdateCallstackPaths( cache, mem, m_activeOnlyTopDown ) || !cache.treeValid || cache.groupByName != m_groupCallstackTreeByNameTopDown || cache.frameCount != m_worker.GetCallstackFrameCount() )
+    {
+        cache.tree.clear();
+        cache.groupByName = m_groupCallstackTreeByNameTopDown;
+        cache.frameCount = m_worker.GetCallstackFrameCount();
+        cache.treeValid = true;
+        BuildCallstackFrameTreeTopDown( cache.paths, cache.tree );
+    }
+    return cache.tree;
 }
 
-unordered_flat_map<uint64_t, CallstackFrameTree> View::GetCallstackFrameTreeBottomUp( const MemData& mem ) const
+void View::BuildCallstackFrameTreeBottomUp( const unordered_flat_map<uint32_t, PathData>& pathSum, unordered_flat_map<uint64_t, CallstackFrameTree>& root ) const
 {
-    unordered_flat_map<uint64_t, CallstackFrameTree> root;
-    auto pathSum = GetCallstackPaths( mem, m_activeOnlyBottomUp );
     if( m_groupCallstackTreeByNameBottomUp )
     {
         for( auto& path : pathSum )
@@ -14565,13 +15073,10 @@ unordered_flat_map<uint64_t, CallstackFrameTree> View::GetCallstackFrameTreeBott
         }
     }
 
-    return root;
 }
 
-unordered_flat_map<uint64_t, CallstackFrameTree> View::GetCallstackFrameTreeTopDown( const MemData& mem ) const
+void View::BuildCallstackFrameTreeTopDown( const unordered_flat_map<uint32_t, PathData>& pathSum, unordered_flat_map<uint64_t, CallstackFrameTree>& root ) const
 {
-    unordered_flat_map<uint64_t, CallstackFrameTree> root;
-    auto pathSum = GetCallstackPaths( mem, m_activeOnlyTopDown );
     if( m_groupCallstackTreeByNameTopDown )
     {
         for( auto& path : pathSum )
@@ -14618,7 +15123,6 @@ unordered_flat_map<uint64_t, CallstackFrameTree> View::GetCallstackFrameTreeTopD
             }
         }
     }
-    return root;
 }
 
 
@@ -14887,14 +15391,8 @@ void View::DrawMemory()
         items.reserve( mem.active.size() );
         if( m_memInfo.restrictTime )
         {
-            for( auto& v : mem.data )
-            {
-                if( v.TimeAlloc() < zvMid && ( v.TimeFree() > zvMid || v.TimeFree() < 0 ) )
-                {
-                    items.emplace_back( &v );
-                    total += v.Size();
-                }
-            }
+            m_worker.GetActiveMemAllocs( zvMid, items );
+            for( auto& v : items ) total += v->Size();
         }
         else
         {
@@ -14999,7 +15497,7 @@ void View::DrawMemory()
         SmallCheckbox( "Only active allocations", &m_activeOnlyBottomUp );
 
         auto& mem = m_worker.GetMemData();
-        auto tree = GetCallstackFrameTreeBottomUp( mem );
+        const auto& tree = GetCallstackFrameTreeBottomUp( mem );
 
         if( !tree.empty() )
         {
@@ -15031,7 +15529,7 @@ void View::DrawMemory()
         SmallCheckbox( "Only active allocations", &m_activeOnlyTopDown );
 
         auto& mem = m_worker.GetMemData();
-        auto tree = GetCallstackFrameTreeTopDown( mem );
+        const auto& tree = GetCallstackFrameTreeTopDown( mem );
 
         if( !tree.empty() )
         {
@@ -16041,6 +16539,40 @@ void View::FindZonesCompare()
 }
 #endif
 
+// Limit range checkbox and the selected time range. Both enabling the limit and the "Limit to view"
+// button set the range to the current view. Returns true if the range has changed.
+bool View::DrawRangeLimit( const char* label, bool& limitRange, int64_t& rangeMin, int64_t& rangeMax )
+{
+    bool changed = false;
+    if( ImGui::Checkbox( "Limit range", &limitRange ) )
+    {
+        changed = true;
+        if( limitRange )
+        {
+            rangeMin = m_vd.zvStart;
+            rangeMax = m_vd.zvEnd;
+        }
+    }
+    if( limitRange )
+    {
+        ImGui::TextUnformatted( ICON_FA_LOCK );
+        ImGui::SameLine();
+        TextFocused( label, TimeToStringExact( rangeMin ) );
+        ImGui::SameLine();
+        TextFocused( "-", TimeToStringExact( rangeMax ) );
+        ImGui::SameLine();
+        ImGui::TextDisabled( "(%s)", TimeToString( rangeMax - rangeMin ) );
+        ImGui::SameLine();
+        if( ImGui::SmallButton( "Limit to view" ) )
+        {
+            changed = true;
+            rangeMin = m_vd.zvStart;
+            rangeMax = m_vd.zvEnd;
+        }
+    }
+    return changed;
+}
+
 void View::SmallCallstackButton( const char* name, uint32_t callstack, int& idx, bool tooltip )
 {
     bool hilite = m_callstackInfoWindow == callstack;
@@ -31,6 +31,7 @@ struct MemoryPage;
 struct QueueItem;
 class FileRead;
 class SourceView;
+class TaskDispatch;
 struct ZoneTimeData;
 
 class View
@@ -56,6 +57,29 @@ class View
         uint64_t count;
     };
 
+    enum class TimelineDrawType : uint8_t
+    {
+        Folded,
+        Zone
+    };
+
+    // Single timeline item, as selected for display by PrepareZoneLevel. Depth is one-based.
+    struct TimelineDraw
+    {
+        TimelineDrawType type;
+        uint16_t depth;
+        uint32_t num;
+        const ZoneEvent* ev;
+        int64_t rend;
+    };
+
+    struct ThreadZoneDraw
+    {
+        std::vector<TimelineDraw> list;
+        int depth;
+        bool ready;
+    };
+
 public:
     struct VisData
     {
@@ -94,6 +118,24 @@ public:
 
     void ShowSampleParents( uint64_t symAddr ) { m_sampleParents.symAddr = symAddr; m_sampleParents.sel = 0; }
 
+    // Scripted control of the view, used by the headless view benchmark.
+    enum class ScriptWindow : uint8_t
+    {
+        Messages,
+        FindZone,
+        Statistics,
+        Memory,
+        Info,
+        SlowZones
+    };
+
+    const Worker& GetWorker() const { return m_worker; }
+    void ResetUserState();
+    void SetViewRange( int64_t start, int64_t end );
+    void SetTimelineScroll( float scroll ) { m_timelineScroll = scroll; }
+    void ShowWindow( ScriptWindow window, bool show );
+    void ShowFindZone( int16_t srcloc );
+
 private:
     enum class Namespace : uint8_t
     {
@@ -116,6 +158,62 @@ private:
         uint64_t mem;
     };
 
+    // Call stack paths of allocations and the tree built from them, valid for the given parameters and
+    // for the given number of allocations and frees.
+    struct MemPathCache
+    {
+        unordered_flat_map<uint32_t, PathData> paths;
+        unordered_flat_map<uint64_t, CallstackFrameTree> tree;
+        bool valid = false;
+        bool treeValid = false;
+        bool onlyActive;
+        bool restrictTime;
+        bool groupByName;
+        uint64_t frameCount;
+        int64_t time;
+        size_t allocCount;
+        size_t freeCount;
+    };
+
+    struct SrcLocStat
+    {
+        int16_t srcloc;
+        int64_t total;
+        int64_t selfTotal;
+        uint64_t count;
+    };
+
+    struct SymbolStat
+    {
+        uint64_t symAddr;
+        uint32_t incl, excl;
+        uint32_t count;
+    };
+
+    // Filtered and sorted statistics lists, rebuilt only when one of the inputs changes.
+    struct StatCache
+    {
+        Vector<SrcLocStat> srcloc;
+        Vector<SymbolStat> symbols;
+        uint32_t slzcnt;
+        bool valid = false;
+        bool symbolsValid = false;
+        std::string filter;
+        std::string symbolFilter;
+        int sort;
+        bool self;
+        bool limitRange;
+        int64_t rangeMin, rangeMax;
+        uint64_t generation;
+        double time;
+        bool symbolSelf;
+        bool showAll;
+        bool separateInlines;
+        size_t symbolCount;
+        uint64_t symbolGeneration;
+        double symbolTime;
+    };
+
     void InitTextEditor( ImFont* font );
 
     const char* ShortenNamespace( const char* name ) const;
@@ -136,17 +234,18 @@ private:
     int DrawGhostLevel( const Vector<GhostZone>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, float yMin, float yMax, uint64_t tid );
     int SkipGhostLevel( const Vector<GhostZone>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, float yMin, float yMax, uint64_t tid );
 #endif
-    int DispatchZoneLevel( const Vector<short_ptr<ZoneEvent>>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, float yMin, float yMax, uint64_t tid );
+    int PrepareZoneLevel( const Vector<short_ptr<ZoneEvent>>& vec, const ZoneLod* lod, double pxns, int64_t nspx, int depth, std::vector<TimelineDraw>& out );
     template<typename Adapter, typename V>
-    int DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, float yMin, float yMax, uint64_t tid );
+    int PrepareZoneLevelImpl( const V& vec, const ZoneLod* lod, double pxns, int64_t nspx, int depth, std::vector<TimelineDraw>& out );
+    void DrawTimelineZones( const std::vector<TimelineDraw>& list, bool hover, double pxns, const ImVec2& wpos, int offset, float yMin, float yMax, uint64_t tid );
     template<typename Adapter, typename V>
-    int SkipZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, float yMin, float yMax, uint64_t tid );
+    int64_t MergeSmallZones( const V& vec, const ZoneLod* lod, size_t& idx, size_t endIdx, int64_t rend, int64_t mergeDist );
     int DispatchGpuZoneLevel( const Vector<short_ptr<GpuEvent>>& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, uint64_t thread, float yMin, float yMax, int64_t begin, int drift );
     template<typename Adapter, typename V>
     int DrawGpuZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, uint64_t thread, float yMin, float yMax, int64_t begin, int drift );
     template<typename Adapter, typename V>
     int SkipGpuZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, uint64_t thread, float yMin, float yMax, int64_t begin, int drift );
-    void DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLocation& srcloc, bool hover, ImDrawList* draw, const ImVec2& wpos, float w, float ty, float offset, uint8_t tid );
+    void DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLocation& srcloc, bool hover, ImDrawList* draw, const ImVec2& wpos, float w, float ty, float offset, uint16_t tid );
     int DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos, int offset, LockHighlight& highlight, float yMin, float yMax );
     int DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, float yMin, float yMax );
     void DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, const PlotItem* item, double prev, bool merged, PlotType type, PlotValueFormatting format, float PlotHeight );
@@ -154,6 +253,7 @@ private:
     int DrawCpuData( int offset, double pxns, const ImVec2& wpos, bool hover, float yMin, float yMax );
     void DrawOptions();
     void DrawMessages();
+    void DrawMessageLine( const MessageData& msg, bool hasCallstack, int idx );
     void DrawFindZone();
     void DrawStatistics();
     void DrawMemory();
@@ -168,13 +268,17 @@ private:
     void DrawCpuDataWindow();
     void DrawSelectedAnnotation();
     void DrawAnnotationList();
+    void DrawSlowZones();
     void DrawSampleParents();
 
     void ListMemData( std::vector<const MemEvent*>& vec, std::function<void(const MemEvent*)> DrawAddress, const char* id = nullptr, int64_t startTime = -1 );
 
-    unordered_flat_map<uint32_t, PathData> GetCallstackPaths( const MemData& mem, bool onlyActive ) const;
-    unordered_flat_map<uint64_t, CallstackFrameTree> GetCallstackFrameTreeBottomUp( const MemData& mem ) const;
-    unordered_flat_map<uint64_t, CallstackFrameTree> GetCallstackFrameTreeTopDown( const MemData& mem ) const;
+    bool UpdateCallstackPaths( MemPathCache& cache, const MemData& mem, bool onlyActive );
+    static void AddCallstackPaths( unordered_flat_map<uint32_t, PathData>& paths, const MemEvent* begin, const MemEvent* end, int64_t time, bool onlyActive );
+    void BuildCallstackFrameTreeBottomUp( const unordered_flat_map<uint32_t, PathData>& pathSum, unordered_flat_map<uint64_t, CallstackFrameTree>& root ) const;
+    void BuildCallstackFrameTreeTopDown( const unordered_flat_map<uint32_t, PathData>& pathSum, unordered_flat_map<uint64_t, CallstackFrameTree>& root ) const;
+    const unordered_flat_map<uint64_t, CallstackFrameTree>& GetCallstackFrameTreeBottomUp( const MemData& mem );
+    const unordered_flat_map<uint64_t, CallstackFrameTree>& GetCallstackFrameTreeTopDown( const MemData& mem );
     void DrawFrameTreeLevel( const unordered_flat_map<uint64_t, CallstackFrameTree>& tree, int& idx );
     void DrawZoneList( const Vector<short_ptr<ZoneEvent>>& zones );
 
@@ -237,6 +341,7 @@ private:
     const char* GetPlotName( const PlotData* plot ) const;
 
     void SmallCallstackButton( const char* name, uint32_t callstack, int& idx, bool tooltip = true );
+    bool DrawRangeLimit( const char* label, bool& limitRange, int64_t& rangeMin, int64_t& rangeMax );
     void DrawCallstackCalls( uint32_t callstack, uint16_t limit ) const;
     void SetViewToLastFrames();
     int64_t GetZoneChildTime( const ZoneEvent& zone );
@@ -261,6 +366,12 @@ private:
     unordered_flat_map<const void*, int> m_gpuDrift;
     unordered_flat_map<const PlotData*, PlotView> m_plotView;
     Vector<const ThreadData*> m_threadOrder;
+    std::vector<ThreadZoneDraw> m_threadZoneDraw;
+    std::unique_ptr<TaskDispatch> m_taskDispatch;
+    MemPathCache m_memPathBottomUp;
+    MemPathCache m_memPathTopDown;
+    StatCache m_statCache;
+    float m_timelineScroll = -1;
     Vector<float> m_threadDnd;
 
     tracy_force_inline VisData& Vis( const void* ptr )
@@ -273,6 +384,8 @@ private:
         return it->second;
     }
 
+    TaskDispatch& GetTaskDispatch();
+
     tracy_force_inline bool& VisibleMsgThread( uint64_t thread )
     {
         auto it = m_visibleMsgThread.find( thread );
@@ -324,6 +437,11 @@ private:
     int m_frameHover = -1;
     bool m_messagesScrollBottom;
     ImGuiTextFilter m_messageFilter;
+    Vector<uint32_t> m_msgList;
+    size_t m_prevMessages = 0;
+    const MessageData* m_prevMessagesBack = nullptr;
+    bool m_msgLimitRange = false;
+    int64_t m_msgRangeMin, m_msgRangeMax;
     bool m_showMessageImages = false;
     ImGuiTextFilter m_statisticsFilter;
     int m_visibleMessages = 0;
@@ -347,6 +465,8 @@ private:
     bool m_showPlayback = false;
     bool m_showCpuDataWindow = false;
     bool m_showAnnotationList = false;
+    bool m_showSlowZones = false;
+    uint64_t m_slowZonesThread = 0;
 
     enum class CpuDataSortBy
     {
@@ -361,6 +481,8 @@ private:
 
     int m_statSort = 0;
     bool m_statSelf = true;
+    bool m_statLimitRange = false;
+    int64_t m_statRangeMin, m_statRangeMax;
     bool m_statSampleTime = true;
     int m_statMode = 0;
     int m_statSampleLocation = 2;
@@ -445,11 +567,36 @@ private:
             int64_t time = 0;
         };
 
+        // Zones grouped by a single processing task, with groups in order of first appearance.
+        struct PartGroup
+        {
+            uint64_t gid;
+            int64_t time;
+            std::vector<short_ptr<ZoneEvent>> zones;
+        };
+
+        struct GroupPart
+        {
+            std::vector<PartGroup> groups;
+            const Worker::ZoneThreadData* end;
+        };
+
+        // Sorted zone times gathered by a single processing task.
+        struct TimePart
+        {
+            std::vector<int64_t> times;
+            int64_t total = 0;
+            int64_t tmin = std::numeric_limits<int64_t>::max();
+            int64_t tmax = std::numeric_limits<int64_t>::min();
+            const Worker::ZoneThreadData* end;
+        };
+
         bool show = false;
         bool ignoreCase = false;
         std::vector<int16_t> match;
         unordered_flat_map<uint64_t, Group> groups;
         size_t processed;
+        size_t partSize = 16 * 1024;
         uint16_t groupId;
         int selMatch = 0;
         uint64_t selGroup = Unselected;
@@ -467,6 +614,7 @@ private:
         int64_t numBins = -1;
         std::unique_ptr<int64_t[]> bins, binTime, selBin;
         Vector<int64_t> sorted, selSort;
+        std::vector<uint64_t> histCumulative;
         size_t sortedNum = 0, selSortNum, selSortActive;
         float average, selAverage;
         float median, selMedian;
@@ -555,6 +703,9 @@ private:
     } m_findZone;
 
     tracy_force_inline uint64_t GetSelectionTarget( const Worker::ZoneThreadData& ev, FindZone::GroupBy groupBy ) const;
+    void GroupFindZones( const Worker::ZoneThreadData* zptr, const Worker::ZoneThreadData* zend, FindZone::GroupPart& part, int64_t rangeMin, int64_t rangeMax );
+    void CollectFindZoneTimes( const Worker::ZoneThreadData* zptr, const Worker::ZoneThreadData* zend, FindZone::TimePart& part, int64_t rangeMin, int64_t rangeMax, uint64_t selGroup );
+    FindZone::TimePart SortFindZoneTimes( const Worker::ZoneThreadData* zbegin, const Worker::ZoneThreadData* zend, Vector<int64_t>& vec, int64_t rangeMin, int64_t rangeMax, uint64_t selGroup );
 
     struct CompVal
     {
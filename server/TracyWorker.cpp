@@ -45,16 +45,99 @@ static tracy_force_inline uint32_t UnpackFileLine( uint64_t packed, uint32_t& li
 
 
 static const uint8_t FileHeader[8] { 't', 'r', 'a', 'c', 'y', Version::Major, Version::Minor, Version::Patch };
+// Raw stream recording header, followed by the protocol version and the data received from client, as is.
+static const char RawStreamHeader[8] { 'T', 'r', 'a', 'c', 'y', 'R', 'a', 'w' };
 enum { FileHeaderMagic = 5 };
 static const int CurrentVersion = FileVersion( Version::Major, Version::Minor, Version::Patch );
 static const int MinSupportedVersion = FileVersion( 0, 5, 0 );
+static const size_t ZoneRangeIndexStep = 64;
+// Layout of the optional sample statistics file section. Zero means the section is empty.
+static const uint32_t SampleStatisticsVersion = 1;
 
 
+// Thread list stored directly in the 64-bit mask.
+class LockThreadListInline
+{
+public:
+    tracy_force_inline LockThreadListInline( LockMap& ) {}
+
+    tracy_force_inline bool Test( uint64_t list, uint16_t thread ) const { return ( list & ( uint64_t( 1 ) << thread ) ) != 0; }
+    tracy_force_inline uint64_t Set( uint64_t list, uint16_t thread ) { return list | ( uint64_t( 1 ) << thread ); }
+    tracy_force_inline uint64_t Clear( uint64_t list, uint16_t thread ) { return list & ~( uint64_t( 1 ) << thread ); }
+};
+
+// Thread list stored in the lock's wait pool. Each modification appends a new copy of the list
+// to the pool, which is then interned, so that the pool grows only with the number of distinct
+// lists and identical lists have the same offset. Empty list is always at offset 0.
+class LockThreadListPooled
+{
+public:
+    tracy_force_inline LockThreadListPooled( LockMap& lockmap ) : m_pool( lockmap.waitPool ), m_map( lockmap.waitPoolMap ), m_words( lockmap.waitWords ) {}
+
+    tracy_force_inline bool Test( uint64_t list, uint16_t thread ) const { return ( m_pool[list + thread / 64] & ( uint64_t( 1 ) << ( thread % 64 ) ) ) != 0; }
+
+    uint64_t Set( uint64_t list, uint16_t thread )
+    {
+        if( Test( list, thread ) ) return list;
+        const auto ret = Copy( list );
+        m_pool[ret + thread / 64] |= uint64_t( 1 ) << ( thread % 64 );
+        return Intern( ret );
+    }
+
+    uint64_t Clear( uint64_t list, uint16_t thread )
+    {
+        if( !Test( list, thread ) ) return list;
+        const auto ret = Copy( list );
+        m_pool[ret + thread / 64] &= ~( uint64_t( 1 ) << ( thread % 64 ) );
+        for( uint16_t i=0; i<m_words; i++ )
+        {
+            if( m_pool[ret + i] != 0 ) return Intern( ret );
+        }
+        m_pool.set_size( ret );
+        return 0;
+    }
+
+private:
+    tracy_force_inline uint64_t Copy( uint64_t list )
+    {
+        const auto ret = m_pool.size();
+        for( uint16_t i=0; i<m_words; i++ )
+        {
+            const auto v = m_pool[list + i];
+            m_pool.push_back( v );
+        }
+        return ret;
+    }
+
+    // The list must be the last one in the pool. If the same list is already stored, the copy is
+    // removed. In the unlikely case of a hash collision between different lists both are kept.
+    uint64_t Intern( uint64_t list )
+    {
+        const auto size = m_words * sizeof( uint64_t );
+        const auto hash = XXH3_64bits( m_pool.data() + list, size );
+        auto it = m_map.find( hash );
+        if( it == m_map.end() )
+        {
+            m_map.emplace( hash, list );
+            return list;
+        }
+        if( memcmp( m_pool.data() + it->second, m_pool.data() + list, size ) != 0 ) return list;
+        m_pool.set_size( list );
+        return it->second;
+    }
+
+    Vector<uint64_t>& m_pool;
+    unordered_flat_map<uint64_t, uint64_t>& m_map;
+    uint16_t m_words;
+};
+
+template<typename ThreadList>
 static void UpdateLockCountLockable( LockMap& lockmap, size_t pos )
 {
     auto& timeline = lockmap.timeline;
+    ThreadList list( lockmap );
     bool isContended = lockmap.isContended;
-    uint8_t lockingThread;
+    uint16_t lockingThread;
     uint8_t lockCount;
     uint64_t waitList;
 
@@ -75,18 +158,18 @@ static void UpdateLockCountLockable( LockMap& lockmap, size_t pos )
 
     while( pos != end )
     {
-        auto& tl = timeline[pos];
-        const auto tbit = uint64_t( 1 ) << tl.ptr->thread;
-        switch( (LockEvent::Type)tl.ptr->type )
+        auto& ev = timeline[pos];
+        const auto thread = ev.ptr->thread;
+        switch( (LockEvent::Type)ev.ptr->type )
         {
         case LockEvent::Type::Wait:
-            waitList |= tbit;
+            waitList = list.Set( waitList, thread );
             break;
         case LockEvent::Type::Obtain:
             assert( lockCount < std::numeric_limits<uint8_t>::max() );
-            assert( ( waitList & tbit ) != 0 );
-            waitList &= ~tbit;
-            lockingThread = tl.ptr->thread;
+            assert( list.Test( waitList, thread ) );
+            waitList = list.Clear( waitList, thread );
+            lockingThread = thread;
             lockCount++;
             break;
         case LockEvent::Type::Release:
@@ -96,9 +179,9 @@ static void UpdateLockCountLockable( LockMap& lockmap, size_t pos )
         default:
             break;
         }
-        tl.lockingThread = lockingThread;
-        tl.waitList = waitList;
-        tl.lockCount = lockCount;
+        ev.lockingThread = lockingThread;
+        ev.waitList = waitList;
+        ev.lockCount = lockCount;
         if( !isContended ) isContended = lockCount != 0 && waitList != 0;
         pos++;
     }
@@ -106,11 +189,13 @@ static void UpdateLockCountLockable( LockMap& lockmap, size_t pos )
     lockmap.isContended = isContended;
 }
 
+template<typename ThreadList>
 static void UpdateLockCountSharedLockable( LockMap& lockmap, size_t pos )
 {
     auto& timeline = lockmap.timeline;
+    ThreadList list( lockmap );
     bool isContended = lockmap.isContended;
-    uint8_t lockingThread;
+    uint16_t lockingThread;
     uint8_t lockCount;
     uint64_t waitShared;
     uint64_t waitList;
@@ -140,22 +225,22 @@ static void UpdateLockCountSharedLockable( LockMap& lockmap, size_t pos )
     // due to the async retrieval of data from threads that's not possible.
     while( pos != end )
     {
-        auto& tl = timeline[pos];
-        const auto tlp = (LockEventShared*)(LockEvent*)tl.ptr;
-        const auto tbit = uint64_t( 1 ) << tlp->thread;
-        switch( (LockEvent::Type)tlp->type )
+        auto& ev = timeline[pos];
+        const auto evp = (LockEventShared*)(LockEvent*)ev.ptr;
+        const auto thread = evp->thread;
+        switch( (LockEvent::Type)evp->type )
         {
         case LockEvent::Type::Wait:
-            waitList |= tbit;
+            waitList = list.Set( waitList, thread );
             break;
         case LockEvent::Type::WaitShared:
-            waitShared |= tbit;
+            waitShared = list.Set( waitShared, thread );
             break;
         case LockEvent::Type::Obtain:
             assert( lockCount < std::numeric_limits<uint8_t>::max() );
-            assert( ( waitList & tbit ) != 0 );
-            waitList &= ~tbit;
-            lockingThread = tlp->thread;
+            assert( list.Test( waitList, thread ) );
+            waitList = list.Clear( waitList, thread );
+            lockingThread = thread;
             lockCount++;
             break;
         case LockEvent::Type::Release:
@@ -163,23 +248,23 @@ static void UpdateLockCountSharedLockable( LockMap& lockmap, size_t pos )
             lockCount--;
             break;
         case LockEvent::Type::ObtainShared:
-            assert( ( waitShared & tbit ) != 0 );
-            assert( ( sharedList & tbit ) == 0 );
-            waitShared &= ~tbit;
-            sharedList |= tbit;
+            assert( list.Test( waitShared, thread ) );
+            assert( !list.Test( sharedList, thread ) );
+            waitShared = list.Clear( waitShared, thread );
+            sharedList = list.Set( sharedList, thread );
             break;
         case LockEvent::Type::ReleaseShared:
-            assert( ( sharedList & tbit ) != 0 );
-            sharedList &= ~tbit;
+            assert( list.Test( sharedList, thread ) );
+            sharedList = list.Clear( sharedList, thread );
             break;
         default:
             break;
         }
-        tl.lockingThread = lockingThread;
-        tlp->waitShared = waitShared;
-        tl.waitList = waitList;
-        tlp->sharedList = sharedList;
-        tl.lockCount = lockCount;
+        ev.lockingThread = lockingThread;
+        evp->waitShared = waitShared;
+        ev.waitList = waitList;
+        evp->sharedList = sharedList;
+        ev.lockCount = lockCount;
         if( !isContended ) isContended = ( lockCount != 0 && ( waitList != 0 || waitShared != 0 ) ) || ( sharedList != 0 && waitList != 0 );
         pos++;
     }
@@ -189,16 +274,48 @@ static void UpdateLockCountSharedLockable( LockMap& lockmap, size_t pos )
 
 static inline void UpdateLockCount( LockMap& lockmap, size_t pos )
 {
-    if( lockmap.type == LockType::Lockable )
+    if( lockmap.waitWords == 0 )
     {
-        UpdateLockCountLockable( lockmap, pos );
+        if( lockmap.type == LockType::Lockable )
+        {
+            UpdateLockCountLockable<LockThreadListInline>( lockmap, pos );
+        }
+        else
+        {
+            UpdateLockCountSharedLockable<LockThreadListInline>( lockmap, pos );
+        }
     }
     else
     {
-        UpdateLockCountSharedLockable( lockmap, pos );
+        if( lockmap.type == LockType::Lockable )
+        {
+            UpdateLockCountLockable<LockThreadListPooled>( lockmap, pos );
+        }
+        else
+        {
+            UpdateLockCountSharedLockable<LockThreadListPooled>( lockmap, pos );
+        }
     }
 }
 
+// Returns true if the thread list representation has changed and the lock counts have to be
+// recalculated from the beginning of the timeline.
+static bool UpdateLockThreadListSize( LockMap& lockmap )
+{
+    const auto threads = lockmap.threadList.size();
+    if( lockmap.range.size() < threads ) lockmap.range.resize( threads );
+    if( threads <= std::max<size_t>( 1, lockmap.waitWords ) * LockInlineThreads ) return false;
+
+    uint16_t words = std::max<uint16_t>( 2, lockmap.waitWords );
+    while( words * LockInlineThreads < threads ) words *= 2;
+    lockmap.waitWords = words;
+    lockmap.waitPool.clear();
+    for( uint16_t i=0; i<words; i++ ) lockmap.waitPool.push_back( 0 );
+    lockmap.waitPoolMap.clear();
+    lockmap.isContended = false;
+    return true;
+}
+
 static tracy_force_inline void WriteTimeOffset( FileWrite& f, int64_t& refTime, int64_t time )
 {
     int64_t timeOffset = time - refTime;
@@ -221,11 +338,51 @@ static tracy_force_inline void UpdateLockRange( LockMap& lockmap, const LockEven
     if( range.end < lt ) range.end = lt;
 }
 
+// Records time, uncompressed data size and memory usage change of consecutive trace file sections.
+template<typename GetBytes>
+class FileSectionTimer
+{
+public:
+    FileSectionTimer( std::vector<FileSectionStats>& stats, GetBytes getBytes )
+        : m_stats( stats )
+        , m_getBytes( getBytes )
+        , m_name( nullptr )
+    {
+        m_stats.clear();
+    }
+
+    void Next( const char* name )
+    {
+        End();
+        m_name = name;
+        m_bytes = m_getBytes();
+        m_memory = memUsage;
+        m_start = std::chrono::high_resolution_clock::now();
+    }
+
+    void End()
+    {
+        if( !m_name ) return;
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - m_start ).count();
+        m_stats.emplace_back( FileSectionStats { m_name, time, m_getBytes() - m_bytes, int64_t( memUsage ) - int64_t( m_memory ) } );
+        m_name = nullptr;
+    }
+
+private:
+    std::vector<FileSectionStats>& m_stats;
+    GetBytes m_getBytes;
+    const char* m_name;
+    uint64_t m_bytes;
+    size_t m_memory;
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_start;
+};
+
 LoadProgress Worker::s_loadProgress;
 
-Worker::Worker( const char* addr, int port )
+Worker::Worker( const char* addr, int port, FILE* rawStream )
     : m_addr( addr )
     , m_port( port )
+    , m_rawStream( rawStream )
     , m_hasData( false )
     , m_stream( LZ4_createStreamDecode() )
     , m_buffer( new char[TargetFrameSize*3 + 1] )
@@ -255,11 +412,66 @@ Worker::Worker( const char* addr, int port )
     m_data.ctxUsageReady = true;
 #endif
 
+    if( m_rawStream )
+    {
+        const uint32_t protocolVersion = ProtocolVersion;
+        fwrite( RawStreamHeader, 1, sizeof( RawStreamHeader ), m_rawStream );
+        fwrite( &protocolVersion, 1, sizeof( protocolVersion ), m_rawStream );
+    }
+
     m_thread = std::thread( [this] { SetThreadName( "Tracy Worker" ); Exec(); } );
     m_threadNet = std::thread( [this] { SetThreadName( "Tracy Network" ); Network(); } );
 }
 
-Worker::Worker( const std::string& program, const std::vector<ImportEventTimeline>& timeline, const std::vector<ImportEventMessages>& messages )
+Worker::Worker( const RawStreamReplay& replay )
+    : m_port( 0 )
+    , m_replayPtr( replay.data + sizeof( RawStreamHeader ) + sizeof( uint32_t ) )
+    , m_replayEnd( replay.data + replay.size )
+    , m_queueTypeStatsEnabled( replay.queueTypeStats )
+    , m_hasData( false )
+    , m_stream( nullptr )
+    , m_buffer( nullptr )
+    , m_bufferOffset( 0 )
+    , m_pendingStrings( 0 )
+    , m_pendingThreads( 0 )
+    , m_pendingExternalNames( 0 )
+    , m_pendingSourceLocation( 0 )
+    , m_pendingCallstackFrames( 0 )
+    , m_pendingCallstackSubframes( 0 )
+    , m_pendingCodeInformation( 0 )
+    , m_callstackFrameStaging( nullptr )
+    , m_traceVersion( CurrentVersion )
+    , m_loadTime( 0 )
+{
+    // The destructor is not run if the constructor throws, so the stream buffers are allocated after the header
+    // is validated.
+    if( replay.size < sizeof( RawStreamHeader ) + sizeof( uint32_t ) || memcmp( replay.data, RawStreamHeader, sizeof( RawStreamHeader ) ) != 0 ) throw NotTracyDump();
+    uint32_t protocolVersion;
+    memcpy( &protocolVersion, replay.data + sizeof( RawStreamHeader ), sizeof( protocolVersion ) );
+    if( protocolVersion != ProtocolVersion ) throw UnsupportedVersion( protocolVersion );
+
+    m_stream = LZ4_createStreamDecode();
+    m_buffer = new char[TargetFrameSize*3 + 1];
+
+    m_data.sourceLocationExpand.push_back( 0 );
+    m_data.localThreadCompress.InitZero();
+    m_data.callstackPayload.push_back( nullptr );
+    m_data.zoneExtra.push_back( ZoneExtra {} );
+
+    memset( m_gpuCtxMap, 0, sizeof( m_gpuCtxMap ) );
+
+#ifndef TRACY_NO_STATISTICS
+    m_data.sourceLocationZonesReady = true;
+    m_data.callstackSamplesReady = true;
+    m_data.ghostZonesReady = true;
+    m_data.ctxUsageReady = true;
+#endif
+
+    m_thread = std::thread( [this] { SetThreadName( "Tracy Worker" ); Exec(); } );
+    m_threadNet = std::thread( [this] { SetThreadName( "Tracy Network" ); Network(); } );
+}
+
+Worker::Worker( const std::string& program )
     : m_hasData( true )
     , m_delay( 0 )
     , m_resolution( 0 )
@@ -277,95 +489,97 @@ Worker::Worker( const std::string& program, const std::vector<ImportEventTimelin
     m_data.zoneExtra.push_back( ZoneExtra {} );
 
     m_data.lastTime = 0;
-    if( !timeline.empty() )
-    {
-        m_data.lastTime = timeline.back().timestamp;
-    }
-    if( !messages.empty() )
-    {
-        if( m_data.lastTime < (int64_t)messages.back().timestamp ) m_data.lastTime = messages.back().timestamp;
-    }
+}
 
-    for( auto& v : timeline )
-    {
-        if( !v.isEnd )
-        {
-            SourceLocation srcloc {
-                StringRef(),
-                StringRef( StringRef::Idx, StoreString( v.name.c_str(), v.name.size() ).idx ),
-                StringRef(),
-                0,
-                0
-            };
-            int key;
-            auto it = m_data.sourceLocationPayloadMap.find( &srcloc );
-            if( it == m_data.sourceLocationPayloadMap.end() )
-            {
-                auto slptr = m_slab.Alloc<SourceLocation>();
-                memcpy( slptr, &srcloc, sizeof( srcloc ) );
-                uint32_t idx = m_data.sourceLocationPayload.size();
-                m_data.sourceLocationPayloadMap.emplace( slptr, idx );
-                m_data.sourceLocationPayload.push_back( slptr );
-                key = -int16_t( idx + 1 );
+int16_t Worker::ImportSourceLocation( const char* name, size_t sz )
+{
+    SourceLocation srcloc {
+        StringRef(),
+        StringRef( StringRef::Idx, StoreString( name, sz ).idx ),
+        StringRef(),
+        0,
+        0
+    };
+    auto it = m_data.sourceLocationPayloadMap.find( &srcloc );
+    if( it != m_data.sourceLocationPayloadMap.end() ) return -int16_t( it->second + 1 );
+
+    auto slptr = m_slab.Alloc<SourceLocation>();
+    memcpy( slptr, &srcloc, sizeof( srcloc ) );
+    uint32_t idx = m_data.sourceLocationPayload.size();
+    m_data.sourceLocationPayloadMap.emplace( slptr, idx );
+    m_data.sourceLocationPayload.push_back( slptr );
+    const auto key = -int16_t( idx + 1 );
 #ifndef TRACY_NO_STATISTICS
-                auto res = m_data.sourceLocationZones.emplace( key, SourceLocationZones() );
-                m_data.srclocZonesLast.first = key;
-                m_data.srclocZonesLast.second = &res.first->second;
-
+    auto res = m_data.sourceLocationZones.emplace( key, SourceLocationZones() );
+    m_data.srclocZonesLast.first = key;
+    m_data.srclocZonesLast.second = &res.first->second;
 #else
-                auto res = m_data.sourceLocationZonesCnt.emplace( key, 0 );
-                m_data.srclocCntLast.first = key;
-                m_data.srclocCntLast.second = &res.first->second;
+    auto res = m_data.sourceLocationZonesCnt.emplace( key, 0 );
+    m_data.srclocCntLast.first = key;
+    m_data.srclocCntLast.second = &res.first->second;
 #endif
-            }
-            else
-            {
-                key = -int16_t( it->second + 1 );
-            }
+    return key;
+}
 
-            auto zone = AllocZoneEvent();
-            zone->SetStartSrcLoc( v.timestamp, key );
-            zone->SetEnd( -1 );
-            zone->SetChild( -1 );
+void Worker::ImportZoneBegin( uint64_t tid, int64_t time, int16_t srcloc, const char* text, size_t sz )
+{
+    if( m_data.lastTime < time ) m_data.lastTime = time;
 
-            if( !v.text.empty() )
-            {
-                auto& extra = RequestZoneExtra( *zone );
-                extra.text = StringIdx( StoreString( v.text.c_str(), v.text.size() ).idx );
-            }
+    auto zone = AllocZoneEvent();
+    zone->SetStartSrcLoc( time, srcloc );
+    zone->SetEnd( -1 );
+    zone->SetChild( -1 );
 
-            m_threadCtxData = NoticeThread( v.tid );
-            NewZone( zone, v.tid );
-        }
-        else
-        {
-            auto td = NoticeThread( v.tid );
-            td->zoneIdStack.pop_back();
-            auto& stack = td->stack;
-            auto zone = stack.back_and_pop();
-            zone->SetEnd( v.timestamp );
+    if( sz != 0 )
+    {
+        auto& extra = RequestZoneExtra( *zone );
+        extra.text = StringIdx( StoreString( text, sz ).idx );
+    }
+
+    m_threadCtxData = NoticeThread( tid );
+    NewZone( zone, tid );
+}
+
+void Worker::ImportZoneEnd( uint64_t tid, int64_t time )
+{
+    auto td = NoticeThread( tid );
+    if( td->stack.empty() ) return;
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    td->zoneIdStack.pop_back();
+    auto zone = td->stack.back_and_pop();
+    zone->SetEnd( time );
 
 #ifndef TRACY_NO_STATISTICS
-            auto slz = GetSourceLocationZones( zone->SrcLoc() );
-            auto& ztd = slz->zones.push_next();
-            ztd.SetZone( zone );
-            ztd.SetThread( CompressThread( v.tid ) );
+    auto slz = GetSourceLocationZones( zone->SrcLoc() );
+    auto& ztd = slz->zones.push_next();
+    ztd.SetZone( zone );
+    ztd.SetThread( CompressThread( tid ) );
+    AddSlowZone( td->slowZones, zone );
 #else
-            CountZoneStatistics( zone );
+    CountZoneStatistics( zone );
 #endif
-        }
-    }
+}
 
-    for( auto& v : messages )
-    {
-        auto msg = m_slab.Alloc<MessageData>();
-        msg->time = v.timestamp;
-        msg->ref = StringRef( StringRef::Type::Idx, StoreString( v.message.c_str(), v.message.size() ).idx );
-        msg->thread = CompressThread( v.tid );
-        msg->color = 0xFFFFFFFF;
-        msg->callstack.SetVal( 0 );
-        InsertMessageData( msg );
-    }
+void Worker::ImportMessage( uint64_t tid, int64_t time, const char* text, size_t sz )
+{
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    auto msg = m_slab.Alloc<MessageData>();
+    msg->time = time;
+    msg->ref = StringRef( StringRef::Type::Idx, StoreString( text, sz ).idx );
+    msg->thread = CompressThread( tid );
+    msg->color = 0xFFFFFFFF;
+    msg->callstack.SetVal( 0 );
+
+    // Threads are imported one after another, the global message list is sorted in ImportFinish().
+    m_data.messages.push_back( msg );
+    NoticeThread( tid )->messages.push_back( msg );
+}
+
+void Worker::ImportFinish()
+{
+    pdqsort_branchless( m_data.messages.begin(), m_data.messages.end(), [] ( const auto& l, const auto& r ) { return l->time < r->time; } );
 
     for( auto& t : m_threadMap )
     {
@@ -395,6 +609,8 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
     , m_buffer( nullptr )
 {
     auto loadStart = std::chrono::high_resolution_clock::now();
+    FileSectionTimer sections( m_loadSections, [&f] { return f.GetBytesRead(); } );
+    sections.Next( "Header" );
 
     m_data.callstackPayload.push_back( nullptr );
 
@@ -523,6 +739,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
 
     f.Read( &m_data.crashEvent, sizeof( m_data.crashEvent ) );
 
+    sections.Next( "Frames" );
     f.Read( sz );
     m_data.frames.Data().reserve_exact( sz, m_slab );
     for( uint64_t i=0; i<sz; i++ )
@@ -591,6 +808,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    sections.Next( "Strings" );
     unordered_flat_map<uint64_t, const char*> pointerMap;
 
     f.Read( sz );
@@ -654,6 +872,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         m_data.externalThreadCompress.Load( f, fileVer );
     }
 
+    sections.Next( "Source locations" );
     f.Read( sz );
     for( uint64_t i=0; i<sz; i++ )
     {
@@ -733,6 +952,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
     }
 #endif
 
+    sections.Next( "Locks" );
     s_loadProgress.progress.store( LoadProgress::Locks, std::memory_order_relaxed );
     f.Read( sz );
     if( eventMask & EventType::Locks )
@@ -783,6 +1003,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 lockmap.threadMap.emplace( t, i );
                 lockmap.threadList.emplace_back( t );
             }
+            UpdateLockThreadListSize( lockmap );
             f.Read( tsz );
             lockmap.timeline.reserve_exact( tsz, m_slab );
             auto ptr = lockmap.timeline.data();
@@ -799,7 +1020,18 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                         int16_t srcloc;
                         f.Read( srcloc );
                         lev->SetSrcLoc( srcloc );
-                        f.Read( &lev->thread, sizeof( LockEvent::thread ) + sizeof( LockEvent::type ) );
+                        if( fileVer >= FileVersion( 0, 6, 13 ) )
+                        {
+                            uint16_t thread;
+                            f.Read2( thread, lev->type );
+                            lev->thread = thread;
+                        }
+                        else
+                        {
+                            uint8_t thread;
+                            f.Read2( thread, lev->type );
+                            lev->thread = thread;
+                        }
                         *ptr++ = { lev };
                         UpdateLockRange( lockmap, *lev, lt );
                     }
@@ -814,7 +1046,18 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                         int16_t srcloc;
                         f.Read( srcloc );
                         lev->SetSrcLoc( srcloc );
-                        f.Read( &lev->thread, sizeof( LockEventShared::thread ) + sizeof( LockEventShared::type ) );
+                        if( fileVer >= FileVersion( 0, 6, 13 ) )
+                        {
+                            uint16_t thread;
+                            f.Read2( thread, lev->type );
+                            lev->thread = thread;
+                        }
+                        else
+                        {
+                            uint8_t thread;
+                            f.Read2( thread, lev->type );
+                            lev->thread = thread;
+                        }
                         *ptr++ = { lev };
                         UpdateLockRange( lockmap, *lev, lt );
                     }
@@ -833,7 +1076,9 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                         int32_t srcloc;
                         f.Read( srcloc );
                         lev->SetSrcLoc( int16_t( srcloc ) );
-                        f.Read( &lev->thread, sizeof( LockEvent::thread ) + sizeof( LockEvent::type ) );
+                        uint8_t thread;
+                        f.Read2( thread, lev->type );
+                        lev->thread = thread;
                         *ptr++ = { lev };
                         UpdateLockRange( lockmap, *lev, lt );
                     }
@@ -848,7 +1093,9 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                         int32_t srcloc;
                         f.Read( srcloc );
                         lev->SetSrcLoc( int16_t( srcloc ) );
-                        f.Read( &lev->thread, sizeof( LockEventShared::thread ) + sizeof( LockEventShared::type ) );
+                        uint8_t thread;
+                        f.Read2( thread, lev->type );
+                        lev->thread = thread;
                         *ptr++ = { lev };
                         UpdateLockRange( lockmap, *lev, lt );
                     }
@@ -881,17 +1128,22 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
             f.Read( tsz );
             f.Skip( tsz * sizeof( uint64_t ) );
             f.Read( tsz );
-            if( fileVer >= FileVersion( 0, 5, 2 ) )
+            if( fileVer >= FileVersion( 0, 6, 13 ) )
             {
                 f.Skip( tsz * ( sizeof( int64_t ) + sizeof( int16_t ) + sizeof( LockEvent::thread ) + sizeof( LockEvent::type ) ) );
             }
+            else if( fileVer >= FileVersion( 0, 5, 2 ) )
+            {
+                f.Skip( tsz * ( sizeof( int64_t ) + sizeof( int16_t ) + sizeof( uint8_t ) + sizeof( LockEvent::type ) ) );
+            }
             else
             {
-                f.Skip( tsz * ( sizeof( int64_t ) + sizeof( int32_t ) + sizeof( LockEvent::thread ) + sizeof( LockEvent::type ) ) );
+                f.Skip( tsz * ( sizeof( int64_t ) + sizeof( int32_t ) + sizeof( uint8_t ) + sizeof( LockEvent::type ) ) );
             }
         }
     }
 
+    sections.Next( "Messages" );
     s_loadProgress.subTotal.store( 0, std::memory_order_relaxed );
     s_loadProgress.progress.store( LoadProgress::Messages, std::memory_order_relaxed );
     unordered_flat_map<uint64_t, MessageData*> msgMap;
@@ -956,6 +1208,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    sections.Next( "Zones" );
     if( fileVer >= FileVersion( 0, 6, 3 ) )
     {
         f.Read( sz );
@@ -1055,6 +1308,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         m_threadMap.emplace( tid, td );
     }
 
+    sections.Next( "GPU zones" );
     s_loadProgress.progress.store( LoadProgress::GpuZones, std::memory_order_relaxed );
     f.Read( sz );
     s_loadProgress.subTotal.store( sz, std::memory_order_relaxed );
@@ -1122,6 +1376,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         m_data.gpuData[i] = ctx;
     }
 
+    sections.Next( "Plots" );
     s_loadProgress.progress.store( LoadProgress::Plots, std::memory_order_relaxed );
     f.Read( sz );
     if( eventMask & EventType::Plots )
@@ -1180,6 +1435,9 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                     f.Read( pd->data[j].val );
                 }
             }
+#ifndef TRACY_NO_STATISTICS
+            BuildPlotLod( pd );
+#endif
             m_data.plots.Data().push_back_no_space_check( pd );
         }
     }
@@ -1203,6 +1461,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
 
     bool reconstructMemAllocPlot = false;
 
+    sections.Next( "Memory" );
     s_loadProgress.subTotal.store( 0, std::memory_order_relaxed );
     s_loadProgress.progress.store( LoadProgress::Memory, std::memory_order_relaxed );
     f.Read( sz );
@@ -1351,6 +1610,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         f.Skip( sizeof( MemData::high ) + sizeof( MemData::low ) + sizeof( MemData::usage ) );
     }
 
+    sections.Next( "Call stacks" );
     s_loadProgress.subTotal.store( 0, std::memory_order_relaxed );
     s_loadProgress.progress.store( LoadProgress::CallStacks, std::memory_order_relaxed );
     f.Read( sz );
@@ -1463,6 +1723,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         f.Read( m_data.appInfo.data(), sizeof( m_data.appInfo[0] ) * sz );
     }
 
+    sections.Next( "Frame images" );
     s_loadProgress.subTotal.store( 0, std::memory_order_relaxed );
     s_loadProgress.progress.store( LoadProgress::FrameImages, std::memory_order_relaxed );
 
@@ -1579,6 +1840,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    sections.Next( "Context switches" );
     if( fileVer >= FileVersion( 0, 5, 6 ) )
     {
         s_loadProgress.subTotal.store( 0, std::memory_order_relaxed );
@@ -1602,9 +1864,18 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 for( uint64_t j=0; j<csz; j++ )
                 {
                     int64_t deltaWakeup, deltaStart, diff;
-                    uint8_t cpu;
+                    uint16_t cpu;
                     int8_t reason, state;
-                    f.Read6( deltaWakeup, deltaStart, diff, cpu, reason, state );
+                    if( fileVer >= FileVersion( 0, 6, 13 ) )
+                    {
+                        f.Read6( deltaWakeup, deltaStart, diff, cpu, reason, state );
+                    }
+                    else
+                    {
+                        uint8_t cpu8;
+                        f.Read6( deltaWakeup, deltaStart, diff, cpu8, reason, state );
+                        cpu = cpu8;
+                    }
                     refTime += deltaWakeup;
                     ptr->SetWakeup( refTime );
                     refTime += deltaStart;
@@ -1628,7 +1899,14 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 f.Skip( sizeof( uint64_t ) );
                 uint64_t csz;
                 f.Read( csz );
-                f.Skip( csz * ( sizeof( int64_t ) * 3 + sizeof( int8_t ) * 3 ) );
+                if( fileVer >= FileVersion( 0, 6, 13 ) )
+                {
+                    f.Skip( csz * ( sizeof( int64_t ) * 3 + sizeof( uint16_t ) + sizeof( int8_t ) * 2 ) );
+                }
+                else
+                {
+                    f.Skip( csz * ( sizeof( int64_t ) * 3 + sizeof( int8_t ) * 3 ) );
+                }
             }
         }
 
@@ -1636,16 +1914,21 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         s_loadProgress.progress.store( LoadProgress::ContextSwitchesPerCpu, std::memory_order_relaxed );
         f.Read( sz );
         s_loadProgress.subTotal.store( sz, std::memory_order_relaxed );
+        uint64_t cpuCount = 256;
+        if( fileVer >= FileVersion( 0, 6, 13 ) )
+        {
+            f.Read( cpuCount );
+        }
         if( eventMask & EventType::ContextSwitches )
         {
             uint64_t cnt = 0;
-            for( int i=0; i<256; i++ )
+            for( uint64_t i=0; i<cpuCount; i++ )
             {
                 int64_t refTime = 0;
                 f.Read( sz );
                 if( sz != 0 )
                 {
-                    m_data.cpuDataCount = i+1;
+                    while( m_data.cpuData.size() <= i ) m_data.cpuData.push_next();
                     m_data.cpuData[i].cs.reserve_exact( sz, m_slab );
                     auto ptr = m_data.cpuData[i].cs.data();
                     for( uint64_t j=0; j<sz; j++ )
@@ -1666,7 +1949,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
         else
         {
-            for( int i=0; i<256; i++ )
+            for( uint64_t i=0; i<cpuCount; i++ )
             {
                 f.Read( sz );
                 f.Skip( sz * ( sizeof( int64_t ) * 2 + sizeof( uint16_t ) ) );
@@ -1691,6 +1974,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    sections.Next( "Symbols" );
     if( fileVer >= FileVersion( 0, 6, 7 ) )
     {
         if( fileVer >= FileVersion( 0, 6, 11 ) )
@@ -1836,6 +2120,32 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    sections.Next( "Sample statistics" );
+    if( fileVer >= FileVersion( 0, 6, 13 ) )
+    {
+        // Statistics computed from call stack samples are optional. Older files, files saved before the
+        // statistics were ready and unknown section layouts are handled by recalculating the data.
+        uint32_t statsVer;
+        f.Read( statsVer );
+        if( statsVer != 0 )
+        {
+            uint64_t statsSize;
+            f.Read( statsSize );
+#ifndef TRACY_NO_STATISTICS
+            if( statsVer == SampleStatisticsVersion && ( eventMask & EventType::Samples ) )
+            {
+                ReadSampleStatistics( f );
+            }
+            else
+#endif
+            {
+                f.Skip( statsSize );
+            }
+        }
+    }
+
+    sections.End();
+
     s_loadProgress.total.store( 0, std::memory_order_relaxed );
     m_loadTime = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - loadStart ).count();
 
@@ -1860,81 +2170,246 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 jobs.emplace_back( std::thread( [this] { ReconstructMemAllocPlot(); } ) );
             }
 
-            std::function<void(Vector<short_ptr<ZoneEvent>>&, uint16_t)> ProcessTimeline;
-            ProcessTimeline = [this, &ProcessTimeline] ( Vector<short_ptr<ZoneEvent>>& _vec, uint16_t thread )
-            {
+            jobs.emplace_back( std::thread( [this] {
+                std::function<void(Vector<short_ptr<ZoneEvent>>&, uint16_t, SourceLocationZonesMap&, Vector<short_ptr<ZoneEvent>>&)> ProcessTimeline;
+                ProcessTimeline = [this, &ProcessTimeline] ( Vector<short_ptr<ZoneEvent>>& _vec, uint16_t thread, SourceLocationZonesMap& slzMap, Vector<short_ptr<ZoneEvent>>& slowZones )
+                {
+                    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+                    assert( _vec.is_magic() );
+                    auto& vec = *(Vector<ZoneEvent>*)( &_vec );
+                    for( auto& zone : vec )
+                    {
+                        if( zone.IsEndValid() )
+                        {
+                            ReconstructZoneStatistics( slzMap, zone, thread );
+                            AddSlowZone( slowZones, &zone );
+                        }
+                        if( zone.HasChildren() ) ProcessTimeline( GetZoneChildrenMutable( zone.Child() ), thread, slzMap, slowZones );
+                    }
+                };
+
+                // Each thread timeline is processed into its own partial map, which are merged afterwards.
+                const auto workers = std::max<int>( std::thread::hardware_concurrency() - 1, 1 );
+                auto td = std::make_unique<TaskDispatch>( workers );
+                std::vector<SourceLocationZonesMap> partial( m_data.threads.size() );
+                std::vector<Vector<short_ptr<ZoneEvent>>> slowZones( m_data.threads.size() );
+                for( size_t i=0; i<m_data.threads.size(); i++ )
+                {
+                    auto t = m_data.threads[i];
+                    if( !t->timeline.empty() )
+                    {
+                        // Don't touch thread compression cache in a thread.
+                        const auto thread = m_data.localThreadCompress.DecompressMustRaw( t->id );
+                        auto slzMap = &partial[i];
+                        auto slow = &slowZones[i];
+                        td->Queue( [t, thread, slzMap, slow, &ProcessTimeline] { ProcessTimeline( t->timeline, thread, *slzMap, *slow ); } );
+                    }
+                }
+                td->Sync();
                 if( m_shutdown.load( std::memory_order_relaxed ) ) return;
-                assert( _vec.is_magic() );
-                auto& vec = *(Vector<ZoneEvent>*)( &_vec );
-                for( auto& zone : vec )
+
+                for( auto& part : partial )
                 {
-                    if( zone.IsEndValid() ) ReconstructZoneStatistics( zone, thread );
-                    if( zone.HasChildren() ) ProcessTimeline( GetZoneChildrenMutable( zone.Child() ), thread );
+                    for( auto& v : part )
+                    {
+                        auto it = m_data.sourceLocationZones.find( v.first );
+                        assert( it != m_data.sourceLocationZones.end() );
+                        MergeSourceLocationZones( it->second, v.second );
+                    }
+                    SourceLocationZonesMap().swap( part );
                 }
-            };
 
-            jobs.emplace_back( std::thread( [this, ProcessTimeline] {
-                for( auto& t : m_data.threads )
+                for( auto& v : m_data.sourceLocationZones )
                 {
-                    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
-                    if( !t->timeline.empty() )
+                    auto slz = &v.second;
+                    if( slz->zones.size() < 1024*1024 )
                     {
-                        // Don't touch thread compression cache in a thread.
-                        ProcessTimeline( t->timeline, m_data.localThreadCompress.DecompressMustRaw( t->id ) );
+                        td->Queue( [this, slz] {
+                            if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+                            pdqsort_branchless( slz->zones.begin(), slz->zones.end(), []( const auto& lhs, const auto& rhs ) { return lhs.Zone()->Start() < rhs.Zone()->Start(); } );
+                            BuildZoneRangeIndex( *slz );
+                        } );
                     }
+                    else
+                    {
+                        if( m_shutdown.load( std::memory_order_relaxed ) ) break;
+                        auto& zones = slz->zones;
+#ifdef NO_PARALLEL_SORT
+                        pdqsort_branchless( zones.begin(), zones.end(), []( const auto& lhs, const auto& rhs ) { return lhs.Zone()->Start() < rhs.Zone()->Start(); } );
+#else
+                        std::sort( std::execution::par_unseq, zones.begin(), zones.end(), []( const auto& lhs, const auto& rhs ) { return lhs.Zone()->Start() < rhs.Zone()->Start(); } );
+#endif
+                        BuildZoneRangeIndex( *slz );
+                    }
+                }
+                td->Sync();
+                if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+
+                std::lock_guard<std::shared_mutex> lock( m_data.lock );
+                for( size_t i=0; i<m_data.threads.size(); i++ )
+                {
+                    m_data.threads[i]->slowZones = std::move( slowZones[i] );
+                }
+                m_data.sourceLocationZonesReady = true;
+            } ) );
+
+            jobs.emplace_back( std::thread( [this] {
+                // Zone trees of each thread are processed into separate maps, which are merged afterwards.
+                const auto workers = std::max<int>( std::thread::hardware_concurrency() - 1, 1 );
+                auto td = std::make_unique<TaskDispatch>( workers );
+                const auto numThreads = m_data.threads.size();
+                std::vector<ZoneLod> timelineLod( numThreads );
+                std::vector<unordered_flat_map<int32_t, ZoneLod>> childrenLod( numThreads );
+                for( size_t i=0; i<numThreads; i++ )
+                {
+                    auto t = m_data.threads[i];
+                    if( t->timeline.empty() ) continue;
+                    auto tlod = &timelineLod[i];
+                    auto clod = &childrenLod[i];
+                    td->Queue( [this, t, tlod, clod] {
+                        if( t->timeline.size() >= ZoneLodMinSize ) UpdateZoneLod( *tlod, t->timeline );
+                        BuildZoneLod( t->timeline, *clod );
+                    } );
+                }
+                td->Sync();
+                td.reset();
+                if( m_shutdown.load( std::memory_order_relaxed ) )
+                {
+                    for( auto& v : timelineLod ) DestroyZoneLod( v );
+                    for( auto& part : childrenLod ) for( auto& v : part ) DestroyZoneLod( v.second );
+                    return;
+                }
+
+                std::lock_guard<std::shared_mutex> lock( m_data.lock );
+                for( size_t i=0; i<numThreads; i++ )
+                {
+                    m_data.threads[i]->timelineLod = std::move( timelineLod[i] );
+                    for( auto& v : childrenLod[i] ) m_data.zoneChildrenLod.emplace( v.first, std::move( v.second ) );
                 }
             } ) );
 
-            if( eventMask & EventType::Samples )
+            if( ( eventMask & EventType::Samples ) && !m_data.callstackSamplesReady )
             {
                 jobs.emplace_back( std::thread( [this] {
-                    unordered_flat_map<uint32_t, uint32_t> counts;
                     uint32_t total = 0;
                     for( auto& t : m_data.threads ) total += t->samples.size();
                     if( total != 0 )
                     {
+                        using InstructionPointersMap = decltype( m_data.instructionPointersMap );
+                        struct SampleCounts
+                        {
+                            unordered_flat_map<uint32_t, uint32_t> counts;
+                            InstructionPointersMap ipMap;
+                        };
+
+                        // Sample ranges are counted into partial maps in parallel. Counts are additive, so the
+                        // partial maps can be merged in any order.
+                        enum { ChunkSize = 256 * 1024 };
+                        size_t numChunks = 0;
+                        for( auto& t : m_data.threads ) numChunks += ( t->samples.size() + ChunkSize - 1 ) / ChunkSize;
+                        std::vector<SampleCounts> partial( numChunks );
+
+                        const auto workers = std::max<int>( std::thread::hardware_concurrency() - 1, 1 );
+                        auto td = std::make_unique<TaskDispatch>( workers );
+                        size_t chunk = 0;
                         for( auto& t : m_data.threads )
                         {
-                            if( m_shutdown.load( std::memory_order_relaxed ) ) return;
-                            for( auto& sd : t->samples )
+                            const auto sz = t->samples.size();
+                            for( size_t i=0; i<sz; i+=ChunkSize )
                             {
-                                const auto cs = sd.callstack.Val();
-                                auto it = counts.find( cs );
+                                auto part = &partial[chunk++];
+                                auto begin = t->samples.begin() + i;
+                                auto end = t->samples.begin() + std::min<size_t>( i + ChunkSize, sz );
+                                td->Queue( [this, part, begin, end] {
+                                    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+                                    for( auto it = begin; it != end; ++it )
+                                    {
+                                        const auto cs = it->callstack.Val();
+                                        auto cit = part->counts.find( cs );
+                                        if( cit == part->counts.end() )
+                                        {
+                                            part->counts.emplace( cs, 1 );
+                                        }
+                                        else
+                                        {
+                                            cit->second++;
+                                        }
+
+                                        const auto& callstack = GetCallstack( cs );
+                                        auto& ip = callstack[0];
+                                        auto frame = GetCallstackFrame( ip );
+                                        if( frame )
+                                        {
+                                            const auto symAddr = frame->data[0].symAddr;
+                                            auto sit = part->ipMap.find( symAddr );
+                                            if( sit == part->ipMap.end() )
+                                            {
+                                                part->ipMap.emplace( symAddr, unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare> { { ip, 1 } } );
+                                            }
+                                            else
+                                            {
+                                                auto fit = sit->second.find( ip );
+                                                if( fit == sit->second.end() )
+                                                {
+                                                    sit->second.emplace( ip, 1 );
+                                                }
+                                                else
+                                                {
+                                                    fit->second++;
+                                                }
+                                            }
+                                        }
+                                    }
+                                } );
+                            }
+                        }
+                        td->Sync();
+                        td.reset();
+                        if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+
+                        unordered_flat_map<uint32_t, uint32_t> counts;
+                        for( auto& part : partial )
+                        {
+                            for( auto& v : part.counts )
+                            {
+                                auto it = counts.find( v.first );
                                 if( it == counts.end() )
                                 {
-                                    counts.emplace( cs, 1 );
+                                    counts.emplace( v.first, v.second );
                                 }
                                 else
                                 {
-                                    it->second++;
+                                    it->second += v.second;
                                 }
-
-                                const auto& callstack = GetCallstack( cs );
-                                auto& ip = callstack[0];
-                                auto frame = GetCallstackFrame( ip );
-                                if( frame )
+                            }
+                            for( auto& v : part.ipMap )
+                            {
+                                auto it = m_data.instructionPointersMap.find( v.first );
+                                if( it == m_data.instructionPointersMap.end() )
                                 {
-                                    const auto symAddr = frame->data[0].symAddr;
-                                    auto it = m_data.instructionPointersMap.find( symAddr );
-                                    if( it == m_data.instructionPointersMap.end() )
-                                    {
-                                        m_data.instructionPointersMap.emplace( symAddr, unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare> { { ip, 1 } } );
-                                    }
-                                    else
+                                    m_data.instructionPointersMap.emplace( v.first, std::move( v.second ) );
+                                }
+                                else
+                                {
+                                    for( auto& ip : v.second )
                                     {
-                                        auto fit = it->second.find( ip );
+                                        auto fit = it->second.find( ip.first );
                                         if( fit == it->second.end() )
                                         {
-                                            it->second.emplace( ip, 1 );
+                                            it->second.emplace( ip.first, ip.second );
                                         }
                                         else
                                         {
-                                            fit->second++;
+                                            fit->second += ip.second;
                                         }
                                     }
                                 }
                             }
+                            InstructionPointersMap().swap( part.ipMap );
+                            unordered_flat_map<uint32_t, uint32_t>().swap( part.counts );
                         }
+                        // Symbol statistics update shared parent frame maps, this part has to stay serial. It only
+                        // has to visit each unique callstack once.
                         for( auto& v : counts ) UpdateSampleStatistics( v.first, v.second, false );
                     }
                     std::lock_guard<std::shared_mutex> lock( m_data.lock );
@@ -1942,100 +2417,165 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 } ) );
 
                 jobs.emplace_back( std::thread( [this] {
-                    uint32_t gcnt = 0;
-                    for( auto& t : m_data.threads )
+                    const auto workers = std::max<int>( std::thread::hardware_concurrency() - 1, 1 );
+                    auto td = std::make_unique<TaskDispatch>( workers );
+                    const auto numThreads = m_data.threads.size();
+
+                    // Ghost frame ids are shared between threads, so they are assigned upfront, once for each
+                    // unique callstack.
+                    std::vector<unordered_flat_set<uint32_t>> usedCallstacks( numThreads );
+                    for( size_t i=0; i<numThreads; i++ )
                     {
-                        if( m_shutdown.load( std::memory_order_relaxed ) ) return;
-                        for( auto& sd : t->samples )
-                        {
-                            const auto& cs = GetCallstack( sd.callstack.Val() );
-                            const auto time = sd.time.Val();
-                            auto vec = &t->ghostZones;
+                        auto t = m_data.threads[i];
+                        if( t->samples.empty() ) continue;
+                        auto used = &usedCallstacks[i];
+                        td->Queue( [this, t, used] {
+                            if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+                            for( auto& sd : t->samples ) used->emplace( sd.callstack.Val() );
+                        } );
+                    }
+                    td->Sync();
+                    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
 
-                            auto idx = cs.size() - 1;
-                            do
+                    unordered_flat_set<uint32_t> visited;
+                    for( auto& used : usedCallstacks )
+                    {
+                        for( auto& csid : used )
+                        {
+                            if( !visited.emplace( csid ).second ) continue;
+                            const auto& cs = GetCallstack( csid );
+                            for( auto& entry : cs )
                             {
-                                auto& entry = cs[idx];
-                                uint32_t fid;
-                                auto it = m_data.ghostFramesMap.find( entry.data );
-                                if( it == m_data.ghostFramesMap.end() )
+                                if( m_data.ghostFramesMap.find( entry.data ) == m_data.ghostFramesMap.end() )
                                 {
-                                    fid = uint32_t( m_data.ghostFrames.size() );
+                                    m_data.ghostFramesMap.emplace( entry.data, uint32_t( m_data.ghostFrames.size() ) );
                                     m_data.ghostFrames.push_back( entry );
-                                    m_data.ghostFramesMap.emplace( entry.data, fid );
                                 }
-                                else
-                                {
-                                    fid = it->second;
-                                }
-                                if( vec->empty() )
-                                {
-                                    gcnt++;
-                                    auto& zone = vec->push_next();
-                                    zone.start.SetVal( time );
-                                    zone.end.SetVal( time + m_samplingPeriod );
-                                    zone.frame.SetVal( fid );
-                                    zone.child = -1;
-                                }
-                                else
+                            }
+                        }
+                        unordered_flat_set<uint32_t>().swap( used );
+                    }
+                    unordered_flat_set<uint32_t>().swap( visited );
+
+                    // Each thread builds its ghost zones with a local children list, which is appended to the
+                    // global one afterwards.
+                    std::vector<Vector<Vector<GhostZone>>> children( numThreads );
+                    std::vector<uint32_t> zoneCount( numThreads, 0 );
+                    for( size_t i=0; i<numThreads; i++ )
+                    {
+                        auto t = m_data.threads[i];
+                        if( t->samples.empty() ) continue;
+                        auto tchildren = &children[i];
+                        auto tcnt = &zoneCount[i];
+                        td->Queue( [this, t, tchildren, tcnt] {
+                            if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+                            uint32_t gcnt = 0;
+                            for( auto& sd : t->samples )
+                            {
+                                const auto& cs = GetCallstack( sd.callstack.Val() );
+                                const auto time = sd.time.Val();
+                                auto vec = &t->ghostZones;
+
+                                auto idx = cs.size() - 1;
+                                do
                                 {
-                                    auto& back = vec->back();
-                                    const auto backFrame = GetCallstackFrame( m_data.ghostFrames[back.frame.Val()] );
-                                    const auto thisFrame = GetCallstackFrame( entry );
-                                    bool match = false;
-                                    if( backFrame && thisFrame )
+                                    auto& entry = cs[idx];
+                                    auto it = m_data.ghostFramesMap.find( entry.data );
+                                    assert( it != m_data.ghostFramesMap.end() );
+                                    const auto fid = it->second;
+                                    if( vec->empty() )
                                     {
-                                        match = backFrame->size == thisFrame->size;
-                                        if( match )
+                                        gcnt++;
+                                        auto& zone = vec->push_next();
+                                        zone.start.SetVal( time );
+                                        zone.end.SetVal( time + m_samplingPeriod );
+                                        zone.frame.SetVal( fid );
+                                        zone.child = -1;
+                                    }
+                                    else
+                                    {
+                                        auto& back = vec->back();
+                                        const auto backFrame = GetCallstackFrame( m_data.ghostFrames[back.frame.Val()] );
+                                        const auto thisFrame = GetCallstackFrame( entry );
+                                        bool match = false;
+                                        if( backFrame && thisFrame )
                                         {
-                                            for( uint8_t i=0; i<thisFrame->size; i++ )
+                                            match = backFrame->size == thisFrame->size;
+                                            if( match )
                                             {
-                                                if( backFrame->data[i].symAddr != thisFrame->data[i].symAddr )
+                                                for( uint8_t i=0; i<thisFrame->size; i++ )
                                                 {
-                                                    match = false;
-                                                    break;
+                                                    if( backFrame->data[i].symAddr != thisFrame->data[i].symAddr )
+                                                    {
+                                                        match = false;
+                                                        break;
+                                                    }
                                                 }
                                             }
                                         }
-                                    }
-                                    if( match )
-                                    {
-                                        back.end.SetVal( time + m_samplingPeriod );
-                                    }
-                                    else
-                                    {
-                                        gcnt++;
-                                        auto ptr = &back;
-                                        for(;;)
+                                        if( match )
                                         {
-                                            ptr->end.SetVal( time );
-                                            if( ptr->child < 0 ) break;
-                                            ptr = &GetGhostChildrenMutable( ptr->child ).back();
+                                            back.end.SetVal( time + m_samplingPeriod );
+                                        }
+                                        else
+                                        {
+                                            gcnt++;
+                                            auto ptr = &back;
+                                            for(;;)
+                                            {
+                                                ptr->end.SetVal( time );
+                                                if( ptr->child < 0 ) break;
+                                                ptr = &(*tchildren)[ptr->child].back();
+                                            }
+                                            auto& zone = vec->push_next_non_empty();
+                                            zone.start.SetVal( time );
+                                            zone.end.SetVal( time + m_samplingPeriod );
+                                            zone.frame.SetVal( fid );
+                                            zone.child = -1;
                                         }
-                                        auto& zone = vec->push_next_non_empty();
-                                        zone.start.SetVal( time );
-                                        zone.end.SetVal( time + m_samplingPeriod );
-                                        zone.frame.SetVal( fid );
-                                        zone.child = -1;
-                                    }
-                                }
-                                if( idx > 0 )
-                                {
-                                    auto& zone = vec->back();
-                                    if( zone.child < 0 )
-                                    {
-                                        zone.child = m_data.ghostChildren.size();
-                                        vec = &m_data.ghostChildren.push_next();
                                     }
-                                    else
+                                    if( idx > 0 )
                                     {
-                                        vec = &m_data.ghostChildren[zone.child];
+                                        auto& zone = vec->back();
+                                        if( zone.child < 0 )
+                                        {
+                                            zone.child = tchildren->size();
+                                            vec = &tchildren->push_next();
+                                        }
+                                        else
+                                        {
+                                            vec = &(*tchildren)[zone.child];
+                                        }
                                     }
                                 }
+                                while( idx-- > 0 );
+                            }
+                            *tcnt = gcnt;
+                        } );
+                    }
+                    td->Sync();
+                    td.reset();
+                    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+
+                    uint32_t gcnt = 0;
+                    for( size_t i=0; i<numThreads; i++ )
+                    {
+                        gcnt += zoneCount[i];
+                        auto& tchildren = children[i];
+                        if( tchildren.empty() ) continue;
+                        const auto offset = int32_t( m_data.ghostChildren.size() );
+                        if( offset != 0 )
+                        {
+                            for( auto& zone : m_data.threads[i]->ghostZones ) if( zone.child >= 0 ) zone.child += offset;
+                            for( auto& v : tchildren )
+                            {
+                                for( auto& zone : v ) if( zone.child >= 0 ) zone.child += offset;
                             }
-                            while( idx-- > 0 );
                         }
+                        for( auto& v : tchildren ) m_data.ghostChildren.push_back( std::move( v ) );
+                        Vector<Vector<GhostZone>>().swap( tchildren );
                     }
+
                     std::lock_guard<std::shared_mutex> lock( m_data.lock );
                     m_data.ghostZonesReady = true;
                     m_data.ghostCnt = gcnt;
@@ -2044,21 +2584,6 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
 
             for( auto& job : jobs ) job.join();
 
-            for( auto& v : m_data.sourceLocationZones )
-            {
-                if( m_shutdown.load( std::memory_order_relaxed ) ) return;
-                auto& zones = v.second.zones;
-#ifdef NO_PARALLEL_SORT
-                pdqsort_branchless( zones.begin(), zones.end(), []( const auto& lhs, const auto& rhs ) { return lhs.Zone()->Start() < rhs.Zone()->Start(); } );
-#else
-                std::sort( std::execution::par_unseq, zones.begin(), zones.end(), []( const auto& lhs, const auto& rhs ) { return lhs.Zone()->Start() < rhs.Zone()->Start(); } );
-#endif
-            }
-            {
-                std::lock_guard<std::shared_mutex> lock( m_data.lock );
-                m_data.sourceLocationZonesReady = true;
-            }
-
             m_backgroundDone.store( true, std::memory_order_relaxed );
         } );
 #else
@@ -2077,6 +2602,7 @@ Worker::~Worker()
 
     delete[] m_buffer;
     LZ4_freeStreamDecode( (LZ4_streamDecode_t*)m_stream );
+    if( m_rawStream ) fclose( m_rawStream );
 
     delete[] m_frameImageBuffer;
 
@@ -2090,8 +2616,15 @@ Worker::~Worker()
 #ifndef TRACY_NO_STATISTICS
         v->childTimeStack.~Vector();
         v->ghostZones.~Vector();
+        v->slowZones.~Vector();
+        DestroyZoneLod( v->timelineLod );
+        v->timelineLod.maxStep.~Vector();
 #endif
     }
+#ifndef TRACY_NO_STATISTICS
+    for( auto& v : m_data.zoneChildrenLod ) DestroyZoneLod( v.second );
+    for( auto& v : m_data.memory.freeIndex ) v.~Vector();
+#endif
     for( auto& v : m_data.gpuData )
     {
         for( auto& vt : v->threadData )
@@ -2102,6 +2635,9 @@ Worker::~Worker()
     }
     for( auto& v : m_data.plots.Data() )
     {
+#ifndef TRACY_NO_STATISTICS
+        for( auto& l : v->lod ) l.~Vector();
+#endif
         v->~PlotData();
     }
     for( auto& v : m_data.frames.Data() )
@@ -2181,9 +2717,9 @@ uint64_t Worker::GetContextSwitchCount() const
 uint64_t Worker::GetContextSwitchPerCpuCount() const
 {
     uint64_t cnt = 0;
-    for( int i=0; i<m_data.cpuDataCount; i++ )
+    for( auto& cpu : m_data.cpuData )
     {
-        cnt += m_data.cpuData[i].cs.size();
+        cnt += cpu.cs.size();
     }
     return cnt;
 }
@@ -2215,9 +2751,9 @@ void Worker::GetCpuUsageAtTime( int64_t time, int& own, int& other ) const
 
     int cntOwn = 0;
     int cntOther = 0;
-    for( int i=0; i<m_data.cpuDataCount; i++ )
+    for( auto& cpu : m_data.cpuData )
     {
-        auto& cs = m_data.cpuData[i].cs;
+        auto& cs = cpu.cs;
         if( !cs.empty() )
         {
             auto it = std::lower_bound( cs.begin(), cs.end(), time, [] ( const auto& l, const auto& r ) { return (uint64_t)l.End() < (uint64_t)r; } );
@@ -2767,6 +3303,133 @@ const Worker::SourceLocationZones& Worker::GetZonesForSourceLocation( int16_t sr
     return it != m_data.sourceLocationZones.end() ? it->second : empty;
 }
 
+// Calls func for each block in [b0, b1] with maximum zone end time greater than time.
+template<typename T>
+static void VisitRangeEndBlocks( const Vector<int64_t>& tree, size_t node, size_t lo, size_t hi, size_t b0, size_t b1, int64_t time, T&& func )
+{
+    if( hi < b0 || lo > b1 || tree[node] <= time ) return;
+    if( lo == hi )
+    {
+        func( lo );
+        return;
+    }
+    const auto mid = ( lo + hi ) / 2;
+    VisitRangeEndBlocks( tree, node * 2, lo, mid, b0, b1, time, func );
+    VisitRangeEndBlocks( tree, node * 2 + 1, mid + 1, hi, b0, b1, time, func );
+}
+
+std::pair<size_t, size_t> Worker::GetZoneRangeCandidates( const SourceLocationZones& slz, int64_t rangeMin, int64_t rangeMax ) const
+{
+    auto& zones = slz.zones;
+    if( slz.rangeIndex.empty() ) return std::make_pair( size_t( 0 ), zones.size() );
+    // Zones starting at or after range end can't fit in the range, as zones with no time span are not stored.
+    auto it0 = std::lower_bound( zones.begin(), zones.end(), rangeMin, [] ( const auto& l, const auto& r ) { return l.Zone()->Start() < r; } );
+    auto it1 = std::lower_bound( it0, zones.end(), rangeMax, [] ( const auto& l, const auto& r ) { return l.Zone()->Start() < r; } );
+    return std::make_pair( size_t( it0 - zones.begin() ), size_t( it1 - zones.begin() ) );
+}
+
+Worker::ZoneRangeStats Worker::GetZoneRangeStats( const SourceLocationZones& slz, int64_t rangeMin, int64_t rangeMax ) const
+{
+    ZoneRangeStats ret = {};
+    auto& zones = slz.zones;
+    const auto range = GetZoneRangeCandidates( slz, rangeMin, rangeMax );
+    if( slz.rangeIndex.empty() )
+    {
+        for( size_t i=range.first; i<range.second; i++ )
+        {
+            auto& zone = *zones[i].Zone();
+            const auto start = zone.Start();
+            const auto end = zone.End();
+            if( start < rangeMin || end > rangeMax ) continue;
+            ret.total += end - start;
+            ret.selfTotal += GetZoneSelfTime( zone );
+            ret.count++;
+        }
+        return ret;
+    }
+
+    const auto p0 = GetZoneTimePrefix( slz, range.first );
+    const auto p1 = GetZoneTimePrefix( slz, range.second );
+    ret.total = p1.total - p0.total;
+    ret.selfTotal = p1.selfTotal - p0.selfTotal;
+    ret.count = range.second - range.first;
+
+    // Remove zones which start in range, but end after it. Only the index blocks which contain
+    // such zones are visited.
+    if( range.first != range.second )
+    {
+        const auto& tree = slz.rangeEndTree;
+        const auto leaves = tree.size() / 2;
+        const auto b0 = range.first / ZoneRangeIndexStep;
+        const auto b1 = ( range.second - 1 ) / ZoneRangeIndexStep;
+        VisitRangeEndBlocks( tree, 1, 0, leaves - 1, b0, b1, rangeMax, [&] ( size_t block ) {
+            const auto i0 = std::max( range.first, block * ZoneRangeIndexStep );
+            const auto i1 = std::min( range.second, ( block + 1 ) * ZoneRangeIndexStep );
+            for( size_t i=i0; i<i1; i++ )
+            {
+                auto& zone = *zones[i].Zone();
+                if( zone.End() > rangeMax )
+                {
+                    ret.total -= zone.End() - zone.Start();
+                    ret.selfTotal -= GetZoneSelfTime( zone );
+                    ret.count--;
+                }
+            }
+        } );
+    }
+    return ret;
+}
+
+std::pair<double, double> Worker::GetPlotRange( const PlotData* plot, size_t begin, size_t end ) const
+{
+    assert( begin < end );
+    assert( end <= plot->data.size() );
+    const auto& data = plot->data;
+    const auto& lod = plot->lod;
+    double min = data[begin].val;
+    double max = min;
+    auto i = begin + 1;
+    while( i < end )
+    {
+        // Use the largest aligned group which fits in the remaining range.
+        int level = -1;
+        while( level + 1 < (int)lod.size() )
+        {
+            const auto size = size_t( 1 ) << ( PlotLodShift + level + 1 );
+            if( ( i & ( size - 1 ) ) != 0 || i + size > end ) break;
+            level++;
+        }
+        if( level < 0 )
+        {
+            const auto val = data[i].val;
+            if( val < min ) min = val;
+            else if( val > max ) max = val;
+            i++;
+        }
+        else
+        {
+            const auto& item = lod[level][i >> ( PlotLodShift + level )];
+            if( item.min < min ) min = item.min;
+            if( item.max > max ) max = item.max;
+            i += size_t( 1 ) << ( PlotLodShift + level );
+        }
+    }
+    return std::make_pair( min, max );
+}
+
+const ZoneLod* Worker::GetZoneChildrenLod( int32_t idx ) const
+{
+    auto it = m_data.zoneChildrenLod.find( idx );
+    if( it == m_data.zoneChildrenLod.end() )
+    {
+        return nullptr;
+    }
+    else
+    {
+        return &it->second;
+    }
+}
+
 const SymbolStats* Worker::GetSymbolStats( uint64_t symAddr ) const
 {
     assert( AreCallstackSamplesReady() );
@@ -2796,6 +3459,27 @@ const unordered_flat_map<CallstackFrameId, uint32_t, Worker::CallstackFrameIdHas
 }
 #endif
 
+template<typename ShouldExit>
+bool Worker::ReadStream( void* buf, int len, ShouldExit exitCb )
+{
+    if( m_replayEnd )
+    {
+        if( m_replayEnd - m_replayPtr < len ) return false;
+        memcpy( buf, m_replayPtr, len );
+        m_replayPtr += len;
+        return true;
+    }
+    if( !m_sock.Read( buf, len, 10, exitCb ) ) return false;
+    if( m_rawStream ) fwrite( buf, 1, len, m_rawStream );
+    return true;
+}
+
+void Worker::SendStream( const void* buf, int len )
+{
+    if( m_replayEnd ) return;
+    m_sock.Send( buf, len );
+}
+
 void Worker::Network()
 {
     auto ShouldExit = [this] { return m_shutdown.load( std::memory_order_relaxed ); };
@@ -2812,8 +3496,8 @@ void Worker::Network()
 
         auto buf = m_buffer + m_bufferOffset;
         lz4sz_t lz4sz;
-        if( !m_sock.Read( &lz4sz, sizeof( lz4sz ), 10, ShouldExit ) ) goto close;
-        if( !m_sock.Read( lz4buf.get(), lz4sz, 10, ShouldExit ) ) goto close;
+        if( !ReadStream( &lz4sz, sizeof( lz4sz ), ShouldExit ) ) goto close;
+        if( !ReadStream( lz4buf.get(), lz4sz, ShouldExit ) ) goto close;
         auto bb = m_bytes.load( std::memory_order_relaxed );
         m_bytes.store( bb + sizeof( lz4sz ) + lz4sz, std::memory_order_relaxed );
 
@@ -2842,7 +3526,7 @@ void Worker::Exec()
 {
     auto ShouldExit = [this] { return m_shutdown.load( std::memory_order_relaxed ); };
 
-    for(;;)
+    while( !m_replayEnd )
     {
         if( m_shutdown.load( std::memory_order_relaxed ) ) { m_netWriteCv.notify_one(); return; };
         if( m_sock.Connect( m_addr.c_str(), m_port ) ) break;
@@ -2851,11 +3535,11 @@ void Worker::Exec()
 
     std::chrono::time_point<std::chrono::high_resolution_clock> t0;
 
-    m_sock.Send( HandshakeShibboleth, HandshakeShibbolethSize );
+    SendStream( HandshakeShibboleth, HandshakeShibbolethSize );
     uint32_t protocolVersion = ProtocolVersion;
-    m_sock.Send( &protocolVersion, sizeof( protocolVersion ) );
+    SendStream( &protocolVersion, sizeof( protocolVersion ) );
     HandshakeStatus handshake;
-    if( !m_sock.Read( &handshake, sizeof( handshake ), 10, ShouldExit ) )
+    if( !ReadStream( &handshake, sizeof( handshake ), ShouldExit ) )
     {
         m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
         goto close;
@@ -2884,7 +3568,7 @@ void Worker::Exec()
 
     {
         WelcomeMessage welcome;
-        if( !m_sock.Read( &welcome, sizeof( welcome ), 10, ShouldExit ) )
+        if( !ReadStream( &welcome, sizeof( welcome ), ShouldExit ) )
         {
             m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
             goto close;
@@ -2921,7 +3605,7 @@ void Worker::Exec()
         if( welcome.onDemand != 0 )
         {
             OnDemandPayloadMessage onDemand;
-            if( !m_sock.Read( &onDemand, sizeof( onDemand ), 10, ShouldExit ) )
+            if( !ReadStream( &onDemand, sizeof( onDemand ), ShouldExit ) )
             {
                 m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
                 goto close;
@@ -2931,11 +3615,19 @@ void Worker::Exec()
         }
     }
 
-    m_serverQuerySpaceBase = m_serverQuerySpaceLeft = ( m_sock.GetSendBufSize() / ServerQueryPacketSize ) - ServerQueryPacketSize;   // leave space for terminate request
+    if( m_replayEnd )
+    {
+        // Answers to all queries are already in the recorded stream.
+        m_serverQuerySpaceBase = m_serverQuerySpaceLeft = std::numeric_limits<size_t>::max() / 2;
+    }
+    else
+    {
+        m_serverQuerySpaceBase = m_serverQuerySpaceLeft = ( m_sock.GetSendBufSize() / ServerQueryPacketSize ) - ServerQueryPacketSize;   // leave space for terminate request
+    }
+    m_connected.store( true, std::memory_order_relaxed );
     m_hasData.store( true, std::memory_order_release );
 
     LZ4_setStreamDecode( (LZ4_streamDecode_t*)m_stream, nullptr, 0 );
-    m_connected.store( true, std::memory_order_relaxed );
     {
         std::lock_guard<std::mutex> lock( m_netWriteLock );
         m_netWriteCnt = 2;
@@ -2969,7 +3661,7 @@ void Worker::Exec()
             while( ptr < end )
             {
                 auto ev = (const QueueItem*)ptr;
-                if( !DispatchProcess( *ev, ptr ) )
+                if( !( m_queueTypeStatsEnabled ? DispatchProcessTimed( *ev, ptr ) : DispatchProcess( *ev, ptr ) ) )
                 {
                     if( m_failure != Failure::None ) HandleFailure( ptr, end );
                     QueryTerminate();
@@ -3010,7 +3702,7 @@ void Worker::Exec()
             if( !m_serverQueryQueue.empty() && m_serverQuerySpaceLeft > 0 )
             {
                 const auto toSend = std::min( m_serverQuerySpaceLeft, m_serverQueryQueue.size() );
-                m_sock.Send( m_serverQueryQueue.data(), toSend * ServerQueryPacketSize );
+                SendStream( m_serverQueryQueue.data(), toSend * ServerQueryPacketSize );
                 m_serverQuerySpaceLeft -= toSend;
                 if( toSend == m_serverQueryQueue.size() )
                 {
@@ -3064,7 +3756,7 @@ void Worker::Exec()
 close:
     Shutdown();
     m_netWriteCv.notify_one();
-    m_sock.Close();
+    if( m_sock.IsValid() ) m_sock.Close();
     m_connected.store( false, std::memory_order_relaxed );
 }
 
@@ -3125,7 +3817,7 @@ void Worker::HandleFailure( const char* ptr, const char* end )
         if( !m_serverQueryQueue.empty() && m_serverQuerySpaceLeft > 0 )
         {
             const auto toSend = std::min( m_serverQuerySpaceLeft, m_serverQueryQueue.size() );
-            m_sock.Send( m_serverQueryQueue.data(), toSend * ServerQueryPacketSize );
+            SendStream( m_serverQueryQueue.data(), toSend * ServerQueryPacketSize );
             m_serverQuerySpaceLeft -= toSend;
             if( toSend == m_serverQueryQueue.size() )
             {
@@ -3217,7 +3909,7 @@ void Worker::Query( ServerQuery type, uint64_t data, uint32_t extra )
     if( m_serverQueryQueue.empty() && m_serverQuerySpaceLeft > 0 )
     {
         m_serverQuerySpaceLeft--;
-        m_sock.Send( &query, ServerQueryPacketSize );
+        SendStream( &query, ServerQueryPacketSize );
     }
     else
     {
@@ -3228,7 +3920,7 @@ void Worker::Query( ServerQuery type, uint64_t data, uint32_t extra )
 void Worker::QueryTerminate()
 {
     ServerQueryPacket query { ServerQueryTerminate, 0, 0 };
-    m_sock.Send( &query, ServerQueryPacketSize );
+    SendStream( &query, ServerQueryPacketSize );
 }
 
 bool Worker::DispatchProcess( const QueueItem& ev, const char*& ptr )
@@ -3314,6 +4006,17 @@ bool Worker::DispatchProcess( const QueueItem& ev, const char*& ptr )
     }
 }
 
+bool Worker::DispatchProcessTimed( const QueueItem& ev, const char*& ptr )
+{
+    auto& stats = m_queueTypeStats[ev.hdr.idx];
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    const auto ret = DispatchProcess( ev, ptr );
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    stats.count++;
+    stats.time += std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+    return ret;
+}
+
 void Worker::CheckSourceLocation( uint64_t ptr )
 {
     if( m_data.checkSrclocLast != ptr )
@@ -3532,12 +4235,14 @@ void Worker::InsertLockEvent( LockMap& lockmap, LockEvent* lev, uint64_t thread,
 
     NoticeThread( thread );
 
+    bool resized = false;
     auto it = lockmap.threadMap.find( thread );
     if( it == lockmap.threadMap.end() )
     {
         assert( lockmap.threadList.size() < MaxLockThreads );
         it = lockmap.threadMap.emplace( thread, lockmap.threadList.size() ).first;
         lockmap.threadList.emplace_back( thread );
+        resized = UpdateLockThreadListSize( lockmap );
     }
     lev->thread = it->second;
     assert( lev->thread == it->second );
@@ -3551,7 +4256,7 @@ void Worker::InsertLockEvent( LockMap& lockmap, LockEvent* lev, uint64_t thread,
     {
         assert( timeline.back().ptr->Time() <= time );
         timeline.push_back_non_empty( { lev } );
-        UpdateLockCount( lockmap, timeline.size() - 1 );
+        UpdateLockCount( lockmap, resized ? 0 : timeline.size() - 1 );
     }
 
     auto& range = lockmap.range[it->second];
@@ -3930,36 +4635,190 @@ void Worker::AddCallstackAllocPayload( uint64_t ptr, const char* data, size_t _s
     m_pendingCallstackId = idx;
 }
 
-void Worker::InsertPlot( PlotData* plot, int64_t time, double val )
+void Worker::InsertPlot( PlotData* plot, int64_t time, double val )
+{
+    if( plot->data.empty() )
+    {
+        plot->min = val;
+        plot->max = val;
+        plot->data.push_back( { Int48( time ), val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( plot, 0 );
+#endif
+    }
+    else if( plot->data.back().time.Val() < time )
+    {
+        if( plot->min > val ) plot->min = val;
+        else if( plot->max < val ) plot->max = val;
+        plot->data.push_back_non_empty( { Int48( time ), val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( plot, plot->data.size() - 1 );
+#endif
+    }
+    else
+    {
+        if( plot->min > val ) plot->min = val;
+        else if( plot->max < val ) plot->max = val;
+        if( plot->postpone.empty() )
+        {
+            plot->postponeTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() ).count();
+            plot->postpone.push_back( { Int48( time ), val } );
+        }
+        else
+        {
+            plot->postpone.push_back_non_empty( { Int48( time ), val } );
+        }
+    }
+}
+
+#ifndef TRACY_NO_STATISTICS
+void Worker::UpdatePlotLod( PlotData* plot, size_t idx )
+{
+    auto& lod = plot->lod;
+    const auto val = plot->data[idx].val;
+    if( lod.empty() ) lod.push_next();
+    size_t level = 0;
+    for(;;)
+    {
+        auto& vec = lod[level];
+        const auto bucket = idx >> ( PlotLodShift + level );
+        if( bucket == vec.size() )
+        {
+            vec.push_back( PlotLodItem { val, val } );
+        }
+        else
+        {
+            // Groups on higher levels contain this one, so they are not affected if the range didn't change.
+            auto& item = vec[bucket];
+            if( val < item.min ) item.min = val;
+            else if( val > item.max ) item.max = val;
+            else break;
+        }
+        if( level + 1 == lod.size() )
+        {
+            if( vec.size() < 2 ) break;
+            const PlotLodItem top { std::min( vec[0].min, vec[1].min ), std::max( vec[0].max, vec[1].max ) };
+            lod.push_next().push_back( top );
+            break;
+        }
+        level++;
+    }
+}
+
+void Worker::BuildPlotLod( PlotData* plot, size_t start )
+{
+    auto& lod = plot->lod;
+    start = ( start >> PlotLodShift ) << PlotLodShift;
+    if( start == 0 )
+    {
+        for( auto& v : lod ) v.~Vector();
+        lod.clear();
+    }
+    else
+    {
+        // Drop groups containing data past start. Partially covered groups are rebuilt from the level below.
+        for( size_t level=0; level<lod.size(); level++ )
+        {
+            auto& vec = lod[level];
+            const auto shift = PlotLodShift + level;
+            const auto full = start >> shift;
+            vec.set_size( full );
+            if( ( start & ( ( size_t( 1 ) << shift ) - 1 ) ) != 0 )
+            {
+                assert( level > 0 );
+                const auto& prev = lod[level-1];
+                auto item = prev[full*2];
+                for( size_t i=full*2+1; i<prev.size(); i++ )
+                {
+                    if( prev[i].min < item.min ) item.min = prev[i].min;
+                    if( prev[i].max > item.max ) item.max = prev[i].max;
+                }
+                vec.push_back( item );
+            }
+        }
+    }
+    const auto sz = plot->data.size();
+    for( size_t i=start; i<sz; i++ ) UpdatePlotLod( plot, i );
+}
+
+template<typename Adapter, typename V>
+void Worker::UpdateZoneLodImpl( ZoneLod& lod, const V& vec )
+{
+    Adapter a;
+    auto& levels = lod.maxStep;
+    if( levels.empty() ) levels.push_next();
+    const auto sz = vec.size();
+    size_t idx = lod.count;
+    int64_t prevEnd = idx == 0 ? 0 : GetZoneEnd( a(vec[idx-1]) );
+    for( ; idx<sz; idx++ )
+    {
+        const auto end = GetZoneEnd( a(vec[idx]) );
+        const auto step = idx == 0 ? 0 : end - prevEnd;
+        prevEnd = end;
+        size_t level = 0;
+        for(;;)
+        {
+            auto& lvl = levels[level];
+            const auto group = idx >> ( ZoneLodShift + level );
+            if( group == lvl.size() )
+            {
+                lvl.push_back( step );
+            }
+            else
+            {
+                // Groups on higher levels contain this one, so they are not affected if the maximum didn't change.
+                auto& item = lvl[group];
+                if( step <= item ) break;
+                item = step;
+            }
+            if( level + 1 == levels.size() )
+            {
+                if( lvl.size() < 2 ) break;
+                const auto top = std::max( lvl[0], lvl[1] );
+                levels.push_next().push_back( top );
+                break;
+            }
+            level++;
+        }
+    }
+    lod.count = sz;
+}
+
+void Worker::UpdateZoneLod( ZoneLod& lod, const Vector<short_ptr<ZoneEvent>>& vec )
 {
-    if( plot->data.empty() )
+    if( vec.is_magic() )
     {
-        plot->min = val;
-        plot->max = val;
-        plot->data.push_back( { Int48( time ), val } );
+        UpdateZoneLodImpl<VectorAdapterDirect<ZoneEvent>>( lod, *(Vector<ZoneEvent>*)( &vec ) );
     }
-    else if( plot->data.back().time.Val() < time )
+    else
     {
-        if( plot->min > val ) plot->min = val;
-        else if( plot->max < val ) plot->max = val;
-        plot->data.push_back_non_empty( { Int48( time ), val } );
+        UpdateZoneLodImpl<VectorAdapterPointer<ZoneEvent>>( lod, vec );
     }
-    else
+}
+
+void Worker::BuildZoneLod( const Vector<short_ptr<ZoneEvent>>& vec, unordered_flat_map<int32_t, ZoneLod>& childrenLod )
+{
+    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+    assert( vec.is_magic() );
+    auto& zones = *(const Vector<ZoneEvent>*)( &vec );
+    for( auto& zone : zones )
     {
-        if( plot->min > val ) plot->min = val;
-        else if( plot->max < val ) plot->max = val;
-        if( plot->postpone.empty() )
-        {
-            plot->postponeTime = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now().time_since_epoch() ).count();
-            plot->postpone.push_back( { Int48( time ), val } );
-        }
-        else
-        {
-            plot->postpone.push_back_non_empty( { Int48( time ), val } );
-        }
+        if( !zone.HasChildren() ) continue;
+        const auto idx = zone.Child();
+        auto& children = m_data.zoneChildren[idx];
+        if( children.size() >= ZoneLodMinSize ) UpdateZoneLod( childrenLod[idx], children );
+        BuildZoneLod( children, childrenLod );
     }
 }
 
+void Worker::DestroyZoneLod( ZoneLod& lod )
+{
+    for( auto& v : lod.maxStep ) v.~Vector();
+    lod.maxStep.clear();
+    lod.count = 0;
+}
+#endif
+
 void Worker::HandlePlotName( uint64_t name, const char* str, size_t sz )
 {
     const auto sl = StoreString( str, sz );
@@ -4000,6 +4859,9 @@ void Worker::HandlePostponedPlots()
         const auto ded = std::distance( dst.begin(), de );
         dst.insert( de, src.begin(), src.end() );
         std::inplace_merge( dst.begin() + dsd, dst.begin() + ded, dst.begin() + ded + src.size(), [] ( const auto& l, const auto& r ) { return l.time.Val() < r.time.Val(); } );
+#ifndef TRACY_NO_STATISTICS
+        BuildPlotLod( plot, dsd );
+#endif
         src.clear();
     }
 }
@@ -4407,6 +5269,17 @@ void Worker::ProcessZoneEnd( const QueueZoneEnd& ev )
     }
 
 #ifndef TRACY_NO_STATISTICS
+    if( stack.empty() )
+    {
+        if( td->timeline.size() >= ZoneLodMinSize ) UpdateZoneLod( td->timelineLod, td->timeline );
+    }
+    else
+    {
+        const auto parentChild = stack.back()->Child();
+        const auto& parentVec = m_data.zoneChildren[parentChild];
+        if( parentVec.size() >= ZoneLodMinSize ) UpdateZoneLod( m_data.zoneChildrenLod[parentChild], parentVec );
+    }
+
     assert( !td->childTimeStack.empty() );
     const auto timeSpan = timeEnd - zone->Start();
     if( timeSpan > 0 )
@@ -4419,10 +5292,14 @@ void Worker::ProcessZoneEnd( const QueueZoneEnd& ev )
         if( slz->max < timeSpan ) slz->max = timeSpan;
         slz->total += timeSpan;
         slz->sumSq += double( timeSpan ) * timeSpan;
+        slz->hist.Add( timeSpan );
         const auto selfSpan = timeSpan - td->childTimeStack.back_and_pop();
         if( slz->selfMin > selfSpan ) slz->selfMin = selfSpan;
         if( slz->selfMax < selfSpan ) slz->selfMax = selfSpan;
         slz->selfTotal += selfSpan;
+        slz->selfHist.Add( selfSpan );
+        m_data.sourceLocationZonesGeneration++;
+        AddSlowZone( td->slowZones, zone );
         if( !td->childTimeStack.empty() )
         {
             td->childTimeStack.back() += timeSpan;
@@ -5264,6 +6141,10 @@ void Worker::ProcessMemAlloc( const QueueMemAlloc& ev )
     m_data.memory.high = std::max( high, ptrend );
     m_data.memory.usage += size;
 
+#ifndef TRACY_NO_STATISTICS
+    AddMemFreeIndex( m_data.memory.freeIndex, m_data.memory.data.size() - 1 );
+#endif
+
     MemAllocChanged( time );
 }
 
@@ -5293,6 +6174,9 @@ bool Worker::ProcessMemFree( const QueueMemFree& ev )
     auto& mem = m_data.memory.data[it->second];
     mem.SetTimeThreadFree( time, CompressThread( ev.thread ) );
     m_data.memory.usage -= mem.Size();
+#ifndef TRACY_NO_STATISTICS
+    UpdateMemFreeIndex( it->second );
+#endif
     m_data.memory.active.erase( it );
 
     MemAllocChanged( time );
@@ -5761,6 +6645,9 @@ void Worker::ProcessSysTime( const QueueSysTime& ev )
         m_sysTimePlot->min = val;
         m_sysTimePlot->max = val;
         m_sysTimePlot->data.push_back( { time, val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( m_sysTimePlot, 0 );
+#endif
         m_data.plots.Data().push_back( m_sysTimePlot );
     }
     else
@@ -5770,6 +6657,9 @@ void Worker::ProcessSysTime( const QueueSysTime& ev )
         if( m_sysTimePlot->min > val ) m_sysTimePlot->min = val;
         else if( m_sysTimePlot->max < val ) m_sysTimePlot->max = val;
         m_sysTimePlot->data.push_back_non_empty( { time, val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( m_sysTimePlot, m_sysTimePlot->data.size() - 1 );
+#endif
     }
 }
 
@@ -5780,7 +6670,7 @@ void Worker::ProcessContextSwitch( const QueueContextSwitch& ev )
     const auto time = TscTime( refTime - m_data.baseTime );
     if( m_data.lastTime < time ) m_data.lastTime = time;
 
-    if( ev.cpu >= m_data.cpuDataCount ) m_data.cpuDataCount = ev.cpu + 1;
+    while( m_data.cpuData.size() <= ev.cpu ) m_data.cpuData.push_next();
     auto& cs = m_data.cpuData[ev.cpu].cs;
     if( ev.oldThread != 0 )
     {
@@ -5924,6 +6814,9 @@ void Worker::MemAllocChanged( int64_t time )
         m_data.memory.plot->min = val;
         m_data.memory.plot->max = val;
         m_data.memory.plot->data.push_back( { time, val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( m_data.memory.plot, m_data.memory.plot->data.size() - 1 );
+#endif
     }
     else
     {
@@ -5932,6 +6825,9 @@ void Worker::MemAllocChanged( int64_t time )
         if( m_data.memory.plot->min > val ) m_data.memory.plot->min = val;
         else if( m_data.memory.plot->max < val ) m_data.memory.plot->max = val;
         m_data.memory.plot->data.push_back_non_empty( { time, val } );
+#ifndef TRACY_NO_STATISTICS
+        UpdatePlotLod( m_data.memory.plot, m_data.memory.plot->data.size() - 1 );
+#endif
     }
 }
 
@@ -5943,9 +6839,38 @@ void Worker::CreateMemAllocPlot()
     m_data.memory.plot->type = PlotType::Memory;
     m_data.memory.plot->format = PlotValueFormatting::Memory;
     m_data.memory.plot->data.push_back( { GetFrameBegin( *m_data.framesBase, 0 ), 0. } );
+#ifndef TRACY_NO_STATISTICS
+    UpdatePlotLod( m_data.memory.plot, 0 );
+#endif
     m_data.plots.Data().push_back( m_data.memory.plot );
 }
 
+// Allocations made before given time and not freed at it, ordered by allocation time.
+void Worker::GetActiveMemAllocs( int64_t time, std::vector<const MemEvent*>& out ) const
+{
+    const auto& data = m_data.memory.data;
+    const auto end = size_t( std::distance( data.begin(), std::lower_bound( data.begin(), data.end(), time, [] ( const auto& lhs, const auto& rhs ) { return lhs.TimeAlloc() < rhs; } ) ) );
+#ifndef TRACY_NO_STATISTICS
+    const auto& index = m_data.memory.freeIndex;
+    if( !index.empty() && index[0].size() == ( ( data.size() + ( 1 << MemFreeIndexShift ) - 1 ) >> MemFreeIndexShift ) )
+    {
+        const auto level = index.size() - 1;
+        const auto& top = index[level];
+        for( size_t i=0; i<top.size(); i++ )
+        {
+            if( ( i << ( MemFreeIndexShift + level ) ) >= end ) break;
+            CollectActiveMemAllocs( level, i, end, time, out );
+        }
+        return;
+    }
+#endif
+    for( size_t i=0; i<end; i++ )
+    {
+        const auto& v = data[i];
+        if( v.TimeFree() < 0 || v.TimeFree() > time ) out.emplace_back( &v );
+    }
+}
+
 void Worker::ReconstructMemAllocPlot()
 {
     auto& mem = m_data.memory;
@@ -6042,17 +6967,27 @@ void Worker::ReconstructMemAllocPlot()
 
     plot->min = 0;
     plot->max = max;
+#ifndef TRACY_NO_STATISTICS
+    BuildPlotLod( plot );
+
+    Vector<Vector<int64_t>> freeIndex;
+    const auto msz = mem.data.size();
+    for( size_t i=0; i<msz; i++ ) AddMemFreeIndex( freeIndex, i );
+#endif
 
     std::lock_guard<std::shared_mutex> lock( m_data.lock );
     m_data.plots.Data().insert( m_data.plots.Data().begin(), plot );
     m_data.memory.plot = plot;
+#ifndef TRACY_NO_STATISTICS
+    m_data.memory.freeIndex = std::move( freeIndex );
+#endif
 }
 
 #ifndef TRACY_NO_STATISTICS
 void Worker::ReconstructContextSwitchUsage()
 {
-    assert( m_data.cpuDataCount != 0 );
-    const auto cpucnt = m_data.cpuDataCount;
+    assert( !m_data.cpuData.empty() );
+    const auto cpucnt = (int)m_data.cpuData.size();
 
     auto& vec = m_data.ctxUsage;
     vec.push_back( ContextSwitchUsage( 0, 0, 0 ) );
@@ -6070,8 +7005,8 @@ void Worker::ReconstructContextSwitchUsage()
         cpus.emplace_back( Cpu { false, m_data.cpuData[i].cs.begin(), m_data.cpuData[i].cs.end() } );
     }
 
-    uint8_t other = 0;
-    uint8_t own = 0;
+    uint16_t other = 0;
+    uint16_t own = 0;
     for(;;)
     {
         int64_t nextTime = std::numeric_limits<int64_t>::max();
@@ -6213,6 +7148,7 @@ void Worker::UpdateSampleStatisticsImpl( const CallstackFrameData** frames, uint
     const auto fexcl = frames[0];
     const auto fxsz = fexcl->size;
     const auto& frame0 = fexcl->data[0];
+    m_data.symbolStatsGeneration++;
     auto sym0 = m_data.symbolStats.find( frame0.symAddr );
     if( sym0 == m_data.symbolStats.end() ) sym0 = m_data.symbolStats.emplace( frame0.symAddr, SymbolStats { 0, 0, unordered_flat_map<uint32_t, uint32_t>() } ).first;
     sym0->second.excl += count;
@@ -6320,6 +7256,204 @@ void Worker::UpdateSampleStatisticsImpl( const CallstackFrameData** frames, uint
         sit->second += count;
     }
 }
+
+// Lookup maps used to deduplicate new entries are not restored, as no more samples will be added to loaded traces.
+void Worker::ReadSampleStatistics( FileRead& f )
+{
+    uint64_t sz;
+    f.Read( sz );
+    m_data.parentCallstackFrameMap.reserve( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        CallstackFrameId id;
+        auto frameData = m_slab.Alloc<CallstackFrameData>();
+        f.Read3( id, frameData->size, frameData->imageName );
+
+        frameData->data = m_slab.Alloc<CallstackFrame>( frameData->size );
+        f.Read( frameData->data, sizeof( CallstackFrame ) * frameData->size );
+
+        m_data.parentCallstackFrameMap.emplace( id, frameData );
+    }
+    m_callstackParentNextIdx = sz;
+
+    f.Read( sz );
+    m_data.parentCallstackPayload.reserve( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        uint16_t csz;
+        f.Read( csz );
+
+        const auto memsize = sizeof( VarArray<CallstackFrameId> ) + csz * sizeof( CallstackFrameId );
+        auto mem = (char*)m_slab.AllocRaw( memsize );
+
+        auto data = (CallstackFrameId*)mem;
+        f.Read( data, csz * sizeof( CallstackFrameId ) );
+
+        auto arr = (VarArray<CallstackFrameId>*)( mem + csz * sizeof( CallstackFrameId ) );
+        new(arr) VarArray<CallstackFrameId>( csz, data );
+
+        m_data.parentCallstackPayload.push_back_no_space_check( arr );
+    }
+
+    f.Read( sz );
+    m_data.symbolStats.reserve( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        uint64_t symAddr, psz;
+        uint32_t incl, excl;
+        f.Read4( symAddr, incl, excl, psz );
+        auto& parents = m_data.symbolStats.emplace( symAddr, SymbolStats { incl, excl, unordered_flat_map<uint32_t, uint32_t>() } ).first->second.parents;
+        parents.reserve( psz );
+        for( uint64_t j=0; j<psz; j++ )
+        {
+            uint32_t idx, count;
+            f.Read2( idx, count );
+            parents.emplace( idx, count );
+        }
+    }
+
+    f.Read( sz );
+    m_data.instructionPointersMap.reserve( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        uint64_t symAddr, isz;
+        f.Read2( symAddr, isz );
+        auto& ipMap = m_data.instructionPointersMap.emplace( symAddr, unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare>() ).first->second;
+        ipMap.reserve( isz );
+        for( uint64_t j=0; j<isz; j++ )
+        {
+            CallstackFrameId ip;
+            uint32_t count;
+            f.Read2( ip, count );
+            ipMap.emplace( ip, count );
+        }
+    }
+
+    f.Read( sz );
+    m_data.ghostFrames.reserve_exact( sz, m_slab );
+    f.Read( m_data.ghostFrames.data(), sizeof( CallstackFrameId ) * sz );
+
+    f.Read( sz );
+    m_data.ghostChildren.reserve( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        uint32_t csz;
+        f.Read( csz );
+        Vector<GhostZone> children;
+        children.reserve_exact( csz, m_slab );
+        f.Read( children.data(), sizeof( GhostZone ) * csz );
+        m_data.ghostChildren.push_back( std::move( children ) );
+    }
+
+    f.Read( sz );
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        uint64_t tid;
+        uint32_t gsz;
+        f.Read2( tid, gsz );
+        auto td = RetrieveThread( tid );
+        if( td )
+        {
+            td->ghostZones.reserve_exact( gsz, m_slab );
+            f.Read( td->ghostZones.data(), sizeof( GhostZone ) * gsz );
+        }
+        else
+        {
+            f.Skip( sizeof( GhostZone ) * gsz );
+        }
+    }
+    f.Read( m_data.ghostCnt );
+
+    m_data.symbolStatsGeneration++;
+    m_data.callstackSamplesReady = true;
+    m_data.ghostZonesReady = true;
+}
+
+// Used to calculate the size of the sample statistics section before it is written.
+struct FileSizeCounter
+{
+    tracy_force_inline void Write( const void*, size_t size ) { total += size; }
+    uint64_t total = 0;
+};
+
+template<typename T>
+void Worker::WriteSampleStatistics( T& f )
+{
+    uint64_t sz = m_data.parentCallstackFrameMap.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& frame : m_data.parentCallstackFrameMap )
+    {
+        f.Write( &frame.first, sizeof( CallstackFrameId ) );
+        f.Write( &frame.second->size, sizeof( frame.second->size ) );
+        f.Write( &frame.second->imageName, sizeof( frame.second->imageName ) );
+        f.Write( frame.second->data, sizeof( CallstackFrame ) * frame.second->size );
+    }
+
+    sz = m_data.parentCallstackPayload.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& cs : m_data.parentCallstackPayload )
+    {
+        uint16_t csz = cs->size();
+        f.Write( &csz, sizeof( csz ) );
+        f.Write( cs->data(), sizeof( CallstackFrameId ) * csz );
+    }
+
+    sz = m_data.symbolStats.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& v : m_data.symbolStats )
+    {
+        uint64_t psz = v.second.parents.size();
+        f.Write( &v.first, sizeof( v.first ) );
+        f.Write( &v.second.incl, sizeof( v.second.incl ) );
+        f.Write( &v.second.excl, sizeof( v.second.excl ) );
+        f.Write( &psz, sizeof( psz ) );
+        for( auto& p : v.second.parents )
+        {
+            f.Write( &p.first, sizeof( p.first ) );
+            f.Write( &p.second, sizeof( p.second ) );
+        }
+    }
+
+    sz = m_data.instructionPointersMap.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& v : m_data.instructionPointersMap )
+    {
+        uint64_t isz = v.second.size();
+        f.Write( &v.first, sizeof( v.first ) );
+        f.Write( &isz, sizeof( isz ) );
+        for( auto& ip : v.second )
+        {
+            f.Write( &ip.first, sizeof( ip.first ) );
+            f.Write( &ip.second, sizeof( ip.second ) );
+        }
+    }
+
+    sz = m_data.ghostFrames.size();
+    f.Write( &sz, sizeof( sz ) );
+    f.Write( m_data.ghostFrames.data(), sizeof( CallstackFrameId ) * sz );
+
+    sz = m_data.ghostChildren.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& v : m_data.ghostChildren )
+    {
+        uint32_t csz = v.size();
+        f.Write( &csz, sizeof( csz ) );
+        f.Write( v.data(), sizeof( GhostZone ) * csz );
+    }
+
+    sz = 0;
+    for( auto& td : m_data.threads ) if( !td->ghostZones.empty() ) sz++;
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& td : m_data.threads )
+    {
+        if( td->ghostZones.empty() ) continue;
+        uint32_t gsz = td->ghostZones.size();
+        f.Write( &td->id, sizeof( td->id ) );
+        f.Write( &gsz, sizeof( gsz ) );
+        f.Write( td->ghostZones.data(), sizeof( GhostZone ) * gsz );
+    }
+    f.Write( &m_data.ghostCnt, sizeof( m_data.ghostCnt ) );
+}
 #endif
 
 int64_t Worker::ReadTimeline( FileRead& f, ZoneEvent* zone, int64_t refTime, int32_t& childIdx )
@@ -6416,14 +7550,14 @@ void Worker::ReadTimelinePre0510( FileRead& f, GpuEvent* zone, int64_t& refTime,
 }
 
 #ifndef TRACY_NO_STATISTICS
-void Worker::ReconstructZoneStatistics( ZoneEvent& zone, uint16_t thread )
+void Worker::ReconstructZoneStatistics( SourceLocationZonesMap& slzMap, ZoneEvent& zone, uint16_t thread )
 {
     assert( zone.IsEndValid() );
     auto timeSpan = zone.End() - zone.Start();
     if( timeSpan > 0 )
     {
-        auto it = m_data.sourceLocationZones.find( zone.SrcLoc() );
-        assert( it != m_data.sourceLocationZones.end() );
+        auto it = slzMap.find( zone.SrcLoc() );
+        if( it == slzMap.end() ) it = slzMap.emplace( zone.SrcLoc(), SourceLocationZones() ).first;
         auto& slz = it->second;
         auto& ztd = slz.zones.push_next();
         ztd.SetZone( &zone );
@@ -6432,6 +7566,7 @@ void Worker::ReconstructZoneStatistics( ZoneEvent& zone, uint16_t thread )
         if( slz.max < timeSpan ) slz.max = timeSpan;
         slz.total += timeSpan;
         slz.sumSq += double( timeSpan ) * timeSpan;
+        slz.hist.Add( timeSpan );
         if( zone.HasChildren() )
         {
             auto& children = GetZoneChildren( zone.Child() );
@@ -6446,7 +7581,199 @@ void Worker::ReconstructZoneStatistics( ZoneEvent& zone, uint16_t thread )
         if( slz.selfMin > timeSpan ) slz.selfMin = timeSpan;
         if( slz.selfMax < timeSpan ) slz.selfMax = timeSpan;
         slz.selfTotal += timeSpan;
+        slz.selfHist.Add( timeSpan );
+    }
+}
+
+// Zones with no duration are not listed. The same rule applies to live captures, imports and loaded traces.
+void Worker::AddSlowZone( Vector<short_ptr<ZoneEvent>>& heap, ZoneEvent* zone )
+{
+    if( zone->End() <= zone->Start() ) return;
+    const auto cmp = [] ( const auto& lhs, const auto& rhs ) { return lhs->End() - lhs->Start() > rhs->End() - rhs->Start(); };
+    if( heap.size() < SlowZonesCount )
+    {
+        heap.push_back( zone );
+        std::push_heap( heap.begin(), heap.end(), cmp );
+    }
+    else if( zone->End() - zone->Start() > heap.front()->End() - heap.front()->Start() )
+    {
+        std::pop_heap( heap.begin(), heap.end(), cmp );
+        heap.back() = zone;
+        std::push_heap( heap.begin(), heap.end(), cmp );
+    }
+}
+
+static tracy_force_inline int64_t MemFreeKey( const MemEvent& ev )
+{
+    const auto t = ev.TimeFree();
+    return t < 0 ? std::numeric_limits<int64_t>::max() : t;
+}
+
+void Worker::AddMemFreeIndex( Vector<Vector<int64_t>>& index, size_t idx ) const
+{
+    const auto key = MemFreeKey( m_data.memory.data[idx] );
+    if( index.empty() ) index.push_next();
+    size_t level = 0;
+    for(;;)
+    {
+        auto& vec = index[level];
+        const auto group = idx >> ( MemFreeIndexShift + level );
+        if( group == vec.size() )
+        {
+            vec.push_back( key );
+        }
+        else
+        {
+            auto& item = vec[group];
+            if( key <= item ) break;
+            item = key;
+        }
+        if( level + 1 == index.size() )
+        {
+            if( vec.size() < 2 ) break;
+            const auto top = std::max( vec[0], vec[1] );
+            index.push_next().push_back( top );
+            break;
+        }
+        level++;
+    }
+}
+
+// Free time of an allocation can only decrease (from not freed), so groups containing it have to be recalculated.
+void Worker::UpdateMemFreeIndex( size_t idx )
+{
+    auto& index = m_data.memory.freeIndex;
+    const auto& data = m_data.memory.data;
+    auto group = idx >> MemFreeIndexShift;
+    const auto first = group << MemFreeIndexShift;
+    const auto last = std::min<size_t>( first + ( 1 << MemFreeIndexShift ), data.size() );
+    int64_t val = std::numeric_limits<int64_t>::min();
+    for( size_t i=first; i<last; i++ ) val = std::max( val, MemFreeKey( data[i] ) );
+    size_t level = 0;
+    for(;;)
+    {
+        auto& item = index[level][group];
+        if( item == val ) break;
+        item = val;
+        if( ++level == index.size() ) break;
+        const auto& prev = index[level-1];
+        group >>= 1;
+        val = prev[group*2];
+        if( group*2+1 < prev.size() ) val = std::max( val, prev[group*2+1] );
+    }
+}
+
+void Worker::CollectActiveMemAllocs( size_t level, size_t group, size_t end, int64_t time, std::vector<const MemEvent*>& out ) const
+{
+    const auto& index = m_data.memory.freeIndex;
+    if( index[level][group] <= time ) return;
+    if( level == 0 )
+    {
+        const auto& data = m_data.memory.data;
+        const auto first = group << MemFreeIndexShift;
+        const auto last = std::min<size_t>( first + ( 1 << MemFreeIndexShift ), end );
+        for( size_t i=first; i<last; i++ )
+        {
+            if( MemFreeKey( data[i] ) > time ) out.emplace_back( &data[i] );
+        }
+    }
+    else
+    {
+        const auto child = group * 2;
+        const auto& lower = index[level-1];
+        for( size_t i=child; i<std::min( child + 2, lower.size() ); i++ )
+        {
+            if( ( i << ( MemFreeIndexShift + level - 1 ) ) >= end ) break;
+            CollectActiveMemAllocs( level - 1, i, end, time, out );
+        }
+    }
+}
+
+void Worker::MergeSourceLocationZones( SourceLocationZones& dst, SourceLocationZones& src )
+{
+    if( dst.zones.empty() )
+    {
+        dst.zones.swap( src.zones );
+    }
+    else
+    {
+        const auto dsz = dst.zones.size();
+        const auto ssz = src.zones.size();
+        dst.zones.reserve( dsz + ssz );
+        memcpy( dst.zones.data() + dsz, src.zones.data(), ssz * sizeof( ZoneThreadData ) );
+        dst.zones.set_size( dsz + ssz );
+    }
+    dst.min = std::min( dst.min, src.min );
+    dst.max = std::max( dst.max, src.max );
+    dst.total += src.total;
+    dst.sumSq += src.sumSq;
+    dst.selfMin = std::min( dst.selfMin, src.selfMin );
+    dst.selfMax = std::max( dst.selfMax, src.selfMax );
+    dst.selfTotal += src.selfTotal;
+    dst.hist.Merge( src.hist );
+    dst.selfHist.Merge( src.selfHist );
+}
+
+void Worker::BuildZoneRangeIndex( SourceLocationZones& slz )
+{
+    auto& zones = slz.zones;
+    const auto sz = zones.size();
+    slz.rangeIndex.reserve_and_use( sz / ZoneRangeIndexStep + 1 );
+    auto ptr = slz.rangeIndex.data();
+    ZoneTimeSum sum = {};
+    for( size_t i=0; i<sz; i++ )
+    {
+        if( i % ZoneRangeIndexStep == 0 ) *ptr++ = sum;
+        auto& zone = *zones[i].Zone();
+        sum.total += zone.End() - zone.Start();
+        sum.selfTotal += GetZoneSelfTime( zone );
+    }
+    if( sz % ZoneRangeIndexStep == 0 ) *ptr++ = sum;
+    assert( ptr == slz.rangeIndex.end() );
+
+    size_t leaves = 1;
+    while( leaves * ZoneRangeIndexStep < sz ) leaves *= 2;
+    slz.rangeEndTree.reserve_and_use( leaves * 2 );
+    auto tree = slz.rangeEndTree.data();
+    for( size_t i=0; i<leaves; i++ ) tree[leaves+i] = std::numeric_limits<int64_t>::min();
+    for( size_t i=0; i<sz; i++ )
+    {
+        auto& leaf = tree[leaves + i / ZoneRangeIndexStep];
+        leaf = std::max( leaf, zones[i].Zone()->End() );
+    }
+    for( size_t i=leaves-1; i>0; i-- ) tree[i] = std::max( tree[i*2], tree[i*2+1] );
+}
+
+Worker::ZoneTimeSum Worker::GetZoneTimePrefix( const SourceLocationZones& slz, size_t idx ) const
+{
+    const auto block = idx / ZoneRangeIndexStep;
+    auto sum = slz.rangeIndex[block];
+    for( size_t i=block*ZoneRangeIndexStep; i<idx; i++ )
+    {
+        auto& zone = *slz.zones[i].Zone();
+        sum.total += zone.End() - zone.Start();
+        sum.selfTotal += GetZoneSelfTime( zone );
+    }
+    return sum;
+}
+
+int64_t Worker::GetZoneSelfTime( const ZoneEvent& zone ) const
+{
+    auto time = zone.End() - zone.Start();
+    if( zone.HasChildren() )
+    {
+        auto& children = GetZoneChildren( zone.Child() );
+        if( children.is_magic() )
+        {
+            auto& c = *(Vector<ZoneEvent>*)( &children );
+            for( auto& v : c ) time -= std::max( int64_t( 0 ), v.End() - v.Start() );
+        }
+        else
+        {
+            for( auto& v : children ) time -= std::max( int64_t( 0 ), v->End() - v->Start() );
+        }
     }
+    return time;
 }
 #else
 void Worker::CountZoneStatistics( ZoneEvent* zone )
@@ -6696,6 +8023,8 @@ void Worker::Disconnect()
 
 void Worker::Write( FileWrite& f )
 {
+    FileSectionTimer sections( m_saveSections, [&f] { return f.GetBytesWritten(); } );
+    sections.Next( "Header" );
     f.Write( FileHeader, sizeof( FileHeader ) );
 
     f.Write( &m_delay, sizeof( m_delay ) );
@@ -6744,6 +8073,7 @@ void Worker::Write( FileWrite& f )
 
     f.Write( &m_data.crashEvent, sizeof( m_data.crashEvent ) );
 
+    sections.Next( "Frames" );
     sz = m_data.frames.Data().size();
     f.Write( &sz, sizeof( sz ) );
     for( auto& fd : m_data.frames.Data() )
@@ -6772,6 +8102,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Strings" );
     sz = m_data.stringData.size();
     f.Write( &sz, sizeof( sz ) );
     for( auto& v : m_data.stringData )
@@ -6815,6 +8146,7 @@ void Worker::Write( FileWrite& f )
     m_data.localThreadCompress.Save( f );
     m_data.externalThreadCompress.Save( f );
 
+    sections.Next( "Source locations" );
     sz = m_data.sourceLocation.size();
     f.Write( &sz, sizeof( sz ) );
     for( auto& v : m_data.sourceLocation )
@@ -6859,6 +8191,7 @@ void Worker::Write( FileWrite& f )
     }
 #endif
 
+    sections.Next( "Locks" );
     sz = m_data.lockMap.size();
     f.Write( &sz, sizeof( sz ) );
     for( auto& v : m_data.lockMap )
@@ -6889,6 +8222,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Messages" );
     {
         int64_t refTime = 0;
         sz = m_data.messages.size();
@@ -6904,6 +8238,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Zones" );
     sz = m_data.zoneExtra.size();
     f.Write( &sz, sizeof( sz ) );
     f.Write( m_data.zoneExtra.data(), sz * sizeof( ZoneExtra ) );
@@ -6938,6 +8273,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "GPU zones" );
     sz = 0;
     for( auto& v : m_data.gpuData ) sz += v->count;
     f.Write( &sz, sizeof( sz ) );
@@ -6963,6 +8299,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Plots" );
     sz = m_data.plots.Data().size();
     for( auto& plot : m_data.plots.Data() ) { if( plot->type == PlotType::Memory ) sz--; }
     f.Write( &sz, sizeof( sz ) );
@@ -6984,6 +8321,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Memory" );
     {
         int64_t refTime = 0;
         sz = m_data.memory.data.size();
@@ -7017,6 +8355,7 @@ void Worker::Write( FileWrite& f )
         f.Write( &m_data.memory.usage, sizeof( m_data.memory.usage ) );
     }
 
+    sections.Next( "Call stacks" );
     sz = m_data.callstackPayload.size() - 1;
     f.Write( &sz, sizeof( sz ) );
     for( size_t i=1; i<=sz; i++ )
@@ -7041,6 +8380,7 @@ void Worker::Write( FileWrite& f )
     f.Write( &sz, sizeof( sz ) );
     if( sz != 0 ) f.Write( m_data.appInfo.data(), sizeof( m_data.appInfo[0] ) * sz );
 
+    sections.Next( "Frame images" );
     {
         TextureCompression texcomp;
         sz = m_data.frameImage.size();
@@ -7055,6 +8395,7 @@ void Worker::Write( FileWrite& f )
         }
     }
 
+    sections.Next( "Context switches" );
     // Only save context switches relevant to active threads.
     std::vector<unordered_flat_map<uint64_t, ContextSwitch*>::const_iterator> ctxValid;
     ctxValid.reserve( m_data.ctxSwitch.size() );
@@ -7079,7 +8420,7 @@ void Worker::Write( FileWrite& f )
             WriteTimeOffset( f, refTime, cs.WakeupVal() );
             WriteTimeOffset( f, refTime, cs.Start() );
             WriteTimeOffset( f, refTime, cs.End() );
-            uint8_t cpu = cs.Cpu();
+            uint16_t cpu = cs.Cpu();
             int8_t reason = cs.Reason();
             int8_t state = cs.State();
             f.Write( &cpu, sizeof( cpu ) );
@@ -7090,7 +8431,9 @@ void Worker::Write( FileWrite& f )
 
     sz = GetContextSwitchPerCpuCount();
     f.Write( &sz, sizeof( sz ) );
-    for( int i=0; i<256; i++ )
+    sz = m_data.cpuData.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( size_t i=0; i<m_data.cpuData.size(); i++ )
     {
         sz = m_data.cpuData[i].cs.size();
         f.Write( &sz, sizeof( sz ) );
@@ -7120,6 +8463,7 @@ void Worker::Write( FileWrite& f )
         f.Write( &v.second, sizeof( v.second ) );
     }
 
+    sections.Next( "Symbols" );
     sz = m_data.symbolLoc.size();
     f.Write( &sz, sizeof( sz ) );
     sz = m_data.symbolLocInline.size();
@@ -7157,6 +8501,25 @@ void Worker::Write( FileWrite& f )
             f.Write( &diff, sizeof( diff ) );
         }
     }
+
+    sections.Next( "Sample statistics" );
+#ifndef TRACY_NO_STATISTICS
+    const uint32_t statsVer = ( m_data.samplesCnt != 0 && m_data.callstackSamplesReady && m_data.ghostZonesReady && m_data.postponedSamples.empty() && m_data.pendingInstructionPointers.empty() ) ? SampleStatisticsVersion : 0;
+#else
+    const uint32_t statsVer = 0;
+#endif
+    f.Write( &statsVer, sizeof( statsVer ) );
+#ifndef TRACY_NO_STATISTICS
+    if( statsVer != 0 )
+    {
+        FileSizeCounter counter;
+        WriteSampleStatistics( counter );
+        f.Write( &counter.total, sizeof( counter.total ) );
+        WriteSampleStatistics( f );
+    }
+#endif
+
+    sections.End();
 }
 
 void Worker::WriteTimeline( FileWrite& f, const Vector<short_ptr<ZoneEvent>>& vec, int64_t& refTime )
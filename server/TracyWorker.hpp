@@ -7,6 +7,7 @@
 #include <mutex>
 #include <shared_mutex>
 #include <stdexcept>
+#include <stdio.h>
 #include <string>
 #include <string.h>
 #include <thread>
@@ -18,6 +19,7 @@
 #include "../common/TracySocket.hpp"
 #include "tracy_robin_hood.h"
 #include "TracyEvent.hpp"
+#include "TracyHistogram.hpp"
 #include "TracyShortPtr.hpp"
 #include "TracySlab.hpp"
 #include "TracyStringDiscovery.hpp"
@@ -87,25 +89,17 @@ struct LoadProgress
     std::atomic<uint64_t> subProgress;
 };
 
+struct FileSectionStats
+{
+    const char* name;
+    int64_t time;
+    uint64_t bytes;
+    int64_t memory;
+};
+
 class Worker
 {
 public:
-    struct ImportEventTimeline
-    {
-        uint64_t tid;
-        uint64_t timestamp;
-        std::string name;
-        std::string text;
-        bool isEnd;
-    };
-
-    struct ImportEventMessages
-    {
-        uint64_t tid;
-        uint64_t timestamp;
-        std::string message;
-    };
-
     struct ZoneThreadData
     {
         tracy_force_inline ZoneEvent* Zone() const { return (ZoneEvent*)( _zone_thread >> 16 ); }
@@ -129,7 +123,20 @@ public:
         uint32_t len;
     };
 
+    struct ZoneRangeStats
+    {
+        int64_t total;
+        int64_t selfTotal;
+        uint64_t count;
+    };
+
 private:
+    struct ZoneTimeSum
+    {
+        int64_t total;
+        int64_t selfTotal;
+    };
+
     struct SourceLocationZones
     {
         Vector<ZoneThreadData> zones;
@@ -140,8 +147,20 @@ private:
         int64_t selfMin = std::numeric_limits<int64_t>::max();
         int64_t selfMax = std::numeric_limits<int64_t>::min();
         int64_t selfTotal = 0;
+        LogHistogram hist;
+        LogHistogram selfHist;
+        // Time sums of all zones preceding each ZoneRangeIndexStep-th zone. Only available if zones
+        // are sorted by start time, which is the case for traces loaded from file. Otherwise (live
+        // captures) range limited statistics have to check every zone of the source location.
+        Vector<ZoneTimeSum> rangeIndex;
+        // Maximum end time of zones in each ZoneRangeIndexStep block, stored as a complete binary
+        // tree (root at index 1, leaves padded to a power of two), used to find zones crossing the
+        // range end without depending on the longest zone time.
+        Vector<int64_t> rangeEndTree;
     };
 
+    using SourceLocationZonesMap = unordered_flat_map<int16_t, SourceLocationZones>;
+
     struct CallstackFrameIdHash
     {
         size_t operator()( const CallstackFrameId& id ) const { return id.data; }
@@ -226,6 +245,7 @@ private:
 #ifndef TRACY_NO_STATISTICS
         unordered_flat_map<int16_t, SourceLocationZones> sourceLocationZones;
         bool sourceLocationZonesReady = false;
+        uint64_t sourceLocationZonesGeneration = 0;
 #else
         unordered_flat_map<int16_t, uint64_t> sourceLocationZonesCnt;
 #endif
@@ -240,6 +260,7 @@ private:
         Vector<uint64_t> symbolLocInline;
         bool newSymbolsWereAdded = false;
         bool newInlineSymbolsWereAdded = false;
+        uint64_t symbolStatsGeneration = 0;
 
 #ifndef TRACY_NO_STATISTICS
         unordered_flat_map<VarArray<CallstackFrameId>*, uint32_t, VarArrayHasher<CallstackFrameId>, VarArrayComparator<CallstackFrameId>> parentCallstackMap;
@@ -260,6 +281,9 @@ private:
         ThreadCompress externalThreadCompress;
 
         Vector<Vector<short_ptr<ZoneEvent>>> zoneChildren;
+#ifndef TRACY_NO_STATISTICS
+        unordered_flat_map<int32_t, ZoneLod> zoneChildrenLod;
+#endif
         Vector<Vector<short_ptr<GpuEvent>>> gpuChildren;
 #ifndef TRACY_NO_STATISTICS
         Vector<Vector<GhostZone>> ghostChildren;
@@ -276,8 +300,7 @@ private:
 
         unordered_flat_map<uint64_t, ContextSwitch*> ctxSwitch;
 
-        CpuData cpuData[256];
-        int cpuDataCount = 0;
+        Vector<CpuData> cpuData;
         unordered_flat_map<uint64_t, uint64_t> tidToPid;
         unordered_flat_map<uint64_t, CpuThreadData> cpuThreadData;
 
@@ -363,8 +386,23 @@ public:
         NUM_FAILURES
     };
 
-    Worker( const char* addr, int port );
-    Worker( const std::string& program, const std::vector<ImportEventTimeline>& timeline, const std::vector<ImportEventMessages>& messages );
+    // Raw network stream recorded with the capture utility, replayed in place of a client connection.
+    struct RawStreamReplay
+    {
+        const char* data;
+        size_t size;
+        bool queueTypeStats;
+    };
+
+    struct QueueTypeStats
+    {
+        uint64_t count;
+        int64_t time;
+    };
+
+    Worker( const char* addr, int port, FILE* rawStream = nullptr );
+    Worker( const RawStreamReplay& replay );
+    Worker( const std::string& program );
     Worker( FileRead& f, EventType::Type eventMask = EventType::All, bool bgTasks = true );
     ~Worker();
 
@@ -417,8 +455,8 @@ public:
         if( m_data.ctxSwitchLast.first == thread ) return m_data.ctxSwitchLast.second;
         return GetContextSwitchDataImpl( thread );
     }
-    const CpuData* GetCpuData() const { return m_data.cpuData; }
-    int GetCpuDataCpuCount() const { return m_data.cpuDataCount; }
+    const CpuData* GetCpuData() const { return m_data.cpuData.data(); }
+    int GetCpuDataCpuCount() const { return (int)m_data.cpuData.size(); }
     uint64_t GetPidFromTid( uint64_t tid ) const;
     const unordered_flat_map<uint64_t, CpuThreadData>& GetCpuThreadData() const { return m_data.cpuThreadData; }
     void GetCpuUsageAtTime( int64_t time, int& own, int& other ) const;
@@ -436,6 +474,7 @@ public:
     const Vector<ThreadData*>& GetThreadData() const { return m_data.threads; }
     const ThreadData* GetThreadData( uint64_t tid ) const;
     const MemData& GetMemData() const { return m_data.memory; }
+    void GetActiveMemAllocs( int64_t time, std::vector<const MemEvent*>& out ) const;
     const Vector<short_ptr<FrameImage>>& GetFrameImages() const { return m_data.frameImage; }
     const Vector<StringRef>& GetAppInfo() const { return m_data.appInfo; }
 
@@ -498,11 +537,19 @@ public:
     const SourceLocationZones& GetZonesForSourceLocation( int16_t srcloc ) const;
     const unordered_flat_map<int16_t, SourceLocationZones>& GetSourceLocationZones() const { return m_data.sourceLocationZones; }
     bool AreSourceLocationZonesReady() const { return m_data.sourceLocationZonesReady; }
+    // Incremented each time zone statistics are updated with a new zone.
+    uint64_t GetSourceLocationZonesGeneration() const { return m_data.sourceLocationZonesGeneration; }
+    std::pair<size_t, size_t> GetZoneRangeCandidates( const SourceLocationZones& slz, int64_t rangeMin, int64_t rangeMax ) const;
+    ZoneRangeStats GetZoneRangeStats( const SourceLocationZones& slz, int64_t rangeMin, int64_t rangeMax ) const;
+    std::pair<double, double> GetPlotRange( const PlotData* plot, size_t begin, size_t end ) const;
+    const ZoneLod* GetZoneChildrenLod( int32_t idx ) const;
     bool IsCpuUsageReady() const { return m_data.ctxUsageReady; }
 
     const unordered_flat_map<uint64_t, SymbolData>& GetSymbolMap() const { return m_data.symbolMap; }
     const unordered_flat_map<uint64_t, SymbolStats>& GetSymbolStats() const { return m_data.symbolStats; }
     const SymbolStats* GetSymbolStats( uint64_t symAddr ) const;
+    // Incremented each time sample statistics are updated.
+    uint64_t GetSymbolStatsGeneration() const { return m_data.symbolStatsGeneration; }
     const unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare>* GetSymbolInstructionPointers( uint64_t symAddr ) const;
     bool AreCallstackSamplesReady() const { return m_data.callstackSamplesReady; }
     bool AreGhostZonesReady() const { return m_data.ghostZonesReady; }
@@ -518,6 +565,7 @@ public:
     size_t GetSendQueueSize() const { return m_mbpsData.queue; }
     size_t GetSendInFlight() const { return m_serverQuerySpaceBase - m_serverQuerySpaceLeft; }
     uint64_t GetDataTransferred() const { return m_mbpsData.transferred; }
+    const QueueTypeStats* GetQueueTypeStats() const { return m_queueTypeStats; }
 
     bool HasData() const { return m_hasData.load( std::memory_order_acquire ); }
     bool IsConnected() const { return m_connected.load( std::memory_order_relaxed ); }
@@ -533,6 +581,8 @@ public:
 
     static const LoadProgress& GetLoadProgress() { return s_loadProgress; }
     int64_t GetLoadTime() const { return m_loadTime; }
+    const std::vector<FileSectionStats>& GetLoadSectionStats() const { return m_loadSections; }
+    const std::vector<FileSectionStats>& GetSaveSectionStats() const { return m_saveSections; }
 
     void ClearFailure() { m_failure = Failure::None; }
     Failure GetFailureType() const { return m_failure; }
@@ -549,13 +599,26 @@ public:
 
     std::pair<uint64_t, uint64_t> GetTextureCompressionBytes() const { return std::make_pair( m_texcomp.GetInputBytesCount(), m_texcomp.GetOutputBytesCount() ); }
 
+    // Building a trace from external data. Events of each thread must be provided in time order,
+    // ImportFinish() has to be called after all events are imported.
+    int16_t ImportSourceLocation( const char* name, size_t sz );
+    void ImportZoneBegin( uint64_t tid, int64_t time, int16_t srcloc, const char* text, size_t sz );
+    void ImportZoneEnd( uint64_t tid, int64_t time );
+    void ImportMessage( uint64_t tid, int64_t time, const char* text, size_t sz );
+    void ImportFinish();
+
 private:
     void Network();
     void Exec();
     void Query( ServerQuery type, uint64_t data, uint32_t extra = 0 );
     void QueryTerminate();
 
+    template<typename ShouldExit>
+    bool ReadStream( void* buf, int len, ShouldExit exitCb );
+    void SendStream( const void* buf, int len );
+
     tracy_force_inline bool DispatchProcess( const QueueItem& ev, const char*& ptr );
+    bool DispatchProcessTimed( const QueueItem& ev, const char*& ptr );
     tracy_force_inline bool Process( const QueueItem& ev );
     tracy_force_inline void ProcessThreadContext( const QueueThreadContext& ev );
     tracy_force_inline void ProcessZoneBegin( const QueueZoneBegin& ev );
@@ -705,6 +768,23 @@ private:
     void HandlePostponedPlots();
     void HandlePostponedSamples();
 
+#ifndef TRACY_NO_STATISTICS
+    void UpdatePlotLod( PlotData* plot, size_t idx );
+    void BuildPlotLod( PlotData* plot, size_t start = 0 );
+
+    void UpdateZoneLod( ZoneLod& lod, const Vector<short_ptr<ZoneEvent>>& vec );
+    template<typename Adapter, typename V>
+    void UpdateZoneLodImpl( ZoneLod& lod, const V& vec );
+    void BuildZoneLod( const Vector<short_ptr<ZoneEvent>>& vec, unordered_flat_map<int32_t, ZoneLod>& childrenLod );
+    void DestroyZoneLod( ZoneLod& lod );
+
+    void AddSlowZone( Vector<short_ptr<ZoneEvent>>& heap, ZoneEvent* zone );
+
+    void AddMemFreeIndex( Vector<Vector<int64_t>>& index, size_t idx ) const;
+    void UpdateMemFreeIndex( size_t idx );
+    void CollectActiveMemAllocs( size_t level, size_t group, size_t end, int64_t time, std::vector<const MemEvent*>& out ) const;
+#endif
+
     bool IsThreadStringRetrieved( uint64_t id );
     bool IsSourceLocationRetrieved( int16_t srcloc );
     bool HasAllFailureData();
@@ -724,6 +804,9 @@ private:
     void UpdateSampleStatistics( uint32_t callstack, uint32_t count, bool canPostpone );
     void UpdateSampleStatisticsPostponed( decltype(Worker::DataBlock::postponedSamples.begin())& it );
     void UpdateSampleStatisticsImpl( const CallstackFrameData** frames, uint16_t framesCount, uint32_t count, const VarArray<CallstackFrameId>& cs );
+    void ReadSampleStatistics( FileRead& f );
+    template<typename T>
+    void WriteSampleStatistics( T& f );
 #endif
 
     tracy_force_inline int64_t ReadTimeline( FileRead& f, ZoneEvent* zone, int64_t refTime, int32_t& childIdx );
@@ -734,7 +817,11 @@ private:
     tracy_force_inline void ReadTimelinePre0510( FileRead& f, GpuEvent* zone, int64_t& refTime, int64_t& refGpuTime, int fileVer );
 
 #ifndef TRACY_NO_STATISTICS
-    tracy_force_inline void ReconstructZoneStatistics( ZoneEvent& zone, uint16_t thread );
+    tracy_force_inline void ReconstructZoneStatistics( SourceLocationZonesMap& slzMap, ZoneEvent& zone, uint16_t thread );
+    void MergeSourceLocationZones( SourceLocationZones& dst, SourceLocationZones& src );
+    void BuildZoneRangeIndex( SourceLocationZones& slz );
+    ZoneTimeSum GetZoneTimePrefix( const SourceLocationZones& slz, size_t idx ) const;
+    int64_t GetZoneSelfTime( const ZoneEvent& zone ) const;
 #else
     tracy_force_inline void CountZoneStatistics( ZoneEvent* zone );
 #endif
@@ -764,6 +851,12 @@ private:
     std::string m_addr;
     int m_port;
 
+    FILE* m_rawStream = nullptr;
+    const char* m_replayPtr = nullptr;
+    const char* m_replayEnd = nullptr;
+    bool m_queueTypeStatsEnabled = false;
+    QueueTypeStats m_queueTypeStats[(int)QueueType::NUM_TYPES] = {};
+
     std::thread m_thread;
     std::thread m_threadNet;
     std::atomic<bool> m_connected { false };
@@ -830,6 +923,8 @@ private:
 
     static LoadProgress s_loadProgress;
     int64_t m_loadTime;
+    std::vector<FileSectionStats> m_loadSections;
+    std::vector<FileSectionStats> m_saveSections;
 
     Failure m_failure = Failure::None;
     FailureData m_failureData;
@@ -0,0 +1,939 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <inttypes.h>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../common/TracyAlloc.hpp"
+#include "../../common/TracyProtocol.hpp"
+#include "../../common/TracyQueue.hpp"
+#include "../../common/TracySocket.hpp"
+#include "../../common/tracy_lz4.hpp"
+#include "../../server/TracyFileWrite.hpp"
+#include "../../server/TracyMemory.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+
+void Usage()
+{
+    printf( "Usage: tracegen -o output.tracy [-t threads] [-n zones] [-r rate] [-d depth] [-f fanout] [-u srclocs]\n" );
+    printf( "                [-l locks] [-p plots] [-m] [-c every] [-F fps] [-s seed] [-w rawstream]\n\n" );
+    printf( "Generates a synthetic trace by streaming client events into the server.\n\n" );
+    printf( "  -t threads: number of threads (default 4)\n" );
+    printf( "  -n zones: total number of zones (default 1000000)\n" );
+    printf( "  -r rate: zones per second, per thread (default 1000000)\n" );
+    printf( "  -d depth: maximum zone depth (default 8)\n" );
+    printf( "  -f fanout: average number of child zones (default 2)\n" );
+    printf( "  -u srclocs: number of zone source locations (default 256)\n" );
+    printf( "  -l locks: number of locks, taken by each leaf zone (default 0)\n" );
+    printf( "  -p plots: number of plots, updated at each root zone (default 0)\n" );
+    printf( "  -m: allocate memory in each zone\n" );
+    printf( "  -c every: collect call stack in every n-th zone (default 0, disabled)\n" );
+    printf( "  -F fps: frame rate of the frame marks (default 60)\n" );
+    printf( "  -s seed: random generator seed (default 1)\n" );
+    printf( "  -w rawstream: also save the raw network stream, for use with the replay utility\n" );
+    exit( 1 );
+}
+
+struct Options
+{
+    int threads = 4;
+    uint64_t zones = 1000000;
+    uint64_t rate = 1000000;
+    int depth = 8;
+    int fanout = 2;
+    uint32_t srclocs = 256;
+    uint32_t locks = 0;
+    uint32_t plots = 0;
+    bool memory = false;
+    uint32_t callstackEvery = 0;
+    uint32_t fps = 60;
+    uint64_t seed = 1;
+};
+
+// Fake pointers, as seen by the server. Each kind of data lives in its own range, so that
+// query handling can tell them apart.
+enum : uint64_t { StringBase = 0x10000000, StringStride = 16 };
+enum : uint64_t { SrcLocBase = 0x20000000, SrcLocStride = 64 };
+enum : uint64_t { FrameBase = 0x400000, FrameStride = 0x100 };
+enum : uint64_t { CustomStringBase = 0x7000000000000000 };
+enum : uint64_t { ThreadIdBase = 1000 };
+enum { LiveAllocations = 64 };
+enum { ThreadFlushSize = 32 * 1024 };
+
+enum class EventType : uint8_t
+{
+    ZoneBegin,
+    ZoneEnd,
+    PlotData,
+    LockWait,
+    LockObtain,
+    LockRelease,
+    MemAlloc,
+    MemFree
+};
+
+struct Event
+{
+    int64_t time;
+    EventType type;
+    uint32_t idx;
+    uint64_t val;
+};
+
+struct ZoneFrame
+{
+    uint32_t srcloc;
+    uint32_t children;
+    uint32_t childIdx;
+};
+
+struct ThreadState
+{
+    uint32_t idx;
+    uint64_t tid;
+    std::mt19937_64 rng;
+    uint64_t quota;
+    int64_t cursor;
+    uint64_t zoneCounter;
+    std::vector<ZoneFrame> stack;
+    std::vector<Event> pending;
+    size_t head;
+
+    std::vector<uint64_t> live;
+    size_t liveHead;
+    uint64_t nextAddr;
+
+    // Main queue items are batched per thread, like the client does, so that the stream is not
+    // dominated by thread context switches.
+    std::vector<char> buf;
+    int64_t refTime;
+};
+
+struct SrcLoc
+{
+    uint32_t name;
+    uint32_t function;
+    uint32_t file;
+    uint32_t line;
+    uint32_t color;
+};
+
+class Generator
+{
+public:
+    Generator( const Options& opt, tracy::Socket& sock )
+        : m_opt( opt )
+        , m_sock( sock )
+        , m_buffer( new char[tracy::TargetFrameSize*3] )
+        , m_bufferOffset( 0 )
+        , m_bufferStart( 0 )
+        , m_lz4Buf( new char[tracy::LZ4Size + sizeof( tracy::lz4sz_t )] )
+        , m_stream( tracy::LZ4_createStream() )
+        , m_refTimeSerial( 0 )
+        , m_callstackId( 0 )
+        , m_customStringId( 0 )
+        , m_connected( true )
+        , m_events( 0 )
+        , m_zones( 0 )
+        , m_streamBytes( 0 )
+    {
+        const auto modules = std::max<uint32_t>( 1, m_opt.srclocs / 16 );
+        for( uint32_t i=0; i<modules; i++ )
+        {
+            char tmp[64];
+            sprintf( tmp, "src/module%02" PRIu32 ".cpp", i );
+            m_moduleFiles.push_back( AddString( tmp ) );
+        }
+        for( uint32_t i=0; i<m_opt.srclocs; i++ )
+        {
+            char tmp[64];
+            sprintf( tmp, "Module%02" PRIu32 "::Task%03" PRIu32, i % modules, i );
+            const auto line = 10 + ( i / modules ) * 25;
+            m_srclocs.emplace_back( SrcLoc { std::numeric_limits<uint32_t>::max(), AddString( tmp ), m_moduleFiles[i % modules], line, 0 } );
+        }
+        if( m_opt.locks > 0 )
+        {
+            const auto file = AddString( "src/locks.cpp" );
+            const auto function = AddString( "SharedState" );
+            for( uint32_t i=0; i<m_opt.locks; i++ )
+            {
+                char tmp[64];
+                sprintf( tmp, "Lock %" PRIu32, i );
+                m_srclocs.emplace_back( SrcLoc { AddString( tmp ), function, file, 10 + i, 0 } );
+            }
+            m_lockFreeAt.resize( m_opt.locks, 0 );
+        }
+        for( uint32_t i=0; i<m_opt.plots; i++ )
+        {
+            char tmp[64];
+            sprintf( tmp, "Plot %" PRIu32, i );
+            m_plotNames.push_back( AddString( tmp ) );
+        }
+        m_plotValues.resize( m_opt.plots, 0 );
+        m_imageName = AddString( "synthetic" );
+
+        m_slot = std::max<int64_t>( 2, int64_t( 1000000000ull / m_opt.rate ) );
+
+        const auto perThread = m_opt.zones / m_opt.threads;
+        const auto extra = m_opt.zones % m_opt.threads;
+        m_threads.resize( m_opt.threads );
+        for( int i=0; i<m_opt.threads; i++ )
+        {
+            auto& t = m_threads[i];
+            t.idx = i;
+            t.tid = ThreadIdBase + i;
+            t.rng.seed( m_opt.seed ^ ( uint64_t( i ) * 0x9E3779B97F4A7C15ull ) );
+            t.quota = perThread + ( uint64_t( i ) < extra ? 1 : 0 );
+            t.cursor = StartTime;
+            t.zoneCounter = 0;
+            t.head = 0;
+            t.liveHead = 0;
+            t.nextAddr = 0;
+            t.refTime = 0;
+        }
+    }
+
+    ~Generator()
+    {
+        tracy::LZ4_freeStream( (tracy::LZ4_stream_t*)m_stream );
+    }
+
+    bool Run()
+    {
+        WriteWelcome();
+
+        for( uint32_t i=0; i<m_opt.locks; i++ )
+        {
+            tracy::QueueItem item;
+            item.hdr.type = tracy::QueueType::LockAnnounce;
+            item.lockAnnounce.id = i;
+            item.lockAnnounce.time = StartTime;
+            item.lockAnnounce.lckloc = SrcLocBase + ( m_opt.srclocs + i ) * SrcLocStride;
+            item.lockAnnounce.type = tracy::LockType::Lockable;
+            AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::LockAnnounce] );
+        }
+
+        // Events of all threads are merged in time order, which is required by the serial
+        // queue (locks, memory) and by frame marks. The frame mark generator uses the last slot.
+        typedef std::pair<int64_t, uint32_t> HeapItem;
+        std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+        int active = 0;
+        for( auto& t : m_threads )
+        {
+            if( Generate( t ) )
+            {
+                heap.emplace( t.pending[0].time, t.idx );
+                active++;
+            }
+        }
+        const auto frameTime = m_opt.fps == 0 ? 0 : int64_t( 1000000000ull / m_opt.fps );
+        int64_t nextFrame = StartTime + frameTime;
+        if( frameTime > 0 ) heap.emplace( nextFrame, m_opt.threads );
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        while( !heap.empty() && m_connected )
+        {
+            const auto top = heap.top();
+            heap.pop();
+            if( top.second == uint32_t( m_opt.threads ) )
+            {
+                if( active == 0 ) continue;
+                tracy::QueueItem item;
+                item.hdr.type = tracy::QueueType::FrameMarkMsg;
+                item.frameMark.time = nextFrame;
+                item.frameMark.name = 0;
+                AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::FrameMarkMsg] );
+                nextFrame += frameTime;
+                heap.emplace( nextFrame, top.second );
+            }
+            else
+            {
+                auto& t = m_threads[top.second];
+                Emit( t, t.pending[t.head++] );
+                if( t.head == t.pending.size() && !Generate( t ) )
+                {
+                    FlushThread( t );
+                    active--;
+                }
+                else
+                {
+                    heap.emplace( t.pending[t.head].time, top.second );
+                }
+            }
+
+            if( ( ++m_events & 0xFFF ) == 0 )
+            {
+                while( m_connected && m_sock.HasData() )
+                {
+                    if( !HandleServerQuery() ) m_connected = false;
+                }
+                if( ( m_events & 0xFFFFF ) == 0 )
+                {
+                    const auto t1 = std::chrono::high_resolution_clock::now();
+                    const auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+                    printf( "\33[2K\r\033[36;1m%7.2f%%\033[0m | %s zones | %s events/s | %s stream | %s memory",
+                        100. * m_zones / std::max<uint64_t>( 1, m_opt.zones ), tracy::RealToString( m_zones ),
+                        tracy::RealToString( uint64_t( m_events / ( dt / 1e9 ) ) ), tracy::MemSizeToString( m_streamBytes ),
+                        tracy::MemSizeToString( tracy::memUsage ) );
+                    fflush( stdout );
+                }
+            }
+        }
+        if( !m_connected ) return false;
+        if( m_bufferOffset != m_bufferStart ) CommitData();
+
+        // Send client termination notice and answer the remaining server queries.
+        tracy::QueueItem terminate;
+        terminate.hdr.type = tracy::QueueType::Terminate;
+        if( !SendData( (const char*)&terminate, 1 ) ) return false;
+        for(;;)
+        {
+            if( m_sock.HasData() )
+            {
+                while( m_sock.HasData() )
+                {
+                    if( !HandleServerQuery() ) return true;
+                }
+                if( m_bufferOffset != m_bufferStart )
+                {
+                    if( !CommitData() ) return false;
+                }
+            }
+            else
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+            }
+        }
+    }
+
+    uint64_t GetEventCount() const { return m_events; }
+    uint64_t GetStreamBytes() const { return m_streamBytes; }
+
+private:
+    enum { StartTime = 1000 };
+
+    uint32_t AddString( const char* str )
+    {
+        m_strings.emplace_back( str );
+        return uint32_t( m_strings.size() - 1 );
+    }
+
+    uint64_t StringPtr( uint32_t idx ) const { return StringBase + idx * StringStride; }
+
+    const char* GetString( uint64_t ptr ) const
+    {
+        if( ptr < StringBase ) return "???";
+        const auto idx = ( ptr - StringBase ) / StringStride;
+        if( idx >= m_strings.size() ) return "???";
+        return m_strings[idx].c_str();
+    }
+
+    int64_t Gap( ThreadState& t )
+    {
+        // Half of the zone self time, jittered by +-50%.
+        return std::max<int64_t>( 1, m_slot / 4 + int64_t( t.rng() % uint64_t( m_slot / 2 + 1 ) ) );
+    }
+
+    void BeginZone( ThreadState& t, uint32_t srcloc )
+    {
+        const auto depth = t.stack.size();
+        t.quota--;
+        m_zones++;
+
+        const uint32_t children = int( depth ) + 1 < m_opt.depth ? uint32_t( t.rng() % uint64_t( m_opt.fanout * 2 + 1 ) ) : 0;
+        const bool callstack = m_opt.callstackEvery != 0 && ++t.zoneCounter % m_opt.callstackEvery == 0;
+        t.stack.emplace_back( ZoneFrame { srcloc, children, 0 } );
+
+        t.pending.emplace_back( Event { t.cursor, EventType::ZoneBegin, srcloc, callstack } );
+        if( depth == 0 )
+        {
+            for( uint32_t i=t.idx; i<m_opt.plots; i+=m_opt.threads )
+            {
+                t.pending.emplace_back( Event { t.cursor, EventType::PlotData, i, 0 } );
+            }
+        }
+        if( m_opt.memory )
+        {
+            const auto size = uint32_t( 16 ) << ( t.rng() % 13 );
+            const auto ptr = ( uint64_t( t.idx + 1 ) << 40 ) | t.nextAddr;
+            t.nextAddr = ( t.nextAddr + size ) & ( ( 1ull << 40 ) - 1 );
+            if( t.live.size() < LiveAllocations )
+            {
+                t.live.emplace_back( ptr );
+            }
+            else
+            {
+                t.pending.emplace_back( Event { t.cursor, EventType::MemFree, 0, t.live[t.liveHead] } );
+                t.live[t.liveHead] = ptr;
+                t.liveHead = ( t.liveHead + 1 ) % LiveAllocations;
+            }
+            t.pending.emplace_back( Event { t.cursor, EventType::MemAlloc, size, ptr } );
+        }
+        t.cursor += Gap( t );
+
+        if( children == 0 && m_opt.locks > 0 )
+        {
+            // Lock holds are handed out in generation order, which keeps them mutually exclusive,
+            // even if a thread generates its wait slightly later than another one.
+            const auto lock = uint32_t( t.rng() % m_opt.locks );
+            const auto wait = t.cursor;
+            const auto obtain = std::max( wait, m_lockFreeAt[lock] + 1 );
+            const auto release = obtain + Gap( t );
+            m_lockFreeAt[lock] = release;
+            t.pending.emplace_back( Event { wait, EventType::LockWait, lock, 0 } );
+            t.pending.emplace_back( Event { obtain, EventType::LockObtain, lock, 0 } );
+            t.pending.emplace_back( Event { release, EventType::LockRelease, lock, 0 } );
+            t.cursor = release;
+        }
+    }
+
+    bool Generate( ThreadState& t )
+    {
+        t.pending.clear();
+        t.head = 0;
+        if( t.stack.empty() )
+        {
+            if( t.quota == 0 ) return false;
+            BeginZone( t, uint32_t( t.rng() % m_opt.srclocs ) );
+        }
+        else
+        {
+            auto& top = t.stack.back();
+            if( top.childIdx < top.children && t.quota > 0 )
+            {
+                // Children are derived from the parent, so that the same call trees repeat.
+                const auto srcloc = uint32_t( ( uint64_t( top.srcloc ) * 2654435761ull + top.childIdx + 1 ) % m_opt.srclocs );
+                top.childIdx++;
+                BeginZone( t, srcloc );
+            }
+            else
+            {
+                t.cursor += Gap( t );
+                t.pending.emplace_back( Event { t.cursor, EventType::ZoneEnd, 0, 0 } );
+                t.stack.pop_back();
+            }
+        }
+        return true;
+    }
+
+    int64_t ThreadTime( ThreadState& t, int64_t time )
+    {
+        const auto dt = time - t.refTime;
+        t.refTime = time;
+        return dt;
+    }
+
+    int64_t SerialTime( int64_t time )
+    {
+        const auto dt = time - m_refTimeSerial;
+        m_refTimeSerial = time;
+        return dt;
+    }
+
+    void ThreadAppend( ThreadState& t, const void* data, size_t len )
+    {
+        const auto sz = t.buf.size();
+        t.buf.resize( sz + len );
+        memcpy( t.buf.data() + sz, data, len );
+    }
+
+    void FlushThread( ThreadState& t )
+    {
+        if( t.buf.empty() ) return;
+        tracy::QueueItem item;
+        item.hdr.type = tracy::QueueType::ThreadContext;
+        item.threadCtx.thread = t.tid;
+        const auto sz = tracy::QueueDataSize[(int)tracy::QueueType::ThreadContext];
+        NeedDataSize( sz + t.buf.size() );
+        AppendDataUnsafe( &item, sz );
+        AppendDataUnsafe( t.buf.data(), t.buf.size() );
+        t.buf.clear();
+        t.refTime = 0;
+    }
+
+    void Emit( ThreadState& t, const Event& ev )
+    {
+        tracy::QueueItem item;
+        switch( ev.type )
+        {
+        case EventType::ZoneBegin:
+        {
+            item.hdr.type = ev.val ? tracy::QueueType::ZoneBeginCallstack : tracy::QueueType::ZoneBegin;
+            item.zoneBegin.time = ThreadTime( t, ev.time );
+            item.zoneBegin.srcloc = SrcLocBase + ev.idx * SrcLocStride;
+            ThreadAppend( t, &item, tracy::QueueDataSize[item.hdr.idx] );
+            if( ev.val )
+            {
+                // Call stack frames mirror the zone stack, innermost first.
+                item.hdr.type = tracy::QueueType::CallstackPayload;
+                item.stringTransfer.ptr = ++m_callstackId;
+                ThreadAppend( t, &item, tracy::QueueDataSize[item.hdr.idx] );
+                const auto l16 = uint16_t( t.stack.size() * sizeof( uint64_t ) );
+                ThreadAppend( t, &l16, sizeof( l16 ) );
+                for( auto it = t.stack.rbegin(); it != t.stack.rend(); ++it )
+                {
+                    const uint64_t frame = FrameBase + it->srcloc * FrameStride;
+                    ThreadAppend( t, &frame, sizeof( frame ) );
+                }
+                item.hdr.type = tracy::QueueType::CallstackLean;
+                ThreadAppend( t, &item, tracy::QueueDataSize[item.hdr.idx] );
+            }
+            break;
+        }
+        case EventType::ZoneEnd:
+            item.hdr.type = tracy::QueueType::ZoneEnd;
+            item.zoneEnd.time = ThreadTime( t, ev.time );
+            ThreadAppend( t, &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        case EventType::PlotData:
+        {
+            std::normal_distribution<double> dist;
+            m_plotValues[ev.idx] += dist( t.rng );
+            item.hdr.type = tracy::QueueType::PlotData;
+            item.plotData.name = StringPtr( m_plotNames[ev.idx] );
+            item.plotData.time = ThreadTime( t, ev.time );
+            item.plotData.type = tracy::PlotDataType::Double;
+            item.plotData.data.d = m_plotValues[ev.idx];
+            ThreadAppend( t, &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        }
+        case EventType::LockWait:
+            item.hdr.type = tracy::QueueType::LockWait;
+            item.lockWait.thread = t.tid;
+            item.lockWait.id = ev.idx;
+            item.lockWait.time = SerialTime( ev.time );
+            item.lockWait.type = tracy::LockType::Lockable;
+            AppendData( &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        case EventType::LockObtain:
+            item.hdr.type = tracy::QueueType::LockObtain;
+            item.lockObtain.thread = t.tid;
+            item.lockObtain.id = ev.idx;
+            item.lockObtain.time = SerialTime( ev.time );
+            AppendData( &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        case EventType::LockRelease:
+            item.hdr.type = tracy::QueueType::LockRelease;
+            item.lockRelease.thread = t.tid;
+            item.lockRelease.id = ev.idx;
+            item.lockRelease.time = SerialTime( ev.time );
+            AppendData( &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        case EventType::MemAlloc:
+        {
+            const uint64_t size = ev.idx;
+            item.hdr.type = tracy::QueueType::MemAlloc;
+            item.memAlloc.time = SerialTime( ev.time );
+            item.memAlloc.thread = t.tid;
+            item.memAlloc.ptr = ev.val;
+            memcpy( item.memAlloc.size, &size, 6 );
+            AppendData( &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        }
+        case EventType::MemFree:
+            item.hdr.type = tracy::QueueType::MemFree;
+            item.memFree.time = SerialTime( ev.time );
+            item.memFree.thread = t.tid;
+            item.memFree.ptr = ev.val;
+            AppendData( &item, tracy::QueueDataSize[item.hdr.idx] );
+            break;
+        default:
+            assert( false );
+            break;
+        }
+        if( t.buf.size() >= ThreadFlushSize ) FlushThread( t );
+    }
+
+    void WriteWelcome()
+    {
+        tracy::WelcomeMessage welcome;
+        memset( &welcome, 0, sizeof( welcome ) );
+        welcome.timerMul = 1.;
+        welcome.initBegin = 0;
+        welcome.initEnd = StartTime;
+        welcome.resolution = 1;
+        welcome.epoch = 1577836800;     // fixed, so that output files are reproducible
+        welcome.pid = 1;
+        welcome.cpuArch = tracy::CpuArchX64;
+        memcpy( welcome.cpuManufacturer, "Synthetic   ", 12 );
+        strcpy( welcome.programName, "tracegen" );
+        snprintf( welcome.hostInfo, tracy::WelcomeMessageHostInfoSize,
+            "Synthetic trace\nSeed: %" PRIu64 "\nThreads: %i\nZones: %" PRIu64 "\nRate: %" PRIu64 " zones/s\nDepth: %i\nFan-out: %i\nSource locations: %" PRIu32 "\nLocks: %" PRIu32 "\nPlots: %" PRIu32 "\nMemory: %s\nCall stack every: %" PRIu32 "\n",
+            m_opt.seed, m_opt.threads, m_opt.zones, m_opt.rate, m_opt.depth, m_opt.fanout, m_opt.srclocs, m_opt.locks, m_opt.plots,
+            m_opt.memory ? "yes" : "no", m_opt.callstackEvery );
+
+        const auto status = tracy::HandshakeWelcome;
+        m_sock.Send( &status, sizeof( status ) );
+        m_sock.Send( &welcome, sizeof( welcome ) );
+    }
+
+    bool AppendData( const void* data, size_t len )
+    {
+        const auto ret = NeedDataSize( len );
+        AppendDataUnsafe( data, len );
+        return ret;
+    }
+
+    bool NeedDataSize( size_t len )
+    {
+        assert( len <= tracy::TargetFrameSize );
+        bool ret = true;
+        if( m_bufferOffset - m_bufferStart + len > tracy::TargetFrameSize )
+        {
+            ret = CommitData();
+        }
+        return ret;
+    }
+
+    void AppendDataUnsafe( const void* data, size_t len )
+    {
+        memcpy( m_buffer.get() + m_bufferOffset, data, len );
+        m_bufferOffset += int( len );
+    }
+
+    bool CommitData()
+    {
+        bool ret = SendData( m_buffer.get() + m_bufferStart, m_bufferOffset - m_bufferStart );
+        if( m_bufferOffset > tracy::TargetFrameSize * 2 ) m_bufferOffset = 0;
+        m_bufferStart = m_bufferOffset;
+        return ret;
+    }
+
+    bool SendData( const char* data, size_t len )
+    {
+        const tracy::lz4sz_t lz4sz = tracy::LZ4_compress_fast_continue( (tracy::LZ4_stream_t*)m_stream, data, m_lz4Buf.get() + sizeof( tracy::lz4sz_t ), (int)len, tracy::LZ4Size, 1 );
+        memcpy( m_lz4Buf.get(), &lz4sz, sizeof( lz4sz ) );
+        m_streamBytes += len;
+        if( m_sock.Send( m_lz4Buf.get(), lz4sz + sizeof( tracy::lz4sz_t ) ) == -1 ) m_connected = false;
+        return m_connected;
+    }
+
+    void SendString( uint64_t ptr, const char* str, tracy::QueueType type )
+    {
+        tracy::QueueItem item;
+        item.hdr.type = type;
+        item.stringTransfer.ptr = ptr;
+        const auto l16 = uint16_t( strlen( str ) );
+        NeedDataSize( tracy::QueueDataSize[(int)type] + sizeof( l16 ) + l16 );
+        AppendDataUnsafe( &item, tracy::QueueDataSize[(int)type] );
+        AppendDataUnsafe( &l16, sizeof( l16 ) );
+        AppendDataUnsafe( str, l16 );
+    }
+
+    uint64_t SendCustomString( const char* str )
+    {
+        // Custom strings are matched by pointer and consumed by the server, so each needs a fresh one.
+        const auto ptr = CustomStringBase + m_customStringId++;
+        SendString( ptr, str, tracy::QueueType::CustomStringData );
+        return ptr;
+    }
+
+    const SrcLoc* GetFrameSrcLoc( uint64_t ptr ) const
+    {
+        if( ptr < FrameBase ) return nullptr;
+        const auto idx = ( ptr - FrameBase ) / FrameStride;
+        if( idx >= m_opt.srclocs ) return nullptr;
+        return &m_srclocs[idx];
+    }
+
+    void SendSourceLocation( uint64_t ptr )
+    {
+        const auto idx = ( ptr - SrcLocBase ) / SrcLocStride;
+        tracy::QueueItem item;
+        item.hdr.type = tracy::QueueType::SourceLocation;
+        if( ptr < SrcLocBase || idx >= m_srclocs.size() )
+        {
+            item.srcloc.name = 0;
+            item.srcloc.function = StringPtr( m_imageName );
+            item.srcloc.file = StringPtr( m_imageName );
+            item.srcloc.line = 0;
+            item.srcloc.r = item.srcloc.g = item.srcloc.b = 0;
+        }
+        else
+        {
+            auto& srcloc = m_srclocs[idx];
+            item.srcloc.name = srcloc.name == std::numeric_limits<uint32_t>::max() ? 0 : StringPtr( srcloc.name );
+            item.srcloc.function = StringPtr( srcloc.function );
+            item.srcloc.file = StringPtr( srcloc.file );
+            item.srcloc.line = srcloc.line;
+            item.srcloc.r = uint8_t( ( srcloc.color       ) & 0xFF );
+            item.srcloc.g = uint8_t( ( srcloc.color >> 8  ) & 0xFF );
+            item.srcloc.b = uint8_t( ( srcloc.color >> 16 ) & 0xFF );
+        }
+        AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::SourceLocation] );
+    }
+
+    void SendCallstackFrame( uint64_t ptr )
+    {
+        auto srcloc = GetFrameSrcLoc( ptr );
+
+        tracy::QueueItem item;
+        item.hdr.type = tracy::QueueType::CallstackFrameSize;
+        item.callstackFrameSize.imageName = SendCustomString( m_strings[m_imageName].c_str() );
+        item.callstackFrameSize.ptr = ptr;
+        item.callstackFrameSize.size = 1;
+        AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::CallstackFrameSize] );
+
+        item.hdr.type = tracy::QueueType::CallstackFrame;
+        item.callstackFrame.name = SendCustomString( srcloc ? m_strings[srcloc->function].c_str() : "[unknown]" );
+        item.callstackFrame.file = SendCustomString( srcloc ? m_strings[srcloc->file].c_str() : "[unknown]" );
+        item.callstackFrame.line = srcloc ? srcloc->line : 0;
+        item.callstackFrame.symAddr = srcloc ? ptr : 0;
+        memset( item.callstackFrame.symLen, 0, 3 );
+        AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::CallstackFrame] );
+    }
+
+    void SendSymbol( uint64_t ptr )
+    {
+        auto srcloc = GetFrameSrcLoc( ptr );
+
+        tracy::QueueItem item;
+        item.hdr.type = tracy::QueueType::SymbolInformation;
+        item.symbolInformation.file = SendCustomString( srcloc ? m_strings[srcloc->file].c_str() : "[unknown]" );
+        item.symbolInformation.line = srcloc ? srcloc->line : 0;
+        item.symbolInformation.symAddr = ptr;
+        AppendData( &item, tracy::QueueDataSize[(int)tracy::QueueType::SymbolInformation] );
+    }
+
+    bool HandleServerQuery()
+    {
+        tracy::ServerQueryPacket payload;
+        if( !m_sock.Read( &payload, sizeof( payload ), 10 ) ) return false;
+
+        switch( payload.type )
+        {
+        case tracy::ServerQueryString:
+            SendString( payload.ptr, GetString( payload.ptr ), tracy::QueueType::StringData );
+            break;
+        case tracy::ServerQueryThreadString:
+        {
+            char tmp[64];
+            sprintf( tmp, "Thread %" PRIu64, payload.ptr - ThreadIdBase );
+            SendString( payload.ptr, tmp, tracy::QueueType::ThreadName );
+            break;
+        }
+        case tracy::ServerQuerySourceLocation:
+            SendSourceLocation( payload.ptr );
+            break;
+        case tracy::ServerQueryPlotName:
+            SendString( payload.ptr, GetString( payload.ptr ), tracy::QueueType::PlotName );
+            break;
+        case tracy::ServerQueryTerminate:
+            return false;
+        case tracy::ServerQueryCallstackFrame:
+            SendCallstackFrame( payload.ptr );
+            break;
+        case tracy::ServerQueryFrameName:
+            SendString( payload.ptr, GetString( payload.ptr ), tracy::QueueType::FrameName );
+            break;
+        case tracy::ServerQueryDisconnect:
+            return false;
+        case tracy::ServerQuerySymbol:
+            SendSymbol( payload.ptr );
+            break;
+        default:
+            // Symbol code, external names and parameters are never advertised.
+            break;
+        }
+        return true;
+    }
+
+    Options m_opt;
+    tracy::Socket& m_sock;
+
+    std::unique_ptr<char[]> m_buffer;
+    int m_bufferOffset;
+    int m_bufferStart;
+    std::unique_ptr<char[]> m_lz4Buf;
+    void* m_stream;
+
+    std::vector<std::string> m_strings;
+    std::vector<uint32_t> m_moduleFiles;
+    std::vector<SrcLoc> m_srclocs;
+    std::vector<uint32_t> m_plotNames;
+    std::vector<double> m_plotValues;
+    std::vector<int64_t> m_lockFreeAt;
+    uint32_t m_imageName;
+    int64_t m_slot;
+
+    std::vector<ThreadState> m_threads;
+    int64_t m_refTimeSerial;
+    uint64_t m_callstackId;
+    uint64_t m_customStringId;
+    bool m_connected;
+
+    uint64_t m_events;
+    uint64_t m_zones;
+    uint64_t m_streamBytes;
+};
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    Options opt;
+    const char* output = nullptr;
+    const char* rawStream = nullptr;
+
+    int c;
+    while( ( c = getopt( argc, argv, "o:t:n:r:d:f:u:l:p:mc:F:s:w:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 'o':
+            output = optarg;
+            break;
+        case 't':
+            opt.threads = atoi( optarg );
+            if( opt.threads < 1 ) Usage();
+            break;
+        case 'n':
+            opt.zones = strtoull( optarg, nullptr, 10 );
+            break;
+        case 'r':
+            opt.rate = strtoull( optarg, nullptr, 10 );
+            if( opt.rate == 0 ) Usage();
+            break;
+        case 'd':
+            opt.depth = atoi( optarg );
+            if( opt.depth < 1 || opt.depth > 255 ) Usage();
+            break;
+        case 'f':
+            opt.fanout = atoi( optarg );
+            if( opt.fanout < 0 ) Usage();
+            break;
+        case 'u':
+            opt.srclocs = uint32_t( atoi( optarg ) );
+            if( opt.srclocs < 1 || opt.srclocs > 16384 ) Usage();
+            break;
+        case 'l':
+            opt.locks = uint32_t( atoi( optarg ) );
+            break;
+        case 'p':
+            opt.plots = uint32_t( atoi( optarg ) );
+            break;
+        case 'm':
+            opt.memory = true;
+            break;
+        case 'c':
+            opt.callstackEvery = uint32_t( atoi( optarg ) );
+            break;
+        case 'F':
+            opt.fps = uint32_t( atoi( optarg ) );
+            break;
+        case 's':
+            opt.seed = strtoull( optarg, nullptr, 10 );
+            break;
+        case 'w':
+            rawStream = optarg;
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( !output ) Usage();
+
+    FILE* rawStreamFile = nullptr;
+    if( rawStream )
+    {
+        rawStreamFile = fopen( rawStream, "wb" );
+        if( !rawStreamFile )
+        {
+            fprintf( stderr, "Cannot open raw stream file!\n" );
+            return 1;
+        }
+    }
+
+    // The generator acts as a client. The server side is a regular Worker, connected over the
+    // loopback interface, so that the resulting trace goes through the normal ingestion path.
+    tracy::ListenSocket listen;
+    int port = 8086;
+    while( !listen.Listen( port, 1 ) )
+    {
+        if( ++port == 8086 + 64 )
+        {
+            fprintf( stderr, "Cannot open listen socket!\n" );
+            return 1;
+        }
+    }
+
+    printf( "Generating trace..." );
+    fflush( stdout );
+    tracy::Worker worker( "127.0.0.1", port, rawStreamFile );
+
+    tracy::Socket* sock = nullptr;
+    while( !sock ) sock = listen.Accept();
+
+    char shibboleth[tracy::HandshakeShibbolethSize];
+    uint32_t protocolVersion;
+    if( !sock->ReadRaw( shibboleth, tracy::HandshakeShibbolethSize, 2000 ) ||
+        memcmp( shibboleth, tracy::HandshakeShibboleth, tracy::HandshakeShibbolethSize ) != 0 ||
+        !sock->ReadRaw( &protocolVersion, sizeof( protocolVersion ), 2000 ) ||
+        protocolVersion != tracy::ProtocolVersion )
+    {
+        fprintf( stderr, "\nServer handshake failed!\n" );
+        return 1;
+    }
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    Generator gen( opt, *sock );
+    const auto ok = gen.Run();
+    sock->~Socket();
+    tracy::tracy_free( sock );
+    if( !ok )
+    {
+        fprintf( stderr, "\nConnection to the server was lost!\n" );
+        return 1;
+    }
+    while( worker.IsConnected() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    const auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+    printf( "\33[2K\r\nZones: %s\nEvents: %s (%s events/s)\nStream size: %s\nTrace time span: %s\nMemory usage: %s\n",
+        tracy::RealToString( worker.GetZoneCount() ), tracy::RealToString( gen.GetEventCount() ),
+        tracy::RealToString( uint64_t( gen.GetEventCount() / ( dt / 1e9 ) ) ), tracy::MemSizeToString( gen.GetStreamBytes() ),
+        tracy::TimeToString( worker.GetLastTime() ), tracy::MemSizeToString( tracy::memUsage ) );
+
+    printf( "Saving trace..." );
+    fflush( stdout );
+    auto f = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( output ) );
+    if( f )
+    {
+        worker.Write( *f );
+        printf( " \033[32;1mdone!\033[0m\n" );
+        f->Finish();
+        const auto stats = f->GetCompressionStatistics();
+        printf( "Trace size %s (%.2f%% ratio)\n", tracy::MemSizeToString( stats.second ), 100.f * stats.second / stats.first );
+    }
+    else
+    {
+        printf( " \033[31;1mfailed!\033[0m\n" );
+        return 1;
+    }
+
+    return 0;
+}
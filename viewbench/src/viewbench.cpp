@@ -0,0 +1,375 @@
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../imgui/imgui.h"
+#include "../../server/IconsFontAwesome5.h"
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyHistogram.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyTexture.hpp"
+#include "../../server/TracyView.hpp"
+#include "../../server/TracyWorker.hpp"
+
+#include "../../capture/src/getopt.h"
+#include "../../profiler/src/Arimo.hpp"
+#include "../../profiler/src/Cousine.hpp"
+#include "../../profiler/src/FontAwesomeSolid.hpp"
+
+// There is no renderer, so textures (frame images) are never uploaded.
+namespace tracy
+{
+void* MakeTexture() { return (void*)(intptr_t)1; }
+void FreeTexture( void* ) {}
+void UpdateTexture( void*, const char*, int, int ) {}
+}
+
+static const char* DefaultScript =
+    "zoom 0 100\n"
+    "run 60 timeline-100%\n"
+    "zoom 45 55\n"
+    "run 60 timeline-10%\n"
+    "zoom 49.5 50.5\n"
+    "run 60 timeline-1%\n"
+    "zoom 49.995 50.005\n"
+    "run 60 timeline-0.01%\n"
+    "zoom 0 1\n"
+    "pan 0.5\n"
+    "run 120 timeline-pan\n"
+    "pan 0\n"
+    "zoom 45 55\n"
+    "scroll 100000\n"
+    "run 60 timeline-scroll\n"
+    "scroll 0\n"
+    "open findzone\n"
+    "run 120 findzone\n"
+    "close findzone\n"
+    "open statistics\n"
+    "run 60 statistics\n"
+    "close statistics\n"
+    "open memory\n"
+    "run 60 memory\n"
+    "close memory\n"
+    "open messages\n"
+    "run 60 messages\n"
+    "close messages\n";
+
+struct WindowName
+{
+    const char* name;
+    tracy::View::ScriptWindow window;
+};
+
+static const WindowName Windows[] = {
+    { "messages", tracy::View::ScriptWindow::Messages },
+    { "findzone", tracy::View::ScriptWindow::FindZone },
+    { "statistics", tracy::View::ScriptWindow::Statistics },
+    { "memory", tracy::View::ScriptWindow::Memory },
+    { "info", tracy::View::ScriptWindow::Info },
+    { "slowzones", tracy::View::ScriptWindow::SlowZones },
+};
+
+struct Result
+{
+    std::string label;
+    std::vector<int64_t> times;
+    int64_t vertices;
+};
+
+void Usage()
+{
+    printf( "Usage: viewbench [-s script] [-w width] [-h height] input.tracy\n\n" );
+    printf( "  -s script: file with commands to execute, one per line (default script is used if not set)\n" );
+    printf( "  -w width, -h height: size of the virtual display (default 1920x1080)\n\n" );
+    printf( "Script commands:\n" );
+    printf( "  zoom start end  - set view range, in percent of trace time span\n" );
+    printf( "  pan percent     - move view range by percent of its width each frame (0 to stop)\n" );
+    printf( "  scroll pixels   - scroll timeline vertically\n" );
+    printf( "  open window     - open window (messages, findzone, statistics, memory, info, slowzones)\n" );
+    printf( "  close window    - close window\n" );
+    printf( "  run frames name - draw frames and report their times under given name\n" );
+    exit( 1 );
+}
+
+static bool FindWindow( const char* name, tracy::View::ScriptWindow& window )
+{
+    for( auto& v : Windows )
+    {
+        if( strcmp( v.name, name ) == 0 )
+        {
+            window = v.window;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    const char* scriptFile = nullptr;
+    int width = 1920;
+    int height = 1080;
+
+    int c;
+    while( ( c = getopt( argc, argv, "s:w:h:" ) ) != -1 )
+    {
+        switch( c )
+        {
+        case 's':
+            scriptFile = optarg;
+            break;
+        case 'w':
+            width = atoi( optarg );
+            break;
+        case 'h':
+            height = atoi( optarg );
+            break;
+        default:
+            Usage();
+            break;
+        }
+    }
+    if( optind != argc - 1 || width <= 0 || height <= 0 ) Usage();
+    const char* input = argv[optind];
+
+    std::string script = DefaultScript;
+    if( scriptFile )
+    {
+        FILE* f = fopen( scriptFile, "rb" );
+        if( !f )
+        {
+            fprintf( stderr, "Cannot open script file!\n" );
+            exit( 1 );
+        }
+        script.clear();
+        char buf[4096];
+        size_t sz;
+        while( ( sz = fread( buf, 1, sizeof( buf ), f ) ) > 0 ) script.append( buf, sz );
+        fclose( f );
+    }
+
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    ImGui::CreateContext();
+    auto& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+    io.DisplaySize = ImVec2( width, height );
+    io.DeltaTime = 1.f / 60.f;
+    io.MousePos = ImVec2( -FLT_MAX, -FLT_MAX );
+
+    static const ImWchar rangesBasic[] = {
+        0x0020, 0x00FF, // Basic Latin + Latin Supplement
+        0x03BC, 0x03BC, // micro
+        0x03C3, 0x03C3, // small sigma
+        0x2013, 0x2013, // en dash
+        0x2264, 0x2264, // less-than or equal to
+        0,
+    };
+    static const ImWchar rangesIcons[] = {
+        ICON_MIN_FA, ICON_MAX_FA,
+        0
+    };
+    ImFontConfig configMerge;
+    configMerge.MergeMode = true;
+
+    io.Fonts->AddFontFromMemoryCompressedTTF( tracy::Arimo_compressed_data, tracy::Arimo_compressed_size, 15.0f, nullptr, rangesBasic );
+    io.Fonts->AddFontFromMemoryCompressedTTF( tracy::FontAwesomeSolid_compressed_data, tracy::FontAwesomeSolid_compressed_size, 14.0f, &configMerge, rangesIcons );
+    auto fixedWidth = io.Fonts->AddFontFromMemoryCompressedTTF( tracy::Cousine_compressed_data, tracy::Cousine_compressed_size, 14.0f );
+    auto bigFont = io.Fonts->AddFontFromMemoryCompressedTTF( tracy::Arimo_compressed_data, tracy::Arimo_compressed_size, 20.0f );
+    auto smallFont = io.Fonts->AddFontFromMemoryCompressedTTF( tracy::Arimo_compressed_data, tracy::Arimo_compressed_size, 10.0f );
+
+    unsigned char* pixels;
+    int tw, th;
+    io.Fonts->GetTexDataAsRGBA32( &pixels, &tw, &th );
+
+    ImGui::StyleColorsDark();
+    auto& style = ImGui::GetStyle();
+    style.WindowBorderSize = 1.f;
+    style.FrameBorderSize = 1.f;
+    style.FrameRounding = 5.f;
+
+    std::vector<Result> results;
+    try
+    {
+        printf( "Loading...\r" );
+        fflush( stdout );
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        auto view = std::make_unique<tracy::View>( *f, fixedWidth, smallFont, bigFont );
+        auto& worker = view->GetWorker();
+        while( !worker.IsBackgroundDone() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        printf( "%s loaded in %s\n", input, tracy::TimeToString( std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count() ) );
+
+        view->ResetUserState();
+
+        const auto span = std::max<int64_t>( worker.GetLastTime(), 1 );
+        int64_t zvStart = 0;
+        int64_t zvEnd = span;
+        double pan = 0;
+
+        auto ptr = script.c_str();
+        int lineNum = 0;
+        while( *ptr )
+        {
+            auto end = ptr;
+            while( *end && *end != '\n' ) end++;
+            std::string line( ptr, end );
+            ptr = *end ? end+1 : end;
+            lineNum++;
+
+            const auto comment = line.find( '#' );
+            if( comment != std::string::npos ) line.resize( comment );
+
+            char cmd[64], arg[256];
+            double v0, v1;
+            int frames;
+            if( sscanf( line.c_str(), "%63s", cmd ) != 1 ) continue;
+            if( strcmp( cmd, "zoom" ) == 0 && sscanf( line.c_str(), "%*s %lf %lf", &v0, &v1 ) == 2 && v0 < v1 )
+            {
+                zvStart = int64_t( span * v0 / 100 );
+                zvEnd = std::max( zvStart + 1, int64_t( span * v1 / 100 ) );
+                view->SetViewRange( zvStart, zvEnd );
+            }
+            else if( strcmp( cmd, "pan" ) == 0 && sscanf( line.c_str(), "%*s %lf", &v0 ) == 1 )
+            {
+                pan = v0 / 100;
+            }
+            else if( strcmp( cmd, "scroll" ) == 0 && sscanf( line.c_str(), "%*s %lf", &v0 ) == 1 && v0 >= 0 )
+            {
+                view->SetTimelineScroll( float( v0 ) );
+            }
+            else if( ( strcmp( cmd, "open" ) == 0 || strcmp( cmd, "close" ) == 0 ) && sscanf( line.c_str(), "%*s %255s", arg ) == 1 )
+            {
+                tracy::View::ScriptWindow window;
+                if( !FindWindow( arg, window ) )
+                {
+                    fprintf( stderr, "Unknown window \"%s\" in script line %i.\n", arg, lineNum );
+                    exit( 1 );
+                }
+                const bool open = cmd[0] == 'o';
+                if( open && window == tracy::View::ScriptWindow::FindZone )
+                {
+                    // Search for the source location with the most zones.
+                    int16_t srcloc = 0;
+                    size_t cnt = 0;
+                    for( auto& v : worker.GetSourceLocationZones() )
+                    {
+                        if( v.second.zones.size() > cnt )
+                        {
+                            cnt = v.second.zones.size();
+                            srcloc = v.first;
+                        }
+                    }
+                    if( cnt != 0 ) view->ShowFindZone( srcloc );
+                }
+                view->ShowWindow( window, open );
+            }
+            else if( strcmp( cmd, "run" ) == 0 && sscanf( line.c_str(), "%*s %i %255s", &frames, arg ) == 2 && frames > 0 )
+            {
+                results.emplace_back( Result { arg, {}, 0 } );
+                auto& res = results.back();
+                auto& times = res.times;
+                times.reserve( frames );
+                for( int i=0; i<frames; i++ )
+                {
+                    if( pan != 0 )
+                    {
+                        const auto delta = std::max<int64_t>( 1, int64_t( ( zvEnd - zvStart ) * std::abs( pan ) ) );
+                        const auto len = zvEnd - zvStart;
+                        if( pan > 0 )
+                        {
+                            zvStart = std::min( zvStart + delta, span - len );
+                        }
+                        else
+                        {
+                            zvStart = std::max<int64_t>( zvStart - delta, 0 );
+                        }
+                        zvEnd = zvStart + len;
+                        view->SetViewRange( zvStart, zvEnd );
+                    }
+
+                    const auto f0 = std::chrono::high_resolution_clock::now();
+                    ImGui::NewFrame();
+                    view->NotifyRootWindowSize( width, height );
+                    view->Draw();
+                    ImGui::Render();
+                    const auto f1 = std::chrono::high_resolution_clock::now();
+                    times.emplace_back( std::chrono::duration_cast<std::chrono::nanoseconds>( f1 - f0 ).count() );
+                    res.vertices += ImGui::GetDrawData()->TotalVtxCount;
+                }
+            }
+            else
+            {
+                fprintf( stderr, "Invalid script line %i: %s\n", lineNum, line.c_str() );
+                exit( 1 );
+            }
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from the future version.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a tracy dump.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::LegacyVersion& e )
+    {
+        fprintf( stderr, "The file you are trying to open is from a legacy version.\n" );
+        exit( 1 );
+    }
+
+    ImGui::DestroyContext();
+
+    printf( "%-24s %8s %12s %12s %12s %12s %12s %10s\n", "name", "frames", "mean", "median", "p90", "p99", "max", "vertices" );
+    for( auto& res : results )
+    {
+        auto& times = res.times;
+        std::sort( times.begin(), times.end() );
+        int64_t total = 0;
+        for( auto& v : times ) total += v;
+        printf( "%-24s %8zu %12s %12s %12s %12s %12s %10s\n", res.label.c_str(), times.size(),
+            tracy::TimeToString( total / int64_t( times.size() ) ),
+            tracy::TimeToString( tracy::Percentile( times, 0.5 ) ),
+            tracy::TimeToString( tracy::Percentile( times, 0.9 ) ),
+            tracy::TimeToString( tracy::Percentile( times, 0.99 ) ),
+            tracy::TimeToString( times.back() ),
+            tracy::RealToString( res.vertices / int64_t( times.size() ) ) );
+    }
+
+    return 0;
+}